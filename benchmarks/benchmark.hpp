@@ -0,0 +1,373 @@
+/**
+ * A small microbenchmark harness.
+ *
+ * Every benchmark is calibrated to a number of iterations that runs for at least the minimum repetition time, warmed
+ * up, then measured over several repetitions. A repetition records the wall time, the CPU cycles and the heap
+ * allocations per iteration; the results report their distribution over the repetitions. Cycles are read from a
+ * perf_event_open hardware counter when the kernel allows it, from rdtsc otherwise.
+ *
+ * Allocations are counted by src/allocation_counter.hpp, which replaces malloc, so the harness must be included by
+ * exactly one translation unit of a benchmark executable. They are counted for the whole process and for each thread,
+ * so a benchmark can leave out the threads of an in-process server.
+ *
+ * Command line options:
+ *   --filter <text>       Only run benchmarks whose name contains the text
+ *   --repetitions <n>     Number of measured repetitions (default 10)
+ *   --min-time-ms <n>     Minimum duration of a repetition (default 20)
+ *   --json <path>         Write the results as JSON to the file instead of stdout
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../src/allocation_counter.hpp"
+
+namespace benchmark {
+
+  /**
+   * Keeps the compiler from optimizing away the computation of a value
+   */
+  template <typename T>
+  inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+  }
+
+  /**
+   * Keeps the compiler from optimizing away writes to memory
+   */
+  inline void clobber_memory() {
+    asm volatile("" : : : "memory");
+  }
+
+  /**
+   * Counts CPU cycles with a perf_event_open hardware counter, or with rdtsc where the counter is not available
+   */
+  class CycleCounter {
+    int _fd = -1;
+    uint64_t _start = 0;
+
+    uint64_t read_counter() {
+      if (_fd >= 0) {
+        uint64_t count = 0;
+        if (::read(_fd, &count, sizeof(count)) != sizeof(count)) {
+          return 0;
+        }
+        return count;
+      }
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#else
+      return 0;
+#endif
+    }
+
+  public:
+
+    CycleCounter() {
+      struct perf_event_attr attr = {};
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      _fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~CycleCounter() {
+      if (_fd >= 0) {
+        close(_fd);
+      }
+    }
+
+    CycleCounter(const CycleCounter&) = delete;
+    CycleCounter& operator=(const CycleCounter&) = delete;
+
+    /**
+     * Returns where the cycles come from: "perf_event", "rdtsc" or "none"
+     */
+    const char* source() const {
+      if (_fd >= 0) {
+        return "perf_event";
+      }
+#if defined(__x86_64__) || defined(__i386__)
+      return "rdtsc";
+#else
+      return "none";
+#endif
+    }
+
+    void start() {
+      _start = read_counter();
+    }
+
+    /**
+     * Returns the cycles since start()
+     */
+    uint64_t stop() {
+      return read_counter() - _start;
+    }
+  };
+
+  /**
+   * Distribution of a per-iteration measurement over the repetitions
+   */
+  struct Summary {
+    double min;
+    double median;
+    double mean;
+    double stddev;
+    double max;
+
+    static Summary of(std::vector<double> samples) {
+      Summary summary{};
+      if (samples.empty()) {
+        return summary;
+      }
+      std::sort(samples.begin(), samples.end());
+      size_t n = samples.size();
+      summary.min = samples.front();
+      summary.max = samples.back();
+      summary.median = n % 2 == 1 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+      for (double sample : samples) {
+        summary.mean += sample;
+      }
+      summary.mean /= n;
+      for (double sample : samples) {
+        summary.stddev += (sample - summary.mean) * (sample - summary.mean);
+      }
+      summary.stddev = n > 1 ? std::sqrt(summary.stddev / (n - 1)) : 0;
+      return summary;
+    }
+
+    std::string to_json() const {
+      char buffer[256];
+      snprintf(buffer, sizeof(buffer), "{\"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f, \"max\": %.3f}", min, median, mean, stddev, max);
+      return buffer;
+    }
+  };
+
+  /**
+   * Latency percentiles of individually timed operations, in nanoseconds
+   */
+  struct Percentiles {
+    size_t count;
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+    double mean;
+    double max;
+
+    /** The nearest-rank percentile of sorted samples */
+    static double percentile(const std::vector<double>& sorted, double p) {
+      size_t rank = (size_t)std::ceil(p / 100 * sorted.size());
+      return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+    }
+
+    static Percentiles of(std::vector<double> samples) {
+      Percentiles percentiles{};
+      if (samples.empty()) {
+        return percentiles;
+      }
+      std::sort(samples.begin(), samples.end());
+      percentiles.count = samples.size();
+      percentiles.p50 = percentile(samples, 50);
+      percentiles.p90 = percentile(samples, 90);
+      percentiles.p99 = percentile(samples, 99);
+      percentiles.p999 = percentile(samples, 99.9);
+      for (double sample : samples) {
+        percentiles.mean += sample;
+      }
+      percentiles.mean /= samples.size();
+      percentiles.max = samples.back();
+      return percentiles;
+    }
+
+    std::string to_json() const {
+      char buffer[256];
+      snprintf(buffer, sizeof(buffer), "{\"count\": %zu, \"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f, \"p99.9\": %.0f, \"mean\": %.0f, \"max\": %.0f}",
+        count, p50, p90, p99, p999, mean, max);
+      return buffer;
+    }
+  };
+
+  struct Result {
+    std::string name;
+    /** Iterations in every repetition */
+    uint64_t iterations;
+    /** Number of measured repetitions */
+    size_t repetitions;
+    Summary ns_per_op;
+    Summary cycles_per_op;
+    /** Heap allocations and allocated bytes per iteration, the lowest over the repetitions */
+    double allocations_per_op;
+    double bytes_per_op;
+  };
+
+  /**
+   * Runs benchmarks and reports their results as a table on stderr and as JSON
+   */
+  class Suite {
+    std::string _name;
+    std::string _filter;
+    std::string _json_path;
+    size_t _repetitions = 10;
+    std::chrono::nanoseconds _min_time = std::chrono::milliseconds(20);
+    CycleCounter _cycles;
+    std::vector<Result> _results;
+
+    struct Sample {
+      double ns;
+      double cycles;
+      double allocations;
+      double bytes;
+    };
+
+    template <typename F>
+    Sample measure(F& fn, uint64_t iterations) {
+      many::allocations::Counts before = many::allocations::process();
+      auto start = std::chrono::steady_clock::now();
+      _cycles.start();
+      for (uint64_t i = 0; i < iterations; i++) {
+        fn();
+      }
+      uint64_t cycles = _cycles.stop();
+      auto end = std::chrono::steady_clock::now();
+      many::allocations::Counts allocated = many::allocations::process() - before;
+      return {
+        (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / iterations,
+        (double)cycles / iterations,
+        (double)allocated.allocations / iterations,
+        (double)allocated.bytes / iterations,
+      };
+    }
+
+  public:
+
+    /**
+     * @param name The name of the suite, reported in the JSON output
+     * @param argc The number of command line arguments
+     * @param argv The command line arguments, see the options above
+     */
+    Suite(const std::string& name, int argc, char** argv)
+      : _name(name)
+    {
+      for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--filter") {
+          _filter = argv[i + 1];
+        } else if (option == "--repetitions") {
+          _repetitions = std::max(1, atoi(argv[i + 1]));
+        } else if (option == "--min-time-ms") {
+          _min_time = std::chrono::milliseconds(std::max(1, atoi(argv[i + 1])));
+        } else if (option == "--json") {
+          _json_path = argv[i + 1];
+        } else {
+          std::cerr << "Unknown option " << option << std::endl;
+        }
+      }
+    }
+
+    /**
+     * Calibrates, warms up and measures a benchmark, unless it is filtered out.
+     *
+     * @param name The name of the benchmark
+     * @param fn The operation to measure, called once per iteration
+     */
+    template <typename F>
+    void run(const std::string& name, F fn) {
+      if (!_filter.empty() && name.find(_filter) == std::string::npos) {
+        return;
+      }
+
+      // Double the iterations until a repetition takes the minimum time, which also warms up caches and branch predictors
+      uint64_t iterations = 1;
+      while (true) {
+        Sample sample = measure(fn, iterations);
+        double elapsed = sample.ns * iterations;
+        if (elapsed >= _min_time.count()) {
+          break;
+        }
+        uint64_t target = elapsed <= 0 ? iterations * 10 : (uint64_t)(iterations * _min_time.count() * 1.2 / elapsed);
+        iterations = std::max(iterations * 2, std::min(target, iterations * 100));
+      }
+
+      std::vector<double> ns, cycles;
+      double min_allocations = INFINITY, min_bytes = INFINITY;
+      for (size_t i = 0; i < _repetitions; i++) {
+        Sample sample = measure(fn, iterations);
+        ns.push_back(sample.ns);
+        cycles.push_back(sample.cycles);
+        min_allocations = std::min(min_allocations, sample.allocations);
+        min_bytes = std::min(min_bytes, sample.bytes);
+      }
+
+      Result result{name, iterations, _repetitions, Summary::of(ns), Summary::of(cycles), min_allocations, min_bytes};
+      fprintf(stderr, "%-40s %12.1f ns %10.1f ns %12.1f cycles %8.2f allocs %10.1f bytes %10llu iterations\n",
+        name.c_str(), result.ns_per_op.median, result.ns_per_op.stddev, result.cycles_per_op.median,
+        result.allocations_per_op, result.bytes_per_op, (unsigned long long)iterations);
+      _results.push_back(result);
+    }
+
+    const std::vector<Result>& results() const {
+      return _results;
+    }
+
+    /**
+     * Returns the results as JSON
+     */
+    std::string to_json() const {
+      std::string out = "{\n  \"suite\": \"" + _name + "\",\n";
+      out += "  \"cycle_source\": \"" + std::string(_cycles.source()) + "\",\n";
+      out += "  \"repetitions\": " + std::to_string(_repetitions) + ",\n";
+      out += "  \"benchmarks\": [";
+      for (size_t i = 0; i < _results.size(); i++) {
+        const Result& result = _results[i];
+        char buffer[128];
+        snprintf(buffer, sizeof(buffer), "\"allocations_per_op\": %.3f, \"bytes_per_op\": %.3f", result.allocations_per_op, result.bytes_per_op);
+        out += i == 0 ? "\n" : ",\n";
+        out += "    {\"name\": \"" + result.name + "\", \"iterations\": " + std::to_string(result.iterations)
+          + ", \"ns_per_op\": " + result.ns_per_op.to_json()
+          + ", \"cycles_per_op\": " + result.cycles_per_op.to_json()
+          + ", " + buffer + "}";
+      }
+      out += "\n  ]\n}\n";
+      return out;
+    }
+
+    /**
+     * Writes the JSON results to the --json file, or to stdout
+     *
+     * @return The process exit code
+     */
+    int report() const {
+      if (_json_path.empty()) {
+        std::cout << to_json();
+        return 0;
+      }
+      std::ofstream file(_json_path);
+      file << to_json();
+      return file.good() ? 0 : 1;
+    }
+  };
+
+} // namespace benchmark
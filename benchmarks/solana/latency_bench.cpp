@@ -0,0 +1,291 @@
+/**
+ * End-to-end latency of the kitchen_sink flow against the local mock server.
+ *
+ * Every iteration runs the flow of examples/solana/kitchen_sink.cpp: node information, slot and account subscriptions,
+ * account reads, an airdrop seen through the account subscription, and a signed transaction. Each operation is timed
+ * individually, the report gives its latency percentiles, its throughput and the heap allocations it made on the
+ * calling thread, so the mock server running in the same process is left out.
+ *
+ * Usage: latency_bench [options]
+ *   --iterations <n>      Number of measured iterations of the flow (default 200)
+ *   --warmup <n>          Number of iterations run before measuring (default 10)
+ *   --transport <name>    "oneshot" for a connection per request, the default, or "keepalive" for a kept-alive one
+ *   --arena               Decode account reads and transactions into the connection's arena
+ *   --tls                 Serve HTTPS and secure websockets with a self-signed certificate
+ *   --latency-us <n>      Latency the server adds to every response and notification
+ *   --jitter-us <n>       Random jitter added to the latency
+ *   --filter <text>       Only report operations whose name contains the text
+ *   --json <path>         Write the results as JSON to the file instead of stdout
+ */
+
+#include "../benchmark.hpp"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/mock_server.hpp"
+
+using namespace solana;
+
+struct Operation {
+  std::string name;
+  std::vector<double> ns;
+  uint64_t allocations = 0;
+  uint64_t allocated_bytes = 0;
+};
+
+/**
+ * Times the operations of the flow, in the order they first run
+ */
+class Recorder {
+  std::vector<Operation> _operations;
+  bool _measuring = false;
+
+  Operation& operation(const std::string& name) {
+    for (auto& operation : _operations) {
+      if (operation.name == name) {
+        return operation;
+      }
+    }
+    _operations.push_back({name, {}});
+    return _operations.back();
+  }
+
+public:
+
+  void start_measuring() {
+    _measuring = true;
+  }
+
+  /**
+   * Runs and times an operation, returning its result
+   */
+  template <typename F>
+  auto time(const std::string& name, F fn) -> decltype(fn()) {
+    many::allocations::Counts allocations = many::allocations::thread();
+    auto start = std::chrono::steady_clock::now();
+    struct Record {
+      Recorder& recorder;
+      const std::string& name;
+      many::allocations::Counts allocations;
+      std::chrono::steady_clock::time_point start;
+      ~Record() {
+        auto end = std::chrono::steady_clock::now();
+        if (recorder._measuring) {
+          Operation& operation = recorder.operation(name);
+          operation.ns.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+          many::allocations::Counts allocated = many::allocations::thread() - allocations;
+          operation.allocations += allocated.allocations;
+          operation.allocated_bytes += allocated.bytes;
+        }
+      }
+    } record{*this, name, allocations, start};
+    return fn();
+  }
+
+  const std::vector<Operation>& operations() const {
+    return _operations;
+  }
+};
+
+/** Polls the connection until the condition holds, fails after five seconds */
+template <typename F>
+void poll_until(Connection& connection, F condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      throw std::runtime_error("Timed out waiting on the mock server");
+    }
+    connection.poll();
+  }
+}
+
+/** Waits until the server has registered the number of subscriptions */
+void wait_for_subscriptions(mock::MockServer& server, Connection& connection, size_t subscriptions) {
+  poll_until(connection, [&]() { return server.subscriptions() == subscriptions; });
+}
+
+/**
+ * One iteration of the kitchen_sink flow
+ */
+void run_flow(mock::MockServer& server, Connection& connection, Recorder& recorder, bool arena) {
+  recorder.time("get_version", [&]() { return connection.get_version().unwrap(); });
+  recorder.time("get_identity", [&]() { return connection.get_identity().unwrap(); });
+  uint64_t slot = recorder.time("get_slot", [&]() { return connection.get_slot().unwrap(); });
+  benchmark::do_not_optimize(slot);
+
+  uint64_t new_slot = 0;
+  int slot_subscription = recorder.time("on_slot_change", [&]() {
+    int id = connection.on_slot_change([&](Result<SlotInfo> result) { new_slot = result.unwrap().slot; });
+    wait_for_subscriptions(server, connection, 1);
+    return id;
+  });
+
+  PublicKey leader = recorder.time("get_slot_leader", [&]() { return connection.get_slot_leader().unwrap(); });
+  recorder.time("get_leader_schedule", [&]() { return connection.get_leader_schedule(leader).unwrap(); });
+  recorder.time("get_cluster_nodes", [&]() { return connection.get_cluster_nodes().unwrap(); });
+  recorder.time("get_latest_blockhash", [&]() { return connection.get_latest_blockhash().unwrap(); });
+  recorder.time("get_token_supply", [&]() { return connection.get_token_supply(NATIVE_MINT).unwrap(); });
+
+  Keypair keypair = recorder.time("Keypair::generate", []() { return Keypair::generate(); });
+  uint64_t notified_lamports = 0;
+  int account_subscription = recorder.time("on_account_change", [&]() {
+    int id = connection.on_account_change(keypair.public_key, [&](Result<Account> result) {
+      notified_lamports = result.unwrap().lamports;
+    });
+    wait_for_subscriptions(server, connection, 2);
+    return id;
+  });
+
+  std::string airdrop = recorder.time("request_airdrop", [&]() { return connection.request_airdrop(keypair.public_key).unwrap(); });
+  // The server pushes the change before it answers the airdrop, so this is the time to poll and dispatch it
+  recorder.time("account_notification", [&]() {
+    poll_until(connection, [&]() { return notified_lamports > 0; });
+    return notified_lamports;
+  });
+  recorder.time("get_balance", [&]() { return connection.get_balance(keypair.public_key).unwrap(); });
+  if (arena) {
+    recorder.time("get_account_info", [&]() {
+      uint64_t lamports = connection.get_account_info(keypair.public_key, connection.arena()).unwrap().lamports;
+      connection.arena().reset();
+      return lamports;
+    });
+    recorder.time("get_transaction", [&]() {
+      uint64_t slot = connection.get_transaction(airdrop, connection.arena()).unwrap().slot;
+      connection.arena().reset();
+      return slot;
+    });
+  } else {
+    recorder.time("get_account_info", [&]() { return connection.get_account_info(keypair.public_key).unwrap(); });
+    recorder.time("get_transaction", [&]() { return connection.get_transaction(airdrop).unwrap(); });
+  }
+  recorder.time("get_token_accounts_by_owner", [&]() { return connection.get_token_accounts_by_owner(keypair.public_key).unwrap(); });
+
+  std::string signature = recorder.time("sign_and_send_transaction", [&]() {
+    Transaction transaction;
+    transaction.add(compute_budget::set_compute_unit_price_instruction(1000));
+    return connection.sign_and_send_transaction(transaction, {keypair}).unwrap();
+  });
+  recorder.time("get_signature_statuses", [&]() { return connection.get_signature_statuses({signature}).unwrap(); });
+
+  connection.remove_account_listener(account_subscription);
+  connection.remove_slot_change_listener(slot_subscription);
+  wait_for_subscriptions(server, connection, 0);
+  benchmark::do_not_optimize(new_slot);
+}
+
+int main(int argc, char** argv) {
+  size_t iterations = 200;
+  size_t warmup = 10;
+  std::string transport = "oneshot";
+  bool arena = false;
+  bool tls = false;
+  std::string filter;
+  std::string json_path;
+  mock::MockServer::Config config;
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+    bool has_value = i + 1 < argc;
+    if (option == "--iterations" && has_value) {
+      iterations = std::max(1, atoi(argv[++i]));
+    } else if (option == "--warmup" && has_value) {
+      warmup = std::max(0, atoi(argv[++i]));
+    } else if (option == "--transport" && has_value) {
+      transport = argv[++i];
+    } else if (option == "--arena") {
+      arena = true;
+    } else if (option == "--tls") {
+      tls = true;
+    } else if (option == "--latency-us" && has_value) {
+      config.faults.latency = std::chrono::microseconds(atoi(argv[++i]));
+    } else if (option == "--jitter-us" && has_value) {
+      config.faults.jitter = std::chrono::microseconds(atoi(argv[++i]));
+    } else if (option == "--filter" && has_value) {
+      filter = argv[++i];
+    } else if (option == "--json" && has_value) {
+      json_path = argv[++i];
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--iterations <n>] [--warmup <n>] [--transport oneshot|keepalive] [--arena] [--tls]"
+        << " [--latency-us <n>] [--jitter-us <n>] [--filter <text>] [--json <path>]" << std::endl;
+      return 1;
+    }
+  }
+  if (transport != "oneshot" && transport != "keepalive") {
+    std::cerr << "Unknown transport " << transport << std::endl;
+    return 1;
+  }
+
+  std::string certificate = "/tmp/latency_bench_" + std::to_string(getpid()) + ".crt";
+  std::string key = "/tmp/latency_bench_" + std::to_string(getpid()) + ".key";
+  if (tls) {
+    mock::MockServer::generate_certificate(certificate, key);
+    config.certificate_file = certificate;
+    config.private_key_file = key;
+  }
+  mock::MockServer server(config);
+  Connection connection(server.endpoint(), Commitment::Processed);
+  if (transport == "keepalive") {
+    connection.keep_alive();
+  }
+
+  Recorder recorder;
+  for (size_t i = 0; i < warmup; i++) {
+    run_flow(server, connection, recorder, arena);
+  }
+  recorder.start_measuring();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    run_flow(server, connection, recorder, arena);
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (tls) {
+    unlink(certificate.c_str());
+    unlink(key.c_str());
+  }
+
+  fprintf(stderr, "%s%s, %s, latency %lld us, jitter %lld us: %zu iterations in %.3f s, %.1f flows/s\n",
+    transport.c_str(), arena ? " with arena" : "", tls ? "tls" : "plain", (long long)config.faults.latency.count(), (long long)config.faults.jitter.count(),
+    iterations, elapsed, iterations / elapsed);
+  fprintf(stderr, "%-28s %10s %10s %10s %10s %10s %10s %8s %10s\n",
+    "operation", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us", "ops/s", "allocs", "bytes");
+
+  std::string out = "{\n  \"suite\": \"latency_bench\",\n";
+  out += "  \"transport\": \"" + transport + "\",\n";
+  out += "  \"arena\": " + std::string(arena ? "true" : "false") + ",\n";
+  out += "  \"tls\": " + std::string(tls ? "true" : "false") + ",\n";
+  out += "  \"latency_us\": " + std::to_string(config.faults.latency.count()) + ",\n";
+  out += "  \"jitter_us\": " + std::to_string(config.faults.jitter.count()) + ",\n";
+  out += "  \"iterations\": " + std::to_string(iterations) + ",\n";
+  out += "  \"flows_per_second\": " + std::to_string(iterations / elapsed) + ",\n";
+  out += "  \"operations\": [";
+  bool first = true;
+  for (auto& operation : recorder.operations()) {
+    if (!filter.empty() && operation.name.find(filter) == std::string::npos) {
+      continue;
+    }
+    auto percentiles = benchmark::Percentiles::of(operation.ns);
+    double per_second = percentiles.mean > 0 ? 1e9 / percentiles.mean : 0;
+    double allocations = (double)operation.allocations / percentiles.count;
+    double allocated_bytes = (double)operation.allocated_bytes / percentiles.count;
+    fprintf(stderr, "%-28s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %8.1f %10.1f\n", operation.name.c_str(),
+      percentiles.p50 / 1e3, percentiles.p90 / 1e3, percentiles.p99 / 1e3, percentiles.p999 / 1e3, percentiles.max / 1e3,
+      per_second, allocations, allocated_bytes);
+
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "\"ops_per_second\": %.1f, \"allocations_per_op\": %.1f, \"bytes_per_op\": %.1f",
+      per_second, allocations, allocated_bytes);
+    out += first ? "\n" : ",\n";
+    out += "    {\"name\": \"" + operation.name + "\", \"ns\": " + percentiles.to_json() + ", " + buffer + "}";
+    first = false;
+  }
+  out += "\n  ]\n}\n";
+
+  if (json_path.empty()) {
+    std::cout << out;
+    return 0;
+  }
+  std::ofstream file(json_path);
+  file << out;
+  return file.good() ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+/**
+ * TLB pressure and first-touch page faults of buffers mapped with memory::PageOptions.
+ *
+ * For each mapping, from the heap to prefaulted huge pages, the benchmark measures:
+ *   - the time and page faults of mapping the buffer, which is where prefaulting moves the faults to
+ *   - the time and page faults of the first pass over it, the first burst after startup
+ *   - a random pointer chase over the whole buffer, in ns per access and, where the kernel allows perf events for the
+ *     process, data TLB misses per access
+ *
+ * Usage: pages [options]
+ *   --size-mb <n>         Size of the buffer, much larger than the TLB reach of base pages (default 512)
+ *   --accesses <n>        Number of dependent loads of the pointer chase (default 20000000)
+ *   --json <path>         Write the results as JSON to the file instead of stdout
+ */
+
+#include "../benchmark.hpp"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+#include <linux/perf_event.h>
+#include <random>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+using namespace solana;
+
+/**
+ * Counts the data TLB load misses of the calling thread, if the kernel lets the process open the event
+ */
+class TlbMisses {
+  int _fd = -1;
+
+public:
+
+  TlbMisses() {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    _fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+
+  ~TlbMisses() {
+    if (_fd != -1) {
+      close(_fd);
+    }
+  }
+
+  bool is_available() const {
+    return _fd != -1;
+  }
+
+  void start() {
+    if (_fd != -1) {
+      ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  /** Returns the misses since start(), or -1 without the event */
+  int64_t stop() {
+    int64_t count = -1;
+    if (_fd != -1) {
+      ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (::read(_fd, &count, sizeof(count)) != sizeof(count)) {
+        count = -1;
+      }
+    }
+    return count;
+  }
+};
+
+/** Returns the page faults the process has taken so far */
+uint64_t page_faults() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (uint64_t)(usage.ru_minflt + usage.ru_majflt);
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+const char* backing_name(memory::Pages::Backing backing) {
+  switch (backing) {
+    case memory::Pages::HEAP: return "heap";
+    case memory::Pages::PAGES: return "pages";
+    case memory::Pages::TRANSPARENT_HUGE_PAGES: return "transparent_huge_pages";
+    case memory::Pages::HUGETLB: return "hugetlb";
+  }
+  return "unknown";
+}
+
+struct Measurement {
+  std::string name;
+  std::string backing;
+  double map_ms;
+  uint64_t map_faults;
+  double first_pass_ms;
+  uint64_t first_pass_faults;
+  double ns_per_access;
+  double tlb_misses_per_access;
+};
+
+int main(int argc, char** argv) {
+  size_t size_mb = 512;
+  size_t accesses = 20000000;
+  std::string json_path;
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+    bool has_value = i + 1 < argc;
+    if (option == "--size-mb" && has_value) {
+      size_mb = std::max(1, atoi(argv[++i]));
+    } else if (option == "--accesses" && has_value) {
+      accesses = std::max(1, atoi(argv[++i]));
+    } else if (option == "--json" && has_value) {
+      json_path = argv[++i];
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--size-mb <n>] [--accesses <n>] [--json <path>]" << std::endl;
+      return 1;
+    }
+  }
+  size_t size = size_mb * 1024 * 1024;
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+  // A random cycle through the cache lines of the buffer, the same for every mapping
+  static constexpr size_t LINE = 64;
+  size_t lines = size / LINE;
+  std::vector<uint32_t> order(lines);
+  for (size_t i = 0; i < lines; i++) {
+    order[i] = (uint32_t)i;
+  }
+  std::shuffle(order.begin() + 1, order.end(), std::mt19937_64(42));
+
+  std::vector<std::pair<std::string, memory::PageOptions>> mappings = {
+    {"heap", {}},
+    {"pages_prefaulted", {false, true, false}},
+    {"huge_pages", {true, false, false}},
+    {"huge_pages_prefaulted", {true, true, false}},
+  };
+  TlbMisses tlb;
+  std::vector<Measurement> measurements;
+  for (auto& mapping : mappings) {
+    Measurement measurement;
+    measurement.name = mapping.first;
+
+    uint64_t faults = page_faults();
+    auto start = std::chrono::steady_clock::now();
+    memory::Pages pages(size, mapping.second);
+    measurement.map_ms = seconds_since(start) * 1e3;
+    measurement.map_faults = page_faults() - faults;
+    measurement.backing = backing_name(pages.backing());
+
+    // The first pass writes the chain, touching every page once
+    faults = page_faults();
+    start = std::chrono::steady_clock::now();
+    char* data = pages.data();
+    for (size_t i = 0; i < lines; i++) {
+      uint64_t next = order[(i + 1) % lines];
+      memcpy(&data[(size_t)order[i] * LINE], &next, sizeof(next));
+    }
+    measurement.first_pass_ms = seconds_since(start) * 1e3;
+    measurement.first_pass_faults = page_faults() - faults;
+
+    uint64_t line = order[0];
+    tlb.start();
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < accesses; i++) {
+      memcpy(&line, &data[line * LINE], sizeof(line));
+    }
+    double elapsed = seconds_since(start);
+    int64_t misses = tlb.stop();
+    benchmark::do_not_optimize(line);
+    measurement.ns_per_access = elapsed * 1e9 / accesses;
+    measurement.tlb_misses_per_access = misses < 0 ? -1 : (double)misses / accesses;
+    measurements.push_back(measurement);
+  }
+
+  fprintf(stderr, "%zu MB, %zu accesses, %zu byte base pages, data TLB misses %s\n", size_mb, accesses, page_size,
+    tlb.is_available() ? "counted" : "unavailable (perf_event_paranoid)");
+  fprintf(stderr, "%-24s %-24s %10s %12s %14s %12s %10s %12s\n",
+    "mapping", "backing", "map ms", "map faults", "first pass ms", "pass faults", "ns/access", "tlb/access");
+  std::string out = "{\n  \"suite\": \"pages\",\n";
+  out += "  \"size_mb\": " + std::to_string(size_mb) + ",\n";
+  out += "  \"accesses\": " + std::to_string(accesses) + ",\n";
+  out += "  \"mappings\": [";
+  for (size_t i = 0; i < measurements.size(); i++) {
+    auto& m = measurements[i];
+    fprintf(stderr, "%-24s %-24s %10.1f %12llu %14.1f %12llu %10.2f %12s\n", m.name.c_str(), m.backing.c_str(),
+      m.map_ms, (unsigned long long)m.map_faults, m.first_pass_ms, (unsigned long long)m.first_pass_faults,
+      m.ns_per_access, m.tlb_misses_per_access < 0 ? "n/a" : std::to_string(m.tlb_misses_per_access).c_str());
+
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer), "{\"name\": \"%s\", \"backing\": \"%s\", \"map_ms\": %.3f, \"map_faults\": %llu, "
+      "\"first_pass_ms\": %.3f, \"first_pass_faults\": %llu, \"ns_per_access\": %.3f, \"tlb_misses_per_access\": %s}",
+      m.name.c_str(), m.backing.c_str(), m.map_ms, (unsigned long long)m.map_faults, m.first_pass_ms,
+      (unsigned long long)m.first_pass_faults, m.ns_per_access,
+      m.tlb_misses_per_access < 0 ? "null" : std::to_string(m.tlb_misses_per_access).c_str());
+    out += i == 0 ? "\n    " : ",\n    ";
+    out += buffer;
+  }
+  out += "\n  ]\n}\n";
+
+  if (json_path.empty()) {
+    std::cout << out;
+    return 0;
+  }
+  std::ofstream file(json_path);
+  file << out;
+  return file.good() ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+#include "../benchmark.hpp"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+/** An unmasked server-to-client websocket text frame */
+std::string text_frame(const std::string& payload) {
+  std::string frame;
+  frame.push_back((char)0x81);
+  if (payload.size() <= 125) {
+    frame.push_back((char)payload.size());
+  } else if (payload.size() <= 65535) {
+    frame.push_back((char)126);
+    frame.push_back((char)(payload.size() >> 8));
+    frame.push_back((char)(payload.size() & 0xff));
+  } else {
+    frame.push_back((char)127);
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      frame.push_back((char)((payload.size() >> shift) & 0xff));
+    }
+  }
+  return frame + payload;
+}
+
+int main(int argc, char** argv) {
+  benchmark::Suite suite("primitives", argc, argv);
+
+  auto payer = Keypair::generate();
+  PublicKey public_key = payer.public_key;
+  std::string public_key_base58 = public_key.to_base58();
+
+  suite.run("base58::b58enc/32", [&]() {
+    char b58[64];
+    size_t size = sizeof(b58);
+    base58::b58enc(b58, &size, public_key.bytes.data(), PUBLIC_KEY_LENGTH);
+    benchmark::do_not_optimize(b58);
+  });
+
+  suite.run("base58::b58tobin/32", [&]() {
+    uint8_t bin[PUBLIC_KEY_LENGTH];
+    size_t size = sizeof(bin);
+    base58::b58tobin(bin, &size, public_key_base58.c_str(), public_key_base58.size());
+    benchmark::do_not_optimize(bin);
+  });
+
+  std::vector<uint8_t> account_data(165);
+  for (size_t i = 0; i < account_data.size(); i++) {
+    account_data[i] = (uint8_t)(i * 31);
+  }
+  std::string account_data_base64 = base64::encode(account_data);
+
+  suite.run("base64::encode/165", [&]() {
+    benchmark::do_not_optimize(base64::encode(account_data));
+  });
+
+  suite.run("base64::decode/165", [&]() {
+    benchmark::do_not_optimize(base64::decode(account_data_base64));
+  });
+
+  std::vector<uint8_t> decoded;
+  suite.run("base64::decode/165_reused", [&]() {
+    benchmark::do_not_optimize(base64::decode(account_data_base64, decoded));
+  });
+
+  suite.run("PublicKey::find_program_address", [&]() {
+    benchmark::do_not_optimize(PublicKey::find_program_address({
+      public_key.to_buffer(),
+      TOKEN_PROGRAM_ID.to_buffer(),
+    }, ASSOCIATED_TOKEN_PROGRAM_ID));
+  });
+
+  Transaction transaction;
+  transaction.message.recent_blockhash = PublicKey("EkSnNWid2cvwEVnVx9aBqawnmiCNiDgp3gUdkDPTKN1N");
+  transaction.add(compute_budget::set_compute_unit_limit_instruction(200000));
+  transaction.add(compute_budget::set_compute_unit_price_instruction(1000));
+  for (int i = 0; i < 3; i++) {
+    transaction.add({
+      .program_id = TOKEN_PROGRAM_ID,
+      .accounts = {
+        {Keypair::generate().public_key, false, true},
+        {Keypair::generate().public_key, false, true},
+        {payer.public_key, true, false},
+      },
+      .data = {3, 0, 0, 0, 0, 0, 0, 0, 0},
+    });
+  }
+
+  suite.run("Transaction::Message::compile", [&]() {
+    benchmark::do_not_optimize(transaction.message.compile({payer}));
+  });
+
+  CompiledTransaction compiled = {
+    .message = transaction.message.compile({payer}),
+    .signatures = {},
+  };
+  std::vector<uint8_t> serialized_message;
+  compiled.message.serialize(serialized_message);
+  compiled.sign(serialized_message, {payer});
+
+  suite.run("CompiledTransaction::serialize", [&]() {
+    benchmark::do_not_optimize(compiled.serialize(serialized_message));
+  });
+
+  suite.run("Keypair::sign", [&]() {
+    benchmark::do_not_optimize(payer.sign(serialized_message));
+  });
+
+  json account_response = {
+    {"jsonrpc", "2.0"},
+    {"id", 1},
+    {"result", {
+      {"context", {{"slot", 250000000}}},
+      {"value", {
+        {"lamports", 2039280},
+        {"owner", TOKEN_PROGRAM_ID.to_base58()},
+        {"data", {account_data_base64, "base64"}},
+        {"executable", false},
+        {"rentEpoch", 361},
+      }},
+    }},
+  };
+
+  suite.run("from_json<Result<Account>>", [&]() {
+    benchmark::do_not_optimize(account_response.get<Result<Account>>());
+  });
+
+  // Notifications are dispatched by subscription, so the frames parse fully but reach no callback
+  websockets::WebSocketClient client("ws://127.0.0.1:8900");
+  std::string small_frame = text_frame(json{
+    {"jsonrpc", "2.0"},
+    {"method", "slotNotification"},
+    {"params", {{"result", {{"parent", 249999999}, {"root", 249999968}, {"slot", 250000000}}}, {"subscription", 1}}},
+  }.dump());
+  std::string account_frame = text_frame(json{
+    {"jsonrpc", "2.0"},
+    {"method", "accountNotification"},
+    {"params", {{"result", account_response["result"]}, {"subscription", 2}}},
+  }.dump());
+
+  suite.run("WebSocketClient::receive/slot", [&]() {
+    client.receive(small_frame.data(), (int)small_frame.size());
+  });
+
+  suite.run("WebSocketClient::receive/account", [&]() {
+    client.receive(account_frame.data(), (int)account_frame.size());
+  });
+
+  // A frame split across reads is reassembled before parsing
+  suite.run("WebSocketClient::receive/account_split", [&]() {
+    size_t half = account_frame.size() / 2;
+    client.receive(account_frame.data(), (int)half);
+    client.receive(account_frame.data() + half, (int)(account_frame.size() - half));
+  });
+
+  return suite.report();
+}
@@ -0,0 +1,117 @@
+/**
+ * Replays a websocket capture recorded with WebSocketClient::record through poll() and the notification dispatch,
+ * decoding every notification into the result type of its subscription.
+ *
+ * Usage: replay --capture <path> [--speed <n>] [suite options]
+ *
+ * Without --speed, or with 0, the capture is replayed as fast as possible as a benchmark, one iteration per replay of
+ * the whole capture. With a speed, it is replayed once at that many times the recorded speed, for profiling.
+ */
+
+#include "../benchmark.hpp"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+/** Returns a callback decoding the notifications of a subscription method the way Connection does */
+std::function<void(json)> decoder(const std::string& method, uint64_t& notifications) {
+  if (method == "accountSubscribe") {
+    return [&notifications](const json& j) { benchmark::do_not_optimize(Result<Account>(j)); notifications++; };
+  } else if (method == "programSubscribe") {
+    return [&notifications](const json& j) { benchmark::do_not_optimize(Result<AccountInfo>(j)); notifications++; };
+  } else if (method == "slotSubscribe") {
+    return [&notifications](const json& j) { benchmark::do_not_optimize(Result<SlotInfo>(j)); notifications++; };
+  } else if (method == "rootSubscribe") {
+    return [&notifications](const json& j) { benchmark::do_not_optimize(Result<uint64_t>(j)); notifications++; };
+  } else if (method == "signatureSubscribe") {
+    return [&notifications](const json& j) { benchmark::do_not_optimize(Result<SignatureStatus>(j)); notifications++; };
+  } else if (method == "logsSubscribe") {
+    return [&notifications](const json& j) { benchmark::do_not_optimize(Result<Logs>(j)); notifications++; };
+  }
+  return [&notifications](const json&) { notifications++; };
+}
+
+int main(int argc, char** argv) {
+  // --capture and --speed are ours, the other options are the suite's
+  std::string path;
+  double speed = 0;
+  std::vector<char*> args = {argv[0]};
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+    if (option == "--capture" && i + 1 < argc) {
+      path = argv[++i];
+    } else if (option == "--speed" && i + 1 < argc) {
+      speed = atof(argv[++i]);
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  if (path.empty()) {
+    std::cerr << "Usage: " << argv[0] << " --capture <path> [--speed <n>] [--filter <text>] [--repetitions <n>] [--min-time-ms <n>] [--json <path>]" << std::endl;
+    return 1;
+  }
+
+  // The subscribe requests are replayed as recorded, so the subscription ids line up with the recorded responses
+  std::vector<json> subscriptions;
+  size_t reads = 0;
+  uint64_t bytes = 0;
+  int64_t first = 0, last = 0;
+  // Loaded once, so the replays do not read the file
+  auto capture = websockets::capture::load(path);
+  {
+    websockets::capture::Reader reader(capture);
+    websockets::capture::Record record;
+    while (reader.next(record)) {
+      if (record.type == websockets::capture::SUBSCRIBED) {
+        subscriptions.push_back(json::parse(record.data));
+      } else {
+        first = first == 0 ? record.timestamp : first;
+        last = record.timestamp;
+        reads++;
+        bytes += record.data.size();
+      }
+    }
+  }
+
+  websockets::WebSocketClient client("ws://127.0.0.1:1");
+  uint64_t notifications = 0;
+  auto replay = [&](double speed, bool decode) {
+    client.replay(capture, speed);
+    for (auto& request : subscriptions) {
+      std::string method = request["method"];
+      client.subscribe(method, request.contains("params") ? request["params"] : json(), decode
+        ? decoder(method, notifications)
+        : [&notifications](const json&) { notifications++; });
+    }
+    while (client.is_replaying()) {
+      client.poll();
+    }
+  };
+
+  replay(0, true);
+  uint64_t per_replay = notifications;
+  fprintf(stderr, "%s: %zu subscriptions, %zu reads, %llu bytes, %llu notifications over %.3f s\n", path.c_str(),
+    subscriptions.size(), reads, (unsigned long long)bytes, (unsigned long long)per_replay, (last - first) / 1e9);
+
+  if (speed > 0) {
+    notifications = 0;
+    auto start = std::chrono::steady_clock::now();
+    replay(speed, true);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "replayed %llu notifications at %.2fx in %.3f s\n", (unsigned long long)notifications, speed, elapsed);
+    return 0;
+  }
+
+  benchmark::Suite suite("replay", (int)args.size(), args.data());
+  suite.run("replay/dispatch", [&]() { replay(0, false); });
+  suite.run("replay/dispatch_and_decode", [&]() { replay(0, true); });
+  for (auto& result : suite.results()) {
+    fprintf(stderr, "%-40s %12.1f ns per notification\n", result.name.c_str(), result.ns_per_op.median / std::max<uint64_t>(per_replay, 1));
+  }
+  return suite.report();
+}
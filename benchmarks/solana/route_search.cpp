@@ -0,0 +1,55 @@
+#include <random>
+
+#include "../benchmark.hpp"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+const size_t MINT_COUNT = 200;
+const size_t POOL_COUNT = 5000;
+
+PublicKey key(uint64_t n) {
+  uint8_t bytes[PUBLIC_KEY_LENGTH] = {};
+  memcpy(bytes, &n, sizeof(n));
+  return PublicKey(bytes);
+}
+
+int main(int argc, char** argv) {
+  benchmark::Suite suite("route_search", argc, argv);
+  std::mt19937_64 random(42);
+  threading::ThreadPool threads;
+  amm::Router router(threads);
+
+  // Most pools pair with a few hub mints, like real liquidity
+  for (size_t i = 0; i < POOL_COUNT; i++) {
+    uint64_t a = random() % 8;
+    uint64_t b = random() % MINT_COUNT;
+    if (a == b) {
+      b = (b + 1) % MINT_COUNT;
+    }
+    amm::ConstantProductPool pool;
+    pool.token_a_mint = key(a);
+    pool.token_b_mint = key(b);
+    pool.token_a_vault = key(1000000 + i);
+    pool.token_b_vault = key(2000000 + i);
+    pool.fees = { 25, 10000, 5, 10000 };
+    pool.reserve_a = 1000000000 + random() % 1000000000000;
+    pool.reserve_b = 1000000000 + random() % 1000000000000;
+    router.add_pool(key(3000000 + i), pool);
+  }
+
+  std::cerr << "pools = " << router.pool_count() << ", mints = " << router.mint_count() << ", threads = " << threads.size() << std::endl;
+
+  suite.run("Router::search", [&]() {
+    PublicKey input = key(random() % 8);
+    PublicKey output = key(random() % MINT_COUNT);
+    benchmark::do_not_optimize(router.search(input, output, 1000000, 5, 3, std::chrono::milliseconds(5)));
+  });
+
+  return suite.report();
+}
@@ -0,0 +1,53 @@
+#include <fstream>
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+void print_stage(const std::string& name, const TransactionBackfill::StageStats& stats) {
+  std::cout << name << ": " << stats.items << " items in " << stats.requests << " requests, "
+    << stats.errors << " errors, mean latency " << std::chrono::duration_cast<std::chrono::microseconds>(stats.mean_latency()).count() << "us"
+    << ", max latency " << std::chrono::duration_cast<std::chrono::microseconds>(stats.max_latency).count() << "us"
+    << ", " << stats.throughput() << " items/s" << std::endl;
+}
+
+int main() {
+  Connection connection(cluster_api_url(Cluster::MainnetBeta), Commitment::Confirmed);
+
+  std::string address;
+  std::cout << "Enter address: ";
+  std::cin >> address;
+
+  int64_t hours;
+  std::cout << "Enter hours of history: ";
+  std::cin >> hours;
+
+  int64_t end_time = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  int64_t start_time = end_time - hours * 3600;
+
+  threading::ThreadPool pool(4);
+  TransactionBackfill backfill(connection, pool, 8, 16, 1024);
+
+  std::ofstream out(address + ".jsonl");
+  auto write = TransactionBackfill::write_to(out);
+  size_t failed = 0;
+  size_t count = backfill.run(PublicKey(address), start_time, end_time, [&](const TransactionBackfill::Item& item) {
+    if (!item.transaction.ok()) {
+      failed++;
+    }
+    write(item);
+  });
+
+  std::cout << "wrote " << count << " transactions to " << address << ".jsonl, " << failed << " failed" << std::endl;
+  auto stats = backfill.stats();
+  print_stage("signatures", stats.signatures);
+  print_stage("fetch", stats.fetch);
+  print_stage("decode", stats.decode);
+  print_stage("emit", stats.emit);
+
+  return 0;
+}
@@ -37,8 +37,8 @@ int main() {
     // Verify that the account was created
     Result<Account> result = connection.get_account_info(associated_token_account);
 
-    if (result.result) { //TODO I don't like this syntax
-      Account& account = result.result.value(); //TODO I don't like this syntax
+    if (result.ok()) {
+      Account account = result.unwrap();
       std::cout << "owner = " << account.owner.to_base58() << std::endl;
       std::cout << "lamports = " << account.lamports << std::endl;
       std::cout << "data = " << account.data << std::endl;
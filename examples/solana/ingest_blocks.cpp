@@ -0,0 +1,40 @@
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+int main() {
+  Connection connection(cluster_api_url(Cluster::MainnetBeta), Commitment::Finalized);
+
+  std::string program_id;
+  std::cout << "Enter program id: ";
+  std::cin >> program_id;
+
+  threading::ThreadPool pool(4);
+  BlockFetcher fetcher(connection, pool, {PublicKey(program_id)}, Commitment::Finalized, 4);
+  fetcher.subscribe_roots(connection);
+
+  while (true) {
+    connection.poll();
+    fetcher.poll([](const std::shared_ptr<const BlockFetcher::Block>& block) {
+      if (block->skipped) {
+        std::cout << block->slot << " skipped" << std::endl;
+        return;
+      }
+      if (!block->error.empty()) {
+        std::cout << block->slot << " failed: " << block->error << std::endl;
+        return;
+      }
+      std::cout << block->slot << ": " << block->transactions.size() << " of " << block->num_transactions << " transactions" << std::endl;
+      for (auto& transaction : block->transactions) {
+        std::cout << "  " << transaction.view.signature() << " fee = " << (*transaction.meta)["fee"] << std::endl;
+      }
+    });
+    usleep(10000);
+  }
+
+  return 0;
+}
@@ -50,7 +50,7 @@ int main() {
   // Create slot change subscription
   std::cout << "Creating slot change subscription...";
   uint64_t new_slot;
-  int slot_subscription_id = connection.on_slot_change([&](Result<SlotInfo> result) {
+  connection.on_slot_change([&](Result<SlotInfo> result) {
     SlotInfo slot_info = result.unwrap();
     new_slot = slot_info.slot;
   });
@@ -95,7 +95,7 @@ int main() {
   // Create account change subscription
   std::cout << "Creating account change subscription...";
   uint64_t new_keypair_lamports = 0;
-  int account_subscription_id = connection.on_account_change(keypair.public_key, [&](Result<Account> result) {
+  connection.on_account_change(keypair.public_key, [&](Result<Account> result) {
     Account account = result.unwrap();
     new_keypair_lamports = account.lamports;
   });
@@ -0,0 +1,55 @@
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/mock_server.hpp"
+
+using namespace solana;
+
+int main() {
+  mock::MockServer::Config config;
+
+  std::cout << "Enter port (0 for any free port): ";
+  std::cin >> config.port;
+
+  uint64_t slot_interval_ms;
+  std::cout << "Enter slot interval in milliseconds: ";
+  std::cin >> slot_interval_ms;
+  config.slot_interval = std::chrono::milliseconds(slot_interval_ms);
+
+  std::cout << "Enter account changes per second (0 for none): ";
+  std::cin >> config.account_changes_per_second;
+
+  uint64_t latency_us, jitter_us;
+  std::cout << "Enter latency and jitter in microseconds: ";
+  std::cin >> latency_us >> jitter_us;
+  config.faults.latency = std::chrono::microseconds(latency_us);
+  config.faults.jitter = std::chrono::microseconds(jitter_us);
+
+  std::cout << "Enter drop and disconnect rates (0 to 1): ";
+  std::cin >> config.faults.drop_rate >> config.faults.disconnect_rate;
+
+  std::string tls;
+  std::cout << "Serve TLS with a self-signed certificate (y/n): ";
+  std::cin >> tls;
+  if (tls == "y") {
+    config.certificate_file = "mock_server.crt";
+    config.private_key_file = "mock_server.key";
+    mock::MockServer::generate_certificate(config.certificate_file, config.private_key_file);
+  }
+
+  mock::MockServer server(config);
+  std::cout << "Serving " << server.endpoint() << " as " << server.identity().to_base58() << std::endl;
+
+  while (true) {
+    sleep(10);
+    auto stats = server.stats();
+    std::cout << "slot = " << server.slot()
+      << " requests = " << stats.requests
+      << " notifications = " << stats.notifications
+      << " drops = " << stats.drops
+      << " disconnects = " << stats.disconnects << std::endl;
+  }
+
+  return 0;
+}
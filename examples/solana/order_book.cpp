@@ -0,0 +1,34 @@
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+int main() {
+  Connection connection(cluster_api_url(Cluster::MainnetBeta), Commitment::Processed);
+
+  std::string bids_public_key;
+  std::cout << "Enter market bids public key: ";
+  std::cin >> bids_public_key;
+
+  openbook::OrderBookSide bids(openbook::Side::Bid);
+
+  int subscriptionId = connection.on_account_change(PublicKey(bids_public_key), [&](Result<Account> result) {
+    bids.update(result.unwrap());
+    const openbook::PriceLevel* best = bids.best();
+    if (best != nullptr) {
+      std::cout << "best bid = " << best->price << " x " << best->quantity << " (" << best->orders << " orders)" << std::endl;
+    }
+  });
+  ASSERT(connection.is_connected());
+
+  for (int i = 0; i < 10; i++) {
+    connection.poll();
+    sleep(1);
+  }
+
+  connection.remove_account_listener(subscriptionId);
+  return 0;
+}
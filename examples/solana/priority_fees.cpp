@@ -0,0 +1,28 @@
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+int main() {
+  Connection connection(cluster_api_url(Cluster::MainnetBeta), Commitment::Processed);
+
+  std::string account;
+  std::cout << "Enter writable account: ";
+  std::cin >> account;
+
+  compute_budget::PriorityFeeEstimator estimator;
+  estimator.track(PublicKey(account));
+
+  for (int i = 0; i < 10; i++) {
+    estimator.poll(connection);
+    std::cout << "p50 = " << estimator.percentile(PublicKey(account), 50)
+      << " p75 = " << estimator.percentile(PublicKey(account), 75)
+      << " p95 = " << estimator.percentile(PublicKey(account), 95) << " micro-lamports" << std::endl;
+    sleep(2);
+  }
+
+  return 0;
+}
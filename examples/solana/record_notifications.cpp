@@ -0,0 +1,40 @@
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+int main() {
+  Connection connection(cluster_api_url(Cluster::MainnetBeta), Commitment::Processed);
+
+  std::string account;
+  std::cout << "Enter account to watch: ";
+  std::cin >> account;
+
+  int seconds;
+  std::cout << "Enter seconds to record: ";
+  std::cin >> seconds;
+
+  std::string path;
+  std::cout << "Enter capture file: ";
+  std::cin >> path;
+
+  // Replay the capture with benchmarks/solana/replay, or with Connection::replay and the same listeners
+  connection.record(path);
+  uint64_t slots = 0, changes = 0;
+  connection.on_slot_change([&](Result<SlotInfo>) { slots++; });
+  connection.on_account_change(PublicKey(account), [&](Result<Account>) { changes++; });
+
+  auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+  while (std::chrono::steady_clock::now() < end) {
+    connection.poll();
+    usleep(100);
+  }
+  connection.stop_recording();
+
+  std::cout << "Recorded " << slots << " slots and " << changes << " account changes to " << path << std::endl;
+
+  return 0;
+}
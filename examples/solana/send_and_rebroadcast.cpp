@@ -0,0 +1,61 @@
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+int main() {
+  Connection connection(cluster_api_url(Cluster::Devnet), Commitment::Processed);
+
+  std::string endpoint;
+  std::cout << "Enter a second devnet RPC endpoint: ";
+  std::cin >> endpoint;
+  Connection backup(endpoint, Commitment::Processed);
+
+  std::string keypair_path;
+  std::cout << "Enter keypair path: ";
+  std::cin >> keypair_path;
+  auto payer = Keypair::from_file(keypair_path);
+
+  // Transfer 1 lamport to ourselves
+  std::vector<uint8_t> data = {2, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0};
+  Transaction transaction;
+  transaction.add({
+    .program_id = SYSTEM_PROGRAM,
+    .accounts = {
+      {payer.public_key, true, true},
+      {payer.public_key, true, true},
+    },
+    .data = data,
+  });
+
+  Blockhash blockhash = connection.get_latest_blockhash().unwrap();
+  transaction.message.recent_blockhash = blockhash.blockhash;
+  std::vector<uint8_t> signed_transaction = transaction.sign({payer});
+
+  threading::ThreadPool pool(2);
+  SignatureTracker tracker;
+  tracker.track_slots(connection);
+  TransactionSender sender({&connection, &backup}, tracker, pool);
+
+  auto future = sender.send(signed_transaction, blockhash.last_valid_block_height, Commitment::Confirmed);
+  while (tracker.pending() > 0) {
+    connection.poll();
+    sender.poll();
+    tracker.poll(connection);
+    usleep(10000);
+  }
+  sender.wait();
+
+  auto update = future.get();
+  std::cout << update.signature << " state = " << (int)update.state << " slot = " << update.slot << std::endl;
+  for (auto& stats : sender.stats()) {
+    std::cout << stats.endpoint << " sends = " << stats.sends << " errors = " << stats.errors
+      << " first acks = " << stats.first_acks << " landed via = " << stats.landed_via
+      << " first ack latency = " << std::chrono::duration_cast<std::chrono::microseconds>(stats.mean_first_ack_latency()).count() << "us" << std::endl;
+  }
+
+  return 0;
+}
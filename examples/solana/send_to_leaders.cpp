@@ -0,0 +1,48 @@
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+int main() {
+  Connection connection(cluster_api_url(Cluster::Devnet), Commitment::Processed);
+
+  std::string keypair_path;
+  std::cout << "Enter keypair path: ";
+  std::cin >> keypair_path;
+  auto payer = Keypair::from_file(keypair_path);
+
+  TpuSender sender;
+  sender.load(connection);
+  sender.subscribe(connection);
+
+  // Transfer 1 lamport to ourselves
+  std::vector<uint8_t> data = {2, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0};
+  Transaction transaction;
+  transaction.add({
+    .program_id = SYSTEM_PROGRAM,
+    .accounts = {
+      {payer.public_key, true, true},
+      {payer.public_key, true, true},
+    },
+    .data = data,
+  });
+  transaction.message.recent_blockhash = connection.get_latest_blockhash().unwrap().blockhash;
+  std::vector<uint8_t> signed_transaction = transaction.sign({payer});
+
+  for (int i = 0; i < 10; i++) {
+    connection.poll();
+    sender.poll(connection);
+    sender.send(signed_transaction);
+    usleep(400000);
+  }
+
+  for (auto& record : sender.log()) {
+    std::cout << "slot = " << record.slot << " leader = " << record.leader.to_base58()
+      << " tpu = " << record.tpu << " ok = " << (record.ok ? "true" : "false") << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,24 @@
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+int main() {
+  Connection connection(cluster_api_url(Cluster::MainnetBeta), Commitment::Processed);
+
+  SysvarCache sysvars;
+  sysvars.subscribe(connection);
+  ASSERT(connection.is_connected());
+
+  for (int i = 0; i < 10; i++) {
+    connection.poll();
+    std::cout << "epoch = " << sysvars.epoch() << " unix timestamp = " << sysvars.unix_timestamp()
+      << " token account rent = " << sysvars.minimum_balance_for_rent_exemption(token::ACCOUNT_SIZE) << std::endl;
+    sleep(1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,36 @@
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+int main() {
+  Connection connection(cluster_api_url(Cluster::Devnet), Commitment::Processed);
+
+  std::string public_key;
+  std::cout << "Enter public key: ";
+  std::cin >> public_key;
+
+  uint64_t last_valid_block_height = connection.get_latest_blockhash().unwrap().last_valid_block_height;
+  std::string signature = connection.request_airdrop(PublicKey(public_key)).unwrap();
+
+  SignatureTracker tracker;
+  tracker.track_slots(connection);
+  auto future = tracker.track(signature, last_valid_block_height, Commitment::Finalized, [](const SignatureTracker::Update& update) {
+    std::cout << update.signature << " state = " << (int)update.state << " slot = " << update.slot
+      << " since landed = " << std::chrono::duration_cast<std::chrono::milliseconds>(update.since_landed).count() << "ms" << std::endl;
+  });
+
+  while (tracker.pending() > 0) {
+    connection.poll();
+    tracker.poll(connection);
+    usleep(10000);
+  }
+
+  auto update = future.get();
+  std::cout << "resolved after " << std::chrono::duration_cast<std::chrono::milliseconds>(update.since_sent).count() << "ms" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * Opt-in counting of heap allocations, for test and benchmark builds.
+ *
+ * Including this header replaces malloc, calloc, realloc and the aligned allocators of the C library, so that every
+ * heap allocation of the process is counted: the ones from operator new, from OpenSSL and the raw buffers of
+ * HttpClient alike. The counts are kept for the whole process and for each thread, so a test can measure the code it
+ * calls while servers or pools run on other threads. The allocations themselves are made by the __libc_ allocators of
+ * glibc.
+ *
+ * The replacements are defined in the header, so it must be included by exactly one translation unit of a test or
+ * benchmark executable and never by library code. It cannot be combined with the sanitizers, which replace the same
+ * functions.
+ *
+ * Hot paths declared allocation-free are held to it with:
+ *
+ *   ASSERT(allocations::count([&]() { ... }).allocations == 0);
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <malloc.h>
+#include <unistd.h>
+
+extern "C" {
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t count, size_t size);
+  void* __libc_realloc(void* pointer, size_t size);
+  void* __libc_memalign(size_t alignment, size_t size);
+}
+
+namespace many {
+
+  namespace allocations {
+
+    /**
+     * A number of heap allocations and the bytes they requested
+     */
+    struct Counts {
+      uint64_t allocations = 0;
+      uint64_t bytes = 0;
+
+      Counts operator-(const Counts& other) const {
+        return {allocations - other.allocations, bytes - other.bytes};
+      }
+    };
+
+    inline std::atomic<uint64_t> _process_allocations{0};
+    inline std::atomic<uint64_t> _process_bytes{0};
+    // Initial-exec so that reading them from malloc never allocates the thread's TLS block
+    inline thread_local uint64_t _thread_allocations __attribute__((tls_model("initial-exec"))) = 0;
+    inline thread_local uint64_t _thread_bytes __attribute__((tls_model("initial-exec"))) = 0;
+
+    inline void counted(size_t size) {
+      _process_allocations.fetch_add(1, std::memory_order_relaxed);
+      _process_bytes.fetch_add(size, std::memory_order_relaxed);
+      _thread_allocations++;
+      _thread_bytes += size;
+    }
+
+    /**
+     * Returns the allocations made so far by every thread of the process
+     */
+    inline Counts process() {
+      return {_process_allocations.load(std::memory_order_relaxed), _process_bytes.load(std::memory_order_relaxed)};
+    }
+
+    /**
+     * Returns the allocations made so far by the calling thread
+     */
+    inline Counts thread() {
+      return {_thread_allocations, _thread_bytes};
+    }
+
+    /**
+     * Runs a function and returns the allocations it made on the calling thread
+     *
+     * @param fn The function to run
+     */
+    template <typename F>
+    Counts count(F&& fn) {
+      Counts before = thread();
+      fn();
+      return thread() - before;
+    }
+
+  } // namespace allocations
+
+} // namespace many
+
+extern "C" {
+
+  void* malloc(size_t size) noexcept {
+    many::allocations::counted(size);
+    return __libc_malloc(size);
+  }
+
+  void* calloc(size_t count, size_t size) noexcept {
+    many::allocations::counted(count * size);
+    return __libc_calloc(count, size);
+  }
+
+  /** A realloc is counted as an allocation of the new size, as it may move the block */
+  void* realloc(void* pointer, size_t size) noexcept {
+    many::allocations::counted(size);
+    return __libc_realloc(pointer, size);
+  }
+
+  void* memalign(size_t alignment, size_t size) noexcept {
+    many::allocations::counted(size);
+    return __libc_memalign(alignment, size);
+  }
+
+  void* aligned_alloc(size_t alignment, size_t size) noexcept {
+    return memalign(alignment, size);
+  }
+
+  int posix_memalign(void** pointer, size_t alignment, size_t size) noexcept {
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+      return EINVAL;
+    }
+    void* allocated = memalign(alignment, size);
+    if (allocated == nullptr) {
+      return ENOMEM;
+    }
+    *pointer = allocated;
+    return 0;
+  }
+
+  void* valloc(size_t size) noexcept {
+    return memalign(sysconf(_SC_PAGESIZE), size);
+  }
+
+}
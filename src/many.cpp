@@ -0,0 +1,22 @@
+//  _______ _____ _____ __ __
+// |   |   |  _  |   | |  |  | Many Exchange C++ SDK
+// | | | | |     | | | |\   /  version 0.0.1
+// |_|___|_|__|__|_|___| |_|   https://github.com/many-exchange/many-exchange-cpp
+//
+// Copyright (c) 2022-2023 Many Exchange
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+// The many library half of many.hpp: its functions and globals, compiled once instead of inline in every user
+
+#ifndef MANY_COMPILED_LIB
+#define MANY_COMPILED_LIB
+#endif
+
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+#include "solana.hpp"
+#include "many_impl.hpp"
@@ -10,8 +10,31 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <sys/mman.h>
+#include <thread>
+#include <tuple>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Header-only builds define the functions and globals of the headers inline, the many library compiles them once
+#ifdef MANY_COMPILED_LIB
+#define MANY_INLINE
+#else
+#define MANY_INLINE inline
+#endif
+
 namespace many {
 
 #define ASSERT(x)                                               \
@@ -28,43 +51,26 @@ namespace many {
    *
    * @param bytes The bytes to decode
   */
-  int decode_length(std::vector<uint8_t> bytes) {
-    int len = 0;
-    int size = 0;
-    while (bytes.size() > 0) {
-      int elem = bytes.front();
-      bytes.erase(bytes.begin());
-      len |= (elem & 0x7f) << (size * 7);
-      size += 1;
-      if ((elem & 0x80) == 0) {
-        break;
-      }
-    }
-    return len;
-  }
+  int decode_length(std::vector<uint8_t> bytes);
 
   /**
    * Encodes a length as a variable length integer
    *
    * @param len The length to encode
    */
-  std::vector<uint8_t> encode_length(int len) {
-    std::vector<uint8_t> bytes;
-    int rem_len = len;
-    for (;;) {
-      int elem = rem_len & 0x7f;
-      rem_len >>= 7;
-      if (rem_len == 0) {
-        bytes.push_back(elem);
-        break;
-      } else {
-        elem |= 0x80;
-        bytes.push_back(elem);
-      }
-    }
-    ASSERT(bytes.size() <= 2);
-    return bytes;
-  }
+  std::vector<uint8_t> encode_length(int len);
+
+  /**
+   * Decodes a variable length integer written by encode_length, advancing the offset past it
+   *
+   * @param data The buffer to read from
+   * @param size The size of the buffer
+   * @param offset The offset of the integer, advanced past it
+   * @param length The decoded length
+   *
+   * @return false if the integer runs past the end of the buffer or is longer than three bytes
+   */
+  bool decode_length(const uint8_t* data, size_t size, size_t& offset, size_t& length);
 
   namespace base58 {
 
@@ -83,341 +89,1541 @@ namespace many {
     extern bool b58enc(char *b58, size_t *b58sz, const void *bin, size_t binsz);
     extern bool b58check_enc(char *b58c, size_t *b58c_sz, uint8_t ver, const void *data, size_t datasz);
 
-    bool (*b58_sha256_impl)(void *, const void *, size_t) = NULL;
-
-    static const int8_t b58digits_map[] = {
-      -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-      -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-      -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-      -1, 0, 1, 2, 3, 4, 5, 6,  7, 8,-1,-1,-1,-1,-1,-1,
-      -1, 9,10,11,12,13,14,15, 16,-1,17,18,19,20,21,-1,
-      22,23,24,25,26,27,28,29, 30,31,32,-1,-1,-1,-1,-1,
-      -1,33,34,35,36,37,38,39, 40,41,42,43,-1,44,45,46,
-      47,48,49,50,51,52,53,54, 55,56,57,-1,-1,-1,-1,-1,
+    inline std::string decode(const std::string &b58) {
+      size_t decodedSize = b58.size() * 733 / 1000 + 1;
+      char decoded[decodedSize];
+      const bool ok = b58tobin(decoded, &decodedSize, b58.c_str(), 0);
+      if (ok) {
+        // remove zero bytes in front of result
+        size_t offset = (b58.size() * 733 / 1000 + 1) - decodedSize;
+        return std::string(decoded + offset, decodedSize);
+      } else
+        return std::string();
+    }
+
+    template <typename T>
+    inline std::string encode(const T &str) {
+      size_t b58Size = str.size() * 138 / 100 + 1;
+      std::string b58(b58Size, '\0');
+      const bool ok = b58enc(b58.data(), &b58Size, str.data(), str.size());
+      if (ok) {
+        // remove zero byte at end of result
+        return std::string(b58.data(), b58Size - 1);
+      } else
+        return std::string();
+    }
+
+  } // namespace base58
+
+  namespace base64 {
+
+    size_t encode(const unsigned char *data, size_t input_length, char *output, size_t output_size);
+    std::string encode(const unsigned char *data, size_t input_length);
+    std::string encode(const std::string& input);
+    std::string encode(const std::vector<uint8_t>& input);
+    size_t decode(const char *data, size_t input_length, char *output, size_t output_size);
+    std::string decode(const char *data, size_t input_length);
+    std::vector<uint8_t> decode(const std::string& input);
+
+    /**
+     * Decodes into a reusable buffer, so binary data (including zero bytes) survives and no new allocation is made
+     * once the buffer has grown to the largest input.
+     *
+     * @param input The base64 string to decode
+     * @param output The buffer to decode into, resized to the decoded length
+     */
+    template <typename Allocator>
+    inline size_t decode(const std::string& input, std::vector<uint8_t, Allocator>& output) {
+      if (input.size() < 4) {
+        output.clear();
+        return 0;
+      }
+      output.resize(input.size() / 4 * 3);
+      size_t length = decode(input.data(), input.size(), (char *)output.data(), output.size());
+      output.resize(length);
+      return length;
+    }
+
+  } // namespace base64
+
+  struct Context {
+    uint64_t slot;
+  };
+
+  void from_json(const json& j, Context& context);
+
+  namespace endian {
+
+    /**
+     * Convert a 16-bit integer from host byte order to big-endian byte order
+     *
+     * @param x 16-bit integer in host byte order
+     */
+    inline uint64_t be64toh(uint64_t x) {
+      #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        return __builtin_bswap64(x);
+      #else
+        return x;
+      #endif
+    }
+
+    /**
+     * Read a little-endian integer from an unaligned buffer
+     *
+     * @param data Pointer to the first byte of the integer
+     */
+    template <typename T>
+    inline T read_le(const uint8_t* data) {
+      static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "read_le assumes a little-endian host");
+      T x;
+      memcpy(&x, data, sizeof(T));
+      return x;
+    }
+
+  } // namespace endian
+
+  namespace diff {
+
+    /**
+     * A half-open range of bytes [start, end)
+     */
+    struct ByteRange {
+      size_t start;
+      size_t end;
     };
 
-    typedef uint64_t b58_maxint_t;
-    typedef uint32_t b58_almostmaxint_t;
-    #define b58_almostmaxint_bits (sizeof(b58_almostmaxint_t) * 8)
-    static const b58_almostmaxint_t b58_almostmaxint_mask = ((((b58_maxint_t)1) << b58_almostmaxint_bits) - 1);
-
-    bool b58tobin(void *bin, size_t *binszp, const char *b58, size_t b58sz) {
-      size_t binsz = *binszp;
-      const unsigned char *b58u = (const unsigned char *)b58;
-      unsigned char *binu = (unsigned char *)bin;
-      size_t outisz = (binsz + sizeof(b58_almostmaxint_t) - 1) / sizeof(b58_almostmaxint_t);
-      b58_almostmaxint_t outi[outisz];
-      b58_maxint_t t;
-      b58_almostmaxint_t c;
-      size_t i, j;
-      uint8_t bytesleft = binsz % sizeof(b58_almostmaxint_t);
-      b58_almostmaxint_t zeromask = bytesleft ? (b58_almostmaxint_mask << (bytesleft * 8)) : 0;
-      unsigned zerocount = 0;
-
-      if (!b58sz)
-        b58sz = strlen(b58);
-
-      for (i = 0; i < outisz; ++i) {
-        outi[i] = 0;
-      }
-
-      // Leading zeros, just count
-      for (i = 0; i < b58sz && b58u[i] == '1'; ++i)
-        ++zerocount;
-
-      for ( ; i < b58sz; ++i) {
-        if (b58u[i] & 0x80)
-          // High-bit set on invalid digit
-          return false;
-        if (b58digits_map[b58u[i]] == -1)
-          // Invalid base58 digit
-          return false;
-        c = (unsigned)b58digits_map[b58u[i]];
-        for (j = outisz; j--; ) {
-          t = ((b58_maxint_t)outi[j]) * 58 + c;
-          c = t >> b58_almostmaxint_bits;
-          outi[j] = t & b58_almostmaxint_mask;
-        }
-        if (c)
-          // Output number too big (carry to the next int32)
-          return false;
-        if (outi[0] & zeromask)
-          // Output number too big (last int32 filled too far)
-          return false;
+    /**
+     * Compares two buffers of the same length and appends the ranges of bytes that differ.
+     *
+     * Blocks of 16 bytes are compared at once, so unchanged regions cost one compare per block.
+     *
+     * @param previous The previous version of the data
+     * @param current The current version of the data
+     * @param length The number of bytes to compare
+     * @param ranges The changed ranges, in ascending order and with adjacent bytes merged
+     */
+    inline void changed_ranges(const uint8_t* previous, const uint8_t* current, size_t length, std::vector<ByteRange>& ranges) {
+      auto mark = [&ranges](size_t index) {
+        if (!ranges.empty() && ranges.back().end == index) {
+          ranges.back().end = index + 1;
+        } else {
+          ranges.push_back({index, index + 1});
+        }
+      };
+
+      size_t i = 0;
+    #if defined(__SSE2__)
+      for (; i + 16 <= length; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)&previous[i]);
+        __m128i b = _mm_loadu_si128((const __m128i*)&current[i]);
+        uint32_t changed = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFF;
+        while (changed != 0) {
+          mark(i + __builtin_ctz(changed));
+          changed &= changed - 1;
+        }
+      }
+    #endif
+      for (; i < length; i++) {
+        if (previous[i] != current[i]) {
+          mark(i);
+        }
       }
+    }
+
+    /**
+     * Keeps the previous version of a buffer and calls back for the watched byte ranges that changed.
+     */
+    class ByteDiffer {
+    public:
+
+      /**
+       * Called with the previous and current data of a changed buffer. `previous` is null on the first update or
+       * when the length of the buffer changed.
+       */
+      typedef std::function<void(const uint8_t* previous, const uint8_t* current, size_t length)> Callback;
+
+    private:
+
+      struct Watch {
+        size_t start;
+        size_t end;
+        Callback callback;
+      };
+
+      std::vector<Watch> _watches;
+      std::vector<uint8_t> _previous;
+      std::vector<ByteRange> _ranges;
+      bool _initialized = false;
 
-      j = 0;
-      if (bytesleft) {
-        for (i = bytesleft; i > 0; --i) {
-          *(binu++) = (outi[0] >> (8 * (i - 1))) & 0xff;
+    public:
+
+      /**
+       * Registers a callback for a range of bytes, e.g. watch(64, 8, ...) for a u64 price at offset 64.
+       *
+       * @param offset The first byte of the field
+       * @param length The length of the field in bytes
+       * @param callback The callback to call when any byte of the field changes
+       */
+      void watch(size_t offset, size_t length, Callback callback) {
+        ASSERT(length > 0);
+        Watch watch = { offset, offset + length, callback };
+        auto it = std::upper_bound(_watches.begin(), _watches.end(), watch, [](const Watch& a, const Watch& b) {
+          return a.start < b.start;
+        });
+        _watches.insert(it, watch);
+      }
+
+      /**
+       * Returns the ranges that changed in the last update.
+       */
+      const std::vector<ByteRange>& ranges() const {
+        return _ranges;
+      }
+
+      /**
+       * Returns the last version of the data.
+       */
+      const std::vector<uint8_t>& data() const {
+        return _previous;
+      }
+
+      /**
+       * Diffs the data against the previous version, calls the watches whose ranges changed and keeps the data.
+       *
+       * @param data The new version of the data
+       * @param length The length of the data
+       */
+      void update(const uint8_t* data, size_t length) {
+        _ranges.clear();
+
+        if (!_initialized || length != _previous.size()) {
+          _initialized = true;
+          _previous.assign(data, data + length);
+          if (length > 0) {
+            _ranges.push_back({0, length});
+          }
+          for (auto& watch : _watches) {
+            if (watch.end <= length) {
+              watch.callback(nullptr, data, length);
+            }
+          }
+          return;
         }
-        ++j;
+
+        changed_ranges(_previous.data(), data, length, _ranges);
+
+        if (!_ranges.empty()) {
+          // Both lists are sorted by start, so a range can be skipped once it ends before the current watch starts
+          size_t first = 0;
+          for (auto& watch : _watches) {
+            if (watch.end > length) {
+              continue;
+            }
+            while (first < _ranges.size() && _ranges[first].end <= watch.start) {
+              first++;
+            }
+            if (first == _ranges.size()) {
+              break;
+            }
+            if (_ranges[first].start < watch.end) {
+              watch.callback(_previous.data(), data, length);
+            }
+          }
+          memcpy(_previous.data(), data, length);
+        }
+      }
+    };
+
+  } // namespace diff
+
+  namespace math {
+
+    /**
+     * Unsigned 256-bit integer, only as wide as needed for Q64.64 fixed point price math
+     */
+    struct uint256 {
+      /** Little-endian 64-bit words */
+      uint64_t words[4];
+
+      uint256() : words{0, 0, 0, 0} {}
+
+      uint256(__uint128_t x) : words{(uint64_t)x, (uint64_t)(x >> 64), 0, 0} {}
+
+      /**
+       * Full 128 x 128 -> 256 bit product
+       */
+      static uint256 mul(__uint128_t a, __uint128_t b) {
+        uint64_t a0 = (uint64_t)a, a1 = (uint64_t)(a >> 64);
+        uint64_t b0 = (uint64_t)b, b1 = (uint64_t)(b >> 64);
+        __uint128_t p00 = (__uint128_t)a0 * b0;
+        __uint128_t p01 = (__uint128_t)a0 * b1;
+        __uint128_t p10 = (__uint128_t)a1 * b0;
+        __uint128_t p11 = (__uint128_t)a1 * b1;
+
+        uint256 r;
+        r.words[0] = (uint64_t)p00;
+        __uint128_t mid = (p00 >> 64) + (uint64_t)p01 + (uint64_t)p10;
+        r.words[1] = (uint64_t)mid;
+        __uint128_t high = (mid >> 64) + (p01 >> 64) + (p10 >> 64) + (uint64_t)p11;
+        r.words[2] = (uint64_t)high;
+        r.words[3] = (uint64_t)((high >> 64) + (p11 >> 64));
+        return r;
+      }
+
+      bool is_zero() const {
+        return (words[0] | words[1] | words[2] | words[3]) == 0;
+      }
+
+      bool fits_u128() const {
+        return (words[2] | words[3]) == 0;
+      }
+
+      __uint128_t low_u128() const {
+        return ((__uint128_t)words[1] << 64) | words[0];
       }
 
-      for (; j < outisz; ++j) {
-        for (i = sizeof(*outi); i > 0; --i) {
-          *(binu++) = (outi[j] >> (8 * (i - 1))) & 0xff;
+      /**
+       * Shifts left by one 64-bit word, returning false on overflow
+       */
+      bool shift_word_left() {
+        if (words[3] != 0) {
+          return false;
         }
+        words[3] = words[2];
+        words[2] = words[1];
+        words[1] = words[0];
+        words[0] = 0;
+        return true;
       }
 
-      // Count canonical base58 byte count
-      binu = (unsigned char *)bin;
-      for (i = 0; i < binsz; ++i) {
-        if (binu[i])
-          break;
-        --*binszp;
+      /**
+       * Shifts right by one 64-bit word, returning the bits shifted out
+       */
+      uint64_t shift_word_right() {
+        uint64_t out = words[0];
+        words[0] = words[1];
+        words[1] = words[2];
+        words[2] = words[3];
+        words[3] = 0;
+        return out;
       }
-      *binszp += zerocount;
 
-      return true;
-    }
+      bool operator<(const uint256& other) const {
+        for (int i = 3; i >= 0; i--) {
+          if (words[i] != other.words[i]) {
+            return words[i] < other.words[i];
+          }
+        }
+        return false;
+      }
 
-    static
-    bool my_dblsha256(void *hash, const void *data, size_t datasz) {
-      uint8_t buf[0x20];
-      return b58_sha256_impl(buf, data, datasz) && b58_sha256_impl(hash, buf, sizeof(buf));
-    }
+      bool operator>=(const uint256& other) const {
+        return !(*this < other);
+      }
 
-    int b58check(const void *bin, size_t binsz, const char *base58str, size_t b58sz) {
-      unsigned char buf[32];
-      const uint8_t *binc = (const uint8_t *)bin;
-      unsigned i;
-      if (binsz < 4)
-        return -4;
-      if (!my_dblsha256(buf, bin, binsz - 4))
-        return -2;
-      if (memcmp(&binc[binsz - 4], buf, 4))
-        return -1;
-
-      // Check number of zeros is correct AFTER verifying checksum (to avoid possibility of accessing base58str beyond the end)
-      for (i = 0; binc[i] == '\0' && base58str[i] == '1'; ++i) {}  // Just finding the end of zeros, nothing to do in loop
-      if (binc[i] == '\0' || base58str[i] == '1')
-        return -3;
-
-      return binc[0];
-    }
+      bool operator==(const uint256& other) const {
+        return memcmp(words, other.words, sizeof(words)) == 0;
+      }
 
-    static const char b58digits_ordered[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+      uint256 operator+(const uint256& other) const {
+        uint256 r;
+        __uint128_t carry = 0;
+        for (int i = 0; i < 4; i++) {
+          carry += (__uint128_t)words[i] + other.words[i];
+          r.words[i] = (uint64_t)carry;
+          carry >>= 64;
+        }
+        return r;
+      }
 
-    bool b58enc(char *b58, size_t *b58sz, const void *data, size_t binsz) {
-      const uint8_t *bin = (const uint8_t *)data;
-      int carry;
-      size_t i, j, high, zcount = 0;
-      size_t size;
+      uint256 operator-(const uint256& other) const {
+        uint256 r;
+        uint64_t borrow = 0;
+        for (int i = 0; i < 4; i++) {
+          uint64_t a = words[i];
+          uint64_t b = other.words[i];
+          r.words[i] = a - b - borrow;
+          borrow = (a < b || (a == b && borrow)) ? 1 : 0;
+        }
+        return r;
+      }
 
-      while (zcount < binsz && !bin[zcount])
-        ++zcount;
+      int bits() const {
+        for (int i = 3; i >= 0; i--) {
+          if (words[i] != 0) {
+            return i * 64 + 64 - __builtin_clzll(words[i]);
+          }
+        }
+        return 0;
+      }
 
-      size = (binsz - zcount) * 138 / 100 + 1;
-      uint8_t buf[size];
-      memset(buf, 0, size);
+      /**
+       * Divides by `denominator`, returning the quotient and storing the remainder
+       *
+       * @param denominator The divisor, which must not be zero
+       * @param remainder Receives the remainder
+       */
+      uint256 div(const uint256& denominator, uint256& remainder) const {
+        ASSERT(!denominator.is_zero());
+        if (fits_u128() && denominator.fits_u128()) {
+          remainder = uint256(low_u128() % denominator.low_u128());
+          return uint256(low_u128() / denominator.low_u128());
+        }
 
-      for (i = zcount, high = size - 1; i < binsz; ++i, high = j) {
-        for (carry = bin[i], j = size - 1; (j > high) || carry; --j) {
-          carry += 256 * buf[j];
-          buf[j] = carry % 58;
-          carry /= 58;
-          if (!j) {
-            // Otherwise j wraps to maxint which is > high
-            break;
+        uint256 quotient;
+        remainder = uint256();
+        for (int i = bits() - 1; i >= 0; i--) {
+          // remainder = (remainder << 1) | bit i
+          for (int w = 3; w > 0; w--) {
+            remainder.words[w] = (remainder.words[w] << 1) | (remainder.words[w - 1] >> 63);
+          }
+          remainder.words[0] = (remainder.words[0] << 1) | ((words[i / 64] >> (i % 64)) & 1);
+          if (remainder >= denominator) {
+            remainder = remainder - denominator;
+            quotient.words[i / 64] |= (uint64_t)1 << (i % 64);
           }
         }
+        return quotient;
       }
 
-      for (j = 0; j < size && !buf[j]; ++j);
+      /**
+       * Divides by `denominator`, rounding the quotient up when `round_up` is set and there is a remainder
+       */
+      uint256 div(const uint256& denominator, bool round_up) const {
+        uint256 remainder;
+        uint256 quotient = div(denominator, remainder);
+        if (round_up && !remainder.is_zero()) {
+          quotient = quotient + uint256(1);
+        }
+        return quotient;
+      }
+    };
+
+  } // namespace math
+
+  namespace threading {
+
+    /**
+     * A fixed set of worker threads executing tasks with work stealing. Every worker owns a queue: tasks submitted from
+     * a worker go to the back of its own queue and are taken back from there, newest first, which keeps a task's
+     * subtasks on the thread whose caches hold its data. Tasks submitted from other threads are spread round-robin. A
+     * worker whose queue is empty steals the oldest task of another worker's queue before going to sleep.
+     */
+    class ThreadPool {
+      struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+      };
+
+      std::vector<std::unique_ptr<Queue>> _queues;
+      std::vector<std::thread> _threads;
+      std::mutex _mutex;
+      std::condition_variable _condition;
+      /** Number of queued tasks not yet taken by a worker, incremented before a task is pushed */
+      std::atomic<size_t> _queued{0};
+      std::atomic<size_t> _next{0};
+      std::atomic<uint64_t> _steals{0};
+      bool _stopping = false;
+
+      /** The pool and queue index of the calling worker thread, if it is one */
+      static std::pair<ThreadPool*, size_t>& current() {
+        static thread_local std::pair<ThreadPool*, size_t> worker(nullptr, 0);
+        return worker;
+      }
 
-      if (*b58sz <= zcount + size - j) {
-        *b58sz = zcount + size - j + 1;
+      bool take(size_t index, std::function<void()>& task) {
+        {
+          Queue& own = *_queues[index];
+          std::lock_guard<std::mutex> lock(own.mutex);
+          if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+          }
+        }
+        for (size_t i = 1; i < _queues.size(); i++) {
+          Queue& victim = *_queues[(index + i) % _queues.size()];
+          std::lock_guard<std::mutex> lock(victim.mutex);
+          if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            _steals++;
+            return true;
+          }
+        }
         return false;
       }
 
-      if (zcount)
-        memset(b58, '1', zcount);
-      for (i = zcount; j < size; ++i, ++j)
-        b58[i] = b58digits_ordered[buf[j]];
-      b58[i] = '\0';
-      *b58sz = i + 1;
+      void run(size_t index) {
+        current() = {this, index};
+        while (true) {
+          std::function<void()> task;
+          if (take(index, task)) {
+            _queued--;
+            task();
+            continue;
+          }
+          std::unique_lock<std::mutex> lock(_mutex);
+          _condition.wait(lock, [this]() { return _stopping || _queued > 0; });
+          if (_stopping && _queued == 0) {
+            return;
+          }
+        }
+      }
 
-      return true;
-    }
+    public:
 
-    bool b58check_enc(char *b58c, size_t *b58c_sz, uint8_t ver, const void *data, size_t datasz) {
-      uint8_t buf[1 + datasz + 0x20];
-      uint8_t *hash = &buf[1 + datasz];
+      ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+        for (size_t i = 0; i < threads; i++) {
+          _queues.emplace_back(new Queue());
+        }
+        for (size_t i = 0; i < threads; i++) {
+          _threads.emplace_back([this, i]() { run(i); });
+        }
+      }
 
-      buf[0] = ver;
-      memcpy(&buf[1], data, datasz);
-      if (!my_dblsha256(hash, buf, datasz + 1)) {
-        *b58c_sz = 0;
-        return false;
+      ~ThreadPool() {
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _stopping = true;
+        }
+        _condition.notify_all();
+        for (auto& thread : _threads) {
+          thread.join();
+        }
       }
 
-      return b58enc(b58c, b58c_sz, buf, 1 + datasz + 4);
-    }
+      ThreadPool(const ThreadPool&) = delete;
+      ThreadPool(ThreadPool&&) = delete;
+      ThreadPool& operator=(const ThreadPool&) = delete;
+      ThreadPool& operator=(ThreadPool&&) = delete;
 
-    inline std::string decode(const std::string &b58) {
-      size_t decodedSize = b58.size() * 733 / 1000 + 1;
-      char decoded[decodedSize];
-      const bool ok = b58tobin(decoded, &decodedSize, b58.c_str(), 0);
-      if (ok) {
-        // remove zero bytes in front of result
-        size_t offset = (b58.size() * 733 / 1000 + 1) - decodedSize;
-        return std::string(decoded + offset, decodedSize);
-      } else
-        return std::string();
+      /**
+       * Returns the number of worker threads
+       */
+      size_t size() const {
+        return _threads.size();
+      }
+
+      /**
+       * Returns the number of tasks a worker took from another worker's queue
+       */
+      uint64_t steals() const {
+        return _steals.load();
+      }
+
+      /**
+       * Queues a task for execution on a worker thread
+       *
+       * @param task The task to execute
+       */
+      void submit(std::function<void()> task) {
+        ASSERT(!_queues.empty());
+        auto worker = current();
+        size_t index = worker.first == this ? worker.second : _next++ % _queues.size();
+        {
+          // Counted before the push, so a worker taking the task can not decrement the count below zero. Taking the lock
+          // orders the increment before a sleeping worker's check of the count
+          std::lock_guard<std::mutex> lock(_mutex);
+          _queued++;
+        }
+        {
+          Queue& queue = *_queues[index];
+          std::lock_guard<std::mutex> lock(queue.mutex);
+          queue.tasks.push_back(std::move(task));
+        }
+        _condition.notify_one();
+      }
+
+      /**
+       * Calls `fn` for every index in [0, count) on the workers and the calling thread, returning when all calls are done
+       *
+       * Must not be called from a worker of this pool: the caller blocks until the helpers it queued have run, and those
+       * can sit behind it in its own queue, which deadlocks.
+       *
+       * @param count The number of indices
+       * @param fn The function to call with each index
+       */
+      void parallel_for(size_t count, const std::function<void(size_t)>& fn) {
+        std::atomic<size_t> next(0);
+        auto work = [&next, &fn, count]() {
+          for (size_t i = next++; i < count; i = next++) {
+            fn(i);
+          }
+        };
+
+        size_t helpers = std::min(_threads.size(), count > 0 ? count - 1 : 0);
+        size_t finished = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+        for (size_t i = 0; i < helpers; i++) {
+          submit([&]() {
+            work();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (++finished == helpers) {
+              done.notify_one();
+            }
+          });
+        }
+
+        work();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&]() { return finished == helpers; });
+      }
+    };
+
+  } // namespace threading
+
+#ifndef MANY_LOG_LEVEL
+#define MANY_LOG_LEVEL 1
+#endif
+
+  /**
+   * Asynchronous logging for the diagnostics of the library.
+   *
+   * A log call copies its printf format, which must be a string literal, and its arguments into a ring owned by the
+   * calling thread and returns. Past the first call of a thread, which registers its ring, it never formats, locks,
+   * allocates or writes: a background thread drains the rings, formats the records and writes them in batches. A full ring drops the record and counts it, and the
+   * drops are reported with the next records of the thread.
+   *
+   * Arguments are numbers, pointers and C strings. Strings are copied when logging, so they only need to live for the
+   * call, and are truncated to share the record. Pass std::string with c_str().
+   *
+   * Levels below MANY_LOG_LEVEL are compiled out, arguments included, and it is the initial runtime level. It defaults
+   * to info, so LOG_DEBUG costs nothing unless the build defines MANY_LOG_LEVEL=0.
+   */
+  namespace logging {
+
+    enum class Level {
+      Debug,
+      Info,
+      Warning,
+      Error,
+      Off,
+    };
+
+    inline const char* level_name(Level level) {
+      switch (level) {
+        case Level::Debug: return "DEBUG";
+        case Level::Info: return "INFO";
+        case Level::Warning: return "WARNING";
+        case Level::Error: return "ERROR";
+        default: return "OFF";
+      }
     }
 
+    struct Record;
+
+    typedef void (*Formatter)(const Record& record, char* out, size_t size);
+
+    /**
+     * A log call, formatted later
+     */
+    struct Record {
+      static constexpr size_t PAYLOAD_SIZE = 224;
+
+      /** Nanoseconds since the epoch */
+      int64_t timestamp;
+      const char* format;
+      Formatter formatter;
+      Level level;
+      /** The arguments, numbers as they are and strings as a length, the characters and a terminating zero */
+      char payload[PAYLOAD_SIZE];
+    };
+
     template <typename T>
-    inline std::string encode(const T &str) {
-      size_t b58Size = str.size() * 138 / 100 + 1;
-      std::string b58(b58Size, '\0');
-      const bool ok = b58enc(b58.data(), &b58Size, str.data(), str.size());
-      if (ok) {
-        // remove zero byte at end of result
-        return std::string(b58.data(), b58Size - 1);
-      } else
-        return std::string();
+    struct Argument {
+      static_assert(std::is_arithmetic<T>::value || std::is_pointer<T>::value, "Log arguments are numbers, pointers and C strings");
+
+      typedef T type;
+      static constexpr bool is_string = false;
+
+      static void write(char*& cursor, T value, size_t) {
+        memcpy(cursor, &value, sizeof(T));
+        cursor += sizeof(T);
+      }
+
+      static T read(const char*& cursor) {
+        T value;
+        memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return value;
+      }
+    };
+
+    template <>
+    struct Argument<const char*> {
+      typedef const char* type;
+      static constexpr bool is_string = true;
+
+      static void write(char*& cursor, const char* value, size_t limit) {
+        uint16_t length = value == nullptr ? 0 : (uint16_t)strnlen(value, limit);
+        memcpy(cursor, &length, sizeof(length));
+        memcpy(cursor + sizeof(length), value, length);
+        cursor[sizeof(length) + length] = '\0';
+        cursor += sizeof(length) + length + 1;
+      }
+
+      static const char* read(const char*& cursor) {
+        uint16_t length;
+        memcpy(&length, cursor, sizeof(length));
+        const char* value = cursor + sizeof(length);
+        cursor += sizeof(length) + length + 1;
+        return value;
+      }
+    };
+
+    template <>
+    struct Argument<char*> : Argument<const char*> {};
+
+    template <typename... Args>
+    void format(const Record& record, char* out, size_t size) {
+      if constexpr (sizeof...(Args) == 0) {
+        snprintf(out, size, "%s", record.format);
+      } else {
+        const char* cursor = record.payload;
+        // Braced initialization reads the arguments in order
+        std::tuple<typename Argument<Args>::type...> values{Argument<Args>::read(cursor)...};
+        std::apply([&](auto... values) { snprintf(out, size, record.format, values...); }, values);
+      }
     }
 
-  } // namespace base58
+    /**
+     * Packs the arguments of a log call into a record, splitting the space left by the numbers between the strings
+     */
+    template <typename... Args>
+    void pack(Record& record, Args... args) {
+      constexpr size_t strings = (0 + ... + (Argument<Args>::is_string ? 1 : 0));
+      constexpr size_t numbers = (0 + ... + (Argument<Args>::is_string ? 0 : sizeof(Args)));
+      static_assert(numbers + strings * 3 < Record::PAYLOAD_SIZE, "Too many log arguments");
+      if constexpr (sizeof...(Args) > 0) {
+        constexpr size_t limit = strings == 0 ? 0 : (Record::PAYLOAD_SIZE - numbers) / (strings == 0 ? 1 : strings) - 3;
+        char* cursor = record.payload;
+        (Argument<Args>::write(cursor, args, limit), ...);
+      }
+      record.formatter = &format<Args...>;
+    }
 
-  namespace base64 {
+    /**
+     * The records of one thread, a single-producer single-consumer ring
+     */
+    struct Ring {
+      static constexpr size_t SIZE = 1024;
+
+      std::array<Record, SIZE> records;
+      /** The next record the thread writes, and the next one the logger reads */
+      alignas(64) std::atomic<uint64_t> head{0};
+      alignas(64) std::atomic<uint64_t> tail{0};
+      std::atomic<uint64_t> dropped{0};
+      /** Drops already reported, read and written by the logger only */
+      uint64_t reported = 0;
+      /** Set when the thread exits, the logger removes the ring once it is drained */
+      std::atomic<bool> closed{false};
+      uint32_t thread = 0;
+    };
+
+    class Logger {
+      std::mutex _mutex;
+      std::vector<std::shared_ptr<Ring>> _rings;
+      std::atomic<int> _fd{2};
+      std::atomic<Level> _level{(Level)MANY_LOG_LEVEL};
+      std::atomic<bool> _running{true};
+      std::atomic<uint32_t> _threads{0};
+      std::thread _thread;
+      std::string _output;
+
+      static void append(std::string& output, int64_t timestamp, Level level, uint32_t thread, const char* message) {
+        time_t seconds = (time_t)(timestamp / 1000000000);
+        struct tm time;
+        gmtime_r(&seconds, &time);
+        char prefix[96];
+        int length = snprintf(prefix, sizeof(prefix), "%04d-%02d-%02d %02d:%02d:%02d.%06d %s [%u] ",
+          time.tm_year + 1900, time.tm_mon + 1, time.tm_mday, time.tm_hour, time.tm_min, time.tm_sec,
+          (int)(timestamp % 1000000000 / 1000), level_name(level), thread);
+        output.append(prefix, length);
+        output.append(message);
+        output.push_back('\n');
+      }
+
+      void write(const std::string& output) {
+        size_t written = 0;
+        int fd = _fd.load(std::memory_order_relaxed);
+        while (written < output.size()) {
+          ssize_t ret = ::write(fd, output.data() + written, output.size() - written);
+          if (ret <= 0) {
+            break;
+          }
+          written += ret;
+        }
+      }
+
+      /** Formats and writes what the rings hold, returns false if they were empty */
+      bool drain() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _output.clear();
+        char message[1024];
+        for (size_t i = 0; i < _rings.size();) {
+          Ring& ring = *_rings[i];
+          bool closed = ring.closed.load(std::memory_order_acquire);
+          uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+          uint64_t head = ring.head.load(std::memory_order_acquire);
+          for (; tail < head; tail++) {
+            const Record& record = ring.records[tail % Ring::SIZE];
+            record.formatter(record, message, sizeof(message));
+            append(_output, record.timestamp, record.level, ring.thread, message);
+          }
+          ring.tail.store(tail, std::memory_order_release);
+          uint64_t dropped = ring.dropped.load(std::memory_order_relaxed);
+          if (dropped != ring.reported) {
+            snprintf(message, sizeof(message), "%llu log records dropped, the ring was full", (unsigned long long)(dropped - ring.reported));
+            append(_output, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count(),
+              Level::Warning, ring.thread, message);
+            ring.reported = dropped;
+          }
+          if (closed) {
+            _rings.erase(_rings.begin() + i);
+          } else {
+            i++;
+          }
+        }
+        if (_output.empty()) {
+          return false;
+        }
+        write(_output);
+        return true;
+      }
+
+      void run() {
+        while (_running.load(std::memory_order_acquire)) {
+          if (!drain()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+          }
+        }
+        drain();
+      }
+
+      Logger() {
+        _output.reserve(65536);
+        _thread = std::thread(&Logger::run, this);
+      }
+
+    public:
+
+      /**
+       * Returns the logger of the process. It is never destroyed, so threads can log until the process exits, and it
+       * writes what is left at exit.
+       */
+      static Logger& instance() {
+        static Logger* logger = []() {
+          Logger* logger = new Logger();
+          std::atexit([]() { instance().stop(); });
+          return logger;
+        }();
+        return *logger;
+      }
+
+      Logger(const Logger&) = delete;
+      Logger& operator=(const Logger&) = delete;
 
-    const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      /**
+       * Returns the ring of the calling thread, registered on its first log call
+       */
+      Ring* ring() {
+        struct Owner {
+          std::shared_ptr<Ring> ring;
+
+          ~Owner() {
+            if (ring) {
+              ring->closed.store(true, std::memory_order_release);
+            }
+          }
+        };
+        thread_local Owner owner;
+        if (!owner.ring) {
+          owner.ring = std::make_shared<Ring>();
+          owner.ring->thread = ++_threads;
+          std::lock_guard<std::mutex> lock(_mutex);
+          _rings.push_back(owner.ring);
+        }
+        return owner.ring.get();
+      }
 
-    size_t encode(const unsigned char *data, size_t input_length, char *output, size_t output_size) {
-      if (output_size < 4 * ((input_length + 2) / 3)) {
-        throw std::runtime_error("Output buffer too small");
+      bool is_running() const {
+        return _running.load(std::memory_order_acquire);
       }
 
-      for (size_t i = 0, j = 0; i < input_length;) {
-        uint32_t octet_a = i < input_length ? (unsigned char)data[i++] : 0;
-        uint32_t octet_b = i < input_length ? (unsigned char)data[i++] : 0;
-        uint32_t octet_c = i < input_length ? (unsigned char)data[i++] : 0;
-        uint32_t triple = (octet_a << 0x10) + (octet_b << 0x08) + octet_c;
+      Level level() const {
+        return _level.load(std::memory_order_relaxed);
+      }
 
-        output[j++] = base64_chars[(triple >> 3 * 6) & 0x3F];
-        output[j++] = base64_chars[(triple >> 2 * 6) & 0x3F];
-        output[j++] = base64_chars[(triple >> 1 * 6) & 0x3F];
-        output[j++] = base64_chars[(triple >> 0 * 6) & 0x3F];
+      void set_level(Level level) {
+        _level.store(level, std::memory_order_relaxed);
+      }
+
+      /**
+       * Sets the file descriptor records are written to, stderr by default
+       */
+      void set_output(int fd) {
+        flush();
+        _fd.store(fd, std::memory_order_relaxed);
+      }
+
+      /**
+       * Writes the records logged so far before returning
+       */
+      void flush() {
+        drain();
+      }
+
+      /**
+       * Stops the background thread after writing the records logged so far. Later calls log synchronously.
+       */
+      void stop() {
+        if (_running.exchange(false)) {
+          _thread.join();
+          // Records published while the worker made its last drain
+          drain();
+        }
       }
 
-      for (size_t i = 0; i < (3 - input_length % 3) % 3; i++) {
-        output[output_size - 1 - i] = '=';
+      /**
+       * Formats and writes a record on the calling thread, for the calls made after stop()
+       */
+      void write(const Record& record) {
+        char message[1024];
+        record.formatter(record, message, sizeof(message));
+        std::string output;
+        append(output, record.timestamp, record.level, 0, message);
+        write(output);
       }
+    };
 
-      return output_size;
+    /**
+     * Returns true if records of the level are logged. The level can be lowered at runtime down to MANY_LOG_LEVEL.
+     */
+    inline bool is_enabled(Level level) {
+      return level >= Logger::instance().level();
     }
 
-    std::string encode(const unsigned char *data, size_t input_length) {
-      int output_length = 4 * ((input_length + 2) / 3);
-      char output[output_length + 1];
-      output[output_length] = '\0';
-      encode((unsigned char *)data, input_length, output, output_length);
-      return output;
+    inline void set_level(Level level) {
+      Logger::instance().set_level(level);
     }
 
-    std::string encode(const std::string& input) {
-      int output_length = 4 * ((input.size() + 2) / 3);
-      char output[output_length + 1];
-      output[output_length] = '\0';
-      encode((unsigned char *)input.data(), input.size(), output, output_length);
-      return output;
+    inline void set_output(int fd) {
+      Logger::instance().set_output(fd);
     }
 
-    std::string encode(const std::vector<uint8_t>& input) {
-      int output_length = 4 * ((input.size() + 2) / 3);
-      char output[output_length + 1];
-      output[output_length] = '\0';
-      encode((unsigned char *)input.data(), input.size(), output, output_length);
-      return output;
+    inline void flush() {
+      Logger::instance().flush();
     }
 
-    const int base64_decode_chars[] = {
-      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
-      52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
-      -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
-      15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
-      -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
-      41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
-      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+    /**
+     * Logs a record, use the LOG_ macros instead so that the format is checked and disabled levels compiled out
+     *
+     * @param level The severity
+     * @param format A printf format, a string literal
+     * @param args The arguments of the format
+     */
+    template <typename... Args>
+    void log(Level level, const char* format, Args... args) {
+      Logger& logger = Logger::instance();
+      int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+      if (!logger.is_running()) {
+        Record record;
+        record.timestamp = timestamp;
+        record.format = format;
+        record.level = level;
+        pack(record, args...);
+        logger.write(record);
+        return;
+      }
+
+      Ring& ring = *logger.ring();
+      uint64_t head = ring.head.load(std::memory_order_relaxed);
+      if (head - ring.tail.load(std::memory_order_acquire) == Ring::SIZE) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      Record& record = ring.records[head % Ring::SIZE];
+      record.timestamp = timestamp;
+      record.format = format;
+      record.level = level;
+      pack(record, args...);
+      ring.head.store(head + 1, std::memory_order_release);
+
+      // stop() may have made the final drain between the check above and the store, the record is then written here.
+      // The fence pairs with the exchange of stop(), so either the drain sees the record or this sees the stop
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!logger.is_running()) {
+        logger.flush();
+      }
+    }
+
+    /** Never called, gives the LOG_ macros the printf format checks of the compiler */
+    inline void check_format(const char* format, ...) __attribute__((format(printf, 1, 2)));
+    inline void check_format(const char*, ...) {}
+
+  } // namespace logging
+
+#define MANY_LOG(level, ...)                                                    \
+  do {                                                                          \
+    if constexpr ((int)(level) >= MANY_LOG_LEVEL) {                             \
+      if (false) {                                                              \
+        many::logging::check_format(__VA_ARGS__);                               \
+      }                                                                         \
+      if (many::logging::is_enabled(level)) {                                   \
+        many::logging::log(level, __VA_ARGS__);                                 \
+      }                                                                         \
+    }                                                                           \
+  } while(0)
+
+#define LOG_DEBUG(...) MANY_LOG(many::logging::Level::Debug, __VA_ARGS__)
+#define LOG_INFO(...) MANY_LOG(many::logging::Level::Info, __VA_ARGS__)
+#define LOG_WARNING(...) MANY_LOG(many::logging::Level::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) MANY_LOG(many::logging::Level::Error, __VA_ARGS__)
+
+  namespace memory {
+
+    /** The size of the huge pages of x86-64 */
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    /**
+     * How the memory of long-lived buffers and caches is mapped
+     */
+    struct PageOptions {
+      /** Back the memory with 2 MB pages, reserved ones (MAP_HUGETLB) if the system has them, transparent ones otherwise */
+      bool huge_pages = false;
+      /** Fault every page in when the memory is mapped, so that its first use does not take page faults */
+      bool prefault = false;
+      /** Lock the pages in memory so they are never swapped out, within RLIMIT_MEMLOCK */
+      bool lock = false;
+
+      bool is_default() const {
+        return !huge_pages && !prefault && !lock;
+      }
     };
 
-    size_t decode(const char *data, size_t input_length, char *output, size_t output_size) {
-      size_t i, j;
-      size_t output_length = input_length / 4 * 3;
+    /**
+     * Returns the page options HttpClient and WebSocketClient map their buffers with. Set it at startup, before the
+     * clients are created. The default keeps the buffers on the heap.
+     */
+    inline PageOptions& buffer_pages() {
+      static PageOptions options;
+      return options;
+    }
+
+    /**
+     * A buffer mapped with page options, or allocated on the heap for the default ones
+     */
+    class Pages {
+    public:
+
+      enum Backing {
+        /** malloc, for the default options */
+        HEAP,
+        /** An anonymous mapping on base pages */
+        PAGES,
+        /** An anonymous mapping advised with MADV_HUGEPAGE, which the kernel backs with huge pages when it has them */
+        TRANSPARENT_HUGE_PAGES,
+        /** Reserved huge pages */
+        HUGETLB,
+      };
+
+    private:
+
+      char* _data = nullptr;
+      size_t _size = 0;
+      /** The length of the mapping, the size rounded up to whole pages */
+      size_t _mapped = 0;
+      PageOptions _options;
+      Backing _backing = HEAP;
+      bool _locked = false;
+
+      static size_t round_up(size_t size, size_t page_size) {
+        return (std::max<size_t>(size, 1) + page_size - 1) / page_size * page_size;
+      }
+
+      /** Maps anonymous memory aligned to the huge page size, so that transparent huge pages can back all of it */
+      static void* map_aligned(size_t length) {
+        size_t padded = length + HUGE_PAGE_SIZE;
+        void* mapping = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) {
+          return MAP_FAILED;
+        }
+        char* start = (char*)mapping;
+        char* aligned = (char*)(((uintptr_t)start + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+        if (aligned > start) {
+          munmap(start, aligned - start);
+        }
+        size_t tail = (start + padded) - (aligned + length);
+        if (tail > 0) {
+          munmap(aligned + length, tail);
+        }
+        return aligned;
+      }
+
+      void map(size_t size) {
+        _size = size;
+        if (_options.is_default()) {
+          _data = (char*)malloc(std::max<size_t>(size, 1));
+          if (_data == nullptr) {
+            throw std::bad_alloc();
+          }
+          _backing = HEAP;
+          return;
+        }
+
+        size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+        void* data = MAP_FAILED;
+        if (_options.huge_pages) {
+          _mapped = round_up(size, HUGE_PAGE_SIZE);
+          data = mmap(nullptr, _mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+          _backing = HUGETLB;
+          if (data == MAP_FAILED) {
+            // No huge pages are reserved, fall back to transparent ones
+            data = map_aligned(_mapped);
+            _backing = data != MAP_FAILED && madvise(data, _mapped, MADV_HUGEPAGE) == 0 ? TRANSPARENT_HUGE_PAGES : PAGES;
+          }
+        } else {
+          _mapped = round_up(size, page_size);
+          data = mmap(nullptr, _mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+          _backing = PAGES;
+        }
+        if (data == MAP_FAILED) {
+          throw std::bad_alloc();
+        }
+        _data = (char*)data;
+
+        if (_options.prefault) {
+          // A write per page, a read would only map the shared zero page
+          for (size_t offset = 0; offset < _mapped; offset += page_size) {
+            ((volatile char*)_data)[offset] = 0;
+          }
+        }
+        if (_options.lock) {
+          _locked = mlock(_data, _mapped) == 0;
+        }
+      }
+
+      void unmap() {
+        if (_data == nullptr) {
+          return;
+        }
+        if (_backing == HEAP) {
+          free(_data);
+        } else {
+          // Unmapping unlocks the pages too
+          munmap(_data, _mapped);
+        }
+        _data = nullptr;
+        _size = 0;
+        _mapped = 0;
+        _locked = false;
+      }
+
+    public:
+
+      Pages() = default;
+
+      /**
+       * @param size The size of the buffer
+       * @param options How to map it
+       */
+      explicit Pages(size_t size, const PageOptions& options = {})
+        : _options(options)
+      {
+        map(size);
+      }
+
+      ~Pages() {
+        unmap();
+      }
+
+      Pages(Pages&& other) noexcept {
+        *this = std::move(other);
+      }
+
+      Pages& operator=(Pages&& other) noexcept {
+        if (this != &other) {
+          unmap();
+          _data = other._data;
+          _size = other._size;
+          _mapped = other._mapped;
+          _options = other._options;
+          _backing = other._backing;
+          _locked = other._locked;
+          other._data = nullptr;
+          other._size = 0;
+          other._mapped = 0;
+          other._locked = false;
+        }
+        return *this;
+      }
+
+      Pages(const Pages&) = delete;
+      Pages& operator=(const Pages&) = delete;
+
+      char* data() const {
+        return _data;
+      }
+
+      size_t size() const {
+        return _size;
+      }
+
+      /**
+       * Returns how the memory is backed, which can be less than the options asked for when the system lacks huge pages
+       */
+      Backing backing() const {
+        return _backing;
+      }
+
+      /**
+       * Returns true if the options asked for locked pages and mlock succeeded
+       */
+      bool is_locked() const {
+        return _locked;
+      }
+
+      /**
+       * Resizes the buffer, keeping its contents. A mapping only moves when the size outgrows its pages.
+       *
+       * @param size The new size
+       */
+      void resize(size_t size) {
+        if (_backing == HEAP && _data != nullptr) {
+          char* data = (char*)realloc(_data, std::max<size_t>(size, 1));
+          if (data == nullptr) {
+            throw std::bad_alloc();
+          }
+          _data = data;
+          _size = size;
+        } else if (size <= _mapped) {
+          _size = size;
+        } else {
+          Pages resized(size, _options);
+          if (_data != nullptr) {
+            memcpy(resized._data, _data, _size);
+          }
+          *this = std::move(resized);
+        }
+      }
+    };
+
+    /**
+     * A memory resource that carves allocations out of regions mapped with page options, for caches that should live
+     * on huge pages:
+     *
+     *   memory::PageResource pages({true, true});
+     *   std::pmr::unsynchronized_pool_resource pool(&pages);
+     *   AccountCache cache(&pool);
+     *
+     * Allocations are bumped through the current region, and larger ones get a region of their own. A region is unmapped
+     * once everything allocated from it was freed, except the current one, which is reused from its start.
+     *
+     * Not thread safe, like the pools it backs.
+     */
+    class PageResource : public std::pmr::memory_resource {
+      struct Region {
+        Pages pages;
+        /** The offset of the next allocation */
+        size_t used = 0;
+        /** The number of live allocations */
+        size_t allocations = 0;
+      };
+
+      PageOptions _options;
+      size_t _region_size;
+      /** Regions by the address of their first byte */
+      std::map<uintptr_t, Region> _regions;
+      Region* _current = nullptr;
+
+      /** Returns the region an allocation was carved from */
+      std::map<uintptr_t, Region>::iterator find(const void* pointer) {
+        auto it = _regions.upper_bound((uintptr_t)pointer);
+        ASSERT(it != _regions.begin());
+        return --it;
+      }
+
+      static char* align(char* pointer, size_t alignment) {
+        return (char*)(((uintptr_t)pointer + alignment - 1) & ~(uintptr_t)(alignment - 1));
+      }
+
+    protected:
+
+      void* do_allocate(size_t bytes, size_t alignment) override {
+        if (_current != nullptr) {
+          char* start = align(_current->pages.data() + _current->used, alignment);
+          if (start + bytes <= _current->pages.data() + _current->pages.size()) {
+            _current->used = start + bytes - _current->pages.data();
+            _current->allocations++;
+            return start;
+          }
+        }
+
+        // Room for the alignment, since the heap only aligns for the standard types
+        bool dedicated = bytes + alignment > _region_size;
+        Pages pages(dedicated ? bytes + alignment : _region_size, _options);
+        char* data = pages.data();
+        Region& region = _regions[(uintptr_t)data];
+        region.pages = std::move(pages);
+        if (!dedicated) {
+          if (_current != nullptr && _current->allocations == 0) {
+            _regions.erase((uintptr_t)_current->pages.data());
+          }
+          _current = &region;
+        }
+        char* start = align(data, alignment);
+        region.used = start + bytes - data;
+        region.allocations = 1;
+        return start;
+      }
+
+      void do_deallocate(void* pointer, size_t, size_t) override {
+        auto it = find(pointer);
+        Region& region = it->second;
+        ASSERT(region.allocations > 0);
+        if (--region.allocations > 0) {
+          return;
+        }
+        if (&region == _current) {
+          region.used = 0;
+        } else {
+          _regions.erase(it);
+        }
+      }
+
+      bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+      }
+
+    public:
+
+      /**
+       * @param options How to map the regions
+       * @param region_size The size of a region, one huge page by default
+       */
+      explicit PageResource(const PageOptions& options, size_t region_size = HUGE_PAGE_SIZE)
+        : _options(options),
+        _region_size(region_size)
+      {}
+
+      PageResource(const PageResource&) = delete;
+      PageResource& operator=(const PageResource&) = delete;
+
+      /**
+       * Returns the number of mapped regions
+       */
+      size_t regions() const {
+        return _regions.size();
+      }
+
+      /**
+       * Returns how the region an allocation was carved from is backed
+       *
+       * @param pointer A live allocation
+       */
+      Pages::Backing backing(const void* pointer) const {
+        auto it = _regions.upper_bound((uintptr_t)pointer);
+        ASSERT(it != _regions.begin());
+        return std::prev(it)->second.pages.backing();
+      }
+    };
+
+    /**
+     * A monotonic arena for short-lived per-request memory. Allocations bump a pointer through blocks taken from the
+     * heap, deallocations do nothing, and reset() releases everything at once but keeps the blocks. A reset after the
+     * arena had to grow merges its blocks into one of the total size, so a steady workload only takes memory from the
+     * heap while it warms up. With page options, the blocks are mapped instead, for arenas that hold caches.
+     *
+     * Not thread safe, an arena is used by one thread at a time.
+     */
+    class Arena : public std::pmr::memory_resource {
+      PageOptions _options;
+      std::vector<Pages> _blocks;
+      /** The block allocations are made from, and the offset of the next one in it */
+      size_t _block = 0;
+      size_t _offset = 0;
+      size_t _used = 0;
+      size_t _peak = 0;
+      uint64_t _heap_allocations = 0;
+
+      void add_block(size_t size) {
+        _blocks.emplace_back(size, _options);
+        _heap_allocations++;
+      }
+
+    protected:
+
+      void* do_allocate(size_t bytes, size_t alignment) override {
+        while (true) {
+          Pages& block = _blocks[_block];
+          // Aligns the address rather than the offset, blocks are only aligned to the page or to the heap's alignment
+          uintptr_t address = reinterpret_cast<uintptr_t>(block.data() + _offset);
+          size_t start = _offset + (size_t)(((address + alignment - 1) & ~(uintptr_t)(alignment - 1)) - address);
+          if (start + bytes <= block.size()) {
+            _offset = start + bytes;
+            _used += bytes;
+            _peak = std::max(_peak, _used);
+            return block.data() + start;
+          }
+          _block++;
+          _offset = 0;
+          if (_block == _blocks.size()) {
+            add_block(std::max(block.size() * 2, bytes + alignment));
+          }
+        }
+      }
+
+      void do_deallocate(void*, size_t, size_t) override {
+      }
+
+      bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+      }
+
+    public:
+
+      /**
+       * @param size The size of the first block, the arena grows by doubling when it runs out
+       * @param options How to map the blocks, on the heap by default
+       */
+      explicit Arena(size_t size = 65536, const PageOptions& options = {})
+        : _options(options)
+      {
+        add_block(std::max<size_t>(size, 64));
+      }
+
+      Arena(const Arena&) = delete;
+      Arena& operator=(const Arena&) = delete;
+
+      /**
+       * Releases everything allocated from the arena. Whatever was allocated from it must not be used afterwards.
+       */
+      void reset() {
+        if (_blocks.size() > 1) {
+          size_t size = 0;
+          for (auto& block : _blocks) {
+            size += block.size();
+          }
+          _blocks.clear();
+          add_block(size);
+        }
+        _block = 0;
+        _offset = 0;
+        _used = 0;
+      }
+
+      /**
+       * Constructs an object in the arena that is never destroyed, for objects whose memory all comes from the arena
+       * and whose destructors would only walk them to free it, such as large JSON documents
+       *
+       * @param args The arguments of the constructor
+       * @return The object, valid until the next reset
+       */
+      template <typename T, typename... Args>
+      T& make(Args&&... args) {
+        return *new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+      }
+
+      /**
+       * Returns the bytes allocated since the last reset
+       */
+      size_t used() const {
+        return _used;
+      }
+
+      /**
+       * Returns the most bytes ever allocated between two resets
+       */
+      size_t peak() const {
+        return _peak;
+      }
+
+      /**
+       * Returns the total size of the blocks
+       */
+      size_t capacity() const {
+        size_t size = 0;
+        for (auto& block : _blocks) {
+          size += block.size();
+        }
+        return size;
+      }
+
+      /**
+       * Returns the number of blocks taken from the heap or mapped so far, which stops growing once the arena is warm
+       */
+      uint64_t heap_allocations() const {
+        return _heap_allocations;
+      }
+    };
+
+    /**
+     * Returns the resource the current thread allocates from with CurrentAllocator, the heap unless a Scope is active
+     */
+    inline std::pmr::memory_resource*& current_resource() {
+      thread_local std::pmr::memory_resource* resource = std::pmr::new_delete_resource();
+      return resource;
+    }
+
+    /**
+     * Makes a resource the current one of the thread for the lifetime of the scope
+     */
+    class Scope {
+      std::pmr::memory_resource* _previous;
 
-      if (data[input_length - 1] == '=') output_length--;
-      if (data[input_length - 2] == '=') output_length--;
+    public:
 
-      if (output_size < output_length) {
-        throw std::runtime_error("Output buffer too small");
+      explicit Scope(std::pmr::memory_resource& resource)
+        : _previous(current_resource())
+      {
+        current_resource() = &resource;
       }
 
-      for (i = 0, j = 0; i < input_length; ) {
-        unsigned int a = data[i] == '=' ? 0 & i++ : base64_decode_chars[(int)data[i++]];
-        unsigned int b = data[i] == '=' ? 0 & i++ : base64_decode_chars[(int)data[i++]];
-        unsigned int c = data[i] == '=' ? 0 & i++ : base64_decode_chars[(int)data[i++]];
-        unsigned int d = data[i] == '=' ? 0 & i++ : base64_decode_chars[(int)data[i++]];
-
-        unsigned int triple = (a << 3 * 6) + (b << 2 * 6) + (c << 1 * 6) + (d << 0 * 6);
-
-        if (j < output_length) output[j++] = (triple >> 2 * 8) & 0xFF;
-        if (j < output_length) output[j++] = (triple >> 1 * 8) & 0xFF;
-        if (j < output_length) output[j++] = (triple >> 0 * 8) & 0xFF;
+      ~Scope() {
+        current_resource() = _previous;
       }
 
-      return output_length;
-    }
+      Scope(const Scope&) = delete;
+      Scope& operator=(const Scope&) = delete;
+    };
 
-    std::string decode(const char *data, size_t input_length) {
-      int output_length = input_length / 4 * 3;
-      char output[output_length + 1];
-      output[output_length] = '\0';
-      output_length = decode(data, input_length, output, output_length);
-      output[output_length] = '\0';
-      return output;
-    }
+    /**
+     * A stateless allocator for the current resource of the thread, for containers that default-construct their
+     * allocators, such as nlohmann::basic_json, where std::pmr::polymorphic_allocator would fall back to the global
+     * default resource. What is allocated within a Scope must be freed within the same Scope.
+     */
+    template <typename T>
+    struct CurrentAllocator {
+      typedef T value_type;
 
-    std::vector<uint8_t> decode(const std::string& input) {
-      std::string decoded = decode(input.c_str(), input.size());
-      return std::vector<uint8_t>(decoded.begin(), decoded.end());
-    }
+      CurrentAllocator() = default;
 
-  } // namespace base64
+      template <typename U>
+      CurrentAllocator(const CurrentAllocator<U>&) {}
 
-  struct Context {
-    uint64_t slot;
-  };
+      T* allocate(size_t n) {
+        return (T*)current_resource()->allocate(n * sizeof(T), alignof(T));
+      }
 
-  void from_json(const json& j, Context& context) {
-    context.slot = j["slot"].get<uint64_t>();
-  }
+      void deallocate(T* pointer, size_t n) {
+        current_resource()->deallocate(pointer, n * sizeof(T), alignof(T));
+      }
 
-  namespace endian {
+      template <typename U>
+      bool operator==(const CurrentAllocator<U>&) const {
+        return true;
+      }
 
-    /**
-     * Convert a 16-bit integer from host byte order to big-endian byte order
-     *
-     * @param x 16-bit integer in host byte order
-     */
-    inline uint64_t be64toh(uint64_t x) {
-      #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-        return __builtin_bswap64(x);
-      #else
-        return x;
-      #endif
-    }
+      template <typename U>
+      bool operator!=(const CurrentAllocator<U>&) const {
+        return false;
+      }
+    };
 
-  } // namespace endian
+  } // namespace memory
 
   namespace http {
 
@@ -430,21 +1636,31 @@ namespace many {
       SSL_CTX *_ssl_ctx;
       SSL *_ssl;
 
+      static constexpr size_t SEND_BUFFER_SIZE = 65536;
+
+      /** Value of the Host header, the authority part of the url */
+      std::string _host;
+      /** The buffers, mapped with memory::buffer_pages() */
+      memory::Pages _send_pages;
+      memory::Pages _recv_pages;
       char* _send_buffer = nullptr;
       char* _recv_buffer = nullptr;
+      /** Grown by post() for larger responses, so a client only holds the memory its largest response needed */
+      size_t _recv_capacity = 65536;
 
       bool write(const char *data, size_t length) {
         if (_use_ssl) {
           int ret = SSL_write(_ssl, data, (int)length);
           if (ret <= 0) {
-            std::cerr << "Error: SSL_write() failed" << std::endl;
+            LOG_ERROR("SSL_write() failed");
             disconnect();
             return false;
           }
         } else {
-          int ret = ::write(_socket, data, (int)length);
+          // MSG_NOSIGNAL so a peer closing a kept-alive connection is an error rather than SIGPIPE
+          int ret = ::send(_socket, data, length, MSG_NOSIGNAL);
           if (ret <= 0) {
-            std::cerr << "Error: write() failed" << std::endl;
+            LOG_ERROR("send() failed: %s", strerror(errno));
             disconnect();
             return false;
           }
@@ -461,7 +1677,7 @@ namespace many {
         timeout.tv_usec = 0;
         int ret = select(_socket + 1, &readfds, NULL, NULL, &timeout);
         if (ret == -1) {
-          std::cerr << "Error: select() failed" << std::endl;
+          LOG_ERROR("select() failed: %s", strerror(errno));
           disconnect();
           return false;
         }
@@ -472,7 +1688,7 @@ namespace many {
         if (_use_ssl) {
           int ret = SSL_read(_ssl, data, length);
           if (ret <= 0) {
-            std::cerr << "Error: SSL_read() failed" << std::endl;
+            LOG_ERROR("SSL_read() failed");
             disconnect();
             return 0;
           }
@@ -480,7 +1696,7 @@ namespace many {
         } else {
           int ret = ::read(_socket, data, length);
           if (ret <= 0) {
-            std::cerr << "Error: SSL_read() failed" << std::endl;
+            LOG_ERROR("read() failed: %s", ret == 0 ? "connection closed" : strerror(errno));
             disconnect();
             return 0;
           }
@@ -491,21 +1707,20 @@ namespace many {
     public:
 
       HttpClient(const std::string url, const std::string interface = "")
-        : _url(url),
-        _interface(interface),
+        : _interface(interface),
+        _url(url),
         _socket(-1),
         _ssl_ctx(nullptr),
         _ssl(nullptr)
       {
-        _send_buffer = (char*)malloc(65536);
-        _recv_buffer = (char*)malloc(8388608);
+        _send_pages = memory::Pages(SEND_BUFFER_SIZE, memory::buffer_pages());
+        _recv_pages = memory::Pages(_recv_capacity, memory::buffer_pages());
+        _send_buffer = _send_pages.data();
+        _recv_buffer = _recv_pages.data();
       }
 
       ~HttpClient() {
         disconnect();
-
-        free(_send_buffer);
-        free(_recv_buffer);
       }
 
       HttpClient() = delete;
@@ -527,6 +1742,7 @@ namespace many {
         index += 3; // "://"
         std::size_t end = _url.find("/", index + 1);
         std::string hostname = _url.substr(index, end - index);
+        _host = hostname;
         index = hostname.find(":");
         if (index != std::string::npos) {
           port = std::stoi(hostname.substr(index + 1));
@@ -536,7 +1752,7 @@ namespace many {
         struct hostent *server;
         server = gethostbyname(hostname.c_str());
         if (server == NULL) {
-          std::cerr << "Error: gethostbyname() failed" << std::endl;
+          LOG_ERROR("gethostbyname(%s) failed", hostname.c_str());
           return false;
         }
 
@@ -560,7 +1776,7 @@ namespace many {
 
         _socket = socket(AF_INET, SOCK_STREAM, 0);
         if (_socket < 0) {
-          std::cerr << "Error: socket() failed" << std::endl;
+          LOG_ERROR("socket() failed: %s", strerror(errno));
           disconnect();
           return false;
         }
@@ -583,10 +1799,7 @@ namespace many {
         std::string address = inet_ntoa(*addr);
 
         if (::connect(_socket, (sockaddr *)&remoteaddr, (int)sizeof(remoteaddr)) == -1) {
-          std::cerr << "CONNECT FAILED" << std::endl;
-          std::cerr << "  socket = " << std::to_string(_socket) << std::endl;
-          std::cerr << "  address = " << address << std::endl;
-          std::cerr << "  port = " << std::to_string(port) << std::endl;
+          LOG_ERROR("connect() to %s:%d failed on socket %d: %s", address.c_str(), (int)port, _socket, strerror(errno));
           disconnect();
           return false;
         }
@@ -596,19 +1809,19 @@ namespace many {
 
           _ssl_ctx = SSL_CTX_new(method);
           if (_ssl_ctx == NULL) {
-            std::cerr << "Error: SSL_CTX_new() failed" << std::endl;
+            LOG_ERROR("SSL_CTX_new() failed");
             disconnect();
             return false;
           }
 
           _ssl = SSL_new(_ssl_ctx);
           if (_ssl == NULL) {
-            std::cerr << "Error: SSL_new() failed" << std::endl;
+            LOG_ERROR("SSL_new() failed");
             int err;
             while ((err = ERR_get_error()) != 0) {
               char *str = ERR_error_string(err, 0);
               if (str != nullptr) {
-                std::cerr << str << std::endl;
+                LOG_ERROR("%s", str);
               }
             }
             disconnect();
@@ -616,7 +1829,7 @@ namespace many {
           }
 
           if (SSL_set_fd(_ssl, _socket) == 0) {
-            std::cerr << "Error: SSL_set_fd() failed" << std::endl;
+            LOG_ERROR("SSL_set_fd() failed");
             disconnect();
             return false;
           }
@@ -633,17 +1846,14 @@ namespace many {
               // Not enough data because we are using non-blocking IO.
             }
             else {
-              std::cerr << "Error: SSL_connect() failed" << std::endl;
+              LOG_ERROR("SSL_connect() failed");
               disconnect();
               return false;
             }
           }
         }
 
-        // std::cout << "CONNECT" << std::endl;
-        // std::cout << "  socket = " << std::to_string(_socket) << std::endl;
-        // std::cout << "  tcp_address = " << tcp_address << std::endl;
-        // std::cout << "  tcp_port = " << std::to_string(tcp_port) << std::endl;
+        LOG_DEBUG("Connected socket %d to %s:%d", _socket, address.c_str(), (int)port);
 
         return true;
       }
@@ -671,30 +1881,59 @@ namespace many {
 
       char* post(json& request, int* recv_length) {
         std::string json_string = request.dump();
+        return post(json_string.data(), json_string.size(), recv_length);
+      }
+
+      /**
+       * Posts a serialized request body.
+       *
+       * @param body The request body
+       * @param length The length of the body
+       * @param recv_length Set to the length of the response body, 0 if there was no response
+       * @return The response body, valid until the next request on the client
+       */
+      char* post(const char* body, size_t length, int* recv_length) {
+        ASSERT(length + 1024 < SEND_BUFFER_SIZE);
 
         int send_length = 0;
         send_length += sprintf(&_send_buffer[send_length], "POST / HTTP/1.1\r\n");
+        send_length += sprintf(&_send_buffer[send_length], "Host: %s\r\n", _host.c_str());
+        send_length += sprintf(&_send_buffer[send_length], "Connection: keep-alive\r\n");
         send_length += sprintf(&_send_buffer[send_length], "Content-Type: application/json\r\n");
-        send_length += sprintf(&_send_buffer[send_length], "Content-Length: %d\r\n", (int)json_string.size());
+        send_length += sprintf(&_send_buffer[send_length], "Content-Length: %d\r\n", (int)length);
         send_length += sprintf(&_send_buffer[send_length], "\r\n");
-        memcpy(&_send_buffer[send_length], json_string.c_str(), json_string.size());
-        send_length += json_string.size();
+        memcpy(&_send_buffer[send_length], body, length);
+        send_length += length;
 
-        write(_send_buffer, send_length);
+        *recv_length = 0;
+        if (!write(_send_buffer, send_length)) {
+          return _recv_buffer;
+        }
 
-        *recv_length = read(&_recv_buffer[*recv_length], 8192);
+        // Read until the end of the headers, which may span several reads
+        int received = 0;
+        char* headers_end = nullptr;
+        while (headers_end == nullptr) {
+          if (received + 8192 + 1 > (int)_recv_capacity) {
+            disconnect();
+            return _recv_buffer;
+          }
+          int ret = read(&_recv_buffer[received], 8192);
+          if (ret == 0) {
+            return _recv_buffer;
+          }
+          received += ret;
+          _recv_buffer[received] = '\0';
+          headers_end = strstr(_recv_buffer, "\r\n\r\n");
+        }
+        int header_length = (int)(headers_end - _recv_buffer) + 4;
+        *headers_end = '\0';
 
         int content_length = 0;
-        int header_length = 0;
-
-
+        bool keep_alive = true;
         char* saveptr;
         char* line = strtok_r(_recv_buffer, "\r\n", &saveptr);
         while (line != nullptr) {
-          if (line[0] == '{') {
-            header_length = (int)(line - _recv_buffer);
-            break;
-          }
           char* colon = strchr(line, ':');
           if (colon != nullptr) {
             *colon = '\0';
@@ -702,19 +1941,34 @@ namespace many {
             while (*value == ' ') {
               value++;
             }
-            std::string key = std::string(line);
-            if (key == "content-length" || key == "Content-Length") {
-              std::string val = std::string(value);
-              content_length = std::stoi(val);
+            if (strcasecmp(line, "content-length") == 0) {
+              content_length = std::stoi(std::string(value));
+            } else if (strcasecmp(line, "connection") == 0 && strcasecmp(value, "close") == 0) {
+              keep_alive = false;
             }
           }
           line = strtok_r(nullptr, "\r\n", &saveptr);
         }
 
-        while (*recv_length < header_length + content_length) {
-          *recv_length += read(&_recv_buffer[*recv_length], 65536);
+        // Grow the buffer for responses larger than it, such as full blocks
+        size_t total = (size_t)header_length + content_length;
+        if (total + 1 > _recv_capacity) {
+          _recv_capacity = total + 1;
+          _recv_pages.resize(_recv_capacity);
+          _recv_buffer = _recv_pages.data();
+        }
+
+        while (received < (int)total) {
+          int ret = read(&_recv_buffer[received], std::min(65536, (int)total - received));
+          if (ret == 0) {
+            return _recv_buffer;
+          }
+          received += ret;
         }
-        *recv_length -= header_length;
+        if (!keep_alive) {
+          disconnect();
+        }
+        *recv_length = content_length;
         return &_recv_buffer[header_length];
       }
 
@@ -726,7 +1980,19 @@ namespace many {
      * @param url The url endpoint for the POST request
      * @param request The json request object
      */
-    json post(const std::string url, json request) {
+    json post(const std::string url, json request);
+
+    /**
+     * Posts a serialized request body on a new connection and passes the response body to a callback, without
+     * copying it.
+     *
+     * @param url The url endpoint for the POST request
+     * @param body The request body
+     * @param length The length of the body
+     * @param on_response Called with the response body and its length, which are only valid during the call
+     */
+    template <typename F>
+    void post(const std::string& url, const char* body, size_t length, F on_response) {
       HttpClient client(url);
       client.connect();
       if (!client.is_connected()) {
@@ -734,916 +2000,443 @@ namespace many {
       }
 
       int response_length = 0;
-      char* response = client.post(request, &response_length);
+      const char* response = client.post(body, length, &response_length);
       client.disconnect();
-
-      // std::cout << response << std::endl;
-
-      return json::parse(std::string(response, response_length));
+      on_response(response, (size_t)response_length);
     }
 
-  } // namespace http
-
-  namespace libsodium {
-
     /**
-     * The following is based on https://github.com/jedisct1/libsodium
+     * A fixed set of keep-alive connections to one endpoint, shared by concurrent callers.
+     * Each caller holds a connection for the duration of one request, so at most `size()`
+     * requests are in flight at once and further callers block until one is released.
      */
+    class ConnectionPool {
+      const std::string _url;
+      std::vector<std::unique_ptr<HttpClient>> _clients;
+      std::vector<HttpClient*> _idle;
+      std::mutex _mutex;
+      std::condition_variable _released;
+      std::atomic<uint64_t> _connects{0};
+
+      HttpClient* acquire() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _released.wait(lock, [this]() { return !_idle.empty(); });
+        HttpClient* client = _idle.back();
+        _idle.pop_back();
+        return client;
+      }
 
-    typedef int32_t fe25519[10];
+      void release(HttpClient* client) {
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _idle.push_back(client);
+        }
+        _released.notify_one();
+      }
 
-    typedef struct {
-      fe25519 X;
-      fe25519 Y;
-      fe25519 Z;
-      fe25519 T;
-    } ge25519_p3;
+    public:
 
-    /* sqrt(-1) */
-    static const fe25519 fe25519_sqrtm1 = {
-      -32595792, -7943725,  9377950,  3500415, 12389472, -272473, -25146209, -2005654, 326686, 11406482
-    };
+      /**
+       * @param url The url endpoint for the POST requests
+       * @param size The number of connections, and so the maximum number of concurrent requests
+       */
+      ConnectionPool(const std::string& url, size_t size)
+        : _url(url)
+      {
+        ASSERT(size > 0);
+        for (size_t i = 0; i < size; i++) {
+          _clients.emplace_back(new HttpClient(url));
+          _idle.push_back(_clients.back().get());
+        }
+      }
 
-    /* 37095705934669439343138083508754565189542113879843219016388785533085940283555 */
-    static const fe25519 ed25519_d = {
-      -10913610, 13857413, -15372611, 6949391,   114729, -8787816, -6275908, -3247719, -18696448, -12055116
-    };
+      ConnectionPool(const ConnectionPool&) = delete;
+      ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+      /**
+       * Returns the number of connections in the pool
+       */
+      size_t size() const {
+        return _clients.size();
+      }
 
-    static inline uint64_t load_3(const unsigned char *in) {
-      uint64_t result;
+      /**
+       * Returns the number of TCP connections opened so far, which stays at `size()` while keep-alive holds
+       */
+      uint64_t connects() const {
+        return _connects.load();
+      }
 
-      result = (uint64_t) in[0];
-      result |= ((uint64_t) in[1]) << 8;
-      result |= ((uint64_t) in[2]) << 16;
+      /**
+       * Posts a json request on an idle connection, connecting it first if needed. A request on a
+       * kept-alive connection the server has since closed is retried once on a fresh connection.
+       *
+       * @param request The json request object, either a single request or a batch array
+       * @return The json response
+       */
+      json post(json request) {
+        std::string body = request.dump();
+        json response;
+        post(body.data(), body.size(), [&response](const char* data, size_t length) {
+          response = json::parse(data, data + length);
+        });
+        return response;
+      }
 
-      return result;
-    }
+      /**
+       * Posts a serialized request body on an idle connection like post(json), and passes the response body to a
+       * callback while the connection is held, without copying it.
+       *
+       * @param body The request body
+       * @param length The length of the body
+       * @param on_response Called with the response body and its length, which are only valid during the call
+       */
+      template <typename F>
+      void post(const char* body, size_t length, F on_response) {
+        HttpClient* client = acquire();
+        // Released however the callback returns
+        struct Held {
+          ConnectionPool& pool;
+          HttpClient* client;
+          ~Held() {
+            pool.release(client);
+          }
+        } held{*this, client};
+        for (int attempt = 0; attempt < 2; attempt++) {
+          bool reused = client->is_connected();
+          if (!reused) {
+            if (!client->connect()) {
+              throw std::runtime_error("Unable to connect to " + _url);
+            }
+            _connects++;
+          }
 
-    static inline uint64_t load_4(const unsigned char *in) {
-      uint64_t result;
+          int response_length = 0;
+          const char* response = client->post(body, length, &response_length);
+          if (response_length > 0) {
+            on_response(response, (size_t)response_length);
+            return;
+          }
 
-      result = (uint64_t) in[0];
-      result |= ((uint64_t) in[1]) << 8;
-      result |= ((uint64_t) in[2]) << 16;
-      result |= ((uint64_t) in[3]) << 24;
+          client->disconnect();
+          if (!reused) {
+            break;
+          }
+        }
+        throw std::runtime_error("No response from " + _url);
+      }
+    };
 
-      return result;
-    }
+  } // namespace http
 
-    int sodium_is_zero(const unsigned char *n, const size_t nlen) {
-      size_t                 i;
-      volatile unsigned char d = 0U;
+  namespace udp {
 
-      for (i = 0U; i < nlen; i++) {
-        d |= n[i];
+    /**
+     * Parses an IPv4 "ip:port" address
+     *
+     * @param address The address to parse
+     * @param sockaddr The parsed address
+     *
+     * @return False if the address is not a valid IPv4 address
+     */
+    inline bool parse_address(const std::string& address, sockaddr_in& sockaddr) {
+      size_t colon = address.rfind(':');
+      if (colon == std::string::npos) {
+        return false;
+      }
+      memset(&sockaddr, 0, sizeof(sockaddr));
+      sockaddr.sin_family = AF_INET;
+      char* end = nullptr;
+      long port = strtol(address.c_str() + colon + 1, &end, 10);
+      if (colon + 1 == address.size() || *end != '\0' || port < 0 || port > 65535 || inet_pton(AF_INET, address.substr(0, colon).c_str(), &sockaddr.sin_addr) != 1) {
+        return false;
       }
-      return 1 & ((d - 1) >> 8);
+      sockaddr.sin_port = htons((uint16_t)port);
+      return true;
     }
 
-    static inline void fe25519_1(fe25519 h) {
-      h[0] = 1;
-      h[1] = 0;
-      memset(&h[2], 0, 8 * sizeof h[0]);
-    }
+    /**
+     * A non-blocking UDP socket
+     */
+    class UdpSocket {
+      int _socket;
 
-    static inline void fe25519_add(fe25519 h, const fe25519 f, const fe25519 g) {
-      int32_t h0 = f[0] + g[0];
-      int32_t h1 = f[1] + g[1];
-      int32_t h2 = f[2] + g[2];
-      int32_t h3 = f[3] + g[3];
-      int32_t h4 = f[4] + g[4];
-      int32_t h5 = f[5] + g[5];
-      int32_t h6 = f[6] + g[6];
-      int32_t h7 = f[7] + g[7];
-      int32_t h8 = f[8] + g[8];
-      int32_t h9 = f[9] + g[9];
-
-      h[0] = h0;
-      h[1] = h1;
-      h[2] = h2;
-      h[3] = h3;
-      h[4] = h4;
-      h[5] = h5;
-      h[6] = h6;
-      h[7] = h7;
-      h[8] = h8;
-      h[9] = h9;
-    }
+    public:
 
-    static void fe25519_cmov(fe25519 f, const fe25519 g, unsigned int b) {
-      uint32_t mask = (uint32_t) (-(int32_t) b);
-      int32_t  f0, f1, f2, f3, f4, f5, f6, f7, f8, f9;
-      int32_t  x0, x1, x2, x3, x4, x5, x6, x7, x8, x9;
-
-      f0 = f[0];
-      f1 = f[1];
-      f2 = f[2];
-      f3 = f[3];
-      f4 = f[4];
-      f5 = f[5];
-      f6 = f[6];
-      f7 = f[7];
-      f8 = f[8];
-      f9 = f[9];
-
-      x0 = f0 ^ g[0];
-      x1 = f1 ^ g[1];
-      x2 = f2 ^ g[2];
-      x3 = f3 ^ g[3];
-      x4 = f4 ^ g[4];
-      x5 = f5 ^ g[5];
-      x6 = f6 ^ g[6];
-      x7 = f7 ^ g[7];
-      x8 = f8 ^ g[8];
-      x9 = f9 ^ g[9];
-
-    #ifdef HAVE_INLINE_ASM
-      __asm__ __volatile__("" : "+r"(mask));
-    #endif
+      UdpSocket() {
+        _socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (_socket < 0) {
+          throw std::runtime_error("Unable to create UDP socket.");
+        }
+        fcntl(_socket, F_SETFL, fcntl(_socket, F_GETFL, 0) | O_NONBLOCK);
+      }
 
-      x0 &= mask;
-      x1 &= mask;
-      x2 &= mask;
-      x3 &= mask;
-      x4 &= mask;
-      x5 &= mask;
-      x6 &= mask;
-      x7 &= mask;
-      x8 &= mask;
-      x9 &= mask;
-
-      f[0] = f0 ^ x0;
-      f[1] = f1 ^ x1;
-      f[2] = f2 ^ x2;
-      f[3] = f3 ^ x3;
-      f[4] = f4 ^ x4;
-      f[5] = f5 ^ x5;
-      f[6] = f6 ^ x6;
-      f[7] = f7 ^ x7;
-      f[8] = f8 ^ x8;
-      f[9] = f9 ^ x9;
-    }
+      ~UdpSocket() {
+        close(_socket);
+      }
 
-    void fe25519_frombytes(fe25519 h, const unsigned char *s) {
-      int64_t h0 = load_4(s);
-      int64_t h1 = load_3(s + 4) << 6;
-      int64_t h2 = load_3(s + 7) << 5;
-      int64_t h3 = load_3(s + 10) << 3;
-      int64_t h4 = load_3(s + 13) << 2;
-      int64_t h5 = load_4(s + 16);
-      int64_t h6 = load_3(s + 20) << 7;
-      int64_t h7 = load_3(s + 23) << 5;
-      int64_t h8 = load_3(s + 26) << 4;
-      int64_t h9 = (load_3(s + 29) & 8388607) << 2;
-
-      int64_t carry0;
-      int64_t carry1;
-      int64_t carry2;
-      int64_t carry3;
-      int64_t carry4;
-      int64_t carry5;
-      int64_t carry6;
-      int64_t carry7;
-      int64_t carry8;
-      int64_t carry9;
-
-      carry9 = (h9 + (int64_t)(1L << 24)) >> 25;
-      h0 += carry9 * 19;
-      h9 -= carry9 * ((uint64_t) 1L << 25);
-      carry1 = (h1 + (int64_t)(1L << 24)) >> 25;
-      h2 += carry1;
-      h1 -= carry1 * ((uint64_t) 1L << 25);
-      carry3 = (h3 + (int64_t)(1L << 24)) >> 25;
-      h4 += carry3;
-      h3 -= carry3 * ((uint64_t) 1L << 25);
-      carry5 = (h5 + (int64_t)(1L << 24)) >> 25;
-      h6 += carry5;
-      h5 -= carry5 * ((uint64_t) 1L << 25);
-      carry7 = (h7 + (int64_t)(1L << 24)) >> 25;
-      h8 += carry7;
-      h7 -= carry7 * ((uint64_t) 1L << 25);
-
-      carry0 = (h0 + (int64_t)(1L << 25)) >> 26;
-      h1 += carry0;
-      h0 -= carry0 * ((uint64_t) 1L << 26);
-      carry2 = (h2 + (int64_t)(1L << 25)) >> 26;
-      h3 += carry2;
-      h2 -= carry2 * ((uint64_t) 1L << 26);
-      carry4 = (h4 + (int64_t)(1L << 25)) >> 26;
-      h5 += carry4;
-      h4 -= carry4 * ((uint64_t) 1L << 26);
-      carry6 = (h6 + (int64_t)(1L << 25)) >> 26;
-      h7 += carry6;
-      h6 -= carry6 * ((uint64_t) 1L << 26);
-      carry8 = (h8 + (int64_t)(1L << 25)) >> 26;
-      h9 += carry8;
-      h8 -= carry8 * ((uint64_t) 1L << 26);
-
-      h[0] = (int32_t) h0;
-      h[1] = (int32_t) h1;
-      h[2] = (int32_t) h2;
-      h[3] = (int32_t) h3;
-      h[4] = (int32_t) h4;
-      h[5] = (int32_t) h5;
-      h[6] = (int32_t) h6;
-      h[7] = (int32_t) h7;
-      h[8] = (int32_t) h8;
-      h[9] = (int32_t) h9;
-    }
+      UdpSocket(const UdpSocket&) = delete;
+      UdpSocket(UdpSocket&&) = delete;
+      UdpSocket& operator=(const UdpSocket&) = delete;
+      UdpSocket& operator=(UdpSocket&&) = delete;
+
+      /**
+       * Binds the socket to a local address, port 0 picks a free port
+       *
+       * @param address The "ip:port" address to bind to
+       */
+      bool bind(const std::string& address) {
+        sockaddr_in sockaddr;
+        if (!parse_address(address, sockaddr)) {
+          return false;
+        }
+        return ::bind(_socket, (struct sockaddr*)&sockaddr, sizeof(sockaddr)) == 0;
+      }
 
-    static void fe25519_reduce(fe25519 h, const fe25519 f) {
-      int32_t h0 = f[0];
-      int32_t h1 = f[1];
-      int32_t h2 = f[2];
-      int32_t h3 = f[3];
-      int32_t h4 = f[4];
-      int32_t h5 = f[5];
-      int32_t h6 = f[6];
-      int32_t h7 = f[7];
-      int32_t h8 = f[8];
-      int32_t h9 = f[9];
-
-      int32_t q;
-      int32_t carry0, carry1, carry2, carry3, carry4, carry5, carry6, carry7, carry8, carry9;
-
-      q = (19 * h9 + ((uint32_t) 1L << 24)) >> 25;
-      q = (h0 + q) >> 26;
-      q = (h1 + q) >> 25;
-      q = (h2 + q) >> 26;
-      q = (h3 + q) >> 25;
-      q = (h4 + q) >> 26;
-      q = (h5 + q) >> 25;
-      q = (h6 + q) >> 26;
-      q = (h7 + q) >> 25;
-      q = (h8 + q) >> 26;
-      q = (h9 + q) >> 25;
-
-      /* Goal: Output h-(2^255-19)q, which is between 0 and 2^255-20. */
-      h0 += 19 * q;
-      /* Goal: Output h-2^255 q, which is between 0 and 2^255-20. */
-      carry0 = h0 >> 26;
-      h1 += carry0;
-      h0 -= carry0 * ((uint32_t) 1L << 26);
-      carry1 = h1 >> 25;
-      h2 += carry1;
-      h1 -= carry1 * ((uint32_t) 1L << 25);
-      carry2 = h2 >> 26;
-      h3 += carry2;
-      h2 -= carry2 * ((uint32_t) 1L << 26);
-      carry3 = h3 >> 25;
-      h4 += carry3;
-      h3 -= carry3 * ((uint32_t) 1L << 25);
-      carry4 = h4 >> 26;
-      h5 += carry4;
-      h4 -= carry4 * ((uint32_t) 1L << 26);
-      carry5 = h5 >> 25;
-      h6 += carry5;
-      h5 -= carry5 * ((uint32_t) 1L << 25);
-      carry6 = h6 >> 26;
-      h7 += carry6;
-      h6 -= carry6 * ((uint32_t) 1L << 26);
-      carry7 = h7 >> 25;
-      h8 += carry7;
-      h7 -= carry7 * ((uint32_t) 1L << 25);
-      carry8 = h8 >> 26;
-      h9 += carry8;
-      h8 -= carry8 * ((uint32_t) 1L << 26);
-      carry9 = h9 >> 25;
-      h9 -= carry9 * ((uint32_t) 1L << 25);
-
-      h[0] = h0;
-      h[1] = h1;
-      h[2] = h2;
-      h[3] = h3;
-      h[4] = h4;
-      h[5] = h5;
-      h[6] = h6;
-      h[7] = h7;
-      h[8] = h8;
-      h[9] = h9;
-    }
+      /**
+       * Returns the local port of a bound socket
+       */
+      uint16_t port() const {
+        sockaddr_in sockaddr;
+        socklen_t length = sizeof(sockaddr);
+        if (getsockname(_socket, (struct sockaddr*)&sockaddr, &length) != 0) {
+          return 0;
+        }
+        return ntohs(sockaddr.sin_port);
+      }
 
-    void fe25519_tobytes(unsigned char *s, const fe25519 h) {
-      fe25519 t;
-
-      fe25519_reduce(t, h);
-      s[0]  = t[0] >> 0;
-      s[1]  = t[0] >> 8;
-      s[2]  = t[0] >> 16;
-      s[3]  = (t[0] >> 24) | (t[1] * ((uint32_t) 1 << 2));
-      s[4]  = t[1] >> 6;
-      s[5]  = t[1] >> 14;
-      s[6]  = (t[1] >> 22) | (t[2] * ((uint32_t) 1 << 3));
-      s[7]  = t[2] >> 5;
-      s[8]  = t[2] >> 13;
-      s[9]  = (t[2] >> 21) | (t[3] * ((uint32_t) 1 << 5));
-      s[10] = t[3] >> 3;
-      s[11] = t[3] >> 11;
-      s[12] = (t[3] >> 19) | (t[4] * ((uint32_t) 1 << 6));
-      s[13] = t[4] >> 2;
-      s[14] = t[4] >> 10;
-      s[15] = t[4] >> 18;
-      s[16] = t[5] >> 0;
-      s[17] = t[5] >> 8;
-      s[18] = t[5] >> 16;
-      s[19] = (t[5] >> 24) | (t[6] * ((uint32_t) 1 << 1));
-      s[20] = t[6] >> 7;
-      s[21] = t[6] >> 15;
-      s[22] = (t[6] >> 23) | (t[7] * ((uint32_t) 1 << 3));
-      s[23] = t[7] >> 5;
-      s[24] = t[7] >> 13;
-      s[25] = (t[7] >> 21) | (t[8] * ((uint32_t) 1 << 4));
-      s[26] = t[8] >> 4;
-      s[27] = t[8] >> 12;
-      s[28] = (t[8] >> 20) | (t[9] * ((uint32_t) 1 << 6));
-      s[29] = t[9] >> 2;
-      s[30] = t[9] >> 10;
-      s[31] = t[9] >> 18;
-    }
+      /**
+       * Sends a datagram
+       *
+       * @param destination The destination address
+       * @param data The datagram
+       * @param length The length of the datagram
+       */
+      bool send_to(const sockaddr_in& destination, const uint8_t* data, size_t length) {
+        return sendto(_socket, data, length, 0, (const struct sockaddr*)&destination, sizeof(destination)) == (ssize_t)length;
+      }
 
-    static inline int fe25519_isnegative(const fe25519 f) {
-      unsigned char s[32];
+      /**
+       * Receives a datagram if one is available
+       *
+       * @param buffer The buffer to receive into
+       * @param size The size of the buffer
+       *
+       * @return The length of the datagram, or -1 if none is available
+       */
+      ssize_t receive(uint8_t* buffer, size_t size) {
+        return recv(_socket, buffer, size, 0);
+      }
+    };
 
-      fe25519_tobytes(s, f);
+  } // namespace udp
 
-      return s[0] & 1;
-    }
+  namespace libsodium {
 
-    static inline int fe25519_iszero(const fe25519 f) {
-      unsigned char s[32];
+    /**
+     * The following is based on https://github.com/jedisct1/libsodium
+     */
 
-      fe25519_tobytes(s, f);
+    typedef int32_t fe25519[10];
 
-      return sodium_is_zero(s, 32);
-    }
+    typedef struct {
+      fe25519 X;
+      fe25519 Y;
+      fe25519 Z;
+      fe25519 T;
+    } ge25519_p3;
 
-    static void fe25519_mul(fe25519 h, const fe25519 f, const fe25519 g) {
-      int32_t f0 = f[0];
-      int32_t f1 = f[1];
-      int32_t f2 = f[2];
-      int32_t f3 = f[3];
-      int32_t f4 = f[4];
-      int32_t f5 = f[5];
-      int32_t f6 = f[6];
-      int32_t f7 = f[7];
-      int32_t f8 = f[8];
-      int32_t f9 = f[9];
-
-      int32_t g0 = g[0];
-      int32_t g1 = g[1];
-      int32_t g2 = g[2];
-      int32_t g3 = g[3];
-      int32_t g4 = g[4];
-      int32_t g5 = g[5];
-      int32_t g6 = g[6];
-      int32_t g7 = g[7];
-      int32_t g8 = g[8];
-      int32_t g9 = g[9];
-
-      int32_t g1_19 = 19 * g1; /* 1.959375*2^29 */
-      int32_t g2_19 = 19 * g2; /* 1.959375*2^30; still ok */
-      int32_t g3_19 = 19 * g3;
-      int32_t g4_19 = 19 * g4;
-      int32_t g5_19 = 19 * g5;
-      int32_t g6_19 = 19 * g6;
-      int32_t g7_19 = 19 * g7;
-      int32_t g8_19 = 19 * g8;
-      int32_t g9_19 = 19 * g9;
-      int32_t f1_2  = 2 * f1;
-      int32_t f3_2  = 2 * f3;
-      int32_t f5_2  = 2 * f5;
-      int32_t f7_2  = 2 * f7;
-      int32_t f9_2  = 2 * f9;
-
-      int64_t f0g0    = f0 * (int64_t) g0;
-      int64_t f0g1    = f0 * (int64_t) g1;
-      int64_t f0g2    = f0 * (int64_t) g2;
-      int64_t f0g3    = f0 * (int64_t) g3;
-      int64_t f0g4    = f0 * (int64_t) g4;
-      int64_t f0g5    = f0 * (int64_t) g5;
-      int64_t f0g6    = f0 * (int64_t) g6;
-      int64_t f0g7    = f0 * (int64_t) g7;
-      int64_t f0g8    = f0 * (int64_t) g8;
-      int64_t f0g9    = f0 * (int64_t) g9;
-      int64_t f1g0    = f1 * (int64_t) g0;
-      int64_t f1g1_2  = f1_2 * (int64_t) g1;
-      int64_t f1g2    = f1 * (int64_t) g2;
-      int64_t f1g3_2  = f1_2 * (int64_t) g3;
-      int64_t f1g4    = f1 * (int64_t) g4;
-      int64_t f1g5_2  = f1_2 * (int64_t) g5;
-      int64_t f1g6    = f1 * (int64_t) g6;
-      int64_t f1g7_2  = f1_2 * (int64_t) g7;
-      int64_t f1g8    = f1 * (int64_t) g8;
-      int64_t f1g9_38 = f1_2 * (int64_t) g9_19;
-      int64_t f2g0    = f2 * (int64_t) g0;
-      int64_t f2g1    = f2 * (int64_t) g1;
-      int64_t f2g2    = f2 * (int64_t) g2;
-      int64_t f2g3    = f2 * (int64_t) g3;
-      int64_t f2g4    = f2 * (int64_t) g4;
-      int64_t f2g5    = f2 * (int64_t) g5;
-      int64_t f2g6    = f2 * (int64_t) g6;
-      int64_t f2g7    = f2 * (int64_t) g7;
-      int64_t f2g8_19 = f2 * (int64_t) g8_19;
-      int64_t f2g9_19 = f2 * (int64_t) g9_19;
-      int64_t f3g0    = f3 * (int64_t) g0;
-      int64_t f3g1_2  = f3_2 * (int64_t) g1;
-      int64_t f3g2    = f3 * (int64_t) g2;
-      int64_t f3g3_2  = f3_2 * (int64_t) g3;
-      int64_t f3g4    = f3 * (int64_t) g4;
-      int64_t f3g5_2  = f3_2 * (int64_t) g5;
-      int64_t f3g6    = f3 * (int64_t) g6;
-      int64_t f3g7_38 = f3_2 * (int64_t) g7_19;
-      int64_t f3g8_19 = f3 * (int64_t) g8_19;
-      int64_t f3g9_38 = f3_2 * (int64_t) g9_19;
-      int64_t f4g0    = f4 * (int64_t) g0;
-      int64_t f4g1    = f4 * (int64_t) g1;
-      int64_t f4g2    = f4 * (int64_t) g2;
-      int64_t f4g3    = f4 * (int64_t) g3;
-      int64_t f4g4    = f4 * (int64_t) g4;
-      int64_t f4g5    = f4 * (int64_t) g5;
-      int64_t f4g6_19 = f4 * (int64_t) g6_19;
-      int64_t f4g7_19 = f4 * (int64_t) g7_19;
-      int64_t f4g8_19 = f4 * (int64_t) g8_19;
-      int64_t f4g9_19 = f4 * (int64_t) g9_19;
-      int64_t f5g0    = f5 * (int64_t) g0;
-      int64_t f5g1_2  = f5_2 * (int64_t) g1;
-      int64_t f5g2    = f5 * (int64_t) g2;
-      int64_t f5g3_2  = f5_2 * (int64_t) g3;
-      int64_t f5g4    = f5 * (int64_t) g4;
-      int64_t f5g5_38 = f5_2 * (int64_t) g5_19;
-      int64_t f5g6_19 = f5 * (int64_t) g6_19;
-      int64_t f5g7_38 = f5_2 * (int64_t) g7_19;
-      int64_t f5g8_19 = f5 * (int64_t) g8_19;
-      int64_t f5g9_38 = f5_2 * (int64_t) g9_19;
-      int64_t f6g0    = f6 * (int64_t) g0;
-      int64_t f6g1    = f6 * (int64_t) g1;
-      int64_t f6g2    = f6 * (int64_t) g2;
-      int64_t f6g3    = f6 * (int64_t) g3;
-      int64_t f6g4_19 = f6 * (int64_t) g4_19;
-      int64_t f6g5_19 = f6 * (int64_t) g5_19;
-      int64_t f6g6_19 = f6 * (int64_t) g6_19;
-      int64_t f6g7_19 = f6 * (int64_t) g7_19;
-      int64_t f6g8_19 = f6 * (int64_t) g8_19;
-      int64_t f6g9_19 = f6 * (int64_t) g9_19;
-      int64_t f7g0    = f7 * (int64_t) g0;
-      int64_t f7g1_2  = f7_2 * (int64_t) g1;
-      int64_t f7g2    = f7 * (int64_t) g2;
-      int64_t f7g3_38 = f7_2 * (int64_t) g3_19;
-      int64_t f7g4_19 = f7 * (int64_t) g4_19;
-      int64_t f7g5_38 = f7_2 * (int64_t) g5_19;
-      int64_t f7g6_19 = f7 * (int64_t) g6_19;
-      int64_t f7g7_38 = f7_2 * (int64_t) g7_19;
-      int64_t f7g8_19 = f7 * (int64_t) g8_19;
-      int64_t f7g9_38 = f7_2 * (int64_t) g9_19;
-      int64_t f8g0    = f8 * (int64_t) g0;
-      int64_t f8g1    = f8 * (int64_t) g1;
-      int64_t f8g2_19 = f8 * (int64_t) g2_19;
-      int64_t f8g3_19 = f8 * (int64_t) g3_19;
-      int64_t f8g4_19 = f8 * (int64_t) g4_19;
-      int64_t f8g5_19 = f8 * (int64_t) g5_19;
-      int64_t f8g6_19 = f8 * (int64_t) g6_19;
-      int64_t f8g7_19 = f8 * (int64_t) g7_19;
-      int64_t f8g8_19 = f8 * (int64_t) g8_19;
-      int64_t f8g9_19 = f8 * (int64_t) g9_19;
-      int64_t f9g0    = f9 * (int64_t) g0;
-      int64_t f9g1_38 = f9_2 * (int64_t) g1_19;
-      int64_t f9g2_19 = f9 * (int64_t) g2_19;
-      int64_t f9g3_38 = f9_2 * (int64_t) g3_19;
-      int64_t f9g4_19 = f9 * (int64_t) g4_19;
-      int64_t f9g5_38 = f9_2 * (int64_t) g5_19;
-      int64_t f9g6_19 = f9 * (int64_t) g6_19;
-      int64_t f9g7_38 = f9_2 * (int64_t) g7_19;
-      int64_t f9g8_19 = f9 * (int64_t) g8_19;
-      int64_t f9g9_38 = f9_2 * (int64_t) g9_19;
-
-      int64_t h0 = f0g0 + f1g9_38 + f2g8_19 + f3g7_38 + f4g6_19 + f5g5_38 +
-                  f6g4_19 + f7g3_38 + f8g2_19 + f9g1_38;
-      int64_t h1 = f0g1 + f1g0 + f2g9_19 + f3g8_19 + f4g7_19 + f5g6_19 + f6g5_19 +
-                  f7g4_19 + f8g3_19 + f9g2_19;
-      int64_t h2 = f0g2 + f1g1_2 + f2g0 + f3g9_38 + f4g8_19 + f5g7_38 + f6g6_19 +
-                  f7g5_38 + f8g4_19 + f9g3_38;
-      int64_t h3 = f0g3 + f1g2 + f2g1 + f3g0 + f4g9_19 + f5g8_19 + f6g7_19 +
-                  f7g6_19 + f8g5_19 + f9g4_19;
-      int64_t h4 = f0g4 + f1g3_2 + f2g2 + f3g1_2 + f4g0 + f5g9_38 + f6g8_19 +
-                  f7g7_38 + f8g6_19 + f9g5_38;
-      int64_t h5 = f0g5 + f1g4 + f2g3 + f3g2 + f4g1 + f5g0 + f6g9_19 + f7g8_19 +
-                  f8g7_19 + f9g6_19;
-      int64_t h6 = f0g6 + f1g5_2 + f2g4 + f3g3_2 + f4g2 + f5g1_2 + f6g0 +
-                  f7g9_38 + f8g8_19 + f9g7_38;
-      int64_t h7 = f0g7 + f1g6 + f2g5 + f3g4 + f4g3 + f5g2 + f6g1 + f7g0 +
-                  f8g9_19 + f9g8_19;
-      int64_t h8 = f0g8 + f1g7_2 + f2g6 + f3g5_2 + f4g4 + f5g3_2 + f6g2 + f7g1_2 +
-                  f8g0 + f9g9_38;
-      int64_t h9 =
-          f0g9 + f1g8 + f2g7 + f3g6 + f4g5 + f5g4 + f6g3 + f7g2 + f8g1 + f9g0;
-
-      int64_t carry0;
-      int64_t carry1;
-      int64_t carry2;
-      int64_t carry3;
-      int64_t carry4;
-      int64_t carry5;
-      int64_t carry6;
-      int64_t carry7;
-      int64_t carry8;
-      int64_t carry9;
-
-      /*
-      |h0| <= (1.65*1.65*2^52*(1+19+19+19+19)+1.65*1.65*2^50*(38+38+38+38+38))
-      i.e. |h0| <= 1.4*2^60; narrower ranges for h2, h4, h6, h8
-      |h1| <= (1.65*1.65*2^51*(1+1+19+19+19+19+19+19+19+19))
-      i.e. |h1| <= 1.7*2^59; narrower ranges for h3, h5, h7, h9
-      */
-
-      carry0 = (h0 + (int64_t)(1L << 25)) >> 26;
-      h1 += carry0;
-      h0 -= carry0 * ((uint64_t) 1L << 26);
-      carry4 = (h4 + (int64_t)(1L << 25)) >> 26;
-      h5 += carry4;
-      h4 -= carry4 * ((uint64_t) 1L << 26);
-      /* |h0| <= 2^25 */
-      /* |h4| <= 2^25 */
-      /* |h1| <= 1.71*2^59 */
-      /* |h5| <= 1.71*2^59 */
-
-      carry1 = (h1 + (int64_t)(1L << 24)) >> 25;
-      h2 += carry1;
-      h1 -= carry1 * ((uint64_t) 1L << 25);
-      carry5 = (h5 + (int64_t)(1L << 24)) >> 25;
-      h6 += carry5;
-      h5 -= carry5 * ((uint64_t) 1L << 25);
-      /* |h1| <= 2^24; from now on fits into int32 */
-      /* |h5| <= 2^24; from now on fits into int32 */
-      /* |h2| <= 1.41*2^60 */
-      /* |h6| <= 1.41*2^60 */
-
-      carry2 = (h2 + (int64_t)(1L << 25)) >> 26;
-      h3 += carry2;
-      h2 -= carry2 * ((uint64_t) 1L << 26);
-      carry6 = (h6 + (int64_t)(1L << 25)) >> 26;
-      h7 += carry6;
-      h6 -= carry6 * ((uint64_t) 1L << 26);
-      /* |h2| <= 2^25; from now on fits into int32 unchanged */
-      /* |h6| <= 2^25; from now on fits into int32 unchanged */
-      /* |h3| <= 1.71*2^59 */
-      /* |h7| <= 1.71*2^59 */
-
-      carry3 = (h3 + (int64_t)(1L << 24)) >> 25;
-      h4 += carry3;
-      h3 -= carry3 * ((uint64_t) 1L << 25);
-      carry7 = (h7 + (int64_t)(1L << 24)) >> 25;
-      h8 += carry7;
-      h7 -= carry7 * ((uint64_t) 1L << 25);
-      /* |h3| <= 2^24; from now on fits into int32 unchanged */
-      /* |h7| <= 2^24; from now on fits into int32 unchanged */
-      /* |h4| <= 1.72*2^34 */
-      /* |h8| <= 1.41*2^60 */
-
-      carry4 = (h4 + (int64_t)(1L << 25)) >> 26;
-      h5 += carry4;
-      h4 -= carry4 * ((uint64_t) 1L << 26);
-      carry8 = (h8 + (int64_t)(1L << 25)) >> 26;
-      h9 += carry8;
-      h8 -= carry8 * ((uint64_t) 1L << 26);
-      /* |h4| <= 2^25; from now on fits into int32 unchanged */
-      /* |h8| <= 2^25; from now on fits into int32 unchanged */
-      /* |h5| <= 1.01*2^24 */
-      /* |h9| <= 1.71*2^59 */
-
-      carry9 = (h9 + (int64_t)(1L << 24)) >> 25;
-      h0 += carry9 * 19;
-      h9 -= carry9 * ((uint64_t) 1L << 25);
-      /* |h9| <= 2^24; from now on fits into int32 unchanged */
-      /* |h0| <= 1.1*2^39 */
-
-      carry0 = (h0 + (int64_t)(1L << 25)) >> 26;
-      h1 += carry0;
-      h0 -= carry0 * ((uint64_t) 1L << 26);
-      /* |h0| <= 2^25; from now on fits into int32 unchanged */
-      /* |h1| <= 1.01*2^24 */
-
-      h[0] = (int32_t) h0;
-      h[1] = (int32_t) h1;
-      h[2] = (int32_t) h2;
-      h[3] = (int32_t) h3;
-      h[4] = (int32_t) h4;
-      h[5] = (int32_t) h5;
-      h[6] = (int32_t) h6;
-      h[7] = (int32_t) h7;
-      h[8] = (int32_t) h8;
-      h[9] = (int32_t) h9;
-    }
+    int sodium_is_zero(const unsigned char *n, const size_t nlen);
+    void fe25519_frombytes(fe25519 h, const unsigned char *s);
+    void fe25519_tobytes(unsigned char *s, const fe25519 h);
+    int ge25519_is_canonical(const unsigned char *s);
+    int ge25519_frombytes(ge25519_p3 *h, const unsigned char *s);
 
-    static inline void fe25519_neg(fe25519 h, const fe25519 f) {
-      int32_t h0 = -f[0];
-      int32_t h1 = -f[1];
-      int32_t h2 = -f[2];
-      int32_t h3 = -f[3];
-      int32_t h4 = -f[4];
-      int32_t h5 = -f[5];
-      int32_t h6 = -f[6];
-      int32_t h7 = -f[7];
-      int32_t h8 = -f[8];
-      int32_t h9 = -f[9];
-
-      h[0] = h0;
-      h[1] = h1;
-      h[2] = h2;
-      h[3] = h3;
-      h[4] = h4;
-      h[5] = h5;
-      h[6] = h6;
-      h[7] = h7;
-      h[8] = h8;
-      h[9] = h9;
-    }
+  } // namespace libsodium
 
-    static void fe25519_sq(fe25519 h, const fe25519 f) {
-      int32_t f0 = f[0];
-      int32_t f1 = f[1];
-      int32_t f2 = f[2];
-      int32_t f3 = f[3];
-      int32_t f4 = f[4];
-      int32_t f5 = f[5];
-      int32_t f6 = f[6];
-      int32_t f7 = f[7];
-      int32_t f8 = f[8];
-      int32_t f9 = f[9];
-
-      int32_t f0_2  = 2 * f0;
-      int32_t f1_2  = 2 * f1;
-      int32_t f2_2  = 2 * f2;
-      int32_t f3_2  = 2 * f3;
-      int32_t f4_2  = 2 * f4;
-      int32_t f5_2  = 2 * f5;
-      int32_t f6_2  = 2 * f6;
-      int32_t f7_2  = 2 * f7;
-      int32_t f5_38 = 38 * f5; /* 1.959375*2^30 */
-      int32_t f6_19 = 19 * f6; /* 1.959375*2^30 */
-      int32_t f7_38 = 38 * f7; /* 1.959375*2^30 */
-      int32_t f8_19 = 19 * f8; /* 1.959375*2^30 */
-      int32_t f9_38 = 38 * f9; /* 1.959375*2^30 */
-
-      int64_t f0f0    = f0 * (int64_t) f0;
-      int64_t f0f1_2  = f0_2 * (int64_t) f1;
-      int64_t f0f2_2  = f0_2 * (int64_t) f2;
-      int64_t f0f3_2  = f0_2 * (int64_t) f3;
-      int64_t f0f4_2  = f0_2 * (int64_t) f4;
-      int64_t f0f5_2  = f0_2 * (int64_t) f5;
-      int64_t f0f6_2  = f0_2 * (int64_t) f6;
-      int64_t f0f7_2  = f0_2 * (int64_t) f7;
-      int64_t f0f8_2  = f0_2 * (int64_t) f8;
-      int64_t f0f9_2  = f0_2 * (int64_t) f9;
-      int64_t f1f1_2  = f1_2 * (int64_t) f1;
-      int64_t f1f2_2  = f1_2 * (int64_t) f2;
-      int64_t f1f3_4  = f1_2 * (int64_t) f3_2;
-      int64_t f1f4_2  = f1_2 * (int64_t) f4;
-      int64_t f1f5_4  = f1_2 * (int64_t) f5_2;
-      int64_t f1f6_2  = f1_2 * (int64_t) f6;
-      int64_t f1f7_4  = f1_2 * (int64_t) f7_2;
-      int64_t f1f8_2  = f1_2 * (int64_t) f8;
-      int64_t f1f9_76 = f1_2 * (int64_t) f9_38;
-      int64_t f2f2    = f2 * (int64_t) f2;
-      int64_t f2f3_2  = f2_2 * (int64_t) f3;
-      int64_t f2f4_2  = f2_2 * (int64_t) f4;
-      int64_t f2f5_2  = f2_2 * (int64_t) f5;
-      int64_t f2f6_2  = f2_2 * (int64_t) f6;
-      int64_t f2f7_2  = f2_2 * (int64_t) f7;
-      int64_t f2f8_38 = f2_2 * (int64_t) f8_19;
-      int64_t f2f9_38 = f2 * (int64_t) f9_38;
-      int64_t f3f3_2  = f3_2 * (int64_t) f3;
-      int64_t f3f4_2  = f3_2 * (int64_t) f4;
-      int64_t f3f5_4  = f3_2 * (int64_t) f5_2;
-      int64_t f3f6_2  = f3_2 * (int64_t) f6;
-      int64_t f3f7_76 = f3_2 * (int64_t) f7_38;
-      int64_t f3f8_38 = f3_2 * (int64_t) f8_19;
-      int64_t f3f9_76 = f3_2 * (int64_t) f9_38;
-      int64_t f4f4    = f4 * (int64_t) f4;
-      int64_t f4f5_2  = f4_2 * (int64_t) f5;
-      int64_t f4f6_38 = f4_2 * (int64_t) f6_19;
-      int64_t f4f7_38 = f4 * (int64_t) f7_38;
-      int64_t f4f8_38 = f4_2 * (int64_t) f8_19;
-      int64_t f4f9_38 = f4 * (int64_t) f9_38;
-      int64_t f5f5_38 = f5 * (int64_t) f5_38;
-      int64_t f5f6_38 = f5_2 * (int64_t) f6_19;
-      int64_t f5f7_76 = f5_2 * (int64_t) f7_38;
-      int64_t f5f8_38 = f5_2 * (int64_t) f8_19;
-      int64_t f5f9_76 = f5_2 * (int64_t) f9_38;
-      int64_t f6f6_19 = f6 * (int64_t) f6_19;
-      int64_t f6f7_38 = f6 * (int64_t) f7_38;
-      int64_t f6f8_38 = f6_2 * (int64_t) f8_19;
-      int64_t f6f9_38 = f6 * (int64_t) f9_38;
-      int64_t f7f7_38 = f7 * (int64_t) f7_38;
-      int64_t f7f8_38 = f7_2 * (int64_t) f8_19;
-      int64_t f7f9_76 = f7_2 * (int64_t) f9_38;
-      int64_t f8f8_19 = f8 * (int64_t) f8_19;
-      int64_t f8f9_38 = f8 * (int64_t) f9_38;
-      int64_t f9f9_38 = f9 * (int64_t) f9_38;
-
-      int64_t h0 = f0f0 + f1f9_76 + f2f8_38 + f3f7_76 + f4f6_38 + f5f5_38;
-      int64_t h1 = f0f1_2 + f2f9_38 + f3f8_38 + f4f7_38 + f5f6_38;
-      int64_t h2 = f0f2_2 + f1f1_2 + f3f9_76 + f4f8_38 + f5f7_76 + f6f6_19;
-      int64_t h3 = f0f3_2 + f1f2_2 + f4f9_38 + f5f8_38 + f6f7_38;
-      int64_t h4 = f0f4_2 + f1f3_4 + f2f2 + f5f9_76 + f6f8_38 + f7f7_38;
-      int64_t h5 = f0f5_2 + f1f4_2 + f2f3_2 + f6f9_38 + f7f8_38;
-      int64_t h6 = f0f6_2 + f1f5_4 + f2f4_2 + f3f3_2 + f7f9_76 + f8f8_19;
-      int64_t h7 = f0f7_2 + f1f6_2 + f2f5_2 + f3f4_2 + f8f9_38;
-      int64_t h8 = f0f8_2 + f1f7_4 + f2f6_2 + f3f5_4 + f4f4 + f9f9_38;
-      int64_t h9 = f0f9_2 + f1f8_2 + f2f7_2 + f3f6_2 + f4f5_2;
-
-      int64_t carry0;
-      int64_t carry1;
-      int64_t carry2;
-      int64_t carry3;
-      int64_t carry4;
-      int64_t carry5;
-      int64_t carry6;
-      int64_t carry7;
-      int64_t carry8;
-      int64_t carry9;
-
-      carry0 = (h0 + (int64_t)(1L << 25)) >> 26;
-      h1 += carry0;
-      h0 -= carry0 * ((uint64_t) 1L << 26);
-      carry4 = (h4 + (int64_t)(1L << 25)) >> 26;
-      h5 += carry4;
-      h4 -= carry4 * ((uint64_t) 1L << 26);
-
-      carry1 = (h1 + (int64_t)(1L << 24)) >> 25;
-      h2 += carry1;
-      h1 -= carry1 * ((uint64_t) 1L << 25);
-      carry5 = (h5 + (int64_t)(1L << 24)) >> 25;
-      h6 += carry5;
-      h5 -= carry5 * ((uint64_t) 1L << 25);
-
-      carry2 = (h2 + (int64_t)(1L << 25)) >> 26;
-      h3 += carry2;
-      h2 -= carry2 * ((uint64_t) 1L << 26);
-      carry6 = (h6 + (int64_t)(1L << 25)) >> 26;
-      h7 += carry6;
-      h6 -= carry6 * ((uint64_t) 1L << 26);
-
-      carry3 = (h3 + (int64_t)(1L << 24)) >> 25;
-      h4 += carry3;
-      h3 -= carry3 * ((uint64_t) 1L << 25);
-      carry7 = (h7 + (int64_t)(1L << 24)) >> 25;
-      h8 += carry7;
-      h7 -= carry7 * ((uint64_t) 1L << 25);
-
-      carry4 = (h4 + (int64_t)(1L << 25)) >> 26;
-      h5 += carry4;
-      h4 -= carry4 * ((uint64_t) 1L << 26);
-      carry8 = (h8 + (int64_t)(1L << 25)) >> 26;
-      h9 += carry8;
-      h8 -= carry8 * ((uint64_t) 1L << 26);
-
-      carry9 = (h9 + (int64_t)(1L << 24)) >> 25;
-      h0 += carry9 * 19;
-      h9 -= carry9 * ((uint64_t) 1L << 25);
-
-      carry0 = (h0 + (int64_t)(1L << 25)) >> 26;
-      h1 += carry0;
-      h0 -= carry0 * ((uint64_t) 1L << 26);
-
-      h[0] = (int32_t) h0;
-      h[1] = (int32_t) h1;
-      h[2] = (int32_t) h2;
-      h[3] = (int32_t) h3;
-      h[4] = (int32_t) h4;
-      h[5] = (int32_t) h5;
-      h[6] = (int32_t) h6;
-      h[7] = (int32_t) h7;
-      h[8] = (int32_t) h8;
-      h[9] = (int32_t) h9;
-    }
+  namespace websockets {
 
-    static void fe25519_sub(fe25519 h, const fe25519 f, const fe25519 g) {
-      int32_t h0 = f[0] - g[0];
-      int32_t h1 = f[1] - g[1];
-      int32_t h2 = f[2] - g[2];
-      int32_t h3 = f[3] - g[3];
-      int32_t h4 = f[4] - g[4];
-      int32_t h5 = f[5] - g[5];
-      int32_t h6 = f[6] - g[6];
-      int32_t h7 = f[7] - g[7];
-      int32_t h8 = f[8] - g[8];
-      int32_t h9 = f[9] - g[9];
-
-      h[0] = h0;
-      h[1] = h1;
-      h[2] = h2;
-      h[3] = h3;
-      h[4] = h4;
-      h[5] = h5;
-      h[6] = h6;
-      h[7] = h7;
-      h[8] = h8;
-      h[9] = h9;
-    }
+    /**
+     * Capture files of the bytes a WebSocketClient received, to replay them later without a network.
+     *
+     * A capture starts with an 8 byte magic, "MWSCAP\0" followed by the format version byte, then the little endian
+     * unix time in nanoseconds the timestamps are relative to. Each record is its type byte, the nanoseconds since the previous
+     * record and the size of its data as LEB128 varints, then the data.
+     */
+    namespace capture {
+
+      static const char MAGIC[8] = {'M', 'W', 'S', 'C', 'A', 'P', 0, 1};
+
+      enum RecordType : uint8_t {
+        /** Bytes as read from the socket, after TLS */
+        RECEIVED = 1,
+        /** A subscribe request as sent, as JSON */
+        SUBSCRIBED = 2,
+      };
+
+      struct Record {
+        RecordType type;
+        /** Unix time in nanoseconds, taken by the kernel when the bytes arrived if it could be */
+        int64_t timestamp;
+        std::string data;
+      };
+
+      /**
+       * Returns the current unix time in nanoseconds
+       */
+      inline int64_t now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+      }
 
-    static void fe25519_pow22523(fe25519 out, const fe25519 z) {
-      fe25519 t0, t1, t2;
-      int     i;
-
-      fe25519_sq(t0, z);
-      fe25519_sq(t1, t0);
-      fe25519_sq(t1, t1);
-      fe25519_mul(t1, z, t1);
-      fe25519_mul(t0, t0, t1);
-      fe25519_sq(t0, t0);
-      fe25519_mul(t0, t1, t0);
-      fe25519_sq(t1, t0);
-      for (i = 1; i < 5; ++i) {
-        fe25519_sq(t1, t1);
-      }
-      fe25519_mul(t0, t1, t0);
-      fe25519_sq(t1, t0);
-      for (i = 1; i < 10; ++i) {
-        fe25519_sq(t1, t1);
-      }
-      fe25519_mul(t1, t1, t0);
-      fe25519_sq(t2, t1);
-      for (i = 1; i < 20; ++i) {
-        fe25519_sq(t2, t2);
-      }
-      fe25519_mul(t1, t2, t1);
-      for (i = 1; i < 11; ++i) {
-        fe25519_sq(t1, t1);
-      }
-      fe25519_mul(t0, t1, t0);
-      fe25519_sq(t1, t0);
-      for (i = 1; i < 50; ++i) {
-        fe25519_sq(t1, t1);
-      }
-      fe25519_mul(t1, t1, t0);
-      fe25519_sq(t2, t1);
-      for (i = 1; i < 100; ++i) {
-        fe25519_sq(t2, t2);
-      }
-      fe25519_mul(t1, t2, t1);
-      for (i = 1; i < 51; ++i) {
-        fe25519_sq(t1, t1);
-      }
-      fe25519_mul(t0, t1, t0);
-      fe25519_sq(t0, t0);
-      fe25519_sq(t0, t0);
-      fe25519_mul(out, t0, z);
-    }
+      class Writer {
+        FILE* _file = nullptr;
+        int64_t _last = 0;
+        uint64_t _records = 0;
+
+        void write_varint(uint64_t value) {
+          uint8_t bytes[10];
+          int size = 0;
+          do {
+            bytes[size] = value & 0x7f;
+            value >>= 7;
+            if (value != 0) {
+              bytes[size] |= 0x80;
+            }
+            size++;
+          } while (value != 0);
+          fwrite(bytes, 1, size, _file);
+        }
+
+      public:
+
+        /**
+         * @param path The capture file to create
+         * @throws std::runtime_error if the file cannot be created
+         */
+        Writer(const std::string& path) {
+          _file = fopen(path.c_str(), "wb");
+          if (_file == nullptr) {
+            throw std::runtime_error("Unable to create " + path);
+          }
+          _last = now();
+          fwrite(MAGIC, 1, sizeof(MAGIC), _file);
+          uint8_t start[8];
+          for (int i = 0; i < 8; i++) {
+            start[i] = (uint8_t)((uint64_t)_last >> (8 * i));
+          }
+          fwrite(start, 1, sizeof(start), _file);
+        }
+
+        ~Writer() {
+          fclose(_file);
+        }
 
-    int ge25519_is_canonical(const unsigned char *s) {
-      unsigned char c;
-      unsigned char d;
-      unsigned int  i;
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        /**
+         * Appends a record. Timestamps earlier than the previous record's are recorded as the previous one.
+         */
+        void write(RecordType type, int64_t timestamp, const char* data, size_t size) {
+          fputc(type, _file);
+          write_varint(timestamp > _last ? timestamp - _last : 0);
+          write_varint(size);
+          fwrite(data, 1, size, _file);
+          _last = std::max(_last, timestamp);
+          _records++;
+        }
 
-      c = (s[31] & 0x7f) ^ 0x7f;
-      for (i = 30; i > 0; i--) {
-        c |= s[i] ^ 0xff;
+        uint64_t records() const {
+          return _records;
+        }
+      };
+
+      /**
+       * Reads a whole capture file into memory, to replay it repeatedly without reading the file again
+       *
+       * @throws std::runtime_error if the file cannot be read
+       */
+      inline std::shared_ptr<const std::string> load(const std::string& path) {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+          throw std::runtime_error("Unable to open " + path);
+        }
+        auto bytes = std::make_shared<std::string>();
+        char buffer[65536];
+        size_t size;
+        while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+          bytes->append(buffer, size);
+        }
+        fclose(file);
+        return bytes;
       }
-      c = (((unsigned int) c) - 1U) >> 8;
-      d = (0xed - 1U - (unsigned int) s[0]) >> 8;
 
-      return 1 - (c & d & 1);
-    }
+      class Reader {
+        std::shared_ptr<const std::string> _bytes;
+        size_t _offset = 0;
+        int64_t _last = 0;
+
+        bool read_varint(uint64_t& value) {
+          value = 0;
+          for (int shift = 0; shift < 64 && _offset < _bytes->size(); shift += 7) {
+            uint8_t byte = (*_bytes)[_offset++];
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+              return true;
+            }
+          }
+          return false;
+        }
 
-    int ge25519_frombytes(ge25519_p3 *h, const unsigned char *s) {
-      fe25519 u;
-      fe25519 v;
-      fe25519 vxx;
-      fe25519 m_root_check, p_root_check;
-      fe25519 negx;
-      fe25519 x_sqrtm1;
-      int     has_m_root, has_p_root;
-
-      fe25519_frombytes(h->Y, s);
-      fe25519_1(h->Z);
-      fe25519_sq(u, h->Y);
-      fe25519_mul(v, u, ed25519_d);
-      fe25519_sub(u, u, h->Z); /* u = y^2-1 */
-      fe25519_add(v, v, h->Z); /* v = dy^2+1 */
-
-      fe25519_mul(h->X, u, v);
-      fe25519_pow22523(h->X, h->X);
-      fe25519_mul(h->X, u, h->X); /* u((uv)^((q-5)/8)) */
-
-      fe25519_sq(vxx, h->X);
-      fe25519_mul(vxx, vxx, v);
-      fe25519_sub(m_root_check, vxx, u); /* vx^2-u */
-      fe25519_add(p_root_check, vxx, u); /* vx^2+u */
-      has_m_root = fe25519_iszero(m_root_check);
-      has_p_root = fe25519_iszero(p_root_check);
-      fe25519_mul(x_sqrtm1, h->X, fe25519_sqrtm1); /* x*sqrt(-1) */
-      fe25519_cmov(h->X, x_sqrtm1, 1 - has_m_root);
-
-      fe25519_neg(negx, h->X);
-      fe25519_cmov(h->X, negx, fe25519_isnegative(h->X) ^ (s[31] >> 7));
-      fe25519_mul(h->T, h->X, h->Y);
-
-      return (has_m_root | has_p_root) - 1;
-    }
+      public:
+
+        /**
+         * @param bytes A capture loaded with load()
+         * @throws std::runtime_error if the bytes are not a capture
+         */
+        Reader(std::shared_ptr<const std::string> bytes)
+          : _bytes(std::move(bytes))
+        {
+          if (_bytes->size() < sizeof(MAGIC) + 8 || memcmp(_bytes->data(), MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error("Not a websocket capture");
+          }
+          for (int i = 0; i < 8; i++) {
+            _last |= (int64_t)(uint8_t)(*_bytes)[sizeof(MAGIC) + i] << (8 * i);
+          }
+          _offset = sizeof(MAGIC) + 8;
+        }
 
-  } // namespace libsodium
+        /**
+         * @param path The capture file to read
+         * @throws std::runtime_error if the file cannot be read or is not a capture
+         */
+        Reader(const std::string& path) : Reader(load(path)) {}
+
+        /**
+         * Reads the next record.
+         *
+         * @return false at the end of the capture, or at a record cut short by the recording process stopping
+         */
+        bool next(Record& record) {
+          uint64_t delta, size;
+          if (_offset >= _bytes->size()) {
+            return false;
+          }
+          uint8_t type = (*_bytes)[_offset++];
+          if (!read_varint(delta) || !read_varint(size) || size > _bytes->size() - _offset) {
+            return false;
+          }
+          record.type = (RecordType)type;
+          record.timestamp = _last += delta;
+          record.data.assign(&(*_bytes)[_offset], size);
+          _offset += size;
+          return true;
+        }
+      };
 
-  namespace websockets {
+    } // namespace capture
 
     class WebSocketClient {
       const std::string _interface;
@@ -1660,6 +2453,10 @@ namespace many {
       static const int SEND_BUFFER_SIZE = 65536;
       static const int RECEIVE_BUFFER_SIZE = 8388608;
 
+      /** The buffers, mapped with memory::buffer_pages() */
+      memory::Pages _send_pages;
+      memory::Pages _recv_pages;
+      memory::Pages _message_pages;
       char* _send_buffer = nullptr;
       char* _recv_buffer = nullptr;
 
@@ -1671,6 +2468,17 @@ namespace many {
 
       uint8_t _send_mask[4];
 
+      static const char* ssl_error_name(int error) {
+        switch (error) {
+          case SSL_ERROR_WANT_WRITE: return "SSL_ERROR_WANT_WRITE";
+          case SSL_ERROR_WANT_READ: return "SSL_ERROR_WANT_READ";
+          case SSL_ERROR_ZERO_RETURN: return "SSL_ERROR_ZERO_RETURN";
+          case SSL_ERROR_SYSCALL: return "SSL_ERROR_SYSCALL";
+          case SSL_ERROR_SSL: return "SSL_ERROR_SSL";
+          default: return "SSL error";
+        }
+      }
+
       //static const uint8_t OPCODE_CONT   = 0x00;
       static const uint8_t OPCODE_TEXT   = 0x01;
       //static const uint8_t OPCODE_BINARY = 0x02;
@@ -1684,6 +2492,14 @@ namespace many {
       std::map<int, std::function<void(json)>> _subscriptions;
       std::map<int, int> _subscription_map;
 
+      std::unique_ptr<capture::Writer> _recorder;
+
+      std::unique_ptr<capture::Reader> _replay;
+      capture::Record _replay_next;
+      double _replay_speed = 1;
+      int64_t _replay_first = 0;
+      std::chrono::steady_clock::time_point _replay_start;
+
       void send_message(uint8_t opcode, const char* message, size_t message_size) {
         int send_length = 0;
 
@@ -1703,7 +2519,7 @@ namespace many {
           send_length += 3;
         }
         else {
-          std::cerr << "Message too big." << std::endl;
+          LOG_ERROR("Message of %zu bytes too big", (size_t)message_size);
           disconnect();
           return;
         }
@@ -1776,24 +2592,23 @@ namespace many {
         int rv = select(_socket + 1, &readfds, NULL, NULL, &tv);
 
         if(rv > 0 && FD_ISSET(_socket, &readfds)) {
-          length = (_use_ssl) ? SSL_read(_ssl, _recv_buffer, 8192) : ::read(_socket, _recv_buffer, 8192);
+          int64_t timestamp = 0;
+          if (_use_ssl) {
+            length = SSL_read(_ssl, _recv_buffer, 8192);
+          } else if (_recorder) {
+            length = read_timestamped(_recv_buffer, 8192, timestamp);
+          } else {
+            length = ::read(_socket, _recv_buffer, 8192);
+          }
 
           if (length > 0) {
+            if (_recorder && _handshake_complete) {
+              _recorder->write(capture::RECEIVED, timestamp != 0 ? timestamp : capture::now(), _recv_buffer, length);
+            }
             return _recv_buffer;
           }
           else if (length < 0) {
-            std::cerr << "READ FAILED" << std::endl;
-
-            if (_use_ssl) {
-              switch (SSL_get_error(_ssl, length)) {
-                case SSL_ERROR_WANT_WRITE: std::cerr << "SSL_ERROR_WANT_WRITE" << std::endl; break;
-                case SSL_ERROR_WANT_READ: std::cerr << "SSL_ERROR_WANT_READ" << std::endl; break;
-                case SSL_ERROR_ZERO_RETURN: std::cerr << "SSL_ERROR_ZERO_RETURN" << std::endl; break;
-                case SSL_ERROR_SYSCALL: std::cerr << "SSL_ERROR_SYSCALL" << std::endl; break;
-                case SSL_ERROR_SSL: std::cerr << "SSL_ERROR_SSL" << std::endl; break;
-              }
-            }
-
+            LOG_ERROR("read() failed: %s", _use_ssl ? ssl_error_name(SSL_get_error(_ssl, length)) : strerror(errno));
             disconnect();
 
             return nullptr;
@@ -1806,6 +2621,64 @@ namespace many {
         }
       }
 
+      /**
+       * Reads from the socket with recvmsg, for the time the kernel received the bytes when SO_TIMESTAMPNS is on
+       *
+       * @param timestamp Set to the unix time in nanoseconds of the kernel timestamp, 0 if there was none
+       */
+      int read_timestamped(char* buffer, int size, int64_t& timestamp) {
+        struct iovec iov = {buffer, (size_t)size};
+        char control[CMSG_SPACE(sizeof(struct timespec))];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        int length = (int)recvmsg(_socket, &msg, 0);
+        timestamp = 0;
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); length > 0 && cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+          if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            timestamp = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+          }
+        }
+        return length;
+      }
+
+      void enable_timestamps() {
+        int enable = 1;
+        setsockopt(_socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+      }
+
+      /**
+       * Delivers the next received bytes of the replayed capture once they are due
+       */
+      void replay_next() {
+        while (_replay) {
+          if (_replay_speed > 0) {
+            auto due = _replay_start + std::chrono::nanoseconds((int64_t)((_replay_next.timestamp - _replay_first) / _replay_speed));
+            if (std::chrono::steady_clock::now() < due) {
+              return;
+            }
+          }
+
+          bool received = _replay_next.type == capture::RECEIVED;
+          if (received) {
+            receive(_replay_next.data.data(), (int)_replay_next.data.size());
+          }
+          if (!_replay->next(_replay_next)) {
+            _replay.reset();
+          }
+          // Like a read from the socket, one poll delivers at most one record of received bytes
+          if (received) {
+            return;
+          }
+        }
+      }
+
       bool write(const void* buffer, const int length) {
         if (!is_connected()) {
           return false;
@@ -1815,42 +2688,11 @@ namespace many {
         int return_code = (_use_ssl) ? SSL_write(_ssl, buffer, length) : ::write(_socket, buffer, length);
 
         if (_handshake_complete) {
-          //TODO: log
+          LOG_DEBUG("Sent %d of %d bytes on socket %d", return_code, length, _socket);
         }
 
         if (return_code <= 0) {
-          if (_use_ssl) {
-            int err = SSL_get_error(_ssl, length);
-            switch (err) {
-              case SSL_ERROR_WANT_WRITE:
-              {
-                std::cerr << "SSL_ERROR_WANT_WRITE" << std::endl;
-                break;
-              }
-              case SSL_ERROR_WANT_READ:
-              {
-                std::cerr << "SSL_ERROR_WANT_READ" << std::endl;
-                break;
-              }
-              case SSL_ERROR_ZERO_RETURN:
-              {
-                std::cerr << "SSL_ERROR_ZERO_RETURN" << std::endl;
-                break;
-              }
-              case SSL_ERROR_SYSCALL:
-              {
-                std::cerr << "SSL_ERROR_SYSCALL" << std::endl;
-                break;
-              }
-              case SSL_ERROR_SSL:
-              {
-                std::cerr << "SSL_ERROR_SSL" << std::endl;
-                break;
-              }
-            }
-          }
-
-          std::cerr << "SEND FAILED" << std::endl;
+          LOG_ERROR("write() failed: %s", _use_ssl ? ssl_error_name(SSL_get_error(_ssl, return_code)) : strerror(errno));
           disconnect();
           return false;
         }
@@ -1878,25 +2720,24 @@ namespace many {
     public:
 
       WebSocketClient(const std::string url, const std::string interface = "")
-        : _url(url),
-        _interface(interface),
+        : _interface(interface),
+        _url(url),
         _socket(-1),
         _ssl_ctx(nullptr),
         _ssl(nullptr)
       {
         _nonce[16] = 0;
 
-        _send_buffer = (char*)malloc(SEND_BUFFER_SIZE);
-        _recv_buffer = (char*)malloc(RECEIVE_BUFFER_SIZE);
-        _message_buffer = (char*)malloc(MESSAGE_BUFFER_SIZE);
+        _send_pages = memory::Pages(SEND_BUFFER_SIZE, memory::buffer_pages());
+        _recv_pages = memory::Pages(RECEIVE_BUFFER_SIZE, memory::buffer_pages());
+        _message_pages = memory::Pages(MESSAGE_BUFFER_SIZE, memory::buffer_pages());
+        _send_buffer = _send_pages.data();
+        _recv_buffer = _recv_pages.data();
+        _message_buffer = _message_pages.data();
       }
 
       ~WebSocketClient() {
         disconnect();
-
-        free(_send_buffer);
-        free(_recv_buffer);
-        free(_message_buffer);
       }
 
       WebSocketClient() = delete;
@@ -1927,7 +2768,7 @@ namespace many {
         struct hostent *server;
         server = gethostbyname(hostname.c_str());
         if (server == NULL) {
-          std::cerr << "Error: gethostbyname() failed" << std::endl;
+          LOG_ERROR("gethostbyname(%s) failed", hostname.c_str());
           return false;
         }
 
@@ -1953,7 +2794,7 @@ namespace many {
 
         _socket = socket(AF_INET, SOCK_STREAM, 0);
         if (_socket < 0) {
-          std::cerr << "Error: socket() failed" << std::endl;
+          LOG_ERROR("socket() failed: %s", strerror(errno));
           disconnect();
           return false;
         }
@@ -1976,10 +2817,7 @@ namespace many {
         std::string address = inet_ntoa(*addr);
 
         if (::connect(_socket, (sockaddr *)&remoteaddr, (int)sizeof(remoteaddr)) == -1) {
-          std::cerr << "CONNECT FAILED" << std::endl;
-          std::cerr << "  socket = " << std::to_string(_socket) << std::endl;
-          std::cerr << "  address = " << address << std::endl;
-          std::cerr << "  port = " << std::to_string(port) << std::endl;
+          LOG_ERROR("connect() to %s:%d failed on socket %d: %s", address.c_str(), (int)port, _socket, strerror(errno));
           disconnect();
           return false;
         }
@@ -1989,19 +2827,19 @@ namespace many {
 
           _ssl_ctx = SSL_CTX_new(method);
           if (_ssl_ctx == NULL) {
-            std::cerr << "Error: SSL_CTX_new() failed" << std::endl;
+            LOG_ERROR("SSL_CTX_new() failed");
             disconnect();
             return false;
           }
 
           _ssl = SSL_new(_ssl_ctx);
           if (_ssl == NULL) {
-            std::cerr << "Error: SSL_new() failed" << std::endl;
+            LOG_ERROR("SSL_new() failed");
             int err;
             while ((err = ERR_get_error()) != 0) {
               char *str = ERR_error_string(err, 0);
               if (str != nullptr) {
-                std::cerr << str << std::endl;
+                LOG_ERROR("%s", str);
               }
             }
             disconnect();
@@ -2009,7 +2847,7 @@ namespace many {
           }
 
           if (SSL_set_fd(_ssl, _socket) == 0) {
-            std::cerr << "Error: SSL_set_fd() failed" << std::endl;
+            LOG_ERROR("SSL_set_fd() failed");
             disconnect();
             return false;
           }
@@ -2026,17 +2864,18 @@ namespace many {
               // Not enough data because we are using non-blocking IO.
             }
             else {
-              std::cerr << "Error: SSL_connect() failed" << std::endl;
+              LOG_ERROR("SSL_connect() failed");
               disconnect();
               return false;
             }
           }
         }
 
-        // std::cout << "CONNECT" << std::endl;
-        // std::cout << "  socket = " << std::to_string(_socket) << std::endl;
-        // std::cout << "  address = " << address << std::endl;
-        // std::cout << "  port = " << std::to_string(port) << std::endl;
+        LOG_DEBUG("Connected socket %d to %s:%d", _socket, address.c_str(), (int)port);
+
+        if (_recorder) {
+          enable_timestamps();
+        }
 
         std::generate(_nonce.begin(), _nonce.end(), []() { return (uint8_t)std::rand(); });
         std::string websocket_key = base64::encode(_nonce.begin(), 16);
@@ -2065,7 +2904,7 @@ namespace many {
             }
             else {
               //end_read(0);
-              std::cerr << "HANDSHAKE FAILED" << std::endl;
+              LOG_ERROR("Websocket handshake failed");
               disconnect();
               return false;
             }
@@ -2079,6 +2918,69 @@ namespace many {
 
     public:
 
+      /**
+       * Starts recording the received bytes to a capture file, with the time the kernel received them. The bytes are
+       * recorded as read from the socket, before they are parsed into frames, and after decryption when using TLS, in
+       * which case the timestamps are taken when the bytes are read. Subscribe requests are recorded too, so a replay
+       * can make the same subscriptions.
+       *
+       * @param path The capture file to create, replacing any recording in progress
+       * @throws std::runtime_error if the file cannot be created
+       */
+      void record(const std::string& path) {
+        _recorder = std::make_unique<capture::Writer>(path);
+        if (is_connected()) {
+          enable_timestamps();
+        }
+      }
+
+      /**
+       * Stops recording and closes the capture file.
+       */
+      void stop_recording() {
+        _recorder.reset();
+      }
+
+      /**
+       * Replays a capture through poll() instead of reading from the network. The client disconnects and forgets its
+       * subscriptions; subscribing again in the order of the recording then dispatches the recorded notifications to
+       * the new callbacks, without sending anything. Each poll() delivers the next recorded read once it is due.
+       *
+       * @param path The capture file
+       * @param speed How many times faster than recorded to replay, 0 for as fast as poll() is called
+       * @throws std::runtime_error if the capture cannot be opened
+       */
+      void replay(const std::string& path, double speed = 1) {
+        replay(capture::load(path), speed);
+      }
+
+      /**
+       * Replays a capture loaded with capture::load(), see above.
+       *
+       * @throws std::runtime_error if the bytes are not a capture
+       */
+      void replay(std::shared_ptr<const std::string> capture, double speed = 1) {
+        auto reader = std::make_unique<capture::Reader>(std::move(capture));
+        disconnect();
+        _subscriptions.clear();
+        _subscription_map.clear();
+        _nextSubscriptionId = 0;
+        _message_start = 0;
+        _message_end = 0;
+
+        _replay_speed = speed;
+        _replay_start = std::chrono::steady_clock::now();
+        _replay = reader->next(_replay_next) ? std::move(reader) : nullptr;
+        _replay_first = _replay_next.timestamp;
+      }
+
+      /**
+       * Returns true until the replayed capture has been delivered completely
+       */
+      bool is_replaying() const {
+        return _replay != nullptr;
+      }
+
       bool disconnect() {
         if (_use_ssl) {
           if (_ssl != nullptr) {
@@ -2099,15 +3001,30 @@ namespace many {
       }
 
       void poll() {
+        if (_replay) {
+          replay_next();
+          return;
+        }
+
         if (!is_connected() || !_handshake_complete) {
           return;
         }
 
         int length = 0;
         char* buffer = read(length);
+        receive(buffer, length);
+      }
 
+      /**
+       * Parses received bytes into frames and dispatches the complete messages, as poll() does with what it reads
+       * from the socket. Partial frames are kept until the rest arrives.
+       *
+       * @param buffer The received bytes
+       * @param length The number of received bytes
+       */
+      void receive(const char* buffer, int length) {
         if ((_message_end + length) >= MESSAGE_BUFFER_SIZE) {
-          std::cerr << "Message buffer out of space." << std::endl;
+          LOG_ERROR("Message buffer out of space");
           disconnect();
           _message_start = 0;
           _message_end = 0;
@@ -2119,12 +3036,11 @@ namespace many {
 
         while ((_message_start + 1) < _message_end) {
           uint8_t opcode = _message_buffer[_message_start] & 0x0F;
-          bool fin = ((_message_buffer[_message_start] >> 7) & 0x01) != 0;
 
           bool mask = ((_message_buffer[_message_start + 1] >> 7) & 0x01) != 0;
 
           if (mask) {
-            std::cerr << "Mask not expected." << std::endl;
+            LOG_ERROR("Mask not expected");
             disconnect();
             _message_start = 0;
             _message_end = 0;
@@ -2134,8 +3050,8 @@ namespace many {
           size_t payload_size = _message_buffer[_message_start + 1] & ~MASK_FLAG;
 
           if (payload_size <= 125) {
-            ASSERT((_message_start + payload_size) < MESSAGE_BUFFER_SIZE);
-            if ((_message_start + 2 + payload_size) > _message_end)
+            ASSERT((_message_start + payload_size) < (size_t)MESSAGE_BUFFER_SIZE);
+            if ((_message_start + 2 + payload_size) > (size_t)_message_end)
             {
               break;
             }
@@ -2143,28 +3059,28 @@ namespace many {
           }
           else if (payload_size == 126) {
             payload_size = ntohs(*(uint16_t*)&_message_buffer[_message_start + 2]);
-            ASSERT((_message_start + payload_size) < MESSAGE_BUFFER_SIZE);
-            if ((_message_start + 4 + payload_size) > _message_end) {
+            ASSERT((_message_start + payload_size) < (size_t)MESSAGE_BUFFER_SIZE);
+            if ((_message_start + 4 + payload_size) > (size_t)_message_end) {
               break;
             }
             _message_start += 4;
           }
           else if (payload_size == 127) {
             payload_size = endian::be64toh(*(uint64_t*)&_message_buffer[_message_start + 2]);
-            ASSERT((_message_start + payload_size) < MESSAGE_BUFFER_SIZE);
-            if ((_message_start + 10 + payload_size) > _message_end) {
+            ASSERT((_message_start + payload_size) < (size_t)MESSAGE_BUFFER_SIZE);
+            if ((_message_start + 10 + payload_size) > (size_t)_message_end) {
               break;
             }
             _message_start += 10;
           }
 
-          ASSERT((_message_start + payload_size) <= _message_end);
+          ASSERT((_message_start + payload_size) <= (size_t)_message_end);
 
           switch (opcode) {
             case OPCODE_TEXT:
             {
               if (_message_buffer[_message_start] != '{') {
-                std::cerr << "Expected '{'." << std::endl;
+                LOG_ERROR("Expected '{'");
                 disconnect();
                 _message_start = 0;
                 _message_end = 0;
@@ -2181,10 +3097,10 @@ namespace many {
                   if (_subscription_map.find(subscription) != _subscription_map.end()) {
                     int subscription_id = _subscription_map[subscription];
                     if (_subscriptions.find(subscription_id) != _subscriptions.end()) {
-                      _subscriptions[subscription_id](j["params"]);
+                      _subscriptions[subscription_id](std::move(j["params"]));
                     }
                   }
-                } else if (j.contains("id") && j.contains("result")) {
+                } else if (j.contains("id") && j.contains("result") && j["result"].is_number()) {
                   int id = j["id"];
                   int result = j["result"];
                   _subscription_map[result] = id;
@@ -2228,25 +3144,28 @@ namespace many {
       }
 
       int subscribe(std::string method, json params, std::function<void(json)> callback) {
-        if (!is_connected()) {
+        if (!is_connected() && !_replay) {
           connect();
         }
-        ASSERT(is_connected());
+        ASSERT(is_connected() || _replay);
 
         int subscriptionId = ++_nextSubscriptionId;
-        if (params.is_null()) {
-          send_message({
-            {"jsonrpc", "2.0"},
-            {"id", subscriptionId},
-            {"method", method},
-          });
-        } else {
-          send_message({
-            {"jsonrpc", "2.0"},
-            {"id", subscriptionId},
-            {"method", method},
-            {"params", params},
-          });
+        json message = {
+          {"jsonrpc", "2.0"},
+          {"id", subscriptionId},
+          {"method", method},
+        };
+        if (!params.is_null()) {
+          message["params"] = params;
+        }
+
+        if (_recorder) {
+          std::string request = message.dump();
+          _recorder->write(capture::SUBSCRIBED, capture::now(), request.data(), request.size());
+        }
+        // A replay already holds the responses to the subscriptions it recorded
+        if (!_replay) {
+          send_message(message);
         }
 
         _subscriptions[subscriptionId] = callback;
@@ -2255,15 +3174,22 @@ namespace many {
 
       void unsubscribe(int subscriptionId, std::string method) {
         if (_subscriptions.find(subscriptionId) != _subscriptions.end()) {
-          if (is_connected()) {
-            send_message({
-              {"jsonrpc", "2.0"},
-              {"id", subscriptionId},
-              {"method", method},
-              {"params", {
-                subscriptionId,
-              }},
-            });
+          // The server knows the subscription by the id it acknowledged, not by the id of the request
+          for (auto it = _subscription_map.begin(); it != _subscription_map.end(); ++it) {
+            if (it->second == subscriptionId) {
+              if (is_connected()) {
+                send_message({
+                  {"jsonrpc", "2.0"},
+                  {"id", ++_nextSubscriptionId},
+                  {"method", method},
+                  {"params", {
+                    it->first,
+                  }},
+                });
+              }
+              _subscription_map.erase(it);
+              break;
+            }
           }
           _subscriptions.erase(subscriptionId);
         }
@@ -2274,3 +3200,7 @@ namespace many {
   } // namespace websockets
 
 }
+
+#ifndef MANY_COMPILED_LIB
+#include "many_impl.hpp"
+#endif
@@ -0,0 +1,1389 @@
+/**
+ * A local mock of a Solana RPC node, to run the examples, tests and benchmarks without a cluster.
+ *
+ * The server answers JSON-RPC over HTTP on its port and websocket subscriptions on the port after it, as a validator
+ * does, optionally over TLS. It simulates a single validator cluster: slots advance at a fixed interval, airdrops and
+ * sent transactions land in the current slot, and subscribers are notified of slots, roots, signatures, logs and
+ * account changes. Subscribed accounts can also change at a fixed rate to generate notification load. Latency, jitter,
+ * dropped responses and websocket disconnects can be injected.
+ *
+ * Responses are generated from the simulated state; `on()` replaces the handler of a method or adds one.
+ */
+
+#pragma once
+
+#include <list>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <poll.h>
+#include <random>
+#include <set>
+#include <sys/eventfd.h>
+
+#include "solana.hpp"
+
+namespace solana {
+namespace mock {
+
+  /**
+   * Faults injected into responses and notifications
+   */
+  struct Faults {
+    /** Delay added to every response and notification */
+    std::chrono::microseconds latency{0};
+    /** Upper bound of a uniformly distributed delay added on top of the latency */
+    std::chrono::microseconds jitter{0};
+    /** Probability that an HTTP request is answered by closing the connection, or that a notification is not sent */
+    double drop_rate = 0;
+    /** Probability, per notification, that the websocket connection is closed instead */
+    double disconnect_rate = 0;
+  };
+
+  /**
+   * An error response of a method handler
+   */
+  struct RpcError : std::runtime_error {
+    int64_t code;
+
+    RpcError(int64_t code, const std::string& message) : std::runtime_error(message), code(code) {}
+  };
+
+  class MockServer {
+  public:
+
+    /** Returns the result of a method for the request params */
+    typedef std::function<json(const json& params)> Handler;
+
+    struct Config {
+      /** The HTTP port, websockets are served on the next port; 0 picks a free pair */
+      uint16_t port = 0;
+      /** PEM certificate and private key files, which serve HTTPS and secure websockets when both are set */
+      std::string certificate_file;
+      std::string private_key_file;
+      /** The first slot of the cluster */
+      uint64_t slot = 1000;
+      /** The time between slots */
+      std::chrono::microseconds slot_interval = std::chrono::milliseconds(400);
+      /** How often every subscribed account changes, 0 to only change accounts on airdrops and set_account() */
+      double account_changes_per_second = 0;
+      Faults faults;
+      /** Seed of the identity, the generated signatures and the injected faults */
+      uint64_t seed = 1;
+    };
+
+    struct Stats {
+      uint64_t http_connections;
+      uint64_t websocket_connections;
+      uint64_t requests;
+      uint64_t responses;
+      uint64_t notifications;
+      /** Requests and notifications dropped by the injected faults */
+      uint64_t drops;
+      /** Websocket connections closed by the injected faults */
+      uint64_t disconnects;
+    };
+
+    static constexpr uint64_t SLOTS_PER_EPOCH = 432000;
+    /** Number of slots between the processed and the rooted slot */
+    static constexpr uint64_t ROOT_DISTANCE = 32;
+
+  private:
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct AccountState {
+      uint64_t lamports;
+      PublicKey owner;
+      std::vector<uint8_t> data;
+      bool executable;
+    };
+
+    struct TransactionState {
+      uint64_t slot;
+      std::vector<std::string> account_keys;
+      /** The serialized transaction as sent, empty for airdrops */
+      std::vector<uint8_t> serialized;
+    };
+
+    struct Subscription {
+      std::string method;
+      /** The account, program or signature of the subscription, "all" for logs of every transaction */
+      std::string key;
+    };
+
+    struct Frame {
+      Clock::time_point due;
+      std::string bytes;
+      /** Close the connection once the frame is sent */
+      bool close;
+    };
+
+    struct Session {
+      int socket;
+      SSL* ssl = nullptr;
+      /** Wakes the websocket thread when a frame is queued */
+      int wake = -1;
+      std::thread thread;
+      std::atomic<bool> done{false};
+
+      /** Frames to send, in order; guarded by the session mutex */
+      std::mutex mutex;
+      std::deque<Frame> outbox;
+      bool closing = false;
+
+      /** Subscriptions by id; guarded by the server mutex */
+      std::map<uint64_t, Subscription> subscriptions;
+
+      int read(char* buffer, int length) {
+        return ssl != nullptr ? SSL_read(ssl, buffer, length) : (int)::recv(socket, buffer, length, 0);
+      }
+
+      bool write(const char* buffer, size_t length) {
+        while (length > 0) {
+          int ret = ssl != nullptr ? SSL_write(ssl, buffer, (int)length) : (int)::send(socket, buffer, length, MSG_NOSIGNAL);
+          if (ret <= 0) {
+            return false;
+          }
+          buffer += ret;
+          length -= ret;
+        }
+        return true;
+      }
+    };
+
+    Config _config;
+    SSL_CTX* _ssl_ctx = nullptr;
+    uint16_t _port = 0;
+    int _http_socket = -1;
+    int _websocket_socket = -1;
+    PublicKey _identity;
+
+    std::atomic<bool> _stopping{false};
+    std::thread _accept_thread;
+    std::thread _generator_thread;
+
+    /** Guards the state below and the subscriptions of the sessions */
+    mutable std::mutex _mutex;
+    std::condition_variable _stopped;
+    Faults _faults;
+    std::map<std::string, Handler> _handlers;
+    std::list<std::shared_ptr<Session>> _sessions;
+    std::map<std::string, AccountState> _accounts;
+    std::map<std::string, TransactionState> _transactions;
+    /** Signatures of the landed transactions, oldest first */
+    std::vector<std::string> _history;
+    uint64_t _slot;
+    uint64_t _next_subscription = 100;
+    std::mt19937_64 _random;
+
+    std::atomic<uint64_t> _http_connections{0};
+    std::atomic<uint64_t> _websocket_connections{0};
+    std::atomic<uint64_t> _requests{0};
+    std::atomic<uint64_t> _responses{0};
+    std::atomic<uint64_t> _notifications{0};
+    std::atomic<uint64_t> _drops{0};
+    std::atomic<uint64_t> _disconnects{0};
+
+    static int listen_on(uint16_t port) {
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      if (fd < 0) {
+        return -1;
+      }
+      int enable = 1;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+      struct sockaddr_in address;
+      memset(&address, 0, sizeof(address));
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      address.sin_port = htons(port);
+      if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 128) != 0) {
+        close(fd);
+        return -1;
+      }
+      return fd;
+    }
+
+    static std::string frame(uint8_t opcode, const std::string& payload) {
+      std::string bytes;
+      bytes.push_back((char)(0x80 | opcode));
+      if (payload.size() <= 125) {
+        bytes.push_back((char)payload.size());
+      } else if (payload.size() <= 65535) {
+        bytes.push_back((char)126);
+        bytes.push_back((char)(payload.size() >> 8));
+        bytes.push_back((char)(payload.size() & 0xff));
+      } else {
+        bytes.push_back((char)127);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+          bytes.push_back((char)((payload.size() >> shift) & 0xff));
+        }
+      }
+      return bytes + payload;
+    }
+
+    /** Returns the value of a header, empty if it is missing */
+    static std::string header(const std::string& headers, const std::string& name) {
+      size_t start = 0;
+      while (start < headers.size()) {
+        size_t end = headers.find("\r\n", start);
+        if (end == std::string::npos) {
+          end = headers.size();
+        }
+        if (end - start > name.size() && headers[start + name.size()] == ':'
+          && strncasecmp(&headers[start], name.c_str(), name.size()) == 0) {
+          size_t value = start + name.size() + 1;
+          while (value < end && headers[value] == ' ') {
+            value++;
+          }
+          return headers.substr(value, end - value);
+        }
+        start = end + 2;
+      }
+      return "";
+    }
+
+    /** Must be called with the mutex held */
+    bool chance(double probability) {
+      return probability > 0 && std::uniform_real_distribution<double>(0, 1)(_random) < probability;
+    }
+
+    /** Must be called with the mutex held */
+    Clock::duration delay() {
+      auto jitter = _faults.jitter.count() > 0
+        ? std::chrono::microseconds(std::uniform_int_distribution<int64_t>(0, _faults.jitter.count())(_random))
+        : std::chrono::microseconds(0);
+      return _faults.latency + jitter;
+    }
+
+    /** Must be called with the mutex held */
+    std::string generate_signature() {
+      std::string bytes(64, '\0');
+      for (auto& byte : bytes) {
+        byte = (char)_random();
+      }
+      return base58::encode(bytes);
+    }
+
+    /** Must be called with the mutex held */
+    json with_context(json value) const {
+      return {
+        {"context", {{"slot", _slot}}},
+        {"value", value},
+      };
+    }
+
+    static json account_json(const AccountState& account) {
+      return {
+        {"lamports", account.lamports},
+        {"owner", account.owner.to_base58()},
+        {"data", {base64::encode(account.data), "base64"}},
+        {"executable", account.executable},
+        {"rentEpoch", 0},
+      };
+    }
+
+    /** Must be called with the mutex held */
+    json account_json(const std::string& address) const {
+      auto it = _accounts.find(address);
+      return it == _accounts.end() ? json(nullptr) : account_json(it->second);
+    }
+
+    /** Must be called with the mutex held */
+    std::string confirmation_status(uint64_t slot) const {
+      if (_slot >= slot + ROOT_DISTANCE) {
+        return "finalized";
+      }
+      return _slot > slot ? "confirmed" : "processed";
+    }
+
+    static void enqueue(Session& session, Frame frame) {
+      {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        if (session.closing) {
+          return;
+        }
+        session.closing = frame.close;
+        session.outbox.push_back(std::move(frame));
+      }
+      uint64_t one = 1;
+      if (::write(session.wake, &one, sizeof(one)) < 0) {
+        // The session is closing
+      }
+    }
+
+    /** Queues a notification with the injected faults; must be called with the mutex held */
+    void notify(Session& session, uint64_t subscription, const std::string& method, const json& result) {
+      if (chance(_faults.disconnect_rate)) {
+        _disconnects++;
+        enqueue(session, {Clock::now() + delay(), frame(0x08, ""), true});
+        return;
+      }
+      if (chance(_faults.drop_rate)) {
+        _drops++;
+        return;
+      }
+      json notification = {
+        {"jsonrpc", "2.0"},
+        {"method", method},
+        {"params", {
+          {"result", result},
+          {"subscription", subscription},
+        }},
+      };
+      _notifications++;
+      enqueue(session, {Clock::now() + delay(), frame(0x01, notification.dump()), false});
+    }
+
+    /** Notifies the account and program subscribers of an account; must be called with the mutex held */
+    void account_changed(const std::string& address) {
+      const AccountState& account = _accounts.at(address);
+      std::string owner = account.owner.to_base58();
+      for (auto& session : _sessions) {
+        for (auto& [id, subscription] : session->subscriptions) {
+          if (subscription.method == "account" && subscription.key == address) {
+            notify(*session, id, "accountNotification", with_context(account_json(account)));
+          } else if (subscription.method == "program" && subscription.key == owner) {
+            notify(*session, id, "programNotification", with_context({
+              {"pubkey", address},
+              {"account", account_json(account)},
+            }));
+          }
+        }
+      }
+    }
+
+    /** Lands a transaction in the current slot; must be called with the mutex held */
+    void land(const std::string& signature, TransactionState transaction) {
+      for (auto& session : _sessions) {
+        for (auto& [id, subscription] : session->subscriptions) {
+          bool mentioned = std::find(transaction.account_keys.begin(), transaction.account_keys.end(), subscription.key) != transaction.account_keys.end();
+          if (subscription.method == "logs" && (subscription.key == "all" || mentioned)) {
+            notify(*session, id, "logsNotification", with_context({
+              {"signature", signature},
+              {"err", nullptr},
+              {"logs", {"Program log: mock"}},
+            }));
+          }
+        }
+      }
+      _transactions[signature] = std::move(transaction);
+      _history.push_back(signature);
+    }
+
+    /** Advances the slot and notifies the slot, root and signature subscribers; must be called with the mutex held */
+    void tick() {
+      _slot++;
+      uint64_t root = _slot > ROOT_DISTANCE ? _slot - ROOT_DISTANCE : 0;
+      for (auto& session : _sessions) {
+        auto it = session->subscriptions.begin();
+        while (it != session->subscriptions.end()) {
+          auto& [id, subscription] = *it;
+          if (subscription.method == "slot") {
+            notify(*session, id, "slotNotification", {{"parent", _slot - 1}, {"root", root}, {"slot", _slot}});
+          } else if (subscription.method == "root") {
+            notify(*session, id, "rootNotification", root);
+          } else if (subscription.method == "signature" && _transactions.count(subscription.key) > 0) {
+            // Signature subscriptions end with their notification
+            notify(*session, id, "signatureNotification", with_context({{"err", nullptr}}));
+            it = session->subscriptions.erase(it);
+            continue;
+          }
+          ++it;
+        }
+      }
+    }
+
+    /** Changes every subscribed account; must be called with the mutex held */
+    void change_subscribed_accounts() {
+      std::set<std::string> addresses;
+      for (auto& session : _sessions) {
+        for (auto& [id, subscription] : session->subscriptions) {
+          if (subscription.method == "account") {
+            addresses.insert(subscription.key);
+          }
+        }
+      }
+      for (auto& address : addresses) {
+        auto it = _accounts.find(address);
+        if (it == _accounts.end()) {
+          it = _accounts.emplace(address, AccountState{0, PublicKey("11111111111111111111111111111111"), {}, false}).first;
+        }
+        it->second.lamports++;
+        account_changed(address);
+      }
+    }
+
+    void generate() {
+      auto next_slot = Clock::now() + _config.slot_interval;
+      auto account_interval = _config.account_changes_per_second > 0
+        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _config.account_changes_per_second))
+        : Clock::duration::max();
+      auto next_change = account_interval == Clock::duration::max() ? Clock::time_point::max() : Clock::now() + account_interval;
+
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (!_stopping) {
+        _stopped.wait_until(lock, std::min(next_slot, next_change));
+        auto now = Clock::now();
+        if (now >= next_slot) {
+          tick();
+          next_slot += _config.slot_interval;
+        }
+        if (now >= next_change) {
+          change_subscribed_accounts();
+          next_change += account_interval;
+        }
+      }
+    }
+
+    json error_response(const json& id, int64_t code, const std::string& message) {
+      return {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"error", {{"code", code}, {"message", message}}},
+      };
+    }
+
+    json call(const json& request) {
+      json id = request.contains("id") ? request["id"] : json(nullptr);
+      if (!request.is_object() || !request.contains("method") || !request["method"].is_string()) {
+        return error_response(id, -32600, "Invalid request");
+      }
+      Handler handler;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _handlers.find(request["method"].get<std::string>());
+        if (it == _handlers.end()) {
+          return error_response(id, -32601, "Method not found");
+        }
+        handler = it->second;
+      }
+      try {
+        json params = request.contains("params") ? request["params"] : json::array();
+        return {
+          {"jsonrpc", "2.0"},
+          {"id", id},
+          {"result", handler(params)},
+        };
+      } catch (const RpcError& e) {
+        return error_response(id, e.code, e.what());
+      } catch (const json::exception& e) {
+        return error_response(id, -32602, std::string("Invalid params: ") + e.what());
+      } catch (const std::exception& e) {
+        return error_response(id, -32603, e.what());
+      }
+    }
+
+    /** Answers a single request or a batch */
+    std::string respond(const std::string& body) {
+      json request = json::parse(body, nullptr, false);
+      if (request.is_discarded()) {
+        return error_response(nullptr, -32700, "Parse error").dump();
+      }
+      if (!request.is_array()) {
+        return call(request).dump();
+      }
+      json responses = json::array();
+      for (auto& item : request) {
+        responses.push_back(call(item));
+      }
+      return responses.dump();
+    }
+
+    bool accept_tls(Session& session) {
+      if (_ssl_ctx == nullptr) {
+        return true;
+      }
+      session.ssl = SSL_new(_ssl_ctx);
+      return session.ssl != nullptr && SSL_set_fd(session.ssl, session.socket) == 1 && SSL_accept(session.ssl) == 1;
+    }
+
+    void serve_http(Session& session) {
+      if (!accept_tls(session)) {
+        return;
+      }
+      std::string buffer;
+      char chunk[65536];
+      while (!_stopping) {
+        size_t headers_end;
+        while ((headers_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+          int length = session.read(chunk, sizeof(chunk));
+          if (length <= 0) {
+            return;
+          }
+          buffer.append(chunk, length);
+        }
+        std::string headers = buffer.substr(0, headers_end + 2);
+        std::string content_length = header(headers, "Content-Length");
+        size_t total = headers_end + 4 + (content_length.empty() ? 0 : std::stoul(content_length));
+        while (buffer.size() < total) {
+          int length = session.read(chunk, sizeof(chunk));
+          if (length <= 0) {
+            return;
+          }
+          buffer.append(chunk, length);
+        }
+        std::string body = buffer.substr(headers_end + 4, total - headers_end - 4);
+        buffer.erase(0, total);
+        bool keep_alive = strcasecmp(header(headers, "Connection").c_str(), "close") != 0;
+        _requests++;
+
+        Clock::duration wait;
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          if (chance(_faults.drop_rate)) {
+            _drops++;
+            return;
+          }
+          wait = delay();
+        }
+        std::string response = respond(body);
+        std::this_thread::sleep_for(wait);
+
+        std::string head = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(response.size())
+          + (keep_alive ? "\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+        if (!session.write((head + response).data(), head.size() + response.size())) {
+          return;
+        }
+        _responses++;
+        if (!keep_alive) {
+          return;
+        }
+      }
+    }
+
+    /** Handles a subscribe or unsubscribe request */
+    void subscribe(Session& session, const std::string& message) {
+      json request = json::parse(message, nullptr, false);
+      json response;
+      if (request.is_discarded() || !request.is_object() || !request.contains("method")) {
+        response = error_response(nullptr, -32700, "Parse error");
+      } else {
+        json id = request.contains("id") ? request["id"] : json(nullptr);
+        std::string method = request["method"].get<std::string>();
+        json params = request.contains("params") ? request["params"] : json::array();
+        std::lock_guard<std::mutex> lock(_mutex);
+        static const std::string SUBSCRIBE = "Subscribe";
+        static const std::string UNSUBSCRIBE = "Unsubscribe";
+        if (method.size() > UNSUBSCRIBE.size() && method.compare(method.size() - UNSUBSCRIBE.size(), UNSUBSCRIBE.size(), UNSUBSCRIBE) == 0) {
+          if (params.size() > 0 && params[0].is_number_unsigned()) {
+            session.subscriptions.erase(params[0].get<uint64_t>());
+          }
+          response = {{"jsonrpc", "2.0"}, {"id", id}, {"result", true}};
+        } else if (method.size() > SUBSCRIBE.size() && method.compare(method.size() - SUBSCRIBE.size(), SUBSCRIBE.size(), SUBSCRIBE) == 0) {
+          Subscription subscription{method.substr(0, method.size() - SUBSCRIBE.size()), ""};
+          if (params.size() > 0 && params[0].is_string()) {
+            subscription.key = params[0].get<std::string>();
+          } else if (params.size() > 0 && params[0].contains("mentions")) {
+            subscription.key = params[0]["mentions"][0].get<std::string>();
+          }
+          if (subscription.method == "logs" && (subscription.key.empty() || subscription.key.rfind("all", 0) == 0)) {
+            subscription.key = "all";
+          }
+          uint64_t subscription_id = _next_subscription++;
+          session.subscriptions[subscription_id] = subscription;
+          response = {{"jsonrpc", "2.0"}, {"id", id}, {"result", subscription_id}};
+        } else {
+          response = error_response(id, -32601, "Method not found");
+        }
+      }
+      Clock::duration wait;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        wait = delay();
+      }
+      enqueue(session, {Clock::now() + wait, frame(0x01, response.dump()), false});
+    }
+
+    /** Parses the complete client frames at the front of the buffer, returns false once the connection closes */
+    bool receive(Session& session, std::string& buffer) {
+      while (buffer.size() >= 2) {
+        uint8_t opcode = buffer[0] & 0x0f;
+        bool masked = (buffer[1] & 0x80) != 0;
+        uint64_t length = buffer[1] & 0x7f;
+        size_t offset = 2;
+        if (length == 126) {
+          if (buffer.size() < 4) {
+            return true;
+          }
+          length = ((uint8_t)buffer[2] << 8) | (uint8_t)buffer[3];
+          offset = 4;
+        } else if (length == 127) {
+          if (buffer.size() < 10) {
+            return true;
+          }
+          length = 0;
+          for (int i = 0; i < 8; i++) {
+            length = (length << 8) | (uint8_t)buffer[2 + i];
+          }
+          offset = 10;
+        }
+        size_t mask = offset;
+        offset += masked ? 4 : 0;
+        if (buffer.size() < offset + length) {
+          return true;
+        }
+        std::string payload = buffer.substr(offset, length);
+        if (masked) {
+          for (size_t i = 0; i < payload.size(); i++) {
+            payload[i] ^= buffer[mask + i % 4];
+          }
+        }
+        buffer.erase(0, offset + length);
+
+        if (opcode == 0x01) {
+          subscribe(session, payload);
+        } else if (opcode == 0x08) {
+          enqueue(session, {Clock::now(), frame(0x08, ""), true});
+        } else if (opcode == 0x09) {
+          enqueue(session, {Clock::now(), frame(0x0a, payload), false});
+        }
+      }
+      return true;
+    }
+
+    void serve_websocket(Session& session) {
+      if (!accept_tls(session)) {
+        return;
+      }
+      std::string buffer;
+      char chunk[65536];
+      size_t headers_end;
+      while ((headers_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+        int length = session.read(chunk, sizeof(chunk));
+        if (length <= 0) {
+          return;
+        }
+        buffer.append(chunk, length);
+      }
+      std::string key = header(buffer.substr(0, headers_end + 2), "Sec-WebSocket-Key");
+      buffer.erase(0, headers_end + 4);
+      if (key.empty()) {
+        std::string response = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        session.write(response.data(), response.size());
+        return;
+      }
+      key += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+      unsigned char sha1[20];
+      SHA1((const unsigned char*)key.data(), key.size(), sha1);
+      std::string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: "
+        + base64::encode(sha1, 20) + "\r\n\r\n";
+      if (!session.write(response.data(), response.size())) {
+        return;
+      }
+
+      struct pollfd fds[2] = {{session.socket, POLLIN, 0}, {session.wake, POLLIN, 0}};
+      while (!_stopping) {
+        // Sleep until a frame is queued or the first queued frame is due
+        int timeout = 100;
+        {
+          std::lock_guard<std::mutex> lock(session.mutex);
+          if (!session.outbox.empty()) {
+            auto until = std::chrono::duration_cast<std::chrono::milliseconds>(session.outbox.front().due - Clock::now()).count();
+            timeout = (int)std::max<int64_t>(0, std::min<int64_t>(timeout, until + 1));
+          }
+        }
+        bool pending = session.ssl != nullptr && SSL_pending(session.ssl) > 0;
+        fds[0].revents = fds[1].revents = 0;
+        if (!pending && ::poll(fds, 2, timeout) < 0 && errno != EINTR) {
+          return;
+        }
+
+        if (pending || (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+          int length = session.read(chunk, sizeof(chunk));
+          if (length <= 0) {
+            return;
+          }
+          buffer.append(chunk, length);
+          receive(session, buffer);
+        }
+        if ((fds[1].revents & POLLIN) != 0) {
+          uint64_t count;
+          if (::read(session.wake, &count, sizeof(count)) < 0) {
+            return;
+          }
+        }
+
+        auto now = Clock::now();
+        while (true) {
+          Frame next;
+          {
+            std::lock_guard<std::mutex> lock(session.mutex);
+            if (session.outbox.empty() || session.outbox.front().due > now) {
+              break;
+            }
+            next = std::move(session.outbox.front());
+            session.outbox.pop_front();
+          }
+          if (!session.write(next.bytes.data(), next.bytes.size()) || next.close) {
+            return;
+          }
+        }
+      }
+    }
+
+    void serve(std::shared_ptr<Session> session, bool websocket) {
+      if (websocket) {
+        serve_websocket(*session);
+      } else {
+        serve_http(*session);
+      }
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        session->subscriptions.clear();
+      }
+      {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->closing = true;
+      }
+      if (session->ssl != nullptr) {
+        SSL_shutdown(session->ssl);
+      }
+      shutdown(session->socket, SHUT_RDWR);
+      session->done = true;
+    }
+
+    static void close_session(Session& session) {
+      if (session.thread.joinable()) {
+        session.thread.join();
+      }
+      if (session.ssl != nullptr) {
+        SSL_free(session.ssl);
+      }
+      close(session.socket);
+      if (session.wake >= 0) {
+        close(session.wake);
+      }
+    }
+
+    void accept_connections() {
+      struct pollfd fds[2] = {{_http_socket, POLLIN, 0}, {_websocket_socket, POLLIN, 0}};
+      while (!_stopping) {
+        fds[0].revents = fds[1].revents = 0;
+        if (::poll(fds, 2, 50) < 0 && errno != EINTR) {
+          break;
+        }
+        for (int i = 0; i < 2; i++) {
+          if ((fds[i].revents & POLLIN) == 0) {
+            continue;
+          }
+          int fd = accept(fds[i].fd, nullptr, nullptr);
+          if (fd < 0) {
+            continue;
+          }
+          int enable = 1;
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+          auto session = std::make_shared<Session>();
+          session->socket = fd;
+          session->wake = eventfd(0, EFD_NONBLOCK);
+          (i == 0 ? _http_connections : _websocket_connections)++;
+          std::lock_guard<std::mutex> lock(_mutex);
+          _sessions.push_back(session);
+          session->thread = std::thread(&MockServer::serve, this, session, i == 1);
+        }
+
+        // Reap the sessions that have ended
+        std::list<std::shared_ptr<Session>> done;
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          for (auto it = _sessions.begin(); it != _sessions.end();) {
+            if ((*it)->done) {
+              done.push_back(*it);
+              it = _sessions.erase(it);
+            } else {
+              ++it;
+            }
+          }
+        }
+        for (auto& session : done) {
+          close_session(*session);
+        }
+      }
+    }
+
+    void install_default_handlers();
+
+  public:
+
+    /**
+     * Starts listening and serving.
+     *
+     * @param config The ports, TLS files, simulation rates and faults
+     * @throws std::runtime_error if the ports cannot be bound or the TLS files cannot be loaded
+     */
+    MockServer(const Config& config)
+      : _config(config),
+      _faults(config.faults),
+      _slot(config.slot),
+      _random(config.seed)
+    {
+      uint8_t identity[PUBLIC_KEY_LENGTH];
+      for (auto& byte : identity) {
+        byte = (uint8_t)_random();
+      }
+      _identity = PublicKey(identity);
+
+      if (!_config.certificate_file.empty() && !_config.private_key_file.empty()) {
+        _ssl_ctx = SSL_CTX_new(TLS_server_method());
+        if (_ssl_ctx == nullptr
+          || SSL_CTX_use_certificate_file(_ssl_ctx, _config.certificate_file.c_str(), SSL_FILETYPE_PEM) != 1
+          || SSL_CTX_use_PrivateKey_file(_ssl_ctx, _config.private_key_file.c_str(), SSL_FILETYPE_PEM) != 1) {
+          if (_ssl_ctx != nullptr) {
+            SSL_CTX_free(_ssl_ctx);
+          }
+          throw std::runtime_error("Unable to load " + _config.certificate_file + " and " + _config.private_key_file);
+        }
+      }
+
+      std::uniform_int_distribution<int> ports(20000, 60000);
+      for (int attempt = 0; attempt < (_config.port == 0 ? 100 : 1) && _websocket_socket < 0; attempt++) {
+        _port = _config.port == 0 ? (uint16_t)ports(_random) : _config.port;
+        _http_socket = listen_on(_port);
+        _websocket_socket = _http_socket < 0 ? -1 : listen_on(_port + 1);
+        if (_websocket_socket < 0 && _http_socket >= 0) {
+          close(_http_socket);
+          _http_socket = -1;
+        }
+      }
+      if (_websocket_socket < 0) {
+        if (_ssl_ctx != nullptr) {
+          SSL_CTX_free(_ssl_ctx);
+        }
+        throw std::runtime_error("Unable to listen on ports " + std::to_string(_port) + " and " + std::to_string(_port + 1));
+      }
+
+      install_default_handlers();
+      _accept_thread = std::thread(&MockServer::accept_connections, this);
+      _generator_thread = std::thread(&MockServer::generate, this);
+    }
+
+    MockServer() : MockServer(Config()) {}
+
+    ~MockServer() {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+      }
+      _stopped.notify_all();
+      _generator_thread.join();
+      _accept_thread.join();
+
+      std::list<std::shared_ptr<Session>> sessions;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        sessions.swap(_sessions);
+      }
+      for (auto& session : sessions) {
+        // Unblocks the reads of the session thread
+        shutdown(session->socket, SHUT_RDWR);
+        close_session(*session);
+      }
+      close(_http_socket);
+      close(_websocket_socket);
+      if (_ssl_ctx != nullptr) {
+        SSL_CTX_free(_ssl_ctx);
+      }
+    }
+
+    MockServer(const MockServer&) = delete;
+    MockServer& operator=(const MockServer&) = delete;
+
+    /**
+     * Returns the HTTP port; websockets are served on the next port
+     */
+    uint16_t port() const {
+      return _port;
+    }
+
+    /**
+     * Returns the url to create a Connection with
+     */
+    std::string endpoint() const {
+      return std::string(_ssl_ctx != nullptr ? "https" : "http") + "://127.0.0.1:" + std::to_string(_port);
+    }
+
+    /**
+     * Returns the identity of the simulated validator, the leader of every slot
+     */
+    const PublicKey& identity() const {
+      return _identity;
+    }
+
+    uint64_t slot() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _slot;
+    }
+
+    /**
+     * Replaces the handler of a method, or adds a method. A handler returns the result of the response, or throws
+     * RpcError for an error response. Handlers run on the connection threads, concurrently.
+     *
+     * @param method The JSON-RPC method
+     * @param handler The handler
+     */
+    void on(const std::string& method, Handler handler) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _handlers[method] = std::move(handler);
+    }
+
+    /**
+     * Creates or replaces an account and notifies its subscribers.
+     */
+    void set_account(const PublicKey& address, uint64_t lamports, const PublicKey& owner, const std::vector<uint8_t>& data = {}, bool executable = false) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      std::string key = address.to_base58();
+      _accounts[key] = {lamports, owner, data, executable};
+      account_changed(key);
+    }
+
+    /**
+     * Changes the faults injected from now on.
+     */
+    void set_faults(const Faults& faults) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _faults = faults;
+    }
+
+    /**
+     * Closes every websocket connection, after the frames already queued.
+     */
+    void disconnect_websockets() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (auto& session : _sessions) {
+        enqueue(*session, {Clock::now(), frame(0x08, ""), true});
+      }
+    }
+
+    /**
+     * Returns the number of active subscriptions over all websocket connections
+     */
+    size_t subscriptions() const {
+      std::lock_guard<std::mutex> lock(_mutex);
+      size_t count = 0;
+      for (auto& session : _sessions) {
+        count += session->subscriptions.size();
+      }
+      return count;
+    }
+
+    Stats stats() const {
+      return {
+        _http_connections,
+        _websocket_connections,
+        _requests,
+        _responses,
+        _notifications,
+        _drops,
+        _disconnects,
+      };
+    }
+
+    /**
+     * Writes a self-signed certificate for localhost and its private key, to serve TLS with.
+     *
+     * @param certificate_file The PEM certificate file to write
+     * @param private_key_file The PEM private key file to write
+     * @throws std::runtime_error if the certificate cannot be generated or written
+     */
+    static void generate_certificate(const std::string& certificate_file, const std::string& private_key_file) {
+      EVP_PKEY* key = EVP_EC_gen("P-256");
+      X509* certificate = X509_new();
+      bool ok = key != nullptr && certificate != nullptr;
+      if (ok) {
+        ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+        X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+        X509_gmtime_adj(X509_getm_notAfter(certificate), 365 * 24 * 3600);
+        X509_set_pubkey(certificate, key);
+        X509_NAME* name = X509_get_subject_name(certificate);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+        X509_set_issuer_name(certificate, name);
+        ok = X509_sign(certificate, key, EVP_sha256()) > 0;
+      }
+      if (ok) {
+        FILE* file = fopen(private_key_file.c_str(), "w");
+        ok = file != nullptr && PEM_write_PrivateKey(file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        if (file != nullptr) {
+          fclose(file);
+        }
+      }
+      if (ok) {
+        FILE* file = fopen(certificate_file.c_str(), "w");
+        ok = file != nullptr && PEM_write_X509(file, certificate) == 1;
+        if (file != nullptr) {
+          fclose(file);
+        }
+      }
+      X509_free(certificate);
+      EVP_PKEY_free(key);
+      if (!ok) {
+        throw std::runtime_error("Unable to generate a certificate to " + certificate_file);
+      }
+    }
+  };
+
+  inline void MockServer::install_default_handlers() {
+    const std::string system_program = "11111111111111111111111111111111";
+
+    auto address_of = [](const json& value) {
+      return PublicKey(value.get<std::string>()).to_base58();
+    };
+
+    _handlers["getVersion"] = [](const json&) -> json {
+      return {{"solana-core", "1.18.0"}, {"feature-set", 4215500110}};
+    };
+
+    _handlers["getHealth"] = [](const json&) -> json {
+      return "ok";
+    };
+
+    _handlers["getIdentity"] = [this](const json&) -> json {
+      return {{"identity", _identity.to_base58()}};
+    };
+
+    _handlers["getSlot"] = [this](const json&) -> json {
+      return slot();
+    };
+
+    _handlers["getBlockHeight"] = [this](const json&) -> json {
+      return slot() - _config.slot / 2;
+    };
+
+    _handlers["getSlotLeader"] = [this](const json&) -> json {
+      return _identity.to_base58();
+    };
+
+    _handlers["getEpochInfo"] = [this](const json&) -> json {
+      uint64_t current = slot();
+      std::lock_guard<std::mutex> lock(_mutex);
+      return {
+        {"absoluteSlot", current},
+        {"blockHeight", current - _config.slot / 2},
+        {"epoch", current / SLOTS_PER_EPOCH},
+        {"slotIndex", current % SLOTS_PER_EPOCH},
+        {"slotsInEpoch", SLOTS_PER_EPOCH},
+        {"transactionCount", _history.size()},
+      };
+    };
+
+    _handlers["getLeaderSchedule"] = [this](const json& params) -> json {
+      std::string leader = _identity.to_base58();
+      if (params.size() > 0 && params.back().is_object() && params.back().contains("identity") && params.back()["identity"] != leader) {
+        return json::object();
+      }
+      // Every slot of the epoch, but only the first ones to keep the response small
+      std::vector<uint64_t> slots;
+      for (uint64_t i = 0; i < 64; i++) {
+        slots.push_back(i);
+      }
+      return {{leader, slots}};
+    };
+
+    _handlers["getClusterNodes"] = [this](const json&) -> json {
+      return {{
+        {"pubkey", _identity.to_base58()},
+        {"gossip", "127.0.0.1:8001"},
+        {"tpu", "127.0.0.1:8003"},
+        {"tpuQuic", "127.0.0.1:8009"},
+        {"rpc", "127.0.0.1:" + std::to_string(_port)},
+        {"version", "1.18.0"},
+        {"featureSet", 4215500110},
+        {"shredVersion", 1},
+      }};
+    };
+
+    _handlers["getLatestBlockhash"] = [this](const json&) -> json {
+      std::lock_guard<std::mutex> lock(_mutex);
+      uint8_t hash[PUBLIC_KEY_LENGTH] = {};
+      memcpy(hash, &_slot, sizeof(_slot));
+      return with_context({
+        {"blockhash", PublicKey(hash).to_base58()},
+        {"lastValidBlockHeight", _slot - _config.slot / 2 + 150},
+      });
+    };
+
+    _handlers["getBalance"] = [this, address_of](const json& params) -> json {
+      std::string address = address_of(params.at(0));
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto it = _accounts.find(address);
+      return with_context(it == _accounts.end() ? 0 : it->second.lamports);
+    };
+
+    _handlers["getAccountInfo"] = [this, address_of](const json& params) -> json {
+      std::string address = address_of(params.at(0));
+      std::lock_guard<std::mutex> lock(_mutex);
+      return with_context(account_json(address));
+    };
+
+    _handlers["getMultipleAccounts"] = [this, address_of](const json& params) -> json {
+      json accounts = json::array();
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (auto& address : params.at(0)) {
+        accounts.push_back(account_json(address_of(address)));
+      }
+      return with_context(accounts);
+    };
+
+    _handlers["getProgramAccounts"] = [this, address_of](const json& params) -> json {
+      PublicKey program(address_of(params.at(0)));
+      json accounts = json::array();
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (auto& [address, account] : _accounts) {
+        if (account.owner == program) {
+          accounts.push_back({{"pubkey", address}, {"account", account_json(account)}});
+        }
+      }
+      return accounts;
+    };
+
+    _handlers["getTokenSupply"] = [this, address_of](const json& params) -> json {
+      std::string mint = address_of(params.at(0));
+      std::lock_guard<std::mutex> lock(_mutex);
+      // A mint holds its supply at offset 36 and its decimals at offset 44
+      auto it = _accounts.find(mint);
+      uint64_t supply = 1000000000000000;
+      uint8_t decimals = 6;
+      if (it != _accounts.end() && it->second.data.size() >= 45) {
+        memcpy(&supply, &it->second.data[36], sizeof(supply));
+        decimals = it->second.data[44];
+      }
+      return with_context({{"amount", std::to_string(supply)}, {"decimals", decimals}});
+    };
+
+    _handlers["getTokenAccountBalance"] = [this, address_of](const json& params) -> json {
+      std::string address = address_of(params.at(0));
+      std::lock_guard<std::mutex> lock(_mutex);
+      // A token account holds its mint at offset 0 and its amount at offset 64
+      auto it = _accounts.find(address);
+      if (it == _accounts.end() || !(it->second.owner == TOKEN_PROGRAM_ID) || it->second.data.size() < 72) {
+        throw RpcError(-32602, "Invalid param: not a Token account");
+      }
+      uint64_t amount;
+      memcpy(&amount, &it->second.data[64], sizeof(amount));
+      auto mint = _accounts.find(PublicKey(it->second.data.data()).to_base58());
+      uint8_t decimals = mint != _accounts.end() && mint->second.data.size() >= 45 ? mint->second.data[44] : 9;
+      return with_context({{"amount", std::to_string(amount)}, {"decimals", decimals}});
+    };
+
+    _handlers["getTokenAccountsByOwner"] = [this, address_of](const json& params) -> json {
+      PublicKey owner(address_of(params.at(0)));
+      std::string mint = params.size() > 1 && params[1].contains("mint") ? address_of(params[1]["mint"]) : "";
+      json accounts = json::array();
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (auto& [address, account] : _accounts) {
+        if (!(account.owner == TOKEN_PROGRAM_ID) || account.data.size() < 72 || !(PublicKey(&account.data[32]) == owner)) {
+          continue;
+        }
+        PublicKey account_mint(account.data.data());
+        if (!mint.empty() && account_mint.to_base58() != mint) {
+          continue;
+        }
+        uint64_t amount;
+        memcpy(&amount, &account.data[64], sizeof(amount));
+        accounts.push_back({
+          {"pubkey", address},
+          {"account", {
+            {"lamports", account.lamports},
+            {"owner", account.owner.to_base58()},
+            {"data", {
+              {"program", "spl-token"},
+              {"parsed", {
+                {"info", {
+                  {"isNative", account_mint == NATIVE_MINT},
+                  {"mint", account_mint.to_base58()},
+                  {"owner", owner.to_base58()},
+                  {"state", "initialized"},
+                  {"tokenAmount", {{"amount", std::to_string(amount)}, {"decimals", 9}}},
+                }},
+                {"type", "account"},
+              }},
+              {"space", account.data.size()},
+            }},
+            {"executable", false},
+            {"rentEpoch", 0},
+          }},
+        });
+      }
+      return with_context(accounts);
+    };
+
+    _handlers["getRecentPrioritizationFees"] = [this](const json&) -> json {
+      uint64_t current = slot();
+      json fees = json::array();
+      for (uint64_t slot = current > 150 ? current - 150 : 0; slot < current; slot++) {
+        fees.push_back({{"slot", slot}, {"prioritizationFee", (slot * 7919) % 10000}});
+      }
+      return fees;
+    };
+
+    _handlers["requestAirdrop"] = [this, address_of, system_program](const json& params) -> json {
+      std::string address = address_of(params.at(0));
+      uint64_t lamports = params.at(1).get<uint64_t>();
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto it = _accounts.find(address);
+      if (it == _accounts.end()) {
+        it = _accounts.emplace(address, AccountState{0, PublicKey(system_program), {}, false}).first;
+      }
+      it->second.lamports += lamports;
+      std::string signature = generate_signature();
+      land(signature, {_slot, {_identity.to_base58(), address, system_program}, {}});
+      account_changed(address);
+      return signature;
+    };
+
+    _handlers["sendTransaction"] = [this](const json& params) -> json {
+      std::string encoding = params.size() > 1 && params[1].contains("encoding") ? params[1]["encoding"].get<std::string>() : "base58";
+      std::string encoded = params.at(0).get<std::string>();
+      std::vector<uint8_t> serialized;
+      if (encoding == "base64") {
+        serialized = base64::decode(encoded);
+      } else {
+        std::string decoded = base58::decode(encoded);
+        serialized.assign(decoded.begin(), decoded.end());
+      }
+      TransactionView view;
+      if (!view.parse(serialized.data(), serialized.size()) || view.num_signatures == 0) {
+        throw RpcError(-32602, "failed to deserialize transaction");
+      }
+      TransactionState transaction{0, {}, serialized};
+      for (size_t i = 0; i < view.num_account_keys; i++) {
+        transaction.account_keys.push_back(view.account_key(i).to_base58());
+      }
+      std::string signature = view.signature();
+      std::lock_guard<std::mutex> lock(_mutex);
+      transaction.slot = _slot;
+      land(signature, std::move(transaction));
+      return signature;
+    };
+
+    _handlers["simulateTransaction"] = [this](const json&) -> json {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return with_context({
+        {"err", nullptr},
+        {"logs", {"Program log: mock"}},
+        {"accounts", nullptr},
+        {"unitsConsumed", 150},
+      });
+    };
+
+    _handlers["getSignatureStatuses"] = [this](const json& params) -> json {
+      json statuses = json::array();
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (auto& signature : params.at(0)) {
+        auto it = _transactions.find(signature.get<std::string>());
+        if (it == _transactions.end()) {
+          statuses.push_back(nullptr);
+          continue;
+        }
+        std::string status = confirmation_status(it->second.slot);
+        statuses.push_back({
+          {"slot", it->second.slot},
+          {"confirmations", status == "finalized" ? json(nullptr) : json(_slot - it->second.slot)},
+          {"err", nullptr},
+          {"confirmationStatus", status},
+        });
+      }
+      return with_context(statuses);
+    };
+
+    _handlers["getSignaturesForAddress"] = [this, address_of](const json& params) -> json {
+      std::string address = address_of(params.at(0));
+      json options = params.size() > 1 ? params[1] : json::object();
+      std::string before = options.value("before", "");
+      std::string until = options.value("until", "");
+      size_t limit = options.value("limit", 1000);
+      json signatures = json::array();
+      std::lock_guard<std::mutex> lock(_mutex);
+      // Newest first, starting after `before` and stopping at `until`
+      bool started = before.empty();
+      for (auto it = _history.rbegin(); it != _history.rend() && signatures.size() < limit; ++it) {
+        if (!started) {
+          started = *it == before;
+          continue;
+        }
+        if (*it == until) {
+          break;
+        }
+        const TransactionState& transaction = _transactions.at(*it);
+        if (std::find(transaction.account_keys.begin(), transaction.account_keys.end(), address) != transaction.account_keys.end()) {
+          signatures.push_back({
+            {"signature", *it},
+            {"slot", transaction.slot},
+            {"err", nullptr},
+            {"memo", nullptr},
+            {"blockTime", 1700000000 + (int64_t)transaction.slot * 2 / 5},
+            {"confirmationStatus", confirmation_status(transaction.slot)},
+          });
+        }
+      }
+      return signatures;
+    };
+
+    _handlers["getTransaction"] = [this, system_program](const json& params) -> json {
+      std::string signature = params.at(0).get<std::string>();
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto it = _transactions.find(signature);
+      if (it == _transactions.end()) {
+        return nullptr;
+      }
+      const TransactionState& transaction = it->second;
+      std::vector<uint64_t> balances(transaction.account_keys.size(), 0);
+      return {
+        {"slot", transaction.slot},
+        {"blockTime", 1700000000 + (int64_t)transaction.slot * 2 / 5},
+        {"transaction", {
+          {"signatures", {signature}},
+          {"message", {
+            {"accountKeys", transaction.account_keys},
+            {"header", {{"numRequiredSignatures", 1}, {"numReadonlySignedAccounts", 0}, {"numReadonlyUnsignedAccounts", 1}}},
+            {"instructions", json::array()},
+            {"recentBlockhash", system_program},
+          }},
+        }},
+        {"meta", {
+          {"err", nullptr},
+          {"fee", 5000},
+          {"innerInstructions", json::array()},
+          {"logMessages", {"Program log: mock"}},
+          {"preBalances", balances},
+          {"postBalances", balances},
+          {"preTokenBalances", json::array()},
+          {"postTokenBalances", json::array()},
+          {"rewards", json::array()},
+        }},
+      };
+    };
+
+    _handlers["getBlock"] = [this](const json& params) -> json {
+      uint64_t block_slot = params.at(0).get<uint64_t>();
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (block_slot > _slot) {
+        throw RpcError(-32004, "Block not available for slot " + std::to_string(block_slot));
+      }
+      // The transactions sent in the slot, airdrops have no serialized form
+      json transactions = json::array();
+      for (auto& signature : _history) {
+        const TransactionState& transaction = _transactions.at(signature);
+        if (transaction.slot == block_slot && !transaction.serialized.empty()) {
+          transactions.push_back({
+            {"transaction", {base64::encode(transaction.serialized), "base64"}},
+            {"meta", {{"err", nullptr}, {"fee", 5000}}},
+            {"version", "legacy"},
+          });
+        }
+      }
+      uint8_t hash[PUBLIC_KEY_LENGTH] = {};
+      memcpy(hash, &block_slot, sizeof(block_slot));
+      return {
+        {"blockHeight", block_slot - _config.slot / 2},
+        {"blockTime", 1700000000 + (int64_t)block_slot * 2 / 5},
+        {"blockhash", PublicKey(hash).to_base58()},
+        {"parentSlot", block_slot - 1},
+        {"transactions", transactions},
+      };
+    };
+  }
+
+} // namespace mock
+} // namespace solana
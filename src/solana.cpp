@@ -0,0 +1,33 @@
+//  ____ _____ __    _____ _____ _____
+// |  __|     |  |  |  _  |   | |  _  |  Solana C++ SDK
+// |__  |  |  |  |__|     | | | |     |  version 0.0.1
+// |____|_____|_____|__|__|_|___|__|__|  https://github.com/many-exchange/many-exchange-cpp
+//
+// Copyright (c) 2022-2023 Many Exchange
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+// The many library half of solana.hpp: its functions and the results of the Connection calls, compiled once instead
+// of inline in every user
+
+#ifndef MANY_COMPILED_LIB
+#define MANY_COMPILED_LIB
+#endif
+
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+#include "solana.hpp"
+#include "solana_impl.hpp"
+
+namespace solana {
+
+#define SOLANA_RESULT(T)    \
+  template class Result<T>; \
+  template void from_json<T>(const json& j, Result<T>& r);
+  SOLANA_RESULT_TYPES(SOLANA_RESULT)
+#undef SOLANA_RESULT
+
+}
@@ -13,11 +13,17 @@
 #include <algorithm>
 #include <arpa/inet.h>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <fcntl.h>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <netdb.h>
+#include <optional>
 #include <openssl/err.h>
 #include <openssl/sha.h>
 #include <openssl/ssl.h>
@@ -49,8 +55,11 @@ using namespace many;
 
 #define TOKEN_PROGRAM_ID PublicKey("TokenkegQfeZyiNwAJbNbGKPFXCWuBvf9Ss623VQ5DA")
 #define ASSOCIATED_TOKEN_PROGRAM_ID PublicKey("ATokenGPvbdGVxr1b2hvZbsiqW5xWH25efTNsLJA8knL")
+#define COMPUTE_BUDGET_PROGRAM_ID PublicKey("ComputeBudget111111111111111111111111111111")
 
+#define MAX_COMPUTE_UNIT_LIMIT 1400000
 #define MAX_SEED_LENGTH 32
+#define MAX_TX_ACCOUNT_LOCKS 64
 #define PACKET_DATA_SIZE 1232
 #define PRIVATE_KEY_LENGTH 64
 #define PUBLIC_KEY_LENGTH 32
@@ -70,20 +79,7 @@ namespace solana {
    *
    * @param cluster The cluster to get the default API URL for
   */
-  std::string cluster_api_url(Cluster cluster) {
-    switch (cluster) {
-      case Cluster::MainnetBeta:
-        return "https://api.mainnet-beta.solana.com";
-      case Cluster::Devnet:
-        return "https://api.devnet.solana.com";
-      case Cluster::Testnet:
-        return "https://api.testnet.solana.com";
-      case Cluster::Localnet:
-        return "http://127.0.0.1:8899";
-      default:
-        throw std::runtime_error("Invalid cluster.");
-    }
-  }
+  std::string cluster_api_url(Cluster cluster);
 
   enum class Commitment {
     Processed,
@@ -91,6 +87,12 @@ namespace solana {
     Finalized,
   };
 
+  NLOHMANN_JSON_SERIALIZE_ENUM(Commitment, {
+    {Commitment::Processed, "processed"},
+    {Commitment::Confirmed, "confirmed"},
+    {Commitment::Finalized, "finalized"},
+  })
+
   struct ConfirmOptions {
     Commitment commitment = Commitment::Finalized;
     bool preflight_commitment = false;
@@ -99,11 +101,11 @@ namespace solana {
 
   struct Blockhash {
     std::string blockhash;
+    /** Last block height at which the blockhash will be valid */
+    uint64_t last_valid_block_height;
   };
 
-  void from_json(const json& j, Blockhash& blockhash) {
-    blockhash.blockhash = j["blockhash"].get<std::string>();
-  }
+  void from_json(const json& j, Blockhash& blockhash);
 
   struct Version {
     /** The current solana feature set enabled */
@@ -112,14 +114,7 @@ namespace solana {
     std::string version;
   };
 
-  void from_json(const json& j, Version& version) {
-    if (j.contains("feature-set")) {
-      version.feature_set = j["feature-set"].get<uint64_t>();
-    }
-    if (j.contains("solana-core")) {
-      version.version = j["solana-core"].get<std::string>();
-    }
-  }
+  void from_json(const json& j, Version& version);
 
   struct PublicKey {
     /** An array of bytes representing the Pubkey */
@@ -148,6 +143,8 @@ namespace solana {
       }
     }
 
+    PublicKey& operator=(const PublicKey& other) = default;
+
     bool operator==(const PublicKey& other) const {
       for (int i = 0; i < PUBLIC_KEY_LENGTH; i++) {
         if (bytes[i] != other.bytes[i]) {
@@ -262,9 +259,7 @@ namespace solana {
     }
   };
 
-  void from_json(const nlohmann::json& j, PublicKey& pubkey) {
-    pubkey = PublicKey(j.get<std::string>());
-  }
+  void from_json(const nlohmann::json& j, PublicKey& pubkey);
 
   struct Keypair {
     std::array<uint8_t, crypto_sign_SECRETKEYBYTES> secret_key;
@@ -275,7 +270,7 @@ namespace solana {
       if (sodium_result == -1) {
         throw std::runtime_error("Failed to initialize libsodium");
       }
-      for (int i = 0; i < crypto_sign_SECRETKEYBYTES; i++) {
+      for (size_t i = 0; i < crypto_sign_SECRETKEYBYTES; i++) {
         secret_key[i] = 0;
       }
       public_key = PublicKey();
@@ -381,31 +376,14 @@ namespace solana {
     uint64_t rent_epoch;
   };
 
-  void from_json(const json& j, Account& account) {
-    account.lamports = j["lamports"].get<uint64_t>();
-    account.owner = j["owner"].get<PublicKey>();
-
-    if (j["data"].is_string()) {
-      account.data = j["data"].get<std::string>();
-    } else {
-      auto encoding = j["data"][1].get<std::string>();
-      ASSERT(encoding == "base64");
-      account.data = j["data"][0].get<std::string>();
-    }
-
-    account.executable = j["executable"].get<bool>();
-    account.rent_epoch = j["rentEpoch"].get<uint64_t>();
-  }
+  void from_json(const json& j, Account& account);
 
   struct AccountInfo {
     PublicKey pubkey;
     Account account;
   };
 
-  void from_json(const json& j, AccountInfo& accountInfo) {
-    accountInfo.pubkey = j["pubkey"].get<PublicKey>();
-    accountInfo.account = j["account"].get<Account>();
-  }
+  void from_json(const json& j, AccountInfo& accountInfo);
 
   struct TokenBalance {
     /** The raw balance without decimals, as a string representation */
@@ -421,10 +399,7 @@ namespace solana {
     }
   };
 
-  void from_json(const json& j, TokenBalance& tokenAmount) {
-    tokenAmount.amount = stol(j["amount"].get<std::string>());
-    tokenAmount.decimals = j["decimals"].get<uint64_t>();
-  }
+  void from_json(const json& j, TokenBalance& tokenAmount);
 
   struct ClusterNode {
     /** Node public key */
@@ -443,62 +418,34 @@ namespace solana {
     uint64_t shred_version;
   };
 
-  void from_json(const json& j, ClusterNode& cluster_node) {
-    if (!j["featureSet"].is_null()) {
-      cluster_node.feature_set = j["featureSet"].get<uint64_t>();
-    }
-    cluster_node.gossip = j["gossip"].get<std::string>();
-    cluster_node.pubkey = j["pubkey"].get<PublicKey>();
-    if (!j["rpc"].is_null()) {
-      cluster_node.rpc = j["rpc"].get<std::string>();
-    }
-    cluster_node.shred_version = j["shredVersion"].get<uint64_t>();
-    if (!j["tpu"].is_null()) {
-      cluster_node.tpu = j["tpu"].get<std::string>();
-    }
-    if (!j["version"].is_null()) {
-      cluster_node.version = j["version"].get<std::string>();
-    }
-  }
+  void from_json(const json& j, ClusterNode& cluster_node);
 
   struct Identity {
     PublicKey identity;
   };
 
-  void from_json(const json& j, Identity& identity) {
-    identity.identity = PublicKey(j["identity"].get<std::string>());
-  }
+  void from_json(const json& j, Identity& identity);
 
   struct LeaderSchedule {
     PublicKey leader;
     std::vector<int> schedule;
   };
 
-  void from_json(const json& j, LeaderSchedule& leader_schedule) {
-    auto it = j.begin();
-    leader_schedule.leader = PublicKey(it.key());
-    leader_schedule.schedule = it.value().get<std::vector<int>>();
-  }
+  void from_json(const json& j, LeaderSchedule& leader_schedule);
 
   struct Logs {
     std::vector<std::string> logs;
     std::string signature;
   };
 
-  void from_json(const json& j, Logs& logs) {
-    logs.logs = j["logs"].get<std::vector<std::string>>();
-    logs.signature = j["signature"].get<std::string>();
-  }
+  void from_json(const json& j, Logs& logs);
 
   struct ResultError {
     int64_t code;
     std::string message;
   };
 
-  void from_json(const json& j, ResultError& t) {
-    t.code = j["code"].get<int64_t>();
-    t.message = j["message"].get<std::string>();
-  }
+  void from_json(const json& j, ResultError& t);
 
   template <typename T>
   class Result {
@@ -510,7 +457,7 @@ namespace solana {
 
     Result() = default;
 
-    Result(T result) : _result(result) {}
+    Result(T result) : _result(std::move(result)) {}
 
     Result(ResultError error) : _error(error) {}
 
@@ -518,13 +465,24 @@ namespace solana {
       return _result != std::nullopt;
     }
 
-    T unwrap() {
+    T unwrap() & {
       if (_error) {
-        std::cerr << _error->message << std::endl;
+        LOG_ERROR("%s", _error->message.c_str());
         throw std::runtime_error(_error->message);
       }
       return _result.value();
     }
+
+    /**
+     * Unwraps a temporary result by moving the value out rather than copying it
+     */
+    T unwrap() && {
+      if (_error) {
+        LOG_ERROR("%s", _error->message.c_str());
+        throw std::runtime_error(_error->message);
+      }
+      return std::move(_result.value());
+    }
   };
 
   template <typename T>
@@ -557,11 +515,22 @@ namespace solana {
     uint64_t root;
   };
 
-  void from_json(const json& j, SlotInfo& slot_info) {
-    slot_info.slot = j["slot"].get<uint64_t>();
-    slot_info.parent = j["parent"].get<uint64_t>();
-    slot_info.root = j["root"].get<uint64_t>();
-  }
+  void from_json(const json& j, SlotInfo& slot_info);
+
+  struct EpochInfo {
+    /** The current slot */
+    uint64_t absolute_slot;
+    /** The current block height */
+    uint64_t block_height;
+    /** The current epoch */
+    uint64_t epoch;
+    /** The current slot relative to the start of the current epoch */
+    uint64_t slot_index;
+    /** The number of slots in this epoch */
+    uint64_t slots_in_epoch;
+  };
+
+  void from_json(const json& j, EpochInfo& epoch_info);
 
   struct TokenAccount {
     /** The account's Pubkey */
@@ -605,43 +574,11 @@ namespace solana {
     } account;
   };
 
-  void from_json(const json& j, TokenAccount::Account::Data::Parsed::Info& parsedAccountInfo) {
-    parsedAccountInfo.is_native = j["isNative"].get<bool>();
-    parsedAccountInfo.mint = j["mint"].get<PublicKey>();
-    parsedAccountInfo.owner = j["owner"].get<PublicKey>();
-    parsedAccountInfo.token_amount = j["tokenAmount"].get<TokenBalance>();
-    if (j.contains("delegate")) {
-      parsedAccountInfo.delegate = j["account"]["data"]["parsed"]["info"]["delegate"].get<PublicKey>();
-      parsedAccountInfo.delegated_amount = j["account"]["data"]["parsed"]["info"]["delegatedAmount"].get<TokenBalance>();
-    }
-    parsedAccountInfo.state = j["state"].get<std::string>();
-  }
-
-  void from_json(const json& j, TokenAccount::Account::Data::Parsed& parsedAccountData) {
-    parsedAccountData.info = j["info"].get<TokenAccount::Account::Data::Parsed::Info>();
-    parsedAccountData.type = j["type"].get<std::string>();
-  }
-
-  void from_json(const json& j, TokenAccount::Account::Data& accountData) {
-    accountData.program = j["program"].get<std::string>();
-    accountData.parsed = j["parsed"].get<TokenAccount::Account::Data::Parsed>();
-    accountData.space = j["space"].get<uint64_t>();
-  }
-
-  void from_json(const json& j, TokenAccount::Account& account) {
-    account.lamports = j["lamports"].get<uint64_t>();
-    account.owner = j["owner"].get<PublicKey>();
-    account.data.program = j["data"]["program"].get<std::string>();
-    account.data.parsed = j["data"]["parsed"].get<TokenAccount::Account::Data::Parsed>();
-    account.data.space = j["data"]["space"].get<uint64_t>();
-    account.executable = j["executable"].get<bool>();
-    account.rent_epoch = j["rentEpoch"].get<uint64_t>();
-  }
-
-  void from_json(const json& j, TokenAccount& tokenAccount) {
-    tokenAccount.pubkey = j["pubkey"].get<PublicKey>();
-    tokenAccount.account = j["account"].get<TokenAccount::Account>();
-  }
+  void from_json(const json& j, TokenAccount::Account::Data::Parsed::Info& parsedAccountInfo);
+  void from_json(const json& j, TokenAccount::Account::Data::Parsed& parsedAccountData);
+  void from_json(const json& j, TokenAccount::Account::Data& accountData);
+  void from_json(const json& j, TokenAccount::Account& account);
+  void from_json(const json& j, TokenAccount& tokenAccount);
 
   struct TransactionMessageHeader {
     /** The number of signatures required to validate this transaction */
@@ -652,11 +589,7 @@ namespace solana {
     uint8_t num_readonly_unsigned_accounts;
   };
 
-  void from_json(const json& j, TransactionMessageHeader& header) {
-    header.num_required_signatures = j["numRequiredSignatures"].get<uint8_t>();
-    header.num_readonly_signed_accounts = j["numReadonlySignedAccounts"].get<uint8_t>();
-    header.num_readonly_unsigned_accounts = j["numReadonlyUnsignedAccounts"].get<uint8_t>();
-  }
+  void from_json(const json& j, TransactionMessageHeader& header);
 
   struct CompiledTransaction {
     /** Defines the content of the transaction */
@@ -752,25 +685,222 @@ namespace solana {
     }
   };
 
-  void from_json(const json& j, CompiledTransaction::Message::Instruction& instruction) {
-    instruction.accounts = j["accounts"].get<std::vector<uint8_t>>();
-    instruction.data = base64::decode(j["data"].get<std::string>());
-    instruction.program_id_index = j["programIdIndex"].get<uint8_t>();
-  }
+  void from_json(const json& j, CompiledTransaction::Message::Instruction& instruction);
+  void from_json(const json& j, CompiledTransaction::Message& message);
+  void from_json(const json& j, CompiledTransaction& transaction);
 
-  void from_json(const json& j, CompiledTransaction::Message& message) {
-    message.account_keys = j["accountKeys"].get<std::vector<PublicKey>>();
-    message.header.num_readonly_signed_accounts = j["header"]["numReadonlySignedAccounts"].get<uint8_t>();
-    message.header.num_readonly_unsigned_accounts = j["header"]["numReadonlyUnsignedAccounts"].get<uint8_t>();
-    message.header.num_required_signatures = j["header"]["numRequiredSignatures"].get<uint8_t>();
-    message.instructions = j["instructions"].get<std::vector<CompiledTransaction::Message::Instruction>>();
-    message.recent_blockhash = PublicKey(j["recentBlockhash"].get<std::string>());
-  }
+  /**
+   * A view of a serialized legacy or v0 transaction that points into the serialized bytes instead of copying them.
+   * The bytes must outlive the view.
+   */
+  struct TransactionView {
+    struct Instruction {
+      /** Index into the account keys of the program that executes this instruction */
+      uint8_t program_id_index;
+      /** Indices into the account keys of the accounts passed to the program */
+      const uint8_t* accounts;
+      size_t num_accounts;
+      /** The program input data */
+      const uint8_t* data;
+      size_t data_size;
+    };
 
-  void from_json(const json& j, CompiledTransaction& transaction) {
-    transaction.message = j["message"].get<CompiledTransaction::Message>();
-    transaction.signatures = j["signatures"].get<std::vector<std::string>>();
-  }
+    struct AddressTableLookup {
+      /** The address lookup table account */
+      const uint8_t* account_key;
+      /** Indices into the table of the loaded writable accounts */
+      const uint8_t* writable_indexes;
+      size_t num_writable_indexes;
+      /** Indices into the table of the loaded readonly accounts */
+      const uint8_t* readonly_indexes;
+      size_t num_readonly_indexes;
+    };
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    const uint8_t* signatures = nullptr;
+    size_t num_signatures = 0;
+    /** True for a v0 transaction, which may load accounts from address lookup tables */
+    bool versioned = false;
+    TransactionMessageHeader header;
+    /** The static account keys, 32 bytes each */
+    const uint8_t* account_keys = nullptr;
+    size_t num_account_keys = 0;
+    const uint8_t* recent_blockhash = nullptr;
+    std::vector<Instruction> instructions;
+    std::vector<AddressTableLookup> address_table_lookups;
+
+  private:
+
+    /**
+     * Parses the transaction up to the instructions, calling `instruction` for each one instead of storing them.
+     */
+    template <typename F>
+    static bool scan(const uint8_t* data, size_t size, TransactionView& view, bool store_lookups, F instruction) {
+      size_t offset = 0;
+      view.data = data;
+      view.size = size;
+      if (!decode_length(data, size, offset, view.num_signatures) || view.num_signatures > size / SIGNATURE_LENGTH) {
+        return false;
+      }
+      view.signatures = data + offset;
+      offset += view.num_signatures * SIGNATURE_LENGTH;
+      if (offset >= size) {
+        return false;
+      }
+      view.versioned = (data[offset] & 0x80) != 0;
+      if (view.versioned) {
+        if ((data[offset] & 0x7f) != 0) {
+          return false;
+        }
+        offset++;
+      }
+      if (offset + 3 > size) {
+        return false;
+      }
+      view.header.num_required_signatures = data[offset];
+      view.header.num_readonly_signed_accounts = data[offset + 1];
+      view.header.num_readonly_unsigned_accounts = data[offset + 2];
+      offset += 3;
+      if (!decode_length(data, size, offset, view.num_account_keys) || view.num_account_keys > (size - offset) / PUBLIC_KEY_LENGTH) {
+        return false;
+      }
+      view.account_keys = data + offset;
+      offset += view.num_account_keys * PUBLIC_KEY_LENGTH;
+      if (offset + PUBLIC_KEY_LENGTH > size) {
+        return false;
+      }
+      view.recent_blockhash = data + offset;
+      offset += PUBLIC_KEY_LENGTH;
+
+      size_t num_instructions;
+      if (!decode_length(data, size, offset, num_instructions)) {
+        return false;
+      }
+      for (size_t i = 0; i < num_instructions; i++) {
+        Instruction ix;
+        if (offset >= size) {
+          return false;
+        }
+        ix.program_id_index = data[offset++];
+        if (!decode_length(data, size, offset, ix.num_accounts) || ix.num_accounts > size - offset) {
+          return false;
+        }
+        ix.accounts = data + offset;
+        offset += ix.num_accounts;
+        if (!decode_length(data, size, offset, ix.data_size) || ix.data_size > size - offset) {
+          return false;
+        }
+        ix.data = data + offset;
+        offset += ix.data_size;
+        if (!instruction(ix)) {
+          return false;
+        }
+      }
+
+      if (view.versioned) {
+        size_t num_lookups;
+        if (!decode_length(data, size, offset, num_lookups)) {
+          return false;
+        }
+        for (size_t i = 0; i < num_lookups; i++) {
+          AddressTableLookup lookup;
+          if (offset + PUBLIC_KEY_LENGTH > size) {
+            return false;
+          }
+          lookup.account_key = data + offset;
+          offset += PUBLIC_KEY_LENGTH;
+          if (!decode_length(data, size, offset, lookup.num_writable_indexes) || lookup.num_writable_indexes > size - offset) {
+            return false;
+          }
+          lookup.writable_indexes = data + offset;
+          offset += lookup.num_writable_indexes;
+          if (!decode_length(data, size, offset, lookup.num_readonly_indexes) || lookup.num_readonly_indexes > size - offset) {
+            return false;
+          }
+          lookup.readonly_indexes = data + offset;
+          offset += lookup.num_readonly_indexes;
+          if (store_lookups) {
+            view.address_table_lookups.push_back(lookup);
+          }
+        }
+      }
+      return offset == size;
+    }
+
+  public:
+
+    /**
+     * Parses a serialized transaction into the view.
+     *
+     * @param data The serialized transaction
+     * @param size The size of the serialized transaction
+     *
+     * @return false if the bytes are not a well-formed transaction
+     */
+    bool parse(const uint8_t* data, size_t size) {
+      instructions.clear();
+      address_table_lookups.clear();
+      return scan(data, size, *this, true, [this](const Instruction& ix) {
+        instructions.push_back(ix);
+        return ix.program_id_index < num_account_keys;
+      });
+    }
+
+    /**
+     * Returns true if a top-level instruction of a serialized transaction invokes one of the given programs. Only the
+     * message is walked, nothing is stored, so this is a cheap filter ahead of parse(). Programs can only be static
+     * account keys, so lookup tables never need to be resolved for this.
+     *
+     * @param data The serialized transaction
+     * @param size The size of the serialized transaction
+     * @param programs The program ids to look for
+     */
+    static bool invokes(const uint8_t* data, size_t size, const std::vector<PublicKey>& programs) {
+      TransactionView view;
+      bool found = false;
+      bool ok = scan(data, size, view, false, [&](const Instruction& ix) {
+        if (ix.program_id_index >= view.num_account_keys) {
+          return false;
+        }
+        const uint8_t* program = view.account_keys + ix.program_id_index * PUBLIC_KEY_LENGTH;
+        for (auto& candidate : programs) {
+          if (memcmp(candidate.bytes.data(), program, PUBLIC_KEY_LENGTH) == 0) {
+            found = true;
+          }
+        }
+        return true;
+      });
+      return ok && found;
+    }
+
+    /**
+     * Returns the first signature, as base-58, which identifies the transaction.
+     */
+    std::string signature() const {
+      ASSERT(num_signatures > 0);
+      return base58::encode(std::string((const char*)signatures, SIGNATURE_LENGTH));
+    }
+
+    /**
+     * Returns a static account key.
+     *
+     * @param index The index into the static account keys
+     */
+    PublicKey account_key(size_t index) const {
+      ASSERT(index < num_account_keys);
+      return PublicKey(account_keys + index * PUBLIC_KEY_LENGTH);
+    }
+
+    /**
+     * Returns the program id of an instruction.
+     *
+     * @param instruction The instruction
+     */
+    PublicKey program_id(const Instruction& instruction) const {
+      return account_key(instruction.program_id_index);
+    }
+  };
 
   struct Transaction {
     /** The transaction signatures */
@@ -827,9 +957,12 @@ namespace solana {
         std::vector<Transaction::Message::Instruction::AccountMeta> account_metas;
         for (auto& instruction : instructions) {
           for (auto& account : instruction.accounts) {
-            //TODO there is a bug here, if the same account is used twice with different signer or writable flags.
-            if (std::find(account_metas.begin(), account_metas.end(), account) == account_metas.end()) {
+            auto existing = std::find(account_metas.begin(), account_metas.end(), account);
+            if (existing == account_metas.end()) {
               account_metas.push_back(account);
+            } else {
+              existing->is_signer |= account.is_signer;
+              existing->is_writable |= account.is_writable;
             }
           }
         }
@@ -839,7 +972,9 @@ namespace solana {
           auto programId = instruction.program_id;
           if (std::find(programIds.begin(), programIds.end(), programId) == programIds.end()) {
             programIds.push_back(programId);
-            account_metas.push_back({programId, false, false});
+            if (std::find(account_metas.begin(), account_metas.end(), programId) == account_metas.end()) {
+              account_metas.push_back({programId, false, false});
+            }
           }
         }
 
@@ -932,13 +1067,262 @@ namespace solana {
     void add(Transaction::Message::Instruction instruction) {
       message.instructions.push_back(instruction);
     }
+
+    /**
+     * Compiles the message with its recent blockhash, signs it and returns the serialized transaction
+     *
+     * @param signers The keypairs to sign the transaction
+     */
+    std::vector<uint8_t> sign(const std::vector<Keypair>& signers) {
+      auto compiled_message = message.compile(signers);
+      CompiledTransaction compiled_transaction = {
+        .message = compiled_message,
+        .signatures = {},
+      };
+
+      std::vector<uint8_t> serialized_message;
+      compiled_message.serialize(serialized_message);
+
+      compiled_transaction.sign(serialized_message, signers);
+
+      return compiled_transaction.serialize(serialized_message);
+    }
   };
 
-  void from_json(const json& j, Transaction::Message::Instruction::AccountMeta& accountMeta) {
-    accountMeta.pubkey = j["pubkey"].get<PublicKey>();
-    accountMeta.is_signer = j["isSigner"].get<bool>();
-    accountMeta.is_writable = j["isWritable"].get<bool>();
-  }
+  void from_json(const json& j, Transaction::Message::Instruction::AccountMeta& accountMeta);
+
+  /**
+   * Packs instructions into as few transactions as possible under the packet size and the account lock limit.
+   *
+   * The serialized size of every candidate transaction is tracked incrementally, so each placement only looks at the
+   * accounts the instruction adds. Unconstrained instructions are placed first-fit by decreasing size. Instructions
+   * with ordering constraints are placed in the order they were added, never in a transaction before the ones they
+   * must follow, so executing the transactions in order preserves the constraints.
+   */
+  class InstructionPacker {
+    typedef Transaction::Message::Instruction Instruction;
+
+    struct Candidate {
+      /** Every account key of the transaction, mapped to whether it signs */
+      std::map<PublicKey, bool> keys;
+      size_t signers = 0;
+      size_t instruction_bytes = 0;
+      std::vector<size_t> instructions;
+    };
+
+    PublicKey _fee_payer;
+    std::vector<Instruction> _prefix;
+    size_t _max_size;
+    size_t _max_accounts;
+    std::vector<Instruction> _instructions;
+    std::vector<std::vector<size_t>> _after;
+
+    static size_t shortvec_size(size_t length) {
+      return length < 0x80 ? 1 : length < 0x4000 ? 2 : 3;
+    }
+
+    static size_t instruction_size(const Instruction& instruction) {
+      return 1 + shortvec_size(instruction.accounts.size()) + instruction.accounts.size() + shortvec_size(instruction.data.size()) + instruction.data.size();
+    }
+
+    static size_t message_size(size_t signers, size_t keys, size_t instructions, size_t instruction_bytes) {
+      return shortvec_size(signers) + SIGNATURE_LENGTH * signers + 3 + shortvec_size(keys) + PUBLIC_KEY_LENGTH * keys + PUBLIC_KEY_LENGTH + shortvec_size(instructions) + instruction_bytes;
+    }
+
+    Candidate empty_candidate() const {
+      Candidate candidate;
+      candidate.keys[_fee_payer] = true;
+      candidate.signers = 1;
+      for (auto& instruction : _prefix) {
+        add_to(candidate, instruction);
+      }
+      return candidate;
+    }
+
+    static void add_to(Candidate& candidate, const Instruction& instruction) {
+      auto add_key = [&candidate](const PublicKey& key, bool is_signer) {
+        auto it = candidate.keys.emplace(key, is_signer);
+        if (it.second) {
+          candidate.signers += is_signer ? 1 : 0;
+        } else if (is_signer && !it.first->second) {
+          it.first->second = true;
+          candidate.signers++;
+        }
+      };
+      add_key(instruction.program_id, false);
+      for (auto& account : instruction.accounts) {
+        add_key(account.pubkey, account.is_signer);
+      }
+      candidate.instruction_bytes += instruction_size(instruction);
+    }
+
+    /**
+     * Returns true if the instruction fits in the candidate, without changing it.
+     */
+    bool fits(const Candidate& candidate, const Instruction& instruction) const {
+      size_t keys = candidate.keys.size();
+      size_t signers = candidate.signers;
+      // Keys the instruction adds or upgrades to signer, with whether they sign so far
+      std::vector<std::pair<PublicKey, bool>> added;
+      auto count_key = [&](const PublicKey& key, bool is_signer) {
+        auto seen = std::find_if(added.begin(), added.end(), [&key](const std::pair<PublicKey, bool>& entry) {
+          return entry.first == key;
+        });
+        if (seen != added.end()) {
+          // A key can appear again as a signer after it was first counted as a non-signer
+          if (is_signer && !seen->second) {
+            seen->second = true;
+            signers++;
+          }
+          return;
+        }
+        auto it = candidate.keys.find(key);
+        if (it == candidate.keys.end()) {
+          added.emplace_back(key, is_signer);
+          keys++;
+          signers += is_signer ? 1 : 0;
+        } else if (is_signer && !it->second) {
+          added.emplace_back(key, true);
+          signers++;
+        }
+      };
+      count_key(instruction.program_id, false);
+      for (auto& account : instruction.accounts) {
+        count_key(account.pubkey, account.is_signer);
+      }
+      if (keys > _max_accounts) {
+        return false;
+      }
+      size_t count = _prefix.size() + candidate.instructions.size() + 1;
+      return message_size(signers, keys, count, candidate.instruction_bytes + instruction_size(instruction)) <= _max_size;
+    }
+
+    /**
+     * Places an instruction in the first candidate from `first` on that fits it, or in a new one.
+     *
+     * @return The index of the candidate
+     */
+    size_t place(std::vector<Candidate>& candidates, size_t index, size_t first) const {
+      const Instruction& instruction = _instructions[index];
+      for (size_t i = first; i < candidates.size(); i++) {
+        if (fits(candidates[i], instruction)) {
+          add_to(candidates[i], instruction);
+          candidates[i].instructions.push_back(index);
+          return i;
+        }
+      }
+      Candidate candidate = empty_candidate();
+      if (!fits(candidate, instruction)) {
+        throw std::runtime_error("Instruction does not fit in a transaction");
+      }
+      add_to(candidate, instruction);
+      candidate.instructions.push_back(index);
+      candidates.push_back(std::move(candidate));
+      return candidates.size() - 1;
+    }
+
+  public:
+
+    /**
+     * @param fee_payer The fee payer of every transaction
+     * @param prefix Instructions added at the start of every transaction, such as compute budget instructions
+     * @param max_size The maximum serialized size of a transaction
+     * @param max_accounts The maximum number of account keys of a transaction
+     */
+    InstructionPacker(const PublicKey& fee_payer, const std::vector<Instruction>& prefix = {}, size_t max_size = PACKET_DATA_SIZE, size_t max_accounts = MAX_TX_ACCOUNT_LOCKS)
+      : _fee_payer(fee_payer),
+      _prefix(prefix),
+      _max_size(max_size),
+      _max_accounts(max_accounts)
+    {
+    }
+
+    /**
+     * Adds an instruction.
+     *
+     * @param instruction The instruction
+     * @param after The indices of previously added instructions that must execute before this one
+     *
+     * @return The index of the instruction
+     */
+    size_t add(const Instruction& instruction, const std::vector<size_t>& after = {}) {
+      for (size_t index : after) {
+        ASSERT(index < _instructions.size());
+      }
+      _instructions.push_back(instruction);
+      _after.push_back(after);
+      return _instructions.size() - 1;
+    }
+
+    /**
+     * Returns the exact serialized size of a signed legacy transaction.
+     *
+     * @param transaction The transaction
+     * @param fee_payer The fee payer
+     */
+    static size_t serialized_size(const Transaction& transaction, const PublicKey& fee_payer) {
+      Candidate candidate;
+      candidate.keys[fee_payer] = true;
+      candidate.signers = 1;
+      for (auto& instruction : transaction.message.instructions) {
+        add_to(candidate, instruction);
+      }
+      return message_size(candidate.signers, candidate.keys.size(), transaction.message.instructions.size(), candidate.instruction_bytes);
+    }
+
+    /**
+     * Packs the added instructions into transactions, to be executed in order.
+     */
+    std::vector<Transaction> pack() const {
+      std::vector<bool> constrained(_instructions.size());
+      for (size_t i = 0; i < _instructions.size(); i++) {
+        if (!_after[i].empty()) {
+          constrained[i] = true;
+          for (size_t index : _after[i]) {
+            constrained[index] = true;
+          }
+        }
+      }
+
+      std::vector<Candidate> candidates;
+      std::vector<size_t> placed_in(_instructions.size());
+      for (size_t i = 0; i < _instructions.size(); i++) {
+        if (!constrained[i]) {
+          continue;
+        }
+        size_t first = 0;
+        for (size_t index : _after[i]) {
+          first = std::max(first, placed_in[index]);
+        }
+        placed_in[i] = place(candidates, i, first);
+      }
+
+      std::vector<size_t> free;
+      for (size_t i = 0; i < _instructions.size(); i++) {
+        if (!constrained[i]) {
+          free.push_back(i);
+        }
+      }
+      std::stable_sort(free.begin(), free.end(), [this](size_t a, size_t b) {
+        return instruction_size(_instructions[a]) + PUBLIC_KEY_LENGTH * _instructions[a].accounts.size() >
+          instruction_size(_instructions[b]) + PUBLIC_KEY_LENGTH * _instructions[b].accounts.size();
+      });
+      for (size_t i : free) {
+        place(candidates, i, 0);
+      }
+
+      std::vector<Transaction> transactions;
+      for (auto& candidate : candidates) {
+        Transaction transaction;
+        transaction.message.instructions = _prefix;
+        for (size_t index : candidate.instructions) {
+          transaction.add(_instructions[index]);
+        }
+        transactions.push_back(std::move(transaction));
+      }
+      return transactions;
+    }
+  };
 
   struct TransactionResponseReturnData {
     /** The program that generated the return data */
@@ -947,10 +1331,7 @@ namespace solana {
     std::string data;
   };
 
-  void from_json(const json& j, TransactionResponseReturnData& transactionReturnData) {
-    transactionReturnData.program_d = j["programId"].get<PublicKey>();
-    transactionReturnData.data = j["data"].get<std::string>();
-  }
+  void from_json(const json& j, TransactionResponseReturnData& transactionReturnData);
 
   struct TransactionResponse {
     /** The slot this transaction was processed in */
@@ -1017,58 +1398,12 @@ namespace solana {
     TransactionResponseReturnData return_data;
   };
 
-  void from_json(const json& j, TransactionResponse::Meta::InnerInstruction::Instruction& metaInstruction) {
-    metaInstruction.program_id_index = j["programIdIndex"].get<uint64_t>();
-    metaInstruction.accounts = j["accounts"].get<std::vector<uint64_t>>();
-    metaInstruction.data = j["data"].get<std::string>();
-  }
-
-  void from_json(const json& j, TransactionResponse::Meta::InnerInstruction& metaInnerInstruction) {
-    metaInnerInstruction.index = j["index"].get<uint64_t>();
-    metaInnerInstruction.instructions = j["instructions"].get<std::vector<TransactionResponse::Meta::InnerInstruction::Instruction>>();
-  }
-
-  void from_json(const json& j, TransactionResponse::Meta::TransactionReward& reward) {
-    reward.pubkey = j["pubkey"].get<PublicKey>();
-    reward.lamports = j["lamports"].get<uint64_t>();
-    reward.post_balance = j["postBalance"].get<uint64_t>();
-    reward.reward_type = j["rewardType"].get<std::string>();
-    if (j.find("commission") != j.end()) {
-      reward.commission = j["commission"].get<uint8_t>();
-    }
-  }
-
-  void from_json(const json& j, TransactionResponse::Meta::LoadedAddresses& loadedAddresses) {
-    loadedAddresses.readonly = j["readonly"].get<std::vector<PublicKey>>();
-    loadedAddresses.writable = j["writable"].get<std::vector<PublicKey>>();
-  }
-
-  void from_json(const json& j, TransactionResponse::Meta& meta) {
-    if (!j.at("err").is_null()) {
-      meta.err = j["err"].get<std::string>();
-    } else {
-      meta.err = "";
-    }
-    meta.fee = j["fee"].get<uint64_t>();
-    meta.inner_instructions = j["innerInstructions"].get<std::vector<TransactionResponse::Meta::InnerInstruction>>();
-    meta.log_messages = j["logMessages"].get<std::vector<std::string>>();
-    meta.loaded_addresses = j["loadedAddresses"].get<TransactionResponse::Meta::LoadedAddresses>();
-    meta.post_balances = j["postBalances"].get<std::vector<uint64_t>>();
-    meta.post_token_balances = j["postTokenBalances"].get<std::vector<TokenBalance>>();
-    meta.pre_balances = j["preBalances"].get<std::vector<uint64_t>>();
-    meta.pre_token_balances = j["preTokenBalances"].get<std::vector<TokenBalance>>();
-    meta.rewards = j["rewards"].get<std::vector<TransactionResponse::Meta::TransactionReward>>();
-  }
-
-  void from_json(const json& j, TransactionResponse& transactionResponse) {
-    transactionResponse.slot = j["slot"].get<uint64_t>();
-    transactionResponse.block_time = j["blockTime"].get<uint64_t>();
-    transactionResponse.transaction = j["transaction"].get<CompiledTransaction>();
-    transactionResponse.meta = j["meta"].get<TransactionResponse::Meta>();
-    if (j.contains("returnData")) {
-      transactionResponse.return_data = j["returnData"].get<TransactionResponseReturnData>();
-    }
-  }
+  void from_json(const json& j, TransactionResponse::Meta::InnerInstruction::Instruction& metaInstruction);
+  void from_json(const json& j, TransactionResponse::Meta::InnerInstruction& metaInnerInstruction);
+  void from_json(const json& j, TransactionResponse::Meta::TransactionReward& reward);
+  void from_json(const json& j, TransactionResponse::Meta::LoadedAddresses& loadedAddresses);
+  void from_json(const json& j, TransactionResponse::Meta& meta);
+  void from_json(const json& j, TransactionResponse& transactionResponse);
 
   struct SimulatedTransactionResponse {
     /** Error if the transaction failed */
@@ -1083,33 +1418,623 @@ namespace solana {
     TransactionResponseReturnData return_data;
   };
 
-  void from_json(const json& j, SimulatedTransactionResponse& simulatedTransactoinResponse) {
-    simulatedTransactoinResponse.err = j["value"]["err"].get<std::string>();
-    simulatedTransactoinResponse.logs = j["value"]["logs"].get<std::vector<std::string>>();
-    simulatedTransactoinResponse.accounts = j["value"]["accounts"].get<std::vector<AccountInfo>>();
-    simulatedTransactoinResponse.units_consumed = j["value"]["unitsConsumed"].get<uint64_t>();
-    simulatedTransactoinResponse.return_data = j["value"]["returnData"].get<TransactionResponseReturnData>();
-  }
+  void from_json(const json& j, SimulatedTransactionResponse& simulatedTransactoinResponse);
 
-  class Connection {
-    Commitment _commitment;
-    std::string _rpc_endpoint;
-    std::string _rpc_ws_endpoint;
-    websockets::WebSocketClient _rpc_web_socket;
+  struct PrioritizationFee {
+    /** The slot in which the fee was observed */
+    uint64_t slot;
+    /** The per-compute-unit fee paid by at least one successfully landed transaction, in micro-lamports */
+    uint64_t prioritization_fee;
+  };
 
-    static std::string make_websocket_url(std::string endpoint) {
-      auto url = endpoint;
-      url.replace(0, 4, "ws");
-      return url;
-    }
+  void from_json(const json& j, PrioritizationFee& fee);
 
-  public:
+  struct SignatureStatus {
+    /** False if the signature is not known to the node */
+    bool found;
+    /** The slot the transaction was processed in */
+    uint64_t slot;
+    /** Number of blocks since signature confirmation, empty if rooted */
+    std::optional<uint64_t> confirmations;
+    /** Error if the transaction failed, as JSON, empty if it succeeded */
+    std::string err;
+    /** The cluster confirmation status of the transaction */
+    Commitment confirmation_status;
+  };
 
-    Connection(std::string endpoint, Commitment commitment)
-      : _commitment(commitment),
-      _rpc_endpoint(endpoint),
-      _rpc_ws_endpoint(make_websocket_url(endpoint)),
-      _rpc_web_socket(_rpc_ws_endpoint)
+  void from_json(const json& j, SignatureStatus& status);
+
+  struct SignatureInfo {
+    /** Transaction signature, as base-58 encoded string */
+    std::string signature;
+    /** The slot that contains the block with the transaction */
+    uint64_t slot;
+    /** Error if the transaction failed, as JSON, empty if it succeeded */
+    std::string err;
+    /** Memo associated with the transaction, empty if there is none */
+    std::string memo;
+    /** Estimated production time as Unix timestamp, 0 if not available */
+    int64_t block_time;
+    /** The cluster confirmation status of the transaction */
+    Commitment confirmation_status;
+  };
+
+  void from_json(const json& j, SignatureInfo& info);
+
+  /**
+   * Variants of the result types whose strings and vectors are allocated from a memory resource, usually an arena,
+   * instead of the heap. They are decoded by the Connection methods taking a memory::Arena, straight from a JSON
+   * document that is itself allocated from the connection's scratch arena, and are only valid until their arena is
+   * reset. Copies made without an allocator go to the default resource, the heap.
+   */
+  namespace pmr {
+
+    /** A JSON document allocated from the current memory::Scope, strings included */
+    typedef nlohmann::basic_json<std::map, std::vector, std::basic_string<char, std::char_traits<char>, memory::CurrentAllocator<char>>,
+      bool, int64_t, uint64_t, double, memory::CurrentAllocator> json;
+
+    typedef std::pmr::polymorphic_allocator<char> allocator_type;
+
+    /** Returns the base-58 form of a key as a string of the current scope, without a heap string in between */
+    inline json base58(const PublicKey& key) {
+      char encoded[64];
+      size_t size = sizeof(encoded);
+      base58::b58enc(encoded, &size, key.bytes.data(), key.bytes.size());
+      return json::string_t(encoded, size - 1);
+    }
+
+    inline PublicKey public_key(const json& j) {
+      const auto& value = j.get_ref<const json::string_t&>();
+      PublicKey key;
+      size_t size = PUBLIC_KEY_LENGTH;
+      base58::b58tobin(key.bytes.data(), &size, value.data(), value.size());
+      return key;
+    }
+
+    template <typename String>
+    inline void assign(String& string, const json& j) {
+      const auto& value = j.get_ref<const json::string_t&>();
+      string.assign(value.data(), value.size());
+    }
+
+    struct Account {
+      typedef pmr::allocator_type allocator_type;
+
+      /** Number of lamports assigned to this account */
+      uint64_t lamports = 0;
+      /** Identifier of the program that owns the account */
+      PublicKey owner;
+      /** Data associated with the account, base-64 encoded */
+      std::pmr::string data;
+      /** Boolean indicating if the account contains a program (and is strictly read-only) */
+      bool executable = false;
+      /** The epoch at which this account will next owe rent */
+      uint64_t rent_epoch = 0;
+
+      Account(allocator_type allocator = {}) : data(allocator) {}
+
+      Account(const Account& other, allocator_type allocator = {})
+        : lamports(other.lamports), owner(other.owner), data(other.data, allocator), executable(other.executable), rent_epoch(other.rent_epoch) {}
+
+      Account(Account&& other, allocator_type allocator)
+        : lamports(other.lamports), owner(other.owner), data(std::move(other.data), allocator), executable(other.executable), rent_epoch(other.rent_epoch) {}
+
+      Account(Account&&) = default;
+      Account& operator=(const Account&) = default;
+      Account& operator=(Account&&) = default;
+    };
+
+    inline void from_json(const json& j, Account& account) {
+      account.lamports = j["lamports"].get<uint64_t>();
+      account.owner = public_key(j["owner"]);
+      if (j["data"].is_string()) {
+        assign(account.data, j["data"]);
+      } else {
+        ASSERT(j["data"][1].get_ref<const json::string_t&>() == "base64");
+        assign(account.data, j["data"][0]);
+      }
+      account.executable = j["executable"].get<bool>();
+      account.rent_epoch = j["rentEpoch"].get<uint64_t>();
+    }
+
+    struct AccountInfo {
+      typedef pmr::allocator_type allocator_type;
+
+      PublicKey pubkey;
+      Account account;
+
+      AccountInfo(allocator_type allocator = {}) : account(allocator) {}
+
+      AccountInfo(const AccountInfo& other, allocator_type allocator = {})
+        : pubkey(other.pubkey), account(other.account, allocator) {}
+
+      AccountInfo(AccountInfo&& other, allocator_type allocator)
+        : pubkey(other.pubkey), account(std::move(other.account), allocator) {}
+
+      AccountInfo(AccountInfo&&) = default;
+      AccountInfo& operator=(const AccountInfo&) = default;
+      AccountInfo& operator=(AccountInfo&&) = default;
+    };
+
+    inline void from_json(const json& j, AccountInfo& account_info) {
+      account_info.pubkey = public_key(j["pubkey"]);
+      from_json(j["account"], account_info.account);
+    }
+
+    struct CompiledTransaction {
+      typedef pmr::allocator_type allocator_type;
+
+      struct Message {
+        typedef pmr::allocator_type allocator_type;
+
+        /** The message header */
+        TransactionMessageHeader header;
+        /** The account keys used by the transaction, the signers first */
+        std::pmr::vector<PublicKey> account_keys;
+        /** A recent blockhash */
+        PublicKey recent_blockhash;
+        struct Instruction {
+          typedef pmr::allocator_type allocator_type;
+
+          /** Ordered indices into the account keys of the accounts to pass to the program */
+          std::pmr::vector<uint8_t> accounts;
+          /** The program input data */
+          std::pmr::vector<uint8_t> data;
+          /** Index into the account keys of the program that executes this instruction */
+          uint8_t program_id_index = 0;
+
+          Instruction(allocator_type allocator = {}) : accounts(allocator), data(allocator) {}
+
+          Instruction(const Instruction& other, allocator_type allocator = {})
+            : accounts(other.accounts, allocator), data(other.data, allocator), program_id_index(other.program_id_index) {}
+
+          Instruction(Instruction&& other, allocator_type allocator)
+            : accounts(std::move(other.accounts), allocator), data(std::move(other.data), allocator), program_id_index(other.program_id_index) {}
+
+          Instruction(Instruction&&) = default;
+          Instruction& operator=(const Instruction&) = default;
+          Instruction& operator=(Instruction&&) = default;
+        };
+        /** The instructions, executed in order */
+        std::pmr::vector<Instruction> instructions;
+
+        Message(allocator_type allocator = {}) : account_keys(allocator), instructions(allocator) {}
+
+        Message(const Message& other, allocator_type allocator = {})
+          : header(other.header), account_keys(other.account_keys, allocator), recent_blockhash(other.recent_blockhash), instructions(other.instructions, allocator) {}
+
+        Message(Message&&) = default;
+        Message& operator=(const Message&) = default;
+        Message& operator=(Message&&) = default;
+      } message;
+      /** The transaction signatures, base-58 encoded */
+      std::pmr::vector<std::pmr::string> signatures;
+
+      CompiledTransaction(allocator_type allocator = {}) : message(allocator), signatures(allocator) {}
+
+      CompiledTransaction(const CompiledTransaction& other, allocator_type allocator = {})
+        : message(other.message, allocator), signatures(other.signatures, allocator) {}
+
+      CompiledTransaction(CompiledTransaction&&) = default;
+      CompiledTransaction& operator=(const CompiledTransaction&) = default;
+      CompiledTransaction& operator=(CompiledTransaction&&) = default;
+    };
+
+    inline void from_json(const json& j, CompiledTransaction::Message::Instruction& instruction) {
+      const json& accounts = j["accounts"];
+      instruction.accounts.reserve(accounts.size());
+      for (auto& account : accounts) {
+        instruction.accounts.push_back(account.get<uint8_t>());
+      }
+      // Instruction data of the json transaction encoding is base-58, decoded at the end of the buffer
+      const auto& data = j["data"].get_ref<const json::string_t&>();
+      size_t capacity = data.size() * 733 / 1000 + 1;
+      size_t size = capacity;
+      instruction.data.resize(capacity);
+      if (base58::b58tobin(instruction.data.data(), &size, data.data(), data.size())) {
+        instruction.data.erase(instruction.data.begin(), instruction.data.begin() + (capacity - size));
+      } else {
+        instruction.data.clear();
+      }
+      instruction.program_id_index = j["programIdIndex"].get<uint8_t>();
+    }
+
+    inline void from_json(const json& j, CompiledTransaction& transaction) {
+      const json& message = j["message"];
+      transaction.message.header.num_readonly_signed_accounts = message["header"]["numReadonlySignedAccounts"].get<uint8_t>();
+      transaction.message.header.num_readonly_unsigned_accounts = message["header"]["numReadonlyUnsignedAccounts"].get<uint8_t>();
+      transaction.message.header.num_required_signatures = message["header"]["numRequiredSignatures"].get<uint8_t>();
+      transaction.message.account_keys.reserve(message["accountKeys"].size());
+      for (auto& key : message["accountKeys"]) {
+        transaction.message.account_keys.push_back(public_key(key));
+      }
+      transaction.message.recent_blockhash = public_key(message["recentBlockhash"]);
+      transaction.message.instructions.reserve(message["instructions"].size());
+      for (auto& instruction : message["instructions"]) {
+        transaction.message.instructions.emplace_back();
+        from_json(instruction, transaction.message.instructions.back());
+      }
+      transaction.signatures.reserve(j["signatures"].size());
+      for (auto& signature : j["signatures"]) {
+        transaction.signatures.emplace_back();
+        assign(transaction.signatures.back(), signature);
+      }
+    }
+
+    struct TransactionResponse {
+      typedef pmr::allocator_type allocator_type;
+
+      /** The slot this transaction was processed in */
+      uint64_t slot = 0;
+      /** The estimated production time of when the transaction was processed */
+      uint64_t block_time = 0;
+      /** The transaction */
+      CompiledTransaction transaction;
+      /** Transaction status metadata object */
+      struct Meta {
+        typedef pmr::allocator_type allocator_type;
+
+        /** Error if the transaction failed */
+        std::pmr::string err;
+        /** Fee this transaction was charged */
+        uint64_t fee = 0;
+        struct InnerInstruction {
+          typedef pmr::allocator_type allocator_type;
+
+          /** Index of the transaction instruction from which the inner instructions originated */
+          uint64_t index = 0;
+          struct Instruction {
+            typedef pmr::allocator_type allocator_type;
+
+            /** Index into the account keys of the program that executes this instruction */
+            uint64_t program_id_index = 0;
+            /** Ordered indices into the account keys of the accounts to pass to the program */
+            std::pmr::vector<uint64_t> accounts;
+            /** The program input data encoded in a base-58 string */
+            std::pmr::string data;
+
+            Instruction(allocator_type allocator = {}) : accounts(allocator), data(allocator) {}
+
+            Instruction(const Instruction& other, allocator_type allocator = {})
+              : program_id_index(other.program_id_index), accounts(other.accounts, allocator), data(other.data, allocator) {}
+
+            Instruction(Instruction&& other, allocator_type allocator)
+              : program_id_index(other.program_id_index), accounts(std::move(other.accounts), allocator), data(std::move(other.data), allocator) {}
+
+            Instruction(Instruction&&) = default;
+            Instruction& operator=(const Instruction&) = default;
+            Instruction& operator=(Instruction&&) = default;
+          };
+          std::pmr::vector<Instruction> instructions;
+
+          InnerInstruction(allocator_type allocator = {}) : instructions(allocator) {}
+
+          InnerInstruction(const InnerInstruction& other, allocator_type allocator = {})
+            : index(other.index), instructions(other.instructions, allocator) {}
+
+          InnerInstruction(InnerInstruction&& other, allocator_type allocator)
+            : index(other.index), instructions(std::move(other.instructions), allocator) {}
+
+          InnerInstruction(InnerInstruction&&) = default;
+          InnerInstruction& operator=(const InnerInstruction&) = default;
+          InnerInstruction& operator=(InnerInstruction&&) = default;
+        };
+        /** Inner instructions, if inner instruction recording was enabled */
+        std::pmr::vector<InnerInstruction> inner_instructions;
+        /** Pubkeys for loaded accounts */
+        struct LoadedAddresses {
+          std::pmr::vector<PublicKey> writable;
+          std::pmr::vector<PublicKey> readonly;
+        } loaded_addresses;
+        /** Log messages, if log message recording was enabled */
+        std::pmr::vector<std::pmr::string> log_messages;
+        /** Account balances before the transaction was processed */
+        std::pmr::vector<uint64_t> pre_balances;
+        /** Token balances before the transaction was processed */
+        std::pmr::vector<TokenBalance> pre_token_balances;
+        /** Account balances after the transaction was processed */
+        std::pmr::vector<uint64_t> post_balances;
+        /** Token balances after the transaction was processed */
+        std::pmr::vector<TokenBalance> post_token_balances;
+        struct TransactionReward {
+          typedef pmr::allocator_type allocator_type;
+
+          /** The Pubkey of the account that received the reward */
+          PublicKey pubkey;
+          /** The number of reward lamports credited or debited by the account */
+          uint64_t lamports = 0;
+          /** The account balance in lamports after the reward was applied */
+          uint64_t post_balance = 0;
+          /** The type of reward */
+          std::pmr::string reward_type;
+          /** Vote account commission when the reward was credited */
+          uint8_t commission = 0;
+
+          TransactionReward(allocator_type allocator = {}) : reward_type(allocator) {}
+
+          TransactionReward(const TransactionReward& other, allocator_type allocator = {})
+            : pubkey(other.pubkey), lamports(other.lamports), post_balance(other.post_balance), reward_type(other.reward_type, allocator), commission(other.commission) {}
+
+          TransactionReward(TransactionReward&& other, allocator_type allocator)
+            : pubkey(other.pubkey), lamports(other.lamports), post_balance(other.post_balance), reward_type(std::move(other.reward_type), allocator), commission(other.commission) {}
+
+          TransactionReward(TransactionReward&&) = default;
+          TransactionReward& operator=(const TransactionReward&) = default;
+          TransactionReward& operator=(TransactionReward&&) = default;
+        };
+        /** Transaction-level rewards, if requested */
+        std::pmr::vector<TransactionReward> rewards;
+
+        Meta(allocator_type allocator = {})
+          : err(allocator), inner_instructions(allocator), loaded_addresses{std::pmr::vector<PublicKey>(allocator), std::pmr::vector<PublicKey>(allocator)},
+          log_messages(allocator), pre_balances(allocator), pre_token_balances(allocator), post_balances(allocator),
+          post_token_balances(allocator), rewards(allocator) {}
+
+        Meta(const Meta& other, allocator_type allocator = {})
+          : err(other.err, allocator), fee(other.fee), inner_instructions(other.inner_instructions, allocator),
+          loaded_addresses{std::pmr::vector<PublicKey>(other.loaded_addresses.writable, allocator), std::pmr::vector<PublicKey>(other.loaded_addresses.readonly, allocator)},
+          log_messages(other.log_messages, allocator), pre_balances(other.pre_balances, allocator), pre_token_balances(other.pre_token_balances, allocator),
+          post_balances(other.post_balances, allocator), post_token_balances(other.post_token_balances, allocator), rewards(other.rewards, allocator) {}
+
+        Meta(Meta&&) = default;
+        Meta& operator=(const Meta&) = default;
+        Meta& operator=(Meta&&) = default;
+      } meta;
+      /** The return data of the transaction */
+      struct ReturnData {
+        /** The program that generated the return data */
+        PublicKey program_id;
+        /** The return data itself */
+        std::pmr::string data;
+      } return_data;
+
+      TransactionResponse(allocator_type allocator = {})
+        : transaction(allocator), meta(allocator), return_data{PublicKey(), std::pmr::string(allocator)} {}
+
+      TransactionResponse(const TransactionResponse& other, allocator_type allocator = {})
+        : slot(other.slot), block_time(other.block_time), transaction(other.transaction, allocator), meta(other.meta, allocator),
+        return_data{other.return_data.program_id, std::pmr::string(other.return_data.data, allocator)} {}
+
+      TransactionResponse(TransactionResponse&&) = default;
+      TransactionResponse& operator=(const TransactionResponse&) = default;
+      TransactionResponse& operator=(TransactionResponse&&) = default;
+    };
+
+    inline void from_json(const json& j, TokenBalance& balance) {
+      const json& amount = j.contains("uiTokenAmount") ? j["uiTokenAmount"] : j;
+      const auto& value = amount["amount"].get_ref<const json::string_t&>();
+      balance.amount = strtoull(value.c_str(), nullptr, 10);
+      balance.decimals = amount["decimals"].get<uint64_t>();
+    }
+
+    inline void from_json(const json& j, TransactionResponse::Meta::InnerInstruction& inner_instruction) {
+      inner_instruction.index = j["index"].get<uint64_t>();
+      inner_instruction.instructions.reserve(j["instructions"].size());
+      for (auto& item : j["instructions"]) {
+        inner_instruction.instructions.emplace_back();
+        auto& instruction = inner_instruction.instructions.back();
+        instruction.program_id_index = item["programIdIndex"].get<uint64_t>();
+        for (auto& account : item["accounts"]) {
+          instruction.accounts.push_back(account.get<uint64_t>());
+        }
+        assign(instruction.data, item["data"]);
+      }
+    }
+
+    inline void from_json(const json& j, TransactionResponse::Meta::TransactionReward& reward) {
+      reward.pubkey = public_key(j["pubkey"]);
+      reward.lamports = j["lamports"].get<uint64_t>();
+      reward.post_balance = j["postBalance"].get<uint64_t>();
+      assign(reward.reward_type, j["rewardType"]);
+      if (j.find("commission") != j.end() && !j["commission"].is_null()) {
+        reward.commission = j["commission"].get<uint8_t>();
+      }
+    }
+
+    inline void from_json(const json& j, TransactionResponse::Meta& meta) {
+      if (!j.at("err").is_null()) {
+        auto err = j["err"].dump();
+        meta.err.assign(err.data(), err.size());
+      }
+      meta.fee = j["fee"].get<uint64_t>();
+      if (j.contains("innerInstructions") && !j["innerInstructions"].is_null()) {
+        for (auto& item : j["innerInstructions"]) {
+          meta.inner_instructions.emplace_back();
+          from_json(item, meta.inner_instructions.back());
+        }
+      }
+      if (j.contains("logMessages") && !j["logMessages"].is_null()) {
+        for (auto& item : j["logMessages"]) {
+          meta.log_messages.emplace_back();
+          assign(meta.log_messages.back(), item);
+        }
+      }
+      if (j.contains("loadedAddresses")) {
+        for (auto& key : j["loadedAddresses"]["writable"]) {
+          meta.loaded_addresses.writable.push_back(public_key(key));
+        }
+        for (auto& key : j["loadedAddresses"]["readonly"]) {
+          meta.loaded_addresses.readonly.push_back(public_key(key));
+        }
+      }
+      for (auto& balance : j["preBalances"]) {
+        meta.pre_balances.push_back(balance.get<uint64_t>());
+      }
+      for (auto& balance : j["postBalances"]) {
+        meta.post_balances.push_back(balance.get<uint64_t>());
+      }
+      for (auto& balance : j["preTokenBalances"]) {
+        meta.pre_token_balances.emplace_back();
+        from_json(balance, meta.pre_token_balances.back());
+      }
+      for (auto& balance : j["postTokenBalances"]) {
+        meta.post_token_balances.emplace_back();
+        from_json(balance, meta.post_token_balances.back());
+      }
+      if (j.contains("rewards") && !j["rewards"].is_null()) {
+        for (auto& item : j["rewards"]) {
+          meta.rewards.emplace_back();
+          from_json(item, meta.rewards.back());
+        }
+      }
+    }
+
+    inline void from_json(const json& j, TransactionResponse& response) {
+      response.slot = j["slot"].get<uint64_t>();
+      response.block_time = j["blockTime"].is_null() ? 0 : j["blockTime"].get<uint64_t>();
+      from_json(j["transaction"], response.transaction);
+      from_json(j["meta"], response.meta);
+      if (j.contains("returnData") && !j["returnData"].is_null()) {
+        response.return_data.program_id = public_key(j["returnData"]["programId"]);
+        assign(response.return_data.data, j["returnData"]["data"]);
+      }
+    }
+
+    template <typename T>
+    void from_json(const json& j, std::pmr::vector<T>& values) {
+      values.reserve(j.size());
+      for (auto& item : j) {
+        values.emplace_back();
+        from_json(item, values.back());
+      }
+    }
+
+    /**
+     * Decodes a JSON-RPC response into a result whose value is allocated from a resource
+     */
+    template <typename T>
+    void from_json(const json& j, Result<T>& result, std::pmr::memory_resource* resource) {
+      if (j.contains("result")) {
+        const json* value = &j["result"];
+        if (value->is_object() && value->contains("context")) {
+          result._context = Context{(*value)["context"]["slot"].get<uint64_t>()};
+        }
+        if (value->is_object() && value->contains("value")) {
+          value = &(*value)["value"];
+        }
+        if (!value->is_null()) {
+          from_json(*value, result._result.emplace(resource));
+        }
+      } else if (j.contains("error")) {
+        const auto& message = j["error"]["message"].get_ref<const json::string_t&>();
+        result._error = ResultError{j["error"]["code"].get<int64_t>(), std::string(message.data(), message.size())};
+      }
+    }
+
+  } // namespace pmr
+
+/**
+ * The result types of the Connection calls. The many library instantiates their results and decoders once, builds
+ * against it declare them extern instead of instantiating them in every translation unit.
+ */
+#define SOLANA_RESULT_TYPES(X)            \
+  X(uint64_t)                             \
+  X(std::string)                          \
+  X(Account)                              \
+  X(Blockhash)                            \
+  X(EpochInfo)                            \
+  X(Identity)                             \
+  X(LeaderSchedule)                       \
+  X(Logs)                                 \
+  X(PublicKey)                            \
+  X(SignatureStatus)                      \
+  X(SimulatedTransactionResponse)         \
+  X(SlotInfo)                             \
+  X(TokenBalance)                         \
+  X(TransactionResponse)                  \
+  X(Version)                              \
+  X(std::vector<Account>)                 \
+  X(std::vector<AccountInfo>)             \
+  X(std::vector<ClusterNode>)             \
+  X(std::vector<PrioritizationFee>)       \
+  X(std::vector<SignatureInfo>)           \
+  X(std::vector<SignatureStatus>)         \
+  X(std::vector<TokenAccount>)
+
+#ifdef MANY_COMPILED_LIB
+#define SOLANA_EXTERN_RESULT(T)      \
+  extern template class Result<T>;   \
+  extern template void from_json<T>(const json& j, Result<T>& r);
+  SOLANA_RESULT_TYPES(SOLANA_EXTERN_RESULT)
+#undef SOLANA_EXTERN_RESULT
+#endif
+
+  class Connection {
+    Commitment _commitment;
+    std::string _rpc_endpoint;
+    std::string _rpc_ws_endpoint;
+    websockets::WebSocketClient _rpc_web_socket;
+    std::unique_ptr<http::ConnectionPool> _http_pool;
+    /** The default arena of the results decoded into arenas */
+    memory::Arena _arena;
+
+    /**
+     * The request and response documents of the calls decoding into arenas, reset by each call. It is per thread, so
+     * calls on the same connection from several threads do not overwrite each other's documents.
+     */
+    static memory::Arena& scratch() {
+      static thread_local memory::Arena arena;
+      return arena;
+    }
+
+    static std::string make_websocket_url(std::string endpoint) {
+      auto url = endpoint;
+      url.replace(0, 4, "ws");
+      return url;
+    }
+
+    /** Posts a request on the keep-alive connections if enabled, on a new connection otherwise */
+    json post(json request) const {
+      if (_http_pool) {
+        return _http_pool->post(std::move(request));
+      }
+      return http::post(_rpc_endpoint, std::move(request));
+    }
+
+    /**
+     * Posts a request and decodes the response into an arena. The request and response documents are allocated from
+     * the scratch arena, and the response is parsed in place from the HTTP client's buffer.
+     *
+     * @param arena The arena the result is allocated from
+     * @param method The JSON-RPC method
+     * @param params Called with the params of the request to fill in
+     */
+    template <typename T, typename F>
+    Result<T> post(memory::Arena& arena, const char* method, F params) {
+      Result<T> result;
+      memory::Arena& scratch = Connection::scratch();
+      scratch.reset();
+      {
+        memory::Scope scope(scratch);
+        // The documents live in the scratch arena and are dropped with it, nlohmann's destructor would take a heap stack
+        // and so would the temporaries of initializer lists, so the request is built by assignment
+        pmr::json& request = scratch.make<pmr::json>();
+        request["jsonrpc"] = "2.0";
+        request["id"] = 1;
+        request["method"] = method;
+        params(request["params"]);
+        pmr::json::string_t body = request.dump();
+        auto on_response = [&](const char* data, size_t length) {
+          pmr::json& response = scratch.make<pmr::json>(pmr::json::parse(data, data + length));
+          pmr::from_json(response, result, &arena);
+        };
+        if (_http_pool) {
+          _http_pool->post(body.data(), body.size(), on_response);
+        } else {
+          http::post(_rpc_endpoint, body.data(), body.size(), on_response);
+        }
+      }
+      scratch.reset();
+      return result;
+    }
+
+  public:
+
+    Connection(std::string endpoint, Commitment commitment)
+      : _commitment(commitment),
+      _rpc_endpoint(endpoint),
+      _rpc_ws_endpoint(make_websocket_url(endpoint)),
+      _rpc_web_socket(_rpc_ws_endpoint)
     {
       auto sodium_result = sodium_init();
       if (sodium_result == -1) {
@@ -1126,6 +2051,41 @@ namespace solana {
     Connection& operator=(const Connection&) = delete;
     Connection& operator=(Connection&&) = delete;
 
+    /**
+     * Returns the HTTP endpoint of the connection.
+     */
+    const std::string& endpoint() const {
+      return _rpc_endpoint;
+    }
+
+    /**
+     * Sends the HTTP requests over kept-alive connections instead of opening a connection per request, which
+     * saves the TCP and TLS handshakes of every call.
+     *
+     * @param connections The number of connections, 0 to go back to a connection per request
+     */
+    void keep_alive(size_t connections = 1) {
+      _http_pool.reset(connections > 0 ? new http::ConnectionPool(_rpc_endpoint, connections) : nullptr);
+    }
+
+    /**
+     * Returns true if the HTTP requests go over kept-alive connections
+     */
+    bool is_kept_alive() const {
+      return _http_pool != nullptr;
+    }
+
+    /**
+     * Returns the connection's arena for the methods decoding into an arena. Their results are only valid until the
+     * arena is reset, which the caller does once they are consumed. Combined with keep_alive(), a warmed up call then
+     * takes no memory from the heap beyond the few internal buffers of the JSON parser.
+     *
+     * Like any arena it is not thread safe: threads calling these methods concurrently must pass arenas of their own.
+     */
+    memory::Arena& arena() {
+      return _arena;
+    }
+
     //-------- Http methods --------------------------------------------------------------------
 
     /**
@@ -1134,7 +2094,7 @@ namespace solana {
      * @param public_key The Pubkey of account to query
      */
     Result<Account> get_account_info(const PublicKey& public_key) {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getAccountInfo"},
@@ -1147,13 +2107,26 @@ namespace solana {
       });
     }
 
+    /**
+     * Returns all information associated with the account of provided Pubkey, allocated from an arena.
+     *
+     * @param public_key The Pubkey of account to query
+     * @param arena The arena the account is allocated from, such as arena()
+     */
+    Result<pmr::Account> get_account_info(const PublicKey& public_key, memory::Arena& arena) {
+      return post<pmr::Account>(arena, "getAccountInfo", [&](pmr::json& params) {
+        params[0] = pmr::base58(public_key);
+        params[1]["encoding"] = "base64";
+      });
+    }
+
     /**
      * Returns the balance of the account of provided Pubkey.
      *
      * @param public_key The Pubkey of the account to query
      */
     Result<uint64_t> get_balance(const PublicKey& public_key) {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getBalance"},
@@ -1163,22 +2136,51 @@ namespace solana {
       });
     }
 
+    /**
+     * Returns the current block height of the node.
+     *
+     * @param commitment The commitment level of the block height
+     */
+    Result<uint64_t> get_block_height(const Commitment& commitment = Commitment::Finalized) {
+      return post({
+        {"jsonrpc", "2.0"},
+        {"id", 1},
+        {"method", "getBlockHeight"},
+        {"params", {
+          {
+            {"commitment", commitment},
+          },
+        }},
+      });
+    }
+
     /**
      * Returns information about all the nodes participating in the cluster.
      */
     Result<std::vector<ClusterNode>> get_cluster_nodes() {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getClusterNodes"},
       });
     }
 
+    /**
+     * Returns information about the current epoch.
+     */
+    Result<EpochInfo> get_epoch_info() {
+      return post({
+        {"jsonrpc", "2.0"},
+        {"id", 1},
+        {"method", "getEpochInfo"},
+      });
+    }
+
     /**
      * Returns the identity Pubkey of the current node.
      */
     Result<Identity> get_identity() {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getIdentity"},
@@ -1189,7 +2191,7 @@ namespace solana {
      * Returns the latest blockhash.
      */
     Result<Blockhash> get_latest_blockhash() const {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getLatestBlockhash"},
@@ -1202,7 +2204,7 @@ namespace solana {
      * @param leader_address The Pubkey of the leader to query
      */
     Result<LeaderSchedule> get_leader_schedule(const PublicKey& leader_address) {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getLeaderSchedule"},
@@ -1214,6 +2216,18 @@ namespace solana {
       });
     }
 
+    /**
+     * Returns the leader schedule of the current epoch, the base58 identity of every leader mapped to its slot indices
+     * relative to the first slot of the epoch.
+     */
+    Result<std::map<std::string, std::vector<uint64_t>>> get_leader_schedule() {
+      return post({
+        {"jsonrpc", "2.0"},
+        {"id", 1},
+        {"method", "getLeaderSchedule"},
+      });
+    }
+
     /**
      * Returns the account information for a list of Pubkeys.
      *
@@ -1224,7 +2238,7 @@ namespace solana {
       for (auto public_key : public_keys) {
         base58Keys.push_back(public_key.to_base58());
       }
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getMultipleAccounts"},
@@ -1243,7 +2257,7 @@ namespace solana {
      * @param program_id The Pubkey of the program to query
      */
     Result<std::vector<AccountInfo>> get_program_accounts(const PublicKey& program_id) {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getProgramAccounts"},
@@ -1256,14 +2270,103 @@ namespace solana {
       });
     }
 
+    /**
+     * Returns all accounts owned by the provided program Pubkey, allocated from an arena.
+     *
+     * @param program_id The Pubkey of the program to query
+     * @param arena The arena the accounts are allocated from, such as arena()
+     */
+    Result<std::pmr::vector<pmr::AccountInfo>> get_program_accounts(const PublicKey& program_id, memory::Arena& arena) {
+      return post<std::pmr::vector<pmr::AccountInfo>>(arena, "getProgramAccounts", [&](pmr::json& params) {
+        params[0] = pmr::base58(program_id);
+        params[1]["encoding"] = "base64";
+      });
+    }
+
+    /**
+     * Returns the statuses of a list of signatures, in the same order. Unknown signatures have found set to false.
+     *
+     * @param signatures The signatures to query, at most 256
+     * @param search_transaction_history Whether to search beyond the recent status cache
+     */
+    Result<std::vector<SignatureStatus>> get_signature_statuses(const std::vector<std::string>& signatures, bool search_transaction_history = false) {
+      return post({
+        {"jsonrpc", "2.0"},
+        {"id", 1},
+        {"method", "getSignatureStatuses"},
+        {"params", {
+          signatures,
+          {
+            {"searchTransactionHistory", search_transaction_history},
+          },
+        }},
+      });
+    }
+
+    /**
+     * Returns signatures for confirmed transactions that include the given address, newest first.
+     * Page backwards through history by passing the last signature of a page as `before`.
+     *
+     * @param address The account address
+     * @param before Start searching backwards from this transaction signature, empty for the most recent
+     * @param until Search until this transaction signature, empty to search back as far as `limit` allows
+     * @param limit The maximum number of signatures to return, between 1 and 1000
+     */
+    Result<std::vector<SignatureInfo>> get_signatures_for_address(const PublicKey& address, const std::string& before = "", const std::string& until = "", size_t limit = 1000) {
+      json options = {
+        {"limit", limit},
+        {"commitment", _commitment},
+      };
+      if (!before.empty()) {
+        options["before"] = before;
+      }
+      if (!until.empty()) {
+        options["until"] = until;
+      }
+      return post({
+        {"jsonrpc", "2.0"},
+        {"id", 1},
+        {"method", "getSignaturesForAddress"},
+        {"params", {
+          address.to_base58(),
+          options,
+        }},
+      });
+    }
+
+    /**
+     * Returns the prioritization fees of the recent slots for transactions locking all the given accounts as writable.
+     *
+     * @param public_keys The writable accounts, at most 128
+     */
+    Result<std::vector<PrioritizationFee>> get_recent_prioritization_fees(const std::vector<PublicKey>& public_keys = {}) {
+      std::vector<std::string> base58Keys;
+      for (auto& public_key : public_keys) {
+        base58Keys.push_back(public_key.to_base58());
+      }
+      return post({
+        {"jsonrpc", "2.0"},
+        {"id", 1},
+        {"method", "getRecentPrioritizationFees"},
+        {"params", {
+          base58Keys,
+        }},
+      });
+    }
+
     /**
      * Returns the slot that has reached the given or default commitment level.
      */
     Result<uint64_t> get_slot(const Commitment& commitment = Commitment::Finalized) {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getSlot"},
+        {"params", {
+          {
+            {"commitment", commitment},
+          },
+        }},
       });
     }
 
@@ -1271,7 +2374,7 @@ namespace solana {
      * Returns the current slot leader.
      */
     Result<PublicKey> get_slot_leader() {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getSlotLeader"},
@@ -1284,7 +2387,7 @@ namespace solana {
      * @param token_address The Pubkey of the token account to query
      */
     Result<TokenBalance> get_token_account_balance(const PublicKey& token_address) {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getTokenAccountBalance"},
@@ -1300,7 +2403,7 @@ namespace solana {
      * @param owner_address The Pubkey of account owner to query
      */
     Result<std::vector<TokenAccount>> get_token_accounts_by_owner(const PublicKey& owner_address) {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getTokenAccountsByOwner"},
@@ -1323,7 +2426,7 @@ namespace solana {
      * @param token_mint The mint of the token to query
      */
     Result<std::vector<TokenAccount>> get_token_accounts_by_owner(const PublicKey& owner_address, const PublicKey& token_mint) {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getTokenAccountsByOwner"},
@@ -1345,7 +2448,7 @@ namespace solana {
      * @param token_mint The Pubkey of the token mint to query
      */
     Result<TokenBalance> get_token_supply(const PublicKey& token_mint) {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getTokenSupply"},
@@ -1363,7 +2466,7 @@ namespace solana {
     Result<TransactionResponse> get_transaction(const std::string& transaction_signature) {
       //TODO commitment
 
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getTransaction"},
@@ -1374,10 +2477,22 @@ namespace solana {
     }
 
     /**
-     * Returns the current solana versions running on the node.
+     * Returns transaction details for a confirmed transaction, allocated from an arena.
+     *
+     * @param transaction_signature The signature of the transaction to query
+     * @param arena The arena the transaction is allocated from, such as arena()
+     */
+    Result<pmr::TransactionResponse> get_transaction(const std::string& transaction_signature, memory::Arena& arena) {
+      return post<pmr::TransactionResponse>(arena, "getTransaction", [&](pmr::json& params) {
+        params[0] = pmr::json::string_t(transaction_signature.data(), transaction_signature.size());
+      });
+    }
+
+    /**
+     * Returns the current solana versions running on the node.
      */
     Result<Version> get_version() {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "getVersion"},
@@ -1391,7 +2506,7 @@ namespace solana {
      * @param lamports The number of lamports to airdrop
      */
     Result<std::string> request_airdrop(const PublicKey& recipient_address, const uint64_t& lamports = LAMPORTS_PER_SOL) {
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "requestAirdrop"},
@@ -1412,27 +2527,34 @@ namespace solana {
     Result<std::string> sign_and_send_transaction(Transaction& transaction, const std::vector<Keypair>& signers) const {
       transaction.message.recent_blockhash = get_latest_blockhash().unwrap().blockhash;
 
-      auto compiled_message = transaction.message.compile(signers);
-      CompiledTransaction compiled_transaction = {
-        .message = compiled_message,
-      };
-
-      std::vector<uint8_t> serialized_message;
-      compiled_message.serialize(serialized_message);
+      std::vector<uint8_t> serialized_transaction = transaction.sign(signers);
 
-      compiled_transaction.sign(serialized_message, signers);
+      return send_transaction(base64::encode(serialized_transaction));
+    }
 
-      std::vector<uint8_t> serialized_transaction = compiled_transaction.serialize(serialized_message);
+    /**
+     * Submits a signed transaction to the cluster for processing.
+     *
+     * @param signed_transaction The base64 encoded signed transaction
+     * @param skip_preflight Whether to skip the preflight transaction checks
+     * @param max_retries Maximum number of times for the node to retry sending the transaction, the node's default if empty
+     */
+    Result<std::string> send_transaction(const std::string& signed_transaction, bool skip_preflight = false, std::optional<uint64_t> max_retries = std::nullopt) const {
+      json options = {
+        {"encoding", "base64"},
+        {"skipPreflight", skip_preflight},
+      };
+      if (max_retries) {
+        options["maxRetries"] = *max_retries;
+      }
 
-      return http::post(_rpc_endpoint, {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "sendTransaction"},
         {"params", {
-          base64::encode(serialized_transaction),
-          {
-            {"encoding", "base64"},
-          },
+          signed_transaction,
+          options,
         }},
       });
     }
@@ -1441,9 +2563,10 @@ namespace solana {
      * Simulate sending a transaction.
      *
      * @param signed_transaction The signed transaction to simulate
+     * @param replace_recent_blockhash Whether to replace the recent blockhash with the latest one, skipping signature verification
      */
-    Result<SimulatedTransactionResponse> simulate_transaction(const std::string& signed_transaction) {
-      return http::post(_rpc_endpoint, {
+    Result<SimulatedTransactionResponse> simulate_transaction(const std::string& signed_transaction, bool replace_recent_blockhash = false) {
+      return post({
         {"jsonrpc", "2.0"},
         {"id", 1},
         {"method", "simulateTransaction"},
@@ -1451,6 +2574,8 @@ namespace solana {
           signed_transaction,
           {
             {"encoding", "base64"},
+            {"sigVerify", false},
+            {"replaceRecentBlockhash", replace_recent_blockhash},
           },
         }},
       });
@@ -1466,11 +2591,45 @@ namespace solana {
      * Poll the websocket for new messages.
      */
     void poll() {
-      if (_rpc_web_socket.is_connected()) {
+      if (_rpc_web_socket.is_connected() || _rpc_web_socket.is_replaying()) {
         _rpc_web_socket.poll();
       }
     }
 
+    /**
+     * Starts recording the bytes received by the websocket to a capture file, see WebSocketClient::record.
+     *
+     * @param path The capture file to create
+     */
+    void record(const std::string& path) {
+      _rpc_web_socket.record(path);
+    }
+
+    /**
+     * Stops recording the websocket.
+     */
+    void stop_recording() {
+      _rpc_web_socket.stop_recording();
+    }
+
+    /**
+     * Replays a capture through poll() instead of the websocket. Listeners added afterwards in the order of the
+     * recording receive the recorded notifications, see WebSocketClient::replay.
+     *
+     * @param path The capture file
+     * @param speed How many times faster than recorded to replay, 0 for as fast as poll() is called
+     */
+    void replay(const std::string& path, double speed = 1) {
+      _rpc_web_socket.replay(path, speed);
+    }
+
+    /**
+     * Returns true until the replayed capture has been delivered completely
+     */
+    bool is_replaying() const {
+      return _rpc_web_socket.is_replaying();
+    }
+
     /**
      * Add an account change listener.
      *
@@ -1492,6 +2651,33 @@ namespace solana {
       );
     }
 
+    /**
+     * Add an account change listener that keeps the previous account data and only calls back for the watched byte
+     * ranges that changed.
+     *
+     * @param account_id The account to listen for changes
+     * @param differ The differ holding the per-field callbacks, which must outlive the subscription
+     *
+     * @return The subscription ID. This can be used to remove the listener with remove_account_listener
+    */
+    int on_account_diff(PublicKey account_id, diff::ByteDiffer& differ) {
+      auto data = std::make_shared<std::vector<uint8_t>>();
+      return _rpc_web_socket.subscribe("accountSubscribe", {
+          account_id.to_base58(),
+          {
+            {"encoding", "base64"},
+            {"commitment", _commitment},
+          },
+        }, [&differ, data](const json& j) {
+          Result<Account> result(j);
+          if (result.ok()) {
+            size_t length = base64::decode(result._result->data, *data);
+            differ.update(data->data(), length);
+          }
+        }
+      );
+    }
+
     /**
      * Remove an account change listener.
      *
@@ -1570,6 +2756,36 @@ namespace solana {
       _rpc_web_socket.unsubscribe(subscription_id, "programUnsubscribe");
     }
 
+    /**
+     * Add a signature listener. The node removes the subscription after the first notification.
+     *
+     * @param signature The transaction signature to listen for
+     * @param commitment The commitment level the transaction has to reach
+     * @param callback The callback function to call when the transaction reaches the commitment level
+     *
+     * @return The subscription ID. This can be used to remove the listener with remove_signature_listener
+    */
+    int on_signature(const std::string& signature, Commitment commitment, std::function<void(Result<SignatureStatus>)> callback) {
+      return _rpc_web_socket.subscribe("signatureSubscribe", {
+          signature,
+          {
+            {"commitment", commitment},
+          },
+        }, [callback](const json& j) {
+          callback(Result<SignatureStatus>(j));
+        }
+      );
+    }
+
+    /**
+     * Remove a signature listener.
+     *
+     * @param subscription_id The subscription id returned by on_signature
+    */
+    void remove_signature_listener(int subscription_id) {
+      _rpc_web_socket.unsubscribe(subscription_id, "signatureUnsubscribe");
+    }
+
     /**
      * Add a slot change listener.
      *
@@ -1596,169 +2812,4382 @@ namespace solana {
       _rpc_web_socket.unsubscribe(subscription_id, "slotUnsubscribe");
     }
 
+    /**
+     * Add a root listener, called with every slot the node roots.
+     *
+     * @param callback The callback function to call with the new root
+     *
+     * @return The subscription ID. This can be used to remove the listener with remove_root_listener
+    */
+    int on_root(std::function<void(Result<uint64_t>)> callback) {
+      return _rpc_web_socket.subscribe("rootSubscribe", {
+        }, [callback](const json& j) {
+          callback(j);
+        }
+      );
+    }
+
+    /**
+     * Remove a root listener.
+     *
+     * @param subscription_id The subscription id returned by on_root
+    */
+    void remove_root_listener(int subscription_id) {
+      _rpc_web_socket.unsubscribe(subscription_id, "rootUnsubscribe");
+    }
+
   };
 
-  namespace token {
+  /**
+   * Mirrors the raw data of a set of accounts, kept up to date by account change subscriptions.
+   *
+   * The account data is allocated from a memory resource, so that large caches can live on huge pages through a
+   * memory::PageResource.
+   */
+  class AccountCache {
+  public:
+
+    struct Entry {
+      /** Number of lamports assigned to the account */
+      uint64_t lamports;
+      /** Identifier of the program that owns the account */
+      PublicKey owner;
+      /** The slot of the last update */
+      uint64_t slot;
+      /** The decoded account data */
+      std::pmr::vector<uint8_t> data;
+    };
+
+    typedef std::function<void(const PublicKey&, const Entry&)> Listener;
+
+  private:
+
+    std::pmr::memory_resource* _resource;
+    std::map<PublicKey, Entry> _accounts;
+    std::vector<Listener> _listeners;
+
+  public:
 
     /**
-     * Returns an Instruction to create an Associated Token Account
+     * @param resource The memory resource the account data is allocated from, which must outlive the cache
+     */
+    explicit AccountCache(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : _resource(resource)
+    {}
+
+    /**
+     * Stores a new version of an account and notifies the listeners.
      *
-     * @param payer Payer of the initialization fees
-     * @param associated_token New associated token account
-     * @param owner Owner of the new account
-     * @param mint Token mint account
-     * @param program_id SPL Token program account
-     * @param associated_token_program_id SPL Associated Token program account
+     * @param pubkey The account's Pubkey
+     * @param account The account, with base64 encoded data
+     * @param slot The slot of the update
      */
-    Transaction::Message::Instruction create_associated_token_account_instruction(
-      const PublicKey& payer,
-      const PublicKey& associated_token,
-      const PublicKey& owner,
-      const PublicKey& mint,
-      const PublicKey& program_id = TOKEN_PROGRAM_ID,
-      const PublicKey& associated_token_program_id = ASSOCIATED_TOKEN_PROGRAM_ID
-    ) {
-      json accounts = {
-        {
-          { "pubkey", payer.to_base58() },
-          { "isSigner", true },
-          { "isWritable", true },
-        },
-        {
-          { "pubkey", associated_token.to_base58() },
-          { "isSigner", false },
-          { "isWritable", true },
-        },
-        {
-          { "pubkey", owner.to_base58() },
-          { "isSigner", false },
-          { "isWritable", false },
-        },
-        {
-          { "pubkey", mint.to_base58() },
-          { "isSigner", false },
-          { "isWritable", false },
-        },
-        {
-          { "pubkey", SYSTEM_PROGRAM.to_base58() },
-          { "isSigner", false },
-          { "isWritable", false },
-        },
-        {
-          { "pubkey", program_id.to_base58() },
-          { "isSigner", false },
-          { "isWritable", false },
-        },
-      };
+    void update(const PublicKey& pubkey, const Account& account, uint64_t slot = 0) {
+      Entry& entry = _accounts.try_emplace(pubkey, Entry{0, PublicKey(), 0, std::pmr::vector<uint8_t>(_resource)}).first->second;
+      entry.lamports = account.lamports;
+      entry.owner = account.owner;
+      entry.slot = slot;
+      base64::decode(account.data, entry.data);
+      for (auto& listener : _listeners) {
+        listener(pubkey, entry);
+      }
+    }
 
-      return {
-        associated_token_program_id,
-        accounts,
-        {}
-      };
+    /**
+     * Returns the cached account, or nullptr if the account is not cached. The pointer stays valid as long as the cache.
+     *
+     * @param pubkey The account's Pubkey
+     */
+    const Entry* get(const PublicKey& pubkey) const {
+      auto it = _accounts.find(pubkey);
+      return it == _accounts.end() ? nullptr : &it->second;
     }
 
     /**
-     * Returns a Transaction to create an Associated Token Account
+     * Returns every cached account.
+     */
+    const std::map<PublicKey, Entry>& accounts() const {
+      return _accounts;
+    }
+
+    /**
+     * Adds a listener that is called after every update.
      *
-     * @param payer Payer of the initialization fees
-     * @param associated_token New associated token account
-     * @param owner Owner of the new account
-     * @param mint Token mint account
-     * @param program_id SPL Token program account
-     * @param associated_token_program_id SPL Associated Token program account
+     * @param listener The callback function
      */
-    Transaction create_associated_token_account_transaction(
-      const PublicKey& payer,
-      const PublicKey& associated_token,
-      const PublicKey& owner,
-      const PublicKey& mint,
-      const PublicKey& program_id = TOKEN_PROGRAM_ID,
-      const PublicKey& associated_token_program_id = ASSOCIATED_TOKEN_PROGRAM_ID
-    ) {
-      Transaction tx;
-      tx.add(
-        create_associated_token_account_instruction(
-          payer,
-          associated_token,
-          owner,
-          mint,
-          program_id,
-          associated_token_program_id
-        )
-      );
+    void on_update(Listener listener) {
+      _listeners.push_back(listener);
+    }
 
-      return tx;
+    /**
+     * Fetches the account once and keeps it up to date with an account change subscription.
+     *
+     * @param connection The connection to subscribe with, which must outlive the subscription
+     * @param pubkey The account to mirror
+     *
+     * @return The subscription ID
+     */
+    int subscribe(Connection& connection, const PublicKey& pubkey) {
+      Result<Account> result = connection.get_account_info(pubkey);
+      if (result.ok()) {
+        update(pubkey, result._result.value(), result._context ? result._context->slot : 0);
+      }
+      return connection.on_account_change(pubkey, [this, pubkey](Result<Account> result) {
+        if (result.ok()) {
+          update(pubkey, result._result.value(), result._context ? result._context->slot : 0);
+        }
+      });
     }
+  };
+
+  namespace sysvar {
+
+    /** Bytes of account metadata charged for rent on top of the account data */
+    const uint64_t ACCOUNT_STORAGE_OVERHEAD = 128;
+
+    /** Base fee charged per transaction signature, in lamports */
+    const uint64_t DEFAULT_LAMPORTS_PER_SIGNATURE = 5000;
 
     /**
-     * Get the address of the associated token account for a given mint and owner
+     * The Rent sysvar
+     */
+    struct Rent {
+      static const size_t SIZE = 17;
+
+      /** Rental rate in lamports per byte-year */
+      uint64_t lamports_per_byte_year;
+      /** Number of years of rent an account must hold to be exempt */
+      double exemption_threshold;
+      /** Percentage of collected rent that is burned */
+      uint8_t burn_percent;
+
+      /**
+       * Decodes the raw account data.
+       *
+       * @return False if the data is too short
+       */
+      bool decode(const uint8_t* data, size_t length) {
+        if (length < SIZE) {
+          return false;
+        }
+        lamports_per_byte_year = endian::read_le<uint64_t>(&data[0]);
+        exemption_threshold = endian::read_le<double>(&data[8]);
+        burn_percent = data[16];
+        return true;
+      }
+
+      /**
+       * Returns the minimum balance for an account to be rent exempt, as getMinimumBalanceForRentExemption.
+       *
+       * @param data_length The length of the account data
+       */
+      uint64_t minimum_balance(size_t data_length) const {
+        return (uint64_t)((double)((ACCOUNT_STORAGE_OVERHEAD + data_length) * lamports_per_byte_year) * exemption_threshold);
+      }
+    };
+
+    /**
+     * The Clock sysvar
+     */
+    struct Clock {
+      static const size_t SIZE = 40;
+
+      /** The current slot */
+      uint64_t slot;
+      /** The unix timestamp of the first slot of the epoch */
+      int64_t epoch_start_timestamp;
+      /** The current epoch */
+      uint64_t epoch;
+      /** The future epoch for which the leader schedule has most recently been calculated */
+      uint64_t leader_schedule_epoch;
+      /** The estimated unix timestamp of the current slot */
+      int64_t unix_timestamp;
+
+      /**
+       * Decodes the raw account data.
+       *
+       * @return False if the data is too short
+       */
+      bool decode(const uint8_t* data, size_t length) {
+        if (length < SIZE) {
+          return false;
+        }
+        slot = endian::read_le<uint64_t>(&data[0]);
+        epoch_start_timestamp = endian::read_le<int64_t>(&data[8]);
+        epoch = endian::read_le<uint64_t>(&data[16]);
+        leader_schedule_epoch = endian::read_le<uint64_t>(&data[24]);
+        unix_timestamp = endian::read_le<int64_t>(&data[32]);
+        return true;
+      }
+    };
+
+    /**
+     * Returns the fee of a transaction, the base fee per signature plus the priority fee of its compute budget.
      *
-     * @param mint                     Token mint account
-     * @param owner                    Owner of the new account
-     * @param allow_owner_off_curve       Allow the owner account to be a PDA (Program Derived Address)
-     * @param program_id                SPL Token program account
-     * @param associated_token_program_id SPL Associated Token program account
+     * @param signatures The number of signatures
+     * @param compute_unit_limit The compute unit limit
+     * @param micro_lamports The compute unit price, in micro-lamports
+     * @param lamports_per_signature The base fee per signature
      */
-    PublicKey get_associated_token_address(
-      const PublicKey& mint,
-      const PublicKey& owner,
-      const bool& allow_owner_off_curve = false,
-      const PublicKey& program_id = TOKEN_PROGRAM_ID,
-      const PublicKey& associated_token_program_id = ASSOCIATED_TOKEN_PROGRAM_ID
-    ) {
-      if (!allow_owner_off_curve && !owner.is_on_curve()) {
-        throw std::runtime_error("Token owner is off curve.");
+    inline uint64_t transaction_fee(uint64_t signatures, uint32_t compute_unit_limit = 0, uint64_t micro_lamports = 0, uint64_t lamports_per_signature = DEFAULT_LAMPORTS_PER_SIGNATURE) {
+      __uint128_t priority = (__uint128_t)compute_unit_limit * micro_lamports;
+      return signatures * lamports_per_signature + (uint64_t)((priority + 999999) / 1000000);
+    }
+
+  } // namespace sysvar
+
+  /**
+   * Keeps the Rent and Clock sysvars up to date with account subscriptions, so that rent-exempt balances and the
+   * cluster time are computed locally.
+   */
+  class SysvarCache {
+    sysvar::Rent _rent{};
+    sysvar::Clock _clock{};
+    bool _has_rent = false;
+    bool _has_clock = false;
+    std::chrono::steady_clock::time_point _clock_updated;
+    std::vector<uint8_t> _data;
+
+    void update(const PublicKey& pubkey, const Account& account) {
+      size_t length = base64::decode(account.data, _data);
+      if (pubkey == SYSVAR_RENT_PUBKEY) {
+        update_rent(_data.data(), length);
+      } else if (pubkey == SYSVAR_CLOCK_PUBKEY) {
+        update_clock(_data.data(), length);
       }
+    }
 
-      std::tuple<PublicKey, uint8_t> pda = PublicKey::find_program_address(
-        {
-          owner.to_buffer(),
-          program_id.to_buffer(),
-          mint.to_buffer()
-        },
-        associated_token_program_id
-      );
+  public:
 
-      return std::get<0>(pda);
+    /**
+     * Applies new Rent sysvar data.
+     *
+     * @return False if the data could not be decoded
+     */
+    bool update_rent(const uint8_t* data, size_t length) {
+      _has_rent |= _rent.decode(data, length);
+      return _has_rent;
     }
 
     /**
-    * Create and initialize a new associated token account
-    *
-    * @param connection Connection to use
-    * @param payer Payer of the transaction and initialization fees
-    * @param mint Mint for the account
-    * @param owner Owner of the new account
-    * @param confirm_options Options for confirming the transaction
-    * @param program_id SPL Token program account
-    * @param associated_token_program_id SPL Associated Token program account
-    */
-    Result<PublicKey> create_associated_token_account(
-      const Connection& connection,
-      const Keypair& payer,
-      const PublicKey& mint,
-      const PublicKey& owner,
-      const ConfirmOptions& confirm_options = {},
-      const PublicKey& program_id = TOKEN_PROGRAM_ID,
-      const PublicKey& associated_token_program_id = ASSOCIATED_TOKEN_PROGRAM_ID
-    ) {
-      const PublicKey associated_token = get_associated_token_address(mint, owner, false, program_id, associated_token_program_id);
-
-      Transaction transaction = create_associated_token_account_transaction(
-        payer.public_key,
-        associated_token,
-        owner,
-        mint,
-        program_id,
-        associated_token_program_id
-      );
+     * Applies new Clock sysvar data.
+     *
+     * @return False if the data could not be decoded
+     */
+    bool update_clock(const uint8_t* data, size_t length) {
+      if (!_clock.decode(data, length)) {
+        return false;
+      }
+      _has_clock = true;
+      _clock_updated = std::chrono::steady_clock::now();
+      return true;
+    }
 
-      std::string txid = connection.sign_and_send_transaction(transaction, {payer}).unwrap();
+    /**
+     * Returns true once both sysvars were loaded.
+     */
+    bool ready() const {
+      return _has_rent && _has_clock;
+    }
 
-      return Result<PublicKey>(associated_token);;
+    const sysvar::Rent& rent() const {
+      return _rent;
     }
 
-  }
+    const sysvar::Clock& clock() const {
+      return _clock;
+    }
 
-}
+    /**
+     * Returns the minimum balance for an account to be rent exempt.
+     *
+     * @param data_length The length of the account data
+     */
+    uint64_t minimum_balance_for_rent_exemption(size_t data_length) const {
+      ASSERT(_has_rent);
+      return _rent.minimum_balance(data_length);
+    }
+
+    /**
+     * Returns the current epoch.
+     */
+    uint64_t epoch() const {
+      ASSERT(_has_clock);
+      return _clock.epoch;
+    }
+
+    /**
+     * Returns the current unix timestamp of the cluster, the last Clock timestamp plus the time elapsed since.
+     */
+    int64_t unix_timestamp() const {
+      ASSERT(_has_clock);
+      auto elapsed = std::chrono::steady_clock::now() - _clock_updated;
+      return _clock.unix_timestamp + std::chrono::duration_cast<std::chrono::seconds>(elapsed).count();
+    }
+
+    /**
+     * Loads both sysvars with a single request.
+     *
+     * @param connection The connection to query
+     */
+    void load(Connection& connection) {
+      auto accounts = connection.get_multiple_accounts({SYSVAR_RENT_PUBKEY, SYSVAR_CLOCK_PUBKEY}).unwrap();
+      ASSERT(accounts.size() == 2);
+      update(SYSVAR_RENT_PUBKEY, accounts[0]);
+      update(SYSVAR_CLOCK_PUBKEY, accounts[1]);
+    }
+
+    /**
+     * Loads both sysvars and keeps them up to date with account change subscriptions.
+     *
+     * @param connection The connection to query and subscribe with, which must outlive the subscriptions
+     *
+     * @return The subscription IDs
+     */
+    std::vector<int> subscribe(Connection& connection) {
+      load(connection);
+      std::vector<int> subscriptions;
+      for (auto& pubkey : {SYSVAR_RENT_PUBKEY, SYSVAR_CLOCK_PUBKEY}) {
+        subscriptions.push_back(connection.on_account_change(pubkey, [this, pubkey](Result<Account> result) {
+          if (result.ok()) {
+            update(pubkey, result._result.value());
+          }
+        }));
+      }
+      return subscriptions;
+    }
+  };
+
+  /**
+   * Account versions per slot, layered by commitment and aware of forks.
+   *
+   * Every update is recorded with the slot it was observed in, and slot notifications link the slots to their parents.
+   * A read at a commitment level returns the newest version on the chain of that level's slot: the latest notified
+   * slot for processed, the confirmed slot, or the root for finalized. When the root advances, versions on forks that
+   * do not descend from it are dropped and the rollback listeners are notified, and older rooted versions are
+   * collapsed into one. A single processed subscription per account serves all three levels. Like AccountCache, the
+   * account data is allocated from a memory resource.
+   */
+  class ForkAwareAccountStore {
+  public:
+
+    typedef std::function<void(const PublicKey&, const AccountCache::Entry& orphaned)> RollbackListener;
+
+  private:
+
+    std::pmr::memory_resource* _resource;
+    std::map<uint64_t, uint64_t> _parents;
+    std::map<PublicKey, std::vector<AccountCache::Entry>> _accounts;
+    std::vector<RollbackListener> _rollback_listeners;
+    uint64_t _head = 0;
+    uint64_t _confirmed = 0;
+    uint64_t _root = 0;
+
+    /**
+     * Returns true if `ancestor` is `slot` or one of its ancestors. Slots without a known parent are assumed to be on
+     * the chain, since account notifications can arrive before the slot notification.
+     */
+    bool is_ancestor(uint64_t ancestor, uint64_t slot) const {
+      while (slot > ancestor) {
+        if (slot == _root) {
+          // Versions at or below the root are pruned to the rooted chain
+          return true;
+        }
+        auto it = _parents.find(slot);
+        if (it == _parents.end()) {
+          return true;
+        }
+        slot = it->second;
+      }
+      return slot == ancestor;
+    }
+
+    void set_root(uint64_t root) {
+      for (auto& account : _accounts) {
+        auto& versions = account.second;
+        std::vector<AccountCache::Entry> kept;
+        kept.reserve(versions.size());
+        for (auto& version : versions) {
+          bool rooted = version.slot <= root && is_ancestor(version.slot, root);
+          bool pending = version.slot > root && is_ancestor(root, version.slot);
+          if (rooted && !kept.empty() && kept.back().slot <= root) {
+            // Only the newest rooted version is needed
+            kept.back() = std::move(version);
+          } else if (rooted || pending) {
+            kept.push_back(std::move(version));
+          } else {
+            for (auto& listener : _rollback_listeners) {
+              listener(account.first, version);
+            }
+          }
+        }
+        versions = std::move(kept);
+      }
+      _root = root;
+      _parents.erase(_parents.begin(), _parents.lower_bound(root));
+    }
+
+  public:
+
+    /**
+     * @param resource The memory resource the account data is allocated from, which must outlive the store
+     */
+    explicit ForkAwareAccountStore(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : _resource(resource)
+    {}
+
+    /**
+     * Records a new version of an account.
+     *
+     * @param pubkey The account's Pubkey
+     * @param account The account, with base64 encoded data
+     * @param slot The slot the version was observed in
+     */
+    void update(const PublicKey& pubkey, const Account& account, uint64_t slot) {
+      AccountCache::Entry entry{account.lamports, account.owner, slot, std::pmr::vector<uint8_t>(_resource)};
+      base64::decode(account.data, entry.data);
+      update(pubkey, std::move(entry));
+    }
+
+    /**
+     * Records a new version of an account, replacing the one of the same slot. Data allocated from another memory
+     * resource is copied into the store's.
+     *
+     * @param pubkey The account's Pubkey
+     * @param entry The version, with its slot
+     */
+    void update(const PublicKey& pubkey, AccountCache::Entry entry) {
+      if (entry.slot < _root) {
+        return;
+      }
+      if (entry.data.get_allocator().resource() != _resource) {
+        entry.data = std::pmr::vector<uint8_t>(entry.data, _resource);
+      }
+      auto& versions = _accounts[pubkey];
+      auto it = std::lower_bound(versions.begin(), versions.end(), entry.slot, [](const AccountCache::Entry& version, uint64_t slot) {
+        return version.slot < slot;
+      });
+      if (it != versions.end() && it->slot == entry.slot) {
+        *it = std::move(entry);
+      } else {
+        versions.insert(it, std::move(entry));
+      }
+    }
+
+    /**
+     * Applies a slot notification, linking the slot to its parent and advancing the root.
+     *
+     * @param slot_info The slot notification
+     */
+    void update_slot(const SlotInfo& slot_info) {
+      if (slot_info.slot > _root) {
+        _parents[slot_info.slot] = slot_info.parent;
+        _head = slot_info.slot;
+      }
+      if (slot_info.root > _root) {
+        set_root(slot_info.root);
+      }
+    }
+
+    /**
+     * Advances the confirmed slot.
+     *
+     * @param slot The latest confirmed slot
+     */
+    void confirm(uint64_t slot) {
+      _confirmed = std::max(_confirmed, slot);
+    }
+
+    /**
+     * Returns the slot a commitment level reads at.
+     *
+     * @param commitment The commitment level
+     */
+    uint64_t slot(Commitment commitment) const {
+      switch (commitment) {
+        case Commitment::Processed:
+          return _head;
+        case Commitment::Confirmed:
+          return std::max(_confirmed, _root);
+        default:
+          return _root;
+      }
+    }
+
+    /**
+     * Returns the newest version of an account at a commitment level, or nullptr if there is none. The pointer is
+     * valid until the next update.
+     *
+     * @param pubkey The account's Pubkey
+     * @param commitment The commitment level
+     */
+    const AccountCache::Entry* get(const PublicKey& pubkey, Commitment commitment) const {
+      auto it = _accounts.find(pubkey);
+      if (it == _accounts.end()) {
+        return nullptr;
+      }
+      uint64_t at = slot(commitment);
+      const auto& versions = it->second;
+      for (auto version = versions.rbegin(); version != versions.rend(); ++version) {
+        bool unseen = commitment == Commitment::Processed && version->slot > _head && _parents.count(version->slot) == 0;
+        if (unseen || (version->slot <= at && is_ancestor(version->slot, at))) {
+          return &*version;
+        }
+      }
+      return nullptr;
+    }
+
+    /**
+     * Returns the number of versions kept for an account.
+     *
+     * @param pubkey The account's Pubkey
+     */
+    size_t versions(const PublicKey& pubkey) const {
+      auto it = _accounts.find(pubkey);
+      return it == _accounts.end() ? 0 : it->second.size();
+    }
+
+    /**
+     * Adds a listener that is called for every version dropped because its fork was abandoned.
+     *
+     * @param listener The callback function
+     */
+    void on_rollback(RollbackListener listener) {
+      _rollback_listeners.push_back(listener);
+    }
+
+    /**
+     * Follows the slot tree with a slot change subscription.
+     *
+     * @param connection The connection to subscribe with, which must outlive the subscription
+     *
+     * @return The subscription ID
+     */
+    int subscribe_slots(Connection& connection) {
+      return connection.on_slot_change([this](Result<SlotInfo> result) {
+        if (result.ok()) {
+          update_slot(result._result.value());
+        }
+      });
+    }
+
+    /**
+     * Records the versions of an account from an account change subscription. The connection must use the processed
+     * commitment level so that every level can be served.
+     *
+     * @param connection The connection to subscribe with, which must outlive the subscription
+     * @param pubkey The account to follow
+     *
+     * @return The subscription ID
+     */
+    int subscribe(Connection& connection, const PublicKey& pubkey) {
+      return connection.on_account_change(pubkey, [this, pubkey](Result<Account> result) {
+        if (result.ok() && result._context) {
+          update(pubkey, result._result.value(), result._context->slot);
+        }
+      });
+    }
+
+    /**
+     * Fetches the confirmed slot.
+     *
+     * @param connection The connection to query
+     */
+    void poll_confirmed(Connection& connection) {
+      auto slot = connection.get_slot(Commitment::Confirmed);
+      if (slot.ok()) {
+        confirm(slot._result.value());
+      }
+    }
+  };
+
+  enum class SignatureState {
+    Pending,
+    Processed,
+    Confirmed,
+    Finalized,
+    Failed,
+    Expired,
+  };
+
+  /**
+   * Follows many in-flight transaction signatures until they reach a commitment level, fail, or expire.
+   *
+   * Statuses are polled in batches of getSignatureStatuses. The interval drops to the minimum after a round that
+   * changed something and doubles after every quiet round. Signatures can also be resolved by signatureSubscribe.
+   * A signature expires once the block height passes its last valid block height without the transaction landing.
+   */
+  class SignatureTracker {
+  public:
+
+    /** Maximum number of signatures per getSignatureStatuses request */
+    static const size_t MAX_SIGNATURE_STATUSES = 256;
+
+    struct Update {
+      std::string signature;
+      SignatureState state;
+      /** The slot the transaction landed in, 0 if it did not land */
+      uint64_t slot;
+      /** Error if the transaction failed, as JSON */
+      std::string err;
+      /** Time from track to this update */
+      std::chrono::nanoseconds since_sent;
+      /** Time from the first notification of the landing slot to this update, zero if the slot was not seen */
+      std::chrono::nanoseconds since_landed;
+    };
+
+    typedef std::function<void(const Update&)> Callback;
+
+  private:
+
+    struct Tracked {
+      uint64_t last_valid_block_height;
+      Commitment commitment;
+      SignatureState target;
+      SignatureState state;
+      uint64_t slot;
+      std::chrono::steady_clock::time_point sent_at;
+      Callback callback;
+      std::promise<Update> promise;
+    };
+
+    static const size_t MAX_SLOT_TIMES = 1024;
+
+    std::map<std::string, Tracked> _tracked;
+    std::map<uint64_t, std::chrono::steady_clock::time_point> _slot_times;
+    std::chrono::milliseconds _min_interval;
+    std::chrono::milliseconds _max_interval;
+    std::chrono::milliseconds _interval;
+    std::chrono::steady_clock::time_point _next_poll;
+
+    static SignatureState state_of(Commitment commitment) {
+      switch (commitment) {
+        case Commitment::Processed:
+          return SignatureState::Processed;
+        case Commitment::Confirmed:
+          return SignatureState::Confirmed;
+        default:
+          return SignatureState::Finalized;
+      }
+    }
+
+    /**
+     * Moves a signature to a new state, notifies its callback and resolves it if the state is final.
+     *
+     * @return True if the state changed
+     */
+    bool advance(std::map<std::string, Tracked>::iterator it, SignatureState state, uint64_t slot, const std::string& err) {
+      Tracked& tracked = it->second;
+      if (state <= tracked.state && state != SignatureState::Failed) {
+        return false;
+      }
+      tracked.state = state;
+      if (slot != 0) {
+        tracked.slot = slot;
+      }
+
+      auto now = std::chrono::steady_clock::now();
+      Update update{it->first, state, tracked.slot, err, now - tracked.sent_at, std::chrono::nanoseconds::zero()};
+      auto slot_time = _slot_times.find(tracked.slot);
+      if (slot_time != _slot_times.end()) {
+        update.since_landed = now - slot_time->second;
+      }
+
+      if (tracked.callback) {
+        tracked.callback(update);
+      }
+      if (state >= tracked.target) {
+        tracked.promise.set_value(update);
+        _tracked.erase(it);
+      }
+      return true;
+    }
+
+  public:
+
+    /**
+     * @param min_interval The polling interval while statuses are changing
+     * @param max_interval The polling interval after a long run of rounds without changes
+     */
+    SignatureTracker(std::chrono::milliseconds min_interval = std::chrono::milliseconds(200), std::chrono::milliseconds max_interval = std::chrono::milliseconds(2000))
+      : _min_interval(min_interval),
+      _max_interval(max_interval),
+      _interval(min_interval)
+    {
+    }
+
+    /**
+     * Starts tracking a signature.
+     *
+     * @param signature The transaction signature
+     * @param last_valid_block_height The last valid block height of the transaction's blockhash
+     * @param commitment The commitment level at which the signature is resolved
+     * @param callback Optional callback function called on every state change
+     *
+     * @return A future resolved with the final update
+     */
+    std::future<Update> track(const std::string& signature, uint64_t last_valid_block_height, Commitment commitment = Commitment::Confirmed, Callback callback = nullptr) {
+      Tracked& tracked = _tracked[signature];
+      tracked.last_valid_block_height = last_valid_block_height;
+      tracked.commitment = commitment;
+      tracked.target = state_of(commitment);
+      tracked.state = SignatureState::Pending;
+      tracked.slot = 0;
+      tracked.sent_at = std::chrono::steady_clock::now();
+      tracked.callback = callback;
+      tracked.promise = std::promise<Update>();
+      _interval = _min_interval;
+      return tracked.promise.get_future();
+    }
+
+    /**
+     * Returns the current state of a tracked signature, or nothing if it is not tracked anymore.
+     *
+     * @param signature The transaction signature
+     */
+    std::optional<SignatureState> state(const std::string& signature) const {
+      auto it = _tracked.find(signature);
+      if (it == _tracked.end()) {
+        return std::nullopt;
+      }
+      return it->second.state;
+    }
+
+    /**
+     * Returns the number of signatures that are not resolved yet.
+     */
+    size_t pending() const {
+      return _tracked.size();
+    }
+
+    /**
+     * Returns the interval until the next polling round.
+     */
+    std::chrono::milliseconds interval() const {
+      return _interval;
+    }
+
+    /**
+     * Records when a slot was first seen, to measure the time from landing to notification.
+     *
+     * @param slot The slot
+     */
+    void note_slot(uint64_t slot) {
+      _slot_times.emplace(slot, std::chrono::steady_clock::now());
+      while (_slot_times.size() > MAX_SLOT_TIMES) {
+        _slot_times.erase(_slot_times.begin());
+      }
+    }
+
+    /**
+     * Applies the result of a getSignatureStatuses request.
+     *
+     * @param signatures The signatures of the request
+     * @param statuses The statuses, in the same order
+     *
+     * @return True if any signature changed state
+     */
+    bool update(const std::vector<std::string>& signatures, const std::vector<SignatureStatus>& statuses) {
+      ASSERT(signatures.size() == statuses.size());
+      bool changed = false;
+      for (size_t i = 0; i < signatures.size(); i++) {
+        const SignatureStatus& status = statuses[i];
+        auto it = _tracked.find(signatures[i]);
+        if (!status.found || it == _tracked.end()) {
+          continue;
+        }
+        SignatureState state = status.err.empty() ? state_of(status.confirmation_status) : SignatureState::Failed;
+        changed |= advance(it, state, status.slot, status.err);
+      }
+      return changed;
+    }
+
+    /**
+     * Expires the signatures that were not confirmed before the block height passed their last valid block height.
+     *
+     * This includes signatures that were only processed, since the fork they were processed on was dropped if the
+     * finalized block height passed their last valid block height without them being confirmed.
+     *
+     * @param block_height The current block height
+     *
+     * @return True if any signature expired
+     */
+    bool update_block_height(uint64_t block_height) {
+      bool changed = false;
+      for (auto it = _tracked.begin(); it != _tracked.end();) {
+        auto next = std::next(it);
+        if (it->second.state < SignatureState::Confirmed && block_height > it->second.last_valid_block_height) {
+          changed |= advance(it, SignatureState::Expired, 0, "");
+        }
+        it = next;
+      }
+      return changed;
+    }
+
+    /**
+     * Runs a polling round if it is due. The block height is read before the statuses, so a signature that is still
+     * unknown after the block height passed its last valid block height can not land anymore.
+     *
+     * @param connection The connection to query
+     *
+     * @return True if a round was run
+     */
+    bool poll(Connection& connection) {
+      auto now = std::chrono::steady_clock::now();
+      if (_tracked.empty() || now < _next_poll) {
+        return false;
+      }
+
+      Result<uint64_t> block_height = connection.get_block_height(Commitment::Finalized);
+
+      std::vector<std::string> signatures;
+      signatures.reserve(_tracked.size());
+      std::vector<std::string> batch;
+      for (auto& tracked : _tracked) {
+        signatures.push_back(tracked.first);
+      }
+
+      bool changed = false;
+      for (size_t start = 0; start < signatures.size(); start += MAX_SIGNATURE_STATUSES) {
+        size_t end = std::min(start + MAX_SIGNATURE_STATUSES, signatures.size());
+        batch.assign(signatures.begin() + start, signatures.begin() + end);
+        Result<std::vector<SignatureStatus>> statuses = connection.get_signature_statuses(batch);
+        if (statuses.ok() && statuses._result->size() == batch.size()) {
+          changed |= update(batch, statuses._result.value());
+        }
+      }
+      if (block_height.ok()) {
+        changed |= update_block_height(block_height._result.value());
+      }
+
+      _interval = changed ? _min_interval : std::min(_interval * 2, _max_interval);
+      _next_poll = now + _interval;
+      return true;
+    }
+
+    /**
+     * Resolves a tracked signature with signatureSubscribe instead of waiting for the next polling round.
+     *
+     * @param connection The connection to subscribe with, which must outlive the subscription
+     * @param signature A tracked signature
+     *
+     * @return The subscription ID
+     */
+    int subscribe(Connection& connection, const std::string& signature) {
+      auto it = _tracked.find(signature);
+      ASSERT(it != _tracked.end());
+      SignatureState target = it->second.target;
+      return connection.on_signature(signature, it->second.commitment, [this, signature, target](Result<SignatureStatus> result) {
+        auto it = _tracked.find(signature);
+        if (!result.ok() || it == _tracked.end()) {
+          return;
+        }
+        uint64_t slot = result._context ? result._context->slot : 0;
+        const std::string& err = result._result->err;
+        advance(it, err.empty() ? target : SignatureState::Failed, slot, err);
+      });
+    }
+
+    /**
+     * Records the first time every slot is seen with a slot change subscription.
+     *
+     * @param connection The connection to subscribe with, which must outlive the subscription
+     *
+     * @return The subscription ID
+     */
+    int track_slots(Connection& connection) {
+      return connection.on_slot_change([this](Result<SlotInfo> result) {
+        if (result.ok()) {
+          note_slot(result._result->slot);
+        }
+      });
+    }
+  };
+
+  /**
+   * Submits the same signed transaction to several RPC endpoints at once and rebroadcasts it on a fixed cadence until
+   * the signature tracker reports it confirmed, failed or expired. A transaction that is only processed is still
+   * rebroadcast, since its fork can be dropped, unless it was sent with the processed commitment.
+   *
+   * Every send uses skipPreflight and maxRetries 0, so the nodes forward the transaction once and retrying is left to
+   * the sender. The sends run on the thread pool; poll() only schedules them. An endpoint is credited with a landed
+   * transaction when it was the first one to acknowledge it.
+   *
+   * The sender may be destroyed before its transactions resolve, on the thread that updates the tracker. The tracker
+   * then still resolves their futures and calls their callbacks, without rebroadcasting them.
+   */
+  class TransactionSender {
+  public:
+
+    typedef std::function<Result<std::string>(size_t endpoint, const std::string& signed_transaction)> SendFunction;
+
+    struct EndpointStats {
+      std::string endpoint;
+      /** Number of sends, including rebroadcasts */
+      uint64_t sends;
+      /** Number of sends that failed or were rejected */
+      uint64_t errors;
+      /** Number of transactions this endpoint acknowledged before any other endpoint */
+      uint64_t first_acks;
+      /** Number of landed transactions this endpoint acknowledged first */
+      uint64_t landed_via;
+      /** Number of transactions acknowledged by this endpoint */
+      uint64_t acked;
+      /** Sum over the acknowledged transactions of the time from the first broadcast to the first acknowledgement */
+      std::chrono::nanoseconds first_ack_latency;
+
+      /**
+       * Returns the mean time from the first broadcast to this endpoint's first acknowledgement.
+       */
+      std::chrono::nanoseconds mean_first_ack_latency() const {
+        return acked == 0 ? std::chrono::nanoseconds::zero() : first_ack_latency / (int64_t)acked;
+      }
+    };
+
+  private:
+
+    struct Submission {
+      std::string signed_transaction;
+      std::chrono::steady_clock::time_point first_sent;
+      std::chrono::steady_clock::time_point next_send;
+      uint32_t broadcasts = 0;
+      Commitment commitment;
+      /** Guarded by the sender's mutex */
+      std::vector<bool> acked;
+      int first_ack = -1;
+    };
+
+    std::vector<std::string> _endpoints;
+    SendFunction _send;
+    SignatureTracker& _tracker;
+    threading::ThreadPool& _pool;
+    std::chrono::milliseconds _cadence;
+    std::map<std::string, std::shared_ptr<Submission>> _submissions;
+
+    std::mutex _mutex;
+    std::condition_variable _idle;
+    size_t _in_flight = 0;
+    std::vector<EndpointStats> _stats;
+    /**
+     * Held by the sender only, the tracker's callbacks hold weak pointers to it, so they stop resolving submissions once
+     * the sender is destroyed while the tracker still follows its signatures
+     */
+    std::shared_ptr<TransactionSender*> _self;
+
+    void broadcast(const std::shared_ptr<Submission>& submission, std::chrono::steady_clock::time_point now) {
+      submission->broadcasts++;
+      submission->next_send = now + _cadence;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _in_flight += _endpoints.size();
+      }
+      for (size_t i = 0; i < _endpoints.size(); i++) {
+        _pool.submit([this, submission, i]() {
+          bool ok = false;
+          try {
+            ok = _send(i, submission->signed_transaction).ok();
+          } catch (const std::exception&) {
+          }
+          auto now = std::chrono::steady_clock::now();
+
+          std::lock_guard<std::mutex> lock(_mutex);
+          EndpointStats& stats = _stats[i];
+          stats.sends++;
+          if (!ok) {
+            stats.errors++;
+          } else if (!submission->acked[i]) {
+            submission->acked[i] = true;
+            stats.acked++;
+            stats.first_ack_latency += now - submission->first_sent;
+            if (submission->first_ack < 0) {
+              submission->first_ack = (int)i;
+              stats.first_acks++;
+            }
+          }
+          if (--_in_flight == 0) {
+            _idle.notify_all();
+          }
+        });
+      }
+    }
+
+    void resolve(const SignatureTracker::Update& update) {
+      auto it = _submissions.find(update.signature);
+      if (it == _submissions.end()) {
+        return;
+      }
+      // A processed transaction can still be dropped with its fork, so it is rebroadcast until it is confirmed
+      if (update.state == SignatureState::Processed && it->second->commitment != Commitment::Processed) {
+        return;
+      }
+      if (update.state != SignatureState::Failed && update.state != SignatureState::Expired) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (it->second->first_ack >= 0) {
+          _stats[it->second->first_ack].landed_via++;
+        }
+      }
+      _submissions.erase(it);
+    }
+
+  public:
+
+    /**
+     * @param endpoints The names of the endpoints, for the statistics
+     * @param send The function submitting a base64 encoded transaction to an endpoint, called on the thread pool
+     * @param tracker The tracker that reports when the transactions land
+     * @param pool The thread pool running the sends
+     * @param cadence The interval between rebroadcasts
+     */
+    TransactionSender(const std::vector<std::string>& endpoints, SendFunction send, SignatureTracker& tracker, threading::ThreadPool& pool, std::chrono::milliseconds cadence = std::chrono::milliseconds(500))
+      : _endpoints(endpoints),
+      _send(send),
+      _tracker(tracker),
+      _pool(pool),
+      _cadence(cadence),
+      _stats(endpoints.size()),
+      _self(std::make_shared<TransactionSender*>(this))
+    {
+      for (size_t i = 0; i < endpoints.size(); i++) {
+        _stats[i].endpoint = endpoints[i];
+      }
+    }
+
+    /**
+     * @param connections The connections to send with, which must outlive the sender
+     * @param tracker The tracker that reports when the transactions land
+     * @param pool The thread pool running the sends
+     * @param cadence The interval between rebroadcasts
+     */
+    TransactionSender(const std::vector<Connection*>& connections, SignatureTracker& tracker, threading::ThreadPool& pool, std::chrono::milliseconds cadence = std::chrono::milliseconds(500))
+      : TransactionSender(endpoints_of(connections), [connections](size_t endpoint, const std::string& signed_transaction) {
+          return connections[endpoint]->send_transaction(signed_transaction, true, 0);
+        }, tracker, pool, cadence)
+    {
+    }
+
+    ~TransactionSender() {
+      _self.reset();
+      wait();
+    }
+
+    TransactionSender(const TransactionSender&) = delete;
+    TransactionSender& operator=(const TransactionSender&) = delete;
+
+    static std::vector<std::string> endpoints_of(const std::vector<Connection*>& connections) {
+      std::vector<std::string> endpoints;
+      for (auto connection : connections) {
+        endpoints.push_back(connection->endpoint());
+      }
+      return endpoints;
+    }
+
+    /**
+     * Returns the base58 signature of a serialized transaction, its first signature.
+     *
+     * @param signed_transaction The serialized signed transaction
+     */
+    static std::string signature_of(const std::vector<uint8_t>& signed_transaction) {
+      ASSERT(signed_transaction.size() > 64 && signed_transaction[0] > 0 && signed_transaction[0] < 0x80);
+      return base58::encode(std::string((const char*)&signed_transaction[1], 64));
+    }
+
+    /**
+     * Broadcasts a signed transaction to every endpoint and starts tracking it.
+     *
+     * @param signed_transaction The serialized signed transaction
+     * @param last_valid_block_height The last valid block height of the transaction's blockhash
+     * @param commitment The commitment level at which the transaction is resolved
+     * @param callback Optional callback function called on every state change
+     *
+     * @return A future resolved with the final update of the tracker
+     */
+    std::future<SignatureTracker::Update> send(const std::vector<uint8_t>& signed_transaction, uint64_t last_valid_block_height, Commitment commitment = Commitment::Confirmed, SignatureTracker::Callback callback = nullptr) {
+      std::string signature = signature_of(signed_transaction);
+      auto now = std::chrono::steady_clock::now();
+
+      auto submission = std::make_shared<Submission>();
+      submission->signed_transaction = base64::encode(signed_transaction);
+      submission->first_sent = now;
+      submission->commitment = commitment;
+      submission->acked.resize(_endpoints.size());
+      _submissions[signature] = submission;
+
+      std::weak_ptr<TransactionSender*> self = _self;
+      auto future = _tracker.track(signature, last_valid_block_height, commitment, [self, callback](const SignatureTracker::Update& update) {
+        if (auto sender = self.lock()) {
+          (*sender)->resolve(update);
+        }
+        if (callback) {
+          callback(update);
+        }
+      });
+      broadcast(submission, now);
+      return future;
+    }
+
+    /**
+     * Rebroadcasts the transactions that are due.
+     *
+     * @return The number of transactions rebroadcast
+     */
+    size_t poll() {
+      auto now = std::chrono::steady_clock::now();
+      size_t count = 0;
+      for (auto& submission : _submissions) {
+        if (now >= submission.second->next_send) {
+          broadcast(submission.second, now);
+          count++;
+        }
+      }
+      return count;
+    }
+
+    /**
+     * Blocks until every scheduled send has completed.
+     */
+    void wait() {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _idle.wait(lock, [this]() { return _in_flight == 0; });
+    }
+
+    /**
+     * Returns the number of transactions still being broadcast.
+     */
+    size_t pending() const {
+      return _submissions.size();
+    }
+
+    /**
+     * Returns the number of times a transaction was broadcast, or 0 if it is not being broadcast anymore.
+     *
+     * @param signature The transaction signature
+     */
+    uint32_t broadcasts(const std::string& signature) const {
+      auto it = _submissions.find(signature);
+      return it == _submissions.end() ? 0 : it->second->broadcasts;
+    }
+
+    /**
+     * Returns a snapshot of the statistics of every endpoint.
+     */
+    std::vector<EndpointStats> stats() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _stats;
+    }
+  };
+
+  /**
+   * The leader schedule of an epoch, stored as one leader index per slot.
+   */
+  class LeaderScheduleCache {
+    uint64_t _epoch_start = 0;
+    std::vector<uint32_t> _slot_leaders;
+    std::vector<PublicKey> _leaders;
+
+  public:
+
+    /**
+     * Replaces the cached leader schedule.
+     *
+     * @param epoch_start The first slot of the epoch
+     * @param schedule The base58 identity of every leader mapped to its slot indices relative to epoch_start
+     */
+    void set(uint64_t epoch_start, const std::map<std::string, std::vector<uint64_t>>& schedule) {
+      _epoch_start = epoch_start;
+      _slot_leaders.clear();
+      _leaders.clear();
+      for (auto& entry : schedule) {
+        uint32_t index = (uint32_t)_leaders.size();
+        _leaders.push_back(PublicKey(entry.first));
+        for (uint64_t slot_index : entry.second) {
+          if (slot_index >= _slot_leaders.size()) {
+            _slot_leaders.resize(slot_index + 1, UINT32_MAX);
+          }
+          _slot_leaders[slot_index] = index;
+        }
+      }
+    }
+
+    /**
+     * Loads the leader schedule of the current epoch.
+     *
+     * @param connection The connection to query
+     *
+     * @return The current slot
+     */
+    uint64_t load(Connection& connection) {
+      EpochInfo epoch_info = connection.get_epoch_info().unwrap();
+      set(epoch_info.absolute_slot - epoch_info.slot_index, connection.get_leader_schedule().unwrap());
+      return epoch_info.absolute_slot;
+    }
+
+    /**
+     * Returns true if the slot is within the cached schedule.
+     *
+     * @param slot The slot
+     */
+    bool contains(uint64_t slot) const {
+      return slot >= _epoch_start && slot - _epoch_start < _slot_leaders.size();
+    }
+
+    /**
+     * Returns the first slot of the cached schedule.
+     */
+    uint64_t start() const {
+      return _epoch_start;
+    }
+
+    /**
+     * Returns the first slot after the cached schedule.
+     */
+    uint64_t end() const {
+      return _epoch_start + _slot_leaders.size();
+    }
+
+    /**
+     * Returns the leader of a slot, or nothing if the slot is outside the cached schedule.
+     *
+     * @param slot The slot
+     */
+    std::optional<PublicKey> leader(uint64_t slot) const {
+      if (!contains(slot)) {
+        return std::nullopt;
+      }
+      uint32_t index = _slot_leaders[slot - _epoch_start];
+      if (index == UINT32_MAX) {
+        return std::nullopt;
+      }
+      return _leaders[index];
+    }
+  };
+
+  /**
+   * Sends transactions straight to the TPU ports of the current and next few leaders over UDP.
+   *
+   * The leader schedule of the epoch is cached as one leader per slot, the leaders are mapped to the TPU addresses of
+   * their cluster nodes, and the current slot follows the slot change notifications. Every send is recorded in a
+   * bounded log, along with per-leader totals.
+   */
+  class TpuSender {
+  public:
+
+    struct SendRecord {
+      /** The first upcoming slot of the leader */
+      uint64_t slot;
+      PublicKey leader;
+      /** The TPU address of the leader, empty if it is not known */
+      std::string tpu;
+      /** The length of the transaction */
+      size_t length;
+      /** False if the leader has no known TPU address or the datagram could not be sent */
+      bool ok;
+    };
+
+    struct LeaderStats {
+      uint64_t sends;
+      uint64_t bytes;
+      uint64_t failures;
+    };
+
+  private:
+
+    struct Tpu {
+      std::string address;
+      sockaddr_in sockaddr;
+    };
+
+    udp::UdpSocket _socket;
+    size_t _fanout;
+    size_t _max_log;
+    LeaderScheduleCache _schedule;
+    std::map<PublicKey, Tpu> _tpus;
+    uint64_t _slot = 0;
+    std::deque<SendRecord> _log;
+    std::map<PublicKey, LeaderStats> _stats;
+
+  public:
+
+    /**
+     * @param fanout The number of distinct leaders to send to, starting with the current one
+     * @param max_log The number of send records to keep
+     */
+    TpuSender(size_t fanout = 3, size_t max_log = 1024)
+      : _fanout(fanout),
+      _max_log(max_log)
+    {
+    }
+
+    /**
+     * Replaces the cached leader schedule.
+     *
+     * @param epoch_start The first slot of the epoch
+     * @param schedule The base58 identity of every leader mapped to its slot indices relative to epoch_start
+     */
+    void set_schedule(uint64_t epoch_start, const std::map<std::string, std::vector<uint64_t>>& schedule) {
+      _schedule.set(epoch_start, schedule);
+    }
+
+    /**
+     * Returns the cached leader schedule.
+     */
+    const LeaderScheduleCache& schedule() const {
+      return _schedule;
+    }
+
+    /**
+     * Maps the leaders to the TPU addresses of the cluster nodes.
+     *
+     * @param nodes The cluster nodes
+     */
+    void set_cluster_nodes(const std::vector<ClusterNode>& nodes) {
+      for (auto& node : nodes) {
+        if (!node.tpu.empty()) {
+          set_tpu(node.pubkey, node.tpu);
+        }
+      }
+    }
+
+    /**
+     * Sets the TPU address of a leader.
+     *
+     * @param leader The leader's identity
+     * @param address The "ip:port" TPU address
+     *
+     * @return False if the address is not a valid IPv4 address
+     */
+    bool set_tpu(const PublicKey& leader, const std::string& address) {
+      Tpu tpu{address, {}};
+      if (!udp::parse_address(address, tpu.sockaddr)) {
+        return false;
+      }
+      _tpus[leader] = tpu;
+      return true;
+    }
+
+    /**
+     * Advances the current slot. Older slots are ignored.
+     *
+     * @param slot The slot
+     */
+    void set_slot(uint64_t slot) {
+      _slot = std::max(_slot, slot);
+    }
+
+    /**
+     * Returns the current slot.
+     */
+    uint64_t slot() const {
+      return _slot;
+    }
+
+    /**
+     * Returns the leader of a slot, or nothing if the slot is outside the cached schedule.
+     *
+     * @param slot The slot
+     */
+    std::optional<PublicKey> leader(uint64_t slot) const {
+      return _schedule.leader(slot);
+    }
+
+    /**
+     * Returns the distinct leaders from the current slot on, with their first upcoming slot.
+     *
+     * @param count The maximum number of leaders
+     */
+    std::vector<std::pair<uint64_t, PublicKey>> upcoming_leaders(size_t count) const {
+      std::vector<std::pair<uint64_t, PublicKey>> leaders;
+      for (uint64_t slot = std::max(_slot, _schedule.start()); slot < _schedule.end() && leaders.size() < count; slot++) {
+        auto leader = _schedule.leader(slot);
+        if (!leader) {
+          continue;
+        }
+        bool seen = false;
+        for (auto& upcoming : leaders) {
+          seen |= upcoming.second == *leader;
+        }
+        if (!seen) {
+          leaders.push_back({slot, *leader});
+        }
+      }
+      return leaders;
+    }
+
+    /**
+     * Returns true if the current slot is past the cached schedule.
+     */
+    bool needs_schedule() const {
+      return !_schedule.contains(_slot);
+    }
+
+    /**
+     * Loads the current slot, the leader schedule of the current epoch and the TPU addresses of the cluster nodes.
+     *
+     * @param connection The connection to query
+     */
+    void load(Connection& connection) {
+      uint64_t slot = _schedule.load(connection);
+      set_cluster_nodes(connection.get_cluster_nodes().unwrap());
+      set_slot(slot);
+    }
+
+    /**
+     * Follows the current slot with a slot change subscription.
+     *
+     * @param connection The connection to subscribe with, which must outlive the subscription
+     *
+     * @return The subscription ID
+     */
+    int subscribe(Connection& connection) {
+      return connection.on_slot_change([this](Result<SlotInfo> result) {
+        if (result.ok()) {
+          set_slot(result._result->slot);
+        }
+      });
+    }
+
+    /**
+     * Reloads the leader schedule once the current slot is past the cached one.
+     *
+     * @param connection The connection to query
+     *
+     * @return True if the schedule was reloaded
+     */
+    bool poll(Connection& connection) {
+      if (!needs_schedule()) {
+        return false;
+      }
+      load(connection);
+      return true;
+    }
+
+    /**
+     * Sends a signed transaction to the TPU of the current and next leaders.
+     *
+     * @param signed_transaction The serialized signed transaction
+     *
+     * @return The number of leaders the transaction was sent to
+     */
+    size_t send(const std::vector<uint8_t>& signed_transaction) {
+      ASSERT(signed_transaction.size() <= PACKET_DATA_SIZE);
+      size_t sent = 0;
+      for (auto& upcoming : upcoming_leaders(_fanout)) {
+        SendRecord record{upcoming.first, upcoming.second, "", signed_transaction.size(), false};
+        auto tpu = _tpus.find(upcoming.second);
+        if (tpu != _tpus.end()) {
+          record.tpu = tpu->second.address;
+          record.ok = _socket.send_to(tpu->second.sockaddr, signed_transaction.data(), signed_transaction.size());
+        }
+
+        LeaderStats& stats = _stats[upcoming.second];
+        if (record.ok) {
+          stats.sends++;
+          stats.bytes += record.length;
+          sent++;
+        } else {
+          stats.failures++;
+        }
+
+        _log.push_back(record);
+        if (_log.size() > _max_log) {
+          _log.pop_front();
+        }
+      }
+      return sent;
+    }
+
+    /**
+     * Returns the most recent sends, oldest first.
+     */
+    const std::deque<SendRecord>& log() const {
+      return _log;
+    }
+
+    /**
+     * Returns the send totals of every leader.
+     */
+    const std::map<PublicKey, LeaderStats>& stats() const {
+      return _stats;
+    }
+  };
+
+  /**
+   * Estimates the current slot and the progress within it from slot notifications and their arrival times.
+   *
+   * Between notifications the estimate advances at the measured slot duration, a moving average of the observed
+   * notification intervals seeded with the nominal duration. It never runs more than a bounded number of slots past
+   * the last notification and never goes backwards: a notification behind the estimate keeps the estimate and only
+   * corrects the rate. Notifications are applied by one thread; estimates can be read from any thread.
+   */
+  class SlotClock {
+  public:
+
+    /** Nominal duration of a slot */
+    static const int64_t DEFAULT_SLOT_NS = 400000000;
+
+    struct Estimate {
+      /** The estimated current slot */
+      uint64_t slot;
+      /** Time elapsed since the estimated start of the slot */
+      int64_t progress_ns;
+      /** The measured slot duration */
+      int64_t slot_ns;
+    };
+
+  private:
+
+    struct alignas(64) State {
+      /** Odd while a write is in progress */
+      std::atomic<uint64_t> sequence{0};
+      std::atomic<double> anchor_position{0};
+      std::atomic<int64_t> anchor_ns{0};
+      std::atomic<double> slot_ns{0};
+      std::atomic<double> limit{0};
+    };
+
+    State _state;
+    double _max_ahead;
+    double _smoothing;
+    int64_t _nominal_slot_ns;
+    uint64_t _last_slot = 0;
+    int64_t _last_ns = 0;
+
+    double position(int64_t now_ns, double& slot_ns) const {
+      double anchor_position, limit;
+      int64_t anchor_ns;
+      uint64_t before, after;
+      do {
+        before = _state.sequence.load(std::memory_order_acquire);
+        anchor_position = _state.anchor_position.load(std::memory_order_relaxed);
+        anchor_ns = _state.anchor_ns.load(std::memory_order_relaxed);
+        slot_ns = _state.slot_ns.load(std::memory_order_relaxed);
+        limit = _state.limit.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = _state.sequence.load(std::memory_order_relaxed);
+      } while (before != after || (before & 1) != 0);
+
+      if (slot_ns == 0) {
+        slot_ns = (double)_nominal_slot_ns;
+        return 0;
+      }
+      double position = anchor_position + (double)(now_ns - anchor_ns) / slot_ns;
+      return std::max(anchor_position, std::min(position, limit));
+    }
+
+  public:
+
+    /**
+     * @param nominal_slot_ns The nominal slot duration, used until intervals are measured
+     * @param max_ahead The maximum number of slots the estimate may run past the last notification
+     * @param smoothing The weight of a new interval in the moving average of the slot duration
+     */
+    SlotClock(int64_t nominal_slot_ns = DEFAULT_SLOT_NS, double max_ahead = 2, double smoothing = 0.1)
+      : _max_ahead(max_ahead),
+      _smoothing(smoothing),
+      _nominal_slot_ns(nominal_slot_ns)
+    {
+    }
+
+    SlotClock(const SlotClock&) = delete;
+    SlotClock& operator=(const SlotClock&) = delete;
+
+    /**
+     * Returns the steady clock time in nanoseconds.
+     */
+    static int64_t now_ns() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * Applies a slot notification. Notifications for slots that are not newer than the last one are ignored.
+     *
+     * @param slot The notified slot
+     * @param arrival_ns The steady clock time the notification arrived, in nanoseconds
+     *
+     * @return False if the notification was ignored
+     */
+    bool update(uint64_t slot, int64_t arrival_ns) {
+      if (_last_slot != 0 && slot <= _last_slot) {
+        return false;
+      }
+
+      double slot_ns;
+      double current = position(arrival_ns, slot_ns);
+      if (_last_slot != 0 && arrival_ns > _last_ns) {
+        double interval = (double)(arrival_ns - _last_ns) / (double)(slot - _last_slot);
+        interval = std::clamp(interval, _nominal_slot_ns / 2.0, _nominal_slot_ns * 2.0);
+        slot_ns += _smoothing * (interval - slot_ns);
+      }
+
+      uint64_t sequence = _state.sequence.load(std::memory_order_relaxed);
+      _state.sequence.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      _state.anchor_position.store(std::max((double)slot, current), std::memory_order_relaxed);
+      _state.anchor_ns.store(arrival_ns, std::memory_order_relaxed);
+      _state.slot_ns.store(slot_ns, std::memory_order_relaxed);
+      _state.limit.store((double)slot + _max_ahead, std::memory_order_relaxed);
+      _state.sequence.store(sequence + 2, std::memory_order_release);
+
+      _last_slot = slot;
+      _last_ns = arrival_ns;
+      return true;
+    }
+
+    /**
+     * Returns the estimate at a steady clock time, 0 before the first notification.
+     *
+     * @param at_ns The steady clock time in nanoseconds
+     */
+    Estimate estimate(int64_t at_ns) const {
+      double slot_ns;
+      double position = this->position(at_ns, slot_ns);
+      uint64_t slot = (uint64_t)position;
+      return {slot, (int64_t)((position - (double)slot) * slot_ns), (int64_t)slot_ns};
+    }
+
+    /**
+     * Returns the estimate now.
+     */
+    Estimate now() const {
+      return estimate(now_ns());
+    }
+
+    /**
+     * Returns the estimated slot after a delay.
+     *
+     * @param delay The delay from now
+     */
+    uint64_t slot_in(std::chrono::nanoseconds delay) const {
+      double slot_ns;
+      int64_t now = now_ns();
+      double position = this->position(now, slot_ns);
+      return (uint64_t)(position + (double)delay.count() / slot_ns);
+    }
+
+    /**
+     * Returns the leader expected to be producing blocks after a delay.
+     *
+     * @param schedule The cached leader schedule
+     * @param delay The delay from now
+     */
+    std::optional<PublicKey> leader_in(const LeaderScheduleCache& schedule, std::chrono::nanoseconds delay) const {
+      return schedule.leader(slot_in(delay));
+    }
+
+    /**
+     * Applies slot notifications from a slot change subscription.
+     *
+     * @param connection The connection to subscribe with, which must outlive the subscription
+     *
+     * @return The subscription ID
+     */
+    int subscribe(Connection& connection) {
+      return connection.on_slot_change([this](Result<SlotInfo> result) {
+        if (result.ok()) {
+          update(result._result->slot, now_ns());
+        }
+      });
+    }
+  };
+
+  /**
+   * Backfills the transaction history of an address over a time range, in four stages:
+   *
+   * 1. signatures: pages getSignaturesForAddress backwards from the newest signature until the start of the range
+   * 2. fetch: `concurrency` threads each request batches of transactions, one JSON-RPC batch array per request, over
+   *    a pool of keep-alive connections
+   * 3. decode: every transaction is decoded on the thread pool
+   * 4. emit: the transactions are handed to the callback on the calling thread in ascending slot order
+   *
+   * At most `window` transactions are between fetching and emitting at once, so a slow consumer stalls the fetch
+   * threads instead of buffering the whole range.
+   */
+  class TransactionBackfill {
+  public:
+
+    /** Returns the page of signatures of an address preceding `before`, newest first */
+    typedef std::function<Result<std::vector<SignatureInfo>>(const PublicKey& address, const std::string& before)> PageFunction;
+    /** Posts a JSON-RPC batch array and returns the array of responses */
+    typedef std::function<json(const json& batch)> FetchFunction;
+
+    /** Number of attempts at fetching a batch before its transactions are emitted with the error */
+    static const int MAX_FETCH_ATTEMPTS = 3;
+
+    struct Item {
+      /** The signature, as listed by getSignaturesForAddress */
+      SignatureInfo signature;
+      /** The getTransaction result as received, null if it is missing */
+      json raw;
+      /** The decoded transaction, or the error that prevented fetching or decoding it */
+      Result<TransactionResponse> transaction;
+    };
+
+    typedef std::function<void(const Item& item)> Callback;
+
+    struct StageStats {
+      /** Number of items that went through the stage */
+      uint64_t items;
+      /** Number of requests or tasks the items were processed in */
+      uint64_t requests;
+      /** Number of failed requests or tasks */
+      uint64_t errors;
+      /** Sum of the request or task latencies */
+      std::chrono::nanoseconds busy;
+      /** Highest request or task latency */
+      std::chrono::nanoseconds max_latency;
+      /** Time from the start of the first request or task to the end of the last one */
+      std::chrono::nanoseconds elapsed;
+
+      /**
+       * Returns the mean latency of a request or task.
+       */
+      std::chrono::nanoseconds mean_latency() const {
+        return requests == 0 ? std::chrono::nanoseconds::zero() : busy / (int64_t)requests;
+      }
+
+      /**
+       * Returns the number of items per second, over the elapsed time of the stage.
+       */
+      double throughput() const {
+        return elapsed.count() == 0 ? 0.0 : (double)items * 1e9 / (double)elapsed.count();
+      }
+    };
+
+    struct Stats {
+      StageStats signatures;
+      StageStats fetch;
+      StageStats decode;
+      StageStats emit;
+    };
+
+  private:
+
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    PageFunction _pages;
+    FetchFunction _fetch;
+    threading::ThreadPool& _pool;
+    size_t _concurrency;
+    size_t _batch_size;
+    size_t _window;
+
+    std::mutex _mutex;
+    std::condition_variable _progress;
+    std::vector<SignatureInfo> _signatures;
+    std::vector<std::optional<Item>> _results;
+    size_t _next = 0;
+    size_t _emitted = 0;
+    size_t _decoded = 0;
+    bool _stopping = false;
+
+    Stats _stats;
+    TimePoint _started[4];
+
+    void record(StageStats& stats, TimePoint& started, TimePoint start, TimePoint end, uint64_t items, bool ok) {
+      if (stats.requests == 0) {
+        started = start;
+      }
+      stats.items += items;
+      stats.requests++;
+      if (!ok) {
+        stats.errors++;
+      }
+      std::chrono::nanoseconds latency = end - start;
+      stats.busy += latency;
+      stats.max_latency = std::max(stats.max_latency, latency);
+      stats.elapsed = std::max(stats.elapsed, std::chrono::nanoseconds(end - started));
+    }
+
+    void collect(const PublicKey& address, int64_t start_time, int64_t end_time) {
+      std::string before;
+      bool done = false;
+      while (!done) {
+        auto start = std::chrono::steady_clock::now();
+        Result<std::vector<SignatureInfo>> page = _pages(address, before);
+        auto end = std::chrono::steady_clock::now();
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          record(_stats.signatures, _started[0], start, end, page.ok() ? page._result->size() : 0, page.ok());
+        }
+        if (!page.ok()) {
+          throw std::runtime_error(page._error ? page._error->message : "getSignaturesForAddress failed");
+        }
+        if (page._result->empty()) {
+          break;
+        }
+        for (auto& info : page._result.value()) {
+          // Signatures without a block time cannot be placed in the range and are kept
+          if (info.block_time != 0 && info.block_time > end_time) {
+            continue;
+          }
+          if (info.block_time != 0 && info.block_time < start_time) {
+            done = true;
+            break;
+          }
+          _signatures.push_back(info);
+        }
+        before = page._result->back().signature;
+      }
+      std::reverse(_signatures.begin(), _signatures.end());
+    }
+
+    void decode(std::shared_ptr<json> response, size_t position, size_t index) {
+      auto start = std::chrono::steady_clock::now();
+      Item item{_signatures[index], nullptr, {}};
+      bool ok = true;
+      const json* entry = position < response->size() ? &(*response)[position] : nullptr;
+      if (entry == nullptr || entry->is_null()) {
+        item.transaction = Result<TransactionResponse>(ResultError{-1, "No response for " + item.signature.signature});
+        ok = false;
+      } else {
+        try {
+          if (entry->contains("result")) {
+            item.raw = (*entry)["result"];
+          }
+          item.transaction = entry->get<Result<TransactionResponse>>();
+          ok = item.transaction.ok();
+          if (!ok && !item.transaction._error) {
+            item.transaction._error = ResultError{-1, "Transaction not found: " + item.signature.signature};
+          }
+        } catch (const std::exception& e) {
+          item.transaction = Result<TransactionResponse>(ResultError{-1, e.what()});
+          ok = false;
+        }
+      }
+      auto end = std::chrono::steady_clock::now();
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      record(_stats.decode, _started[2], start, end, 1, ok);
+      _results[index] = std::move(item);
+      _decoded++;
+      _progress.notify_all();
+    }
+
+    void fetch_loop() {
+      while (true) {
+        size_t begin, end;
+        {
+          std::unique_lock<std::mutex> lock(_mutex);
+          _progress.wait(lock, [this]() {
+            return _stopping || _next >= _signatures.size() || _next < _emitted + _window;
+          });
+          if (_stopping || _next >= _signatures.size()) {
+            return;
+          }
+          begin = _next;
+          end = std::min({_signatures.size(), begin + _batch_size, _emitted + _window});
+          _next = end;
+        }
+
+        json batch = json::array();
+        for (size_t i = begin; i < end; i++) {
+          batch.push_back(transaction_request(_signatures[i].signature, i));
+        }
+
+        // The responses of a batch may come back in any order, so they are matched to the requests by id
+        auto response = std::make_shared<json>(json::array());
+        for (int attempt = 0; attempt < MAX_FETCH_ATTEMPTS; attempt++) {
+          auto start = std::chrono::steady_clock::now();
+          json result;
+          try {
+            result = _fetch(batch);
+          } catch (const std::exception&) {
+          }
+          bool ok = result.is_array();
+          auto finish = std::chrono::steady_clock::now();
+          {
+            std::lock_guard<std::mutex> lock(_mutex);
+            record(_stats.fetch, _started[1], start, finish, ok ? end - begin : 0, ok);
+          }
+          if (ok) {
+            *response = json::array();
+            for (size_t i = begin; i < end; i++) {
+              response->push_back(nullptr);
+            }
+            for (auto& entry : result) {
+              if (entry.contains("id") && entry["id"].is_number_unsigned()) {
+                size_t id = entry["id"].get<size_t>();
+                if (id >= begin && id < end) {
+                  (*response)[id - begin] = std::move(entry);
+                }
+              }
+            }
+            break;
+          }
+        }
+
+        for (size_t i = begin; i < end; i++) {
+          _pool.submit([this, response, i, begin]() { decode(response, i - begin, i); });
+        }
+      }
+    }
+
+  public:
+
+    /**
+     * @param pages The function returning pages of signatures, called on the calling thread
+     * @param fetch The function posting batches of getTransaction requests, called concurrently on the fetch threads
+     * @param pool The thread pool decoding the transactions
+     * @param concurrency The number of fetch threads, and so of batches in flight
+     * @param batch_size The number of transactions requested in one batch
+     * @param window The maximum number of transactions fetched but not yet emitted
+     */
+    TransactionBackfill(PageFunction pages, FetchFunction fetch, threading::ThreadPool& pool, size_t concurrency = 8, size_t batch_size = 16, size_t window = 1024)
+      : _pages(pages),
+      _fetch(fetch),
+      _pool(pool),
+      _concurrency(concurrency),
+      _batch_size(batch_size),
+      _window(window)
+    {
+      ASSERT(concurrency > 0 && batch_size > 0 && window >= batch_size);
+    }
+
+    /**
+     * @param connection The connection to page the signatures with, whose endpoint the transactions are fetched from
+     * over `concurrency` keep-alive connections
+     * @param pool The thread pool decoding the transactions
+     * @param concurrency The number of fetch threads and connections
+     * @param batch_size The number of transactions requested in one batch
+     * @param window The maximum number of transactions fetched but not yet emitted
+     */
+    TransactionBackfill(Connection& connection, threading::ThreadPool& pool, size_t concurrency = 8, size_t batch_size = 16, size_t window = 1024)
+      : TransactionBackfill(
+          [&connection](const PublicKey& address, const std::string& before) {
+            return connection.get_signatures_for_address(address, before);
+          },
+          [connections = std::make_shared<http::ConnectionPool>(connection.endpoint(), concurrency)](const json& batch) {
+            return connections->post(batch);
+          },
+          pool, concurrency, batch_size, window)
+    {
+    }
+
+    TransactionBackfill(const TransactionBackfill&) = delete;
+    TransactionBackfill& operator=(const TransactionBackfill&) = delete;
+
+    /**
+     * Returns a getTransaction request for a batch, accepting versioned transactions.
+     *
+     * @param signature The transaction signature
+     * @param id The request id, used to match the response
+     */
+    static json transaction_request(const std::string& signature, size_t id) {
+      return {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"method", "getTransaction"},
+        {"params", {
+          signature,
+          {
+            {"encoding", "json"},
+            {"commitment", Commitment::Confirmed},
+            {"maxSupportedTransactionVersion", 0},
+          },
+        }},
+      };
+    }
+
+    /**
+     * Returns a callback writing every item to a stream as one line of JSON with the signature, slot and the
+     * getTransaction result.
+     *
+     * @param out The stream to write to, which must outlive the backfill
+     */
+    static Callback write_to(std::ostream& out) {
+      return [&out](const Item& item) {
+        out << json{
+          {"signature", item.signature.signature},
+          {"slot", item.signature.slot},
+          {"transaction", item.raw},
+        }.dump() << '\n';
+      };
+    }
+
+    /**
+     * Backfills the transactions of an address with a block time in [start_time, end_time], blocking until the
+     * callback has been called for every one of them.
+     *
+     * @param address The account address
+     * @param start_time The start of the range, as Unix timestamp
+     * @param end_time The end of the range, as Unix timestamp
+     * @param callback The function called with every transaction, in ascending slot order, on the calling thread
+     *
+     * @return The number of transactions emitted
+     */
+    size_t run(const PublicKey& address, int64_t start_time, int64_t end_time, Callback callback) {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _signatures.clear();
+        _results.clear();
+        _next = 0;
+        _emitted = 0;
+        _decoded = 0;
+        _stopping = false;
+        _stats = Stats{};
+      }
+      collect(address, start_time, end_time);
+      _results.resize(_signatures.size());
+
+      std::vector<std::thread> fetchers;
+      for (size_t i = 0; i < _concurrency; i++) {
+        fetchers.emplace_back([this]() { fetch_loop(); });
+      }
+
+      std::exception_ptr error;
+      try {
+        while (_emitted < _signatures.size()) {
+          Item item;
+          {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _progress.wait(lock, [this]() { return _results[_emitted].has_value(); });
+            item = std::move(_results[_emitted].value());
+            _results[_emitted].reset();
+          }
+          auto start = std::chrono::steady_clock::now();
+          callback(item);
+          auto end = std::chrono::steady_clock::now();
+          {
+            std::lock_guard<std::mutex> lock(_mutex);
+            record(_stats.emit, _started[3], start, end, 1, true);
+            _emitted++;
+          }
+          _progress.notify_all();
+        }
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+      }
+      _progress.notify_all();
+      for (auto& fetcher : fetchers) {
+        fetcher.join();
+      }
+      if (error) {
+        // Decode tasks already queued still reference the results
+        std::unique_lock<std::mutex> lock(_mutex);
+        _progress.wait(lock, [this]() { return _decoded == _next; });
+        std::rethrow_exception(error);
+      }
+      return _emitted;
+    }
+
+    /**
+     * Returns the statistics of every stage of the last or current run.
+     */
+    Stats stats() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _stats;
+    }
+  };
+
+  /**
+   * Fetches blocks by slot and decodes their transactions in parallel.
+   *
+   * Slots are requested from root or slot notifications, or directly, and gaps between requested slots are filled in.
+   * `concurrency` fetch threads keep that many getBlock requests in flight over keep-alive connections. A block whose
+   * slot is not yet available is retried after a delay. The base64 transactions of a block are decoded on the thread
+   * pool in chunks into views over one buffer owned by the block. With a program filter, a transaction is first
+   * checked for a top-level instruction of one of the programs and skipped without building its view otherwise.
+   * poll() delivers the blocks in slot order on the calling thread.
+   */
+  class BlockFetcher {
+  public:
+
+    /** Returns the getBlock response for a slot */
+    typedef std::function<json(uint64_t slot)> FetchFunction;
+
+    /** Error code of a block that is not available yet */
+    static const int64_t BLOCK_NOT_AVAILABLE = -32004;
+    /** Error codes of a slot that was skipped, and so has no block */
+    static const int64_t SLOT_SKIPPED = -32007;
+    static const int64_t LONG_TERM_STORAGE_SLOT_SKIPPED = -32009;
+    /** Number of transactions decoded by one task */
+    static const size_t DECODE_CHUNK = 64;
+
+    struct Transaction {
+      /** The position of the transaction in the block */
+      size_t index;
+      /** The transaction, pointing into the block's buffer */
+      TransactionView view;
+      /** The transaction status metadata, pointing into the block's response */
+      const json* meta;
+    };
+
+    struct Block {
+      uint64_t slot;
+      /** True if the slot was skipped by its leader and has no block */
+      bool skipped;
+      /** Why the block could not be fetched, empty if it was */
+      std::string error;
+      uint64_t parent_slot;
+      std::string blockhash;
+      /** Estimated production time as Unix timestamp, 0 if not available */
+      int64_t block_time;
+      uint64_t block_height;
+      /** Number of transactions in the block */
+      size_t num_transactions;
+      /** Number of transactions that are not well-formed, with a program filter only those invoking one of the programs */
+      size_t malformed;
+      /** The transactions that passed the program filter, in block order */
+      std::vector<Transaction> transactions;
+      /** The getBlock response, which the transaction metadata points into */
+      json response;
+      /** The decoded transactions, which the views point into */
+      std::vector<uint8_t> buffer;
+    };
+
+    typedef std::function<void(const std::shared_ptr<const Block>& block)> Callback;
+
+    struct Stats {
+      /** Number of blocks fetched, skipped slots and slots that failed */
+      uint64_t blocks;
+      uint64_t skipped;
+      uint64_t errors;
+      /** Number of requests repeated because the block was not available yet */
+      uint64_t retries;
+      /** Number of transactions in the fetched blocks */
+      uint64_t transactions;
+      /** Number of transactions that passed the program filter */
+      uint64_t matched;
+      /** Number of transactions that are not well-formed */
+      uint64_t malformed;
+      /** Sum of the getBlock request latencies */
+      std::chrono::nanoseconds fetch_latency;
+      /** Sum of the decode task latencies */
+      std::chrono::nanoseconds decode_latency;
+    };
+
+  private:
+
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    struct Job {
+      uint64_t slot;
+      int attempts;
+      TimePoint not_before;
+    };
+
+    FetchFunction _fetch;
+    threading::ThreadPool& _pool;
+    std::vector<PublicKey> _programs;
+    int _max_attempts;
+    std::chrono::milliseconds _retry_delay;
+    uint64_t _max_gap;
+
+    std::mutex _mutex;
+    std::condition_variable _jobs_changed;
+    std::condition_variable _idle;
+    std::deque<Job> _jobs;
+    /** Requested slots not yet delivered, with their block once it is complete */
+    std::map<uint64_t, std::shared_ptr<Block>> _outstanding;
+    uint64_t _highest = 0;
+    size_t _in_flight = 0;
+    bool _stopping = false;
+    Stats _stats{};
+    std::vector<std::thread> _threads;
+
+    void complete(std::shared_ptr<Block> block) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (block->skipped) {
+        _stats.skipped++;
+      } else if (!block->error.empty()) {
+        _stats.errors++;
+      } else {
+        _stats.blocks++;
+        _stats.transactions += block->num_transactions;
+        _stats.matched += block->transactions.size();
+        _stats.malformed += block->malformed;
+      }
+      _outstanding[block->slot] = block;
+      _in_flight--;
+      _idle.notify_all();
+    }
+
+    void decode(std::shared_ptr<Block> block) {
+      // The response is only read from here on, through const references, so the tasks can share it
+      const json& transactions = block->response.at("result").at("transactions");
+      size_t count = transactions.size();
+      block->num_transactions = count;
+
+      // Lay the decoded transactions out back to back, each at the offset of its upper bound size
+      auto offsets = std::make_shared<std::vector<size_t>>(count + 1, 0);
+      for (size_t i = 0; i < count; i++) {
+        (*offsets)[i + 1] = (*offsets)[i] + transactions[i]["transaction"][0].get_ref<const std::string&>().size() / 4 * 3;
+      }
+      block->buffer.resize(offsets->back());
+
+      size_t chunks = (count + DECODE_CHUNK - 1) / DECODE_CHUNK;
+      if (chunks == 0) {
+        complete(block);
+        return;
+      }
+      auto results = std::make_shared<std::vector<std::vector<Transaction>>>(chunks);
+      auto malformed = std::make_shared<std::atomic<size_t>>(0);
+      auto remaining = std::make_shared<std::atomic<size_t>>(chunks);
+      for (size_t chunk = 0; chunk < chunks; chunk++) {
+        _pool.submit([this, block, offsets, results, malformed, remaining, chunk, count]() {
+          auto start = std::chrono::steady_clock::now();
+          const json& transactions = block->response.at("result").at("transactions");
+          std::vector<Transaction>& matched = (*results)[chunk];
+          for (size_t i = chunk * DECODE_CHUNK; i < std::min(count, (chunk + 1) * DECODE_CHUNK); i++) {
+            const std::string& encoded = transactions[i]["transaction"][0].get_ref<const std::string&>();
+            uint8_t* bytes = block->buffer.data() + (*offsets)[i];
+            size_t size = 0;
+            if (encoded.size() >= 4 && encoded.size() % 4 == 0) {
+              size = base64::decode(encoded.data(), encoded.size(), (char*)bytes, (*offsets)[i + 1] - (*offsets)[i]);
+            }
+            if (!_programs.empty() && !TransactionView::invokes(bytes, size, _programs)) {
+              continue;
+            }
+            Transaction transaction{i, {}, transactions[i].contains("meta") ? &transactions[i]["meta"] : nullptr};
+            if (!transaction.view.parse(bytes, size)) {
+              (*malformed)++;
+              continue;
+            }
+            matched.push_back(std::move(transaction));
+          }
+          auto end = std::chrono::steady_clock::now();
+          {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stats.decode_latency += end - start;
+          }
+
+          if (--(*remaining) == 0) {
+            for (auto& chunk_matched : *results) {
+              block->transactions.insert(block->transactions.end(), chunk_matched.begin(), chunk_matched.end());
+            }
+            block->malformed = *malformed;
+            complete(block);
+          }
+        });
+      }
+    }
+
+    void process(const Job& job, json response) {
+      auto block = std::make_shared<Block>();
+      block->slot = job.slot;
+      if (response.contains("error")) {
+        int64_t code = response["error"].value("code", (int64_t)0);
+        if (code == SLOT_SKIPPED || code == LONG_TERM_STORAGE_SLOT_SKIPPED) {
+          block->skipped = true;
+        } else if (code == BLOCK_NOT_AVAILABLE && job.attempts < _max_attempts) {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _stats.retries++;
+          _jobs.push_back({job.slot, job.attempts, std::chrono::steady_clock::now() + _retry_delay});
+          _jobs_changed.notify_one();
+          return;
+        } else {
+          block->error = response["error"].value("message", "getBlock failed");
+        }
+        complete(block);
+        return;
+      }
+      if (!response.contains("result") || response["result"].is_null()) {
+        block->skipped = true;
+        complete(block);
+        return;
+      }
+
+      try {
+        const json& result = response["result"];
+        block->parent_slot = result.value("parentSlot", (uint64_t)0);
+        block->blockhash = result.value("blockhash", "");
+        if (result.contains("blockTime") && !result["blockTime"].is_null()) {
+          block->block_time = result["blockTime"].get<int64_t>();
+        }
+        if (result.contains("blockHeight") && !result["blockHeight"].is_null()) {
+          block->block_height = result["blockHeight"].get<uint64_t>();
+        }
+        if (!result.contains("transactions")) {
+          block->response = json{{"result", {{"transactions", json::array()}}}};
+        } else {
+          block->response = std::move(response);
+        }
+        decode(block);
+      } catch (const std::exception& e) {
+        block->error = e.what();
+        complete(block);
+      }
+    }
+
+    void fetch_loop() {
+      while (true) {
+        Job job;
+        {
+          std::unique_lock<std::mutex> lock(_mutex);
+          while (true) {
+            if (_stopping) {
+              return;
+            }
+            auto now = std::chrono::steady_clock::now();
+            auto ready = std::find_if(_jobs.begin(), _jobs.end(), [now](const Job& job) { return job.not_before <= now; });
+            if (ready != _jobs.end()) {
+              job = *ready;
+              _jobs.erase(ready);
+              break;
+            }
+            if (_jobs.empty()) {
+              _jobs_changed.wait(lock);
+            } else {
+              auto earliest = std::min_element(_jobs.begin(), _jobs.end(), [](const Job& a, const Job& b) { return a.not_before < b.not_before; });
+              _jobs_changed.wait_until(lock, earliest->not_before);
+            }
+          }
+        }
+
+        job.attempts++;
+        auto start = std::chrono::steady_clock::now();
+        json response;
+        try {
+          response = _fetch(job.slot);
+        } catch (const std::exception& e) {
+          response = {{"error", {{"code", BLOCK_NOT_AVAILABLE}, {"message", e.what()}}}};
+        }
+        auto end = std::chrono::steady_clock::now();
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _stats.fetch_latency += end - start;
+        }
+        process(job, std::move(response));
+      }
+    }
+
+  public:
+
+    /**
+     * @param fetch The function returning the getBlock response for a slot, called concurrently on the fetch threads
+     * @param pool The thread pool decoding the transactions
+     * @param programs Only transactions invoking one of these programs are decoded, all of them if empty
+     * @param concurrency The number of fetch threads, and so of requests in flight
+     * @param max_attempts The number of attempts at a block that is not available before giving up on it
+     * @param retry_delay The delay before asking again for a block that is not available
+     * @param max_gap The maximum number of slots between two requested slots that are filled in
+     */
+    BlockFetcher(FetchFunction fetch, threading::ThreadPool& pool, const std::vector<PublicKey>& programs = {}, size_t concurrency = 4, int max_attempts = 10, std::chrono::milliseconds retry_delay = std::chrono::milliseconds(200), uint64_t max_gap = 64)
+      : _fetch(fetch),
+      _pool(pool),
+      _programs(programs),
+      _max_attempts(max_attempts),
+      _retry_delay(retry_delay),
+      _max_gap(max_gap)
+    {
+      for (size_t i = 0; i < concurrency; i++) {
+        _threads.emplace_back([this]() { fetch_loop(); });
+      }
+    }
+
+    /**
+     * @param connection The connection whose endpoint the blocks are fetched from over `concurrency` keep-alive connections
+     * @param pool The thread pool decoding the transactions
+     * @param programs Only transactions invoking one of these programs are decoded, all of them if empty
+     * @param commitment The commitment of the blocks, confirmed or finalized
+     * @param concurrency The number of fetch threads and connections
+     */
+    BlockFetcher(Connection& connection, threading::ThreadPool& pool, const std::vector<PublicKey>& programs = {}, Commitment commitment = Commitment::Confirmed, size_t concurrency = 4)
+      : BlockFetcher(
+          [commitment, connections = std::make_shared<http::ConnectionPool>(connection.endpoint(), concurrency)](uint64_t slot) {
+            return connections->post(block_request(slot, commitment));
+          },
+          pool, programs, concurrency)
+    {
+    }
+
+    ~BlockFetcher() {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+      }
+      _jobs_changed.notify_all();
+      for (auto& thread : _threads) {
+        thread.join();
+      }
+      // Decode tasks still queued on the pool reference the fetcher
+      std::unique_lock<std::mutex> lock(_mutex);
+      _idle.wait(lock, [this]() { return _in_flight == _jobs.size(); });
+    }
+
+    BlockFetcher(const BlockFetcher&) = delete;
+    BlockFetcher& operator=(const BlockFetcher&) = delete;
+
+    /**
+     * Returns a getBlock request with base64 transactions and without rewards.
+     *
+     * @param slot The slot of the block
+     * @param commitment The commitment of the block, confirmed or finalized
+     */
+    static json block_request(uint64_t slot, Commitment commitment = Commitment::Confirmed) {
+      return {
+        {"jsonrpc", "2.0"},
+        {"id", 1},
+        {"method", "getBlock"},
+        {"params", {
+          slot,
+          {
+            {"encoding", "base64"},
+            {"transactionDetails", "full"},
+            {"rewards", false},
+            {"commitment", commitment},
+            {"maxSupportedTransactionVersion", 0},
+          },
+        }},
+      };
+    }
+
+    /**
+     * Requests the block of a slot, and of the slots since the highest requested slot if there are at most `max_gap`
+     * of them. Slots at or below the highest requested slot are ignored.
+     *
+     * @param slot The slot
+     */
+    void request(uint64_t slot) {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (slot <= _highest) {
+          return;
+        }
+        uint64_t first = (_highest == 0 || slot - _highest > _max_gap) ? slot : _highest + 1;
+        auto now = std::chrono::steady_clock::now();
+        for (uint64_t s = first; s <= slot; s++) {
+          _jobs.push_back({s, 0, now});
+          _outstanding[s] = nullptr;
+          _in_flight++;
+        }
+        _highest = slot;
+      }
+      _jobs_changed.notify_all();
+    }
+
+    /**
+     * Delivers the blocks completed since the last call, in slot order. A block is held back until every requested
+     * slot before it is complete.
+     *
+     * @param callback The function called with every block, skipped slot or failed slot
+     *
+     * @return The number of blocks delivered
+     */
+    size_t poll(const Callback& callback) {
+      std::vector<std::shared_ptr<Block>> ready;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        while (!_outstanding.empty() && _outstanding.begin()->second) {
+          ready.push_back(_outstanding.begin()->second);
+          _outstanding.erase(_outstanding.begin());
+        }
+      }
+      for (auto& block : ready) {
+        callback(block);
+      }
+      return ready.size();
+    }
+
+    /**
+     * Blocks until every requested slot is complete.
+     */
+    void wait() {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _idle.wait(lock, [this]() { return _in_flight == 0; });
+    }
+
+    /**
+     * Returns the number of requested slots not yet delivered.
+     */
+    size_t pending() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _outstanding.size();
+    }
+
+    Stats stats() {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _stats;
+    }
+
+    /**
+     * Requests every slot the node roots.
+     *
+     * @param connection The connection to subscribe with, which must outlive the subscription
+     *
+     * @return The subscription ID
+     */
+    int subscribe_roots(Connection& connection) {
+      return connection.on_root([this](Result<uint64_t> result) {
+        if (result.ok()) {
+          request(result._result.value());
+        }
+      });
+    }
+
+    /**
+     * Requests the parent of every slot the node starts processing, the most recent block that can be complete.
+     * Blocks that are not confirmed yet are retried.
+     *
+     * @param connection The connection to subscribe with, which must outlive the subscription
+     *
+     * @return The subscription ID
+     */
+    int subscribe_slots(Connection& connection) {
+      return connection.on_slot_change([this](Result<SlotInfo> result) {
+        if (result.ok()) {
+          request(result._result->parent);
+        }
+      });
+    }
+  };
+
+  namespace token {
+
+    /** Size of an SPL Token account */
+    const size_t ACCOUNT_SIZE = 165;
+
+    /**
+     * Zero-copy view over the raw data of an SPL Token account
+     */
+    struct AccountView {
+      const uint8_t* data;
+
+      /** The mint of the token */
+      PublicKey mint() const {
+        return PublicKey(&data[0]);
+      }
+
+      /** The Pubkey of the token account owner */
+      PublicKey owner() const {
+        return PublicKey(&data[32]);
+      }
+
+      /** The amount of tokens, without decimals */
+      uint64_t amount() const {
+        return endian::read_le<uint64_t>(&data[64]);
+      }
+    };
+
+    /**
+     * Returns an Instruction to create an Associated Token Account
+     *
+     * @param payer Payer of the initialization fees
+     * @param associated_token New associated token account
+     * @param owner Owner of the new account
+     * @param mint Token mint account
+     * @param program_id SPL Token program account
+     * @param associated_token_program_id SPL Associated Token program account
+     */
+    Transaction::Message::Instruction create_associated_token_account_instruction(
+      const PublicKey& payer,
+      const PublicKey& associated_token,
+      const PublicKey& owner,
+      const PublicKey& mint,
+      const PublicKey& program_id = TOKEN_PROGRAM_ID,
+      const PublicKey& associated_token_program_id = ASSOCIATED_TOKEN_PROGRAM_ID
+    );
+
+    /**
+     * Returns a Transaction to create an Associated Token Account
+     *
+     * @param payer Payer of the initialization fees
+     * @param associated_token New associated token account
+     * @param owner Owner of the new account
+     * @param mint Token mint account
+     * @param program_id SPL Token program account
+     * @param associated_token_program_id SPL Associated Token program account
+     */
+    Transaction create_associated_token_account_transaction(
+      const PublicKey& payer,
+      const PublicKey& associated_token,
+      const PublicKey& owner,
+      const PublicKey& mint,
+      const PublicKey& program_id = TOKEN_PROGRAM_ID,
+      const PublicKey& associated_token_program_id = ASSOCIATED_TOKEN_PROGRAM_ID
+    );
+
+    /**
+     * Get the address of the associated token account for a given mint and owner
+     *
+     * @param mint                     Token mint account
+     * @param owner                    Owner of the new account
+     * @param allow_owner_off_curve       Allow the owner account to be a PDA (Program Derived Address)
+     * @param program_id                SPL Token program account
+     * @param associated_token_program_id SPL Associated Token program account
+     */
+    PublicKey get_associated_token_address(
+      const PublicKey& mint,
+      const PublicKey& owner,
+      const bool& allow_owner_off_curve = false,
+      const PublicKey& program_id = TOKEN_PROGRAM_ID,
+      const PublicKey& associated_token_program_id = ASSOCIATED_TOKEN_PROGRAM_ID
+    );
+
+    /**
+    * Create and initialize a new associated token account
+    *
+    * @param connection Connection to use
+    * @param payer Payer of the transaction and initialization fees
+    * @param mint Mint for the account
+    * @param owner Owner of the new account
+    * @param confirm_options Options for confirming the transaction
+    * @param program_id SPL Token program account
+    * @param associated_token_program_id SPL Associated Token program account
+    */
+    Result<PublicKey> create_associated_token_account(
+      const Connection& connection,
+      const Keypair& payer,
+      const PublicKey& mint,
+      const PublicKey& owner,
+      const ConfirmOptions& confirm_options = {},
+      const PublicKey& program_id = TOKEN_PROGRAM_ID,
+      const PublicKey& associated_token_program_id = ASSOCIATED_TOKEN_PROGRAM_ID
+    );
+
+  }
+
+  namespace compute_budget {
+
+    /**
+     * Returns an Instruction setting the compute unit limit of the transaction
+     *
+     * @param units The maximum number of compute units the transaction may consume
+     */
+    Transaction::Message::Instruction set_compute_unit_limit_instruction(uint32_t units);
+
+    /**
+     * Returns an Instruction setting the compute unit price of the transaction
+     *
+     * @param micro_lamports The price of a compute unit, in micro-lamports
+     */
+    Transaction::Message::Instruction set_compute_unit_price_instruction(uint64_t micro_lamports);
+
+    /**
+     * Returns true if the instruction sets the compute unit limit or the compute unit price
+     *
+     * @param instruction The instruction
+     */
+    bool is_compute_unit_limit_or_price(const Transaction::Message::Instruction& instruction);
+
+    /**
+     * Replaces the compute unit limit and price instructions of a transaction, placed first. Other compute budget
+     * instructions, such as a heap frame request, are kept.
+     *
+     * @param transaction The transaction to update
+     * @param units The compute unit limit, none if 0
+     * @param micro_lamports The compute unit price, none if 0
+     */
+    void set_compute_budget(Transaction& transaction, uint32_t units, uint64_t micro_lamports);
+
+    /**
+     * Estimates compute unit prices from the recent prioritization fees of the writable accounts a transaction locks.
+     *
+     * Each tracked account keeps the fees of the most recent slots and a sorted copy for percentile lookups. An estimate
+     * for a transaction is the highest percentile across its accounts, since the most contended account decides.
+     */
+    class PriorityFeeEstimator {
+      struct Fees {
+        std::map<uint64_t, uint64_t> by_slot;
+        std::vector<uint64_t> sorted;
+        std::chrono::steady_clock::time_point refreshed;
+      };
+
+      std::map<PublicKey, Fees> _accounts;
+      size_t _window;
+      std::chrono::milliseconds _refresh_interval;
+
+    public:
+
+      /**
+       * @param window The number of most recent slots to keep per account
+       * @param refresh_interval The minimum time between two fetches of the same account
+       */
+      PriorityFeeEstimator(size_t window = 150, std::chrono::milliseconds refresh_interval = std::chrono::milliseconds(2000))
+        : _window(window),
+        _refresh_interval(refresh_interval)
+      {
+      }
+
+      /**
+       * Starts tracking the fees of a writable account.
+       *
+       * @param account The account
+       */
+      void track(const PublicKey& account) {
+        _accounts.try_emplace(account);
+      }
+
+      /**
+       * Merges the result of getRecentPrioritizationFees into the window of an account.
+       *
+       * @param account The account
+       * @param fees The recent fees
+       */
+      void update(const PublicKey& account, const std::vector<PrioritizationFee>& fees) {
+        Fees& entry = _accounts[account];
+        for (auto& fee : fees) {
+          entry.by_slot[fee.slot] = fee.prioritization_fee;
+        }
+        while (entry.by_slot.size() > _window) {
+          entry.by_slot.erase(entry.by_slot.begin());
+        }
+        entry.sorted.clear();
+        for (auto& fee : entry.by_slot) {
+          entry.sorted.push_back(fee.second);
+        }
+        std::sort(entry.sorted.begin(), entry.sorted.end());
+        entry.refreshed = std::chrono::steady_clock::now();
+      }
+
+      /**
+       * Returns a percentile of the recent fees of an account, or 0 if it has none.
+       *
+       * @param account The account
+       * @param percentile The percentile, between 0 and 100
+       */
+      uint64_t percentile(const PublicKey& account, double percentile) const {
+        auto it = _accounts.find(account);
+        if (it == _accounts.end() || it->second.sorted.empty()) {
+          return 0;
+        }
+        const auto& sorted = it->second.sorted;
+        size_t index = (size_t)std::ceil(percentile / 100.0 * sorted.size());
+        return sorted[std::min(index > 0 ? index - 1 : 0, sorted.size() - 1)];
+      }
+
+      /**
+       * Returns the compute unit price for a transaction, the highest percentile across its writable accounts.
+       *
+       * @param accounts The writable accounts of the transaction
+       * @param percentile The percentile, between 0 and 100
+       */
+      uint64_t estimate(const std::vector<PublicKey>& accounts, double percentile) const {
+        uint64_t price = 0;
+        for (auto& account : accounts) {
+          price = std::max(price, this->percentile(account, percentile));
+        }
+        return price;
+      }
+
+      /**
+       * Fetches the fees of the tracked accounts that were not refreshed within the refresh interval.
+       *
+       * @param connection The connection to query
+       *
+       * @return The number of accounts fetched
+       */
+      size_t poll(Connection& connection) {
+        auto now = std::chrono::steady_clock::now();
+        size_t count = 0;
+        for (auto& entry : _accounts) {
+          if (now - entry.second.refreshed < _refresh_interval) {
+            continue;
+          }
+          auto fees = connection.get_recent_prioritization_fees({entry.first});
+          if (fees.ok()) {
+            update(entry.first, fees._result.value());
+          }
+          entry.second.refreshed = now;
+          count++;
+        }
+        return count;
+      }
+    };
+
+    /**
+     * Sizes compute unit limits by simulating a transaction once per template and adding headroom.
+     *
+     * Transactions share a template when they call the same programs with the same accounts and data lengths, so a
+     * swap with a different amount reuses the limit measured for the first one.
+     */
+    class ComputeUnitSizer {
+      std::map<std::string, uint32_t> _limits;
+      double _headroom;
+
+    public:
+
+      /**
+       * @param headroom The fraction of the simulated units added on top of them
+       */
+      ComputeUnitSizer(double headroom = 0.1)
+        : _headroom(headroom)
+      {
+      }
+
+      /**
+       * Returns the template key of a transaction, ignoring its compute unit limit and price.
+       *
+       * @param transaction The transaction
+       */
+      static std::string template_key(const Transaction& transaction) {
+        std::string key;
+        for (auto& instruction : transaction.message.instructions) {
+          if (is_compute_unit_limit_or_price(instruction)) {
+            continue;
+          }
+          key.append((const char*)instruction.program_id.bytes.data(), PUBLIC_KEY_LENGTH);
+          for (auto& account : instruction.accounts) {
+            key.append((const char*)account.pubkey.bytes.data(), PUBLIC_KEY_LENGTH);
+            key.push_back((char)((account.is_signer ? 1 : 0) | (account.is_writable ? 2 : 0)));
+          }
+          uint32_t length = (uint32_t)instruction.data.size();
+          key.append((const char*)&length, sizeof(length));
+        }
+        return key;
+      }
+
+      /**
+       * Returns the cached limit of the transaction's template, if it was sized before.
+       *
+       * @param transaction The transaction
+       */
+      std::optional<uint32_t> cached(const Transaction& transaction) const {
+        auto it = _limits.find(template_key(transaction));
+        if (it == _limits.end()) {
+          return std::nullopt;
+        }
+        return it->second;
+      }
+
+      /**
+       * Caches the limit of the transaction's template from the compute units it consumed.
+       *
+       * @param transaction The transaction
+       * @param units_consumed The compute units consumed by a simulation
+       *
+       * @return The limit, the consumed units plus headroom
+       */
+      uint32_t record(const Transaction& transaction, uint64_t units_consumed) {
+        uint64_t limit = units_consumed + (uint64_t)std::ceil(units_consumed * _headroom);
+        uint32_t units = (uint32_t)std::min<uint64_t>(limit, MAX_COMPUTE_UNIT_LIMIT);
+        _limits[template_key(transaction)] = units;
+        return units;
+      }
+
+      /**
+       * Returns the limit of the transaction's template, simulating the transaction with the maximum limit the first
+       * time. The simulation runs with replaceRecentBlockhash and without signature verification, so the transaction
+       * does not need a fresh blockhash.
+       *
+       * @param connection The connection to simulate with
+       * @param transaction The transaction
+       * @param signers The keypairs to sign the simulated transaction
+       */
+      uint32_t size(Connection& connection, const Transaction& transaction, const std::vector<Keypair>& signers) {
+        auto limit = cached(transaction);
+        if (limit) {
+          return *limit;
+        }
+
+        Transaction simulated = transaction;
+        set_compute_budget(simulated, MAX_COMPUTE_UNIT_LIMIT, 0);
+        auto response = connection.simulate_transaction(base64::encode(simulated.sign(signers)), true).unwrap();
+        if (!response.err.empty()) {
+          throw std::runtime_error("Simulation failed: " + response.err);
+        }
+        return record(transaction, response.units_consumed);
+      }
+    };
+
+  } // namespace compute_budget
+
+  /**
+   * Live totals per mint across a set of token accounts and owner system accounts.
+   *
+   * Token amounts are decoded from the raw account data of every notification and applied as a delta to the mint's
+   * total. Lamports of the owner accounts are totalled under SYSTEM_PROGRAM, the owner of system accounts.
+   */
+  class Portfolio {
+  public:
+
+    /**
+     * Called when the total of a mint crosses a threshold, in either direction.
+     */
+    typedef std::function<void(const PublicKey& mint, uint64_t previous_total, uint64_t total)> ThresholdCallback;
+
+  private:
+
+    struct Holding {
+      PublicKey mint;
+      uint64_t amount;
+    };
+
+    struct Threshold {
+      uint64_t value;
+      ThresholdCallback callback;
+    };
+
+    std::map<PublicKey, Holding> _holdings;
+    std::map<PublicKey, uint64_t> _totals;
+    std::map<PublicKey, std::vector<Threshold>> _thresholds;
+    std::vector<uint8_t> _data;
+
+    void apply(const PublicKey& account, const PublicKey& mint, uint64_t amount) {
+      Holding& holding = _holdings.try_emplace(account, Holding{mint, 0}).first->second;
+      if (!(holding.mint == mint)) {
+        // Closed and reopened for another mint
+        set_total(holding.mint, _totals[holding.mint] - holding.amount);
+        holding.mint = mint;
+        holding.amount = 0;
+      }
+      uint64_t total = _totals[mint];
+      set_total(mint, total - holding.amount + amount);
+      holding.amount = amount;
+    }
+
+    void set_total(const PublicKey& mint, uint64_t total) {
+      uint64_t& current = _totals[mint];
+      uint64_t previous = current;
+      current = total;
+      auto it = _thresholds.find(mint);
+      if (it == _thresholds.end() || previous == total) {
+        return;
+      }
+      for (auto& threshold : it->second) {
+        if ((previous < threshold.value) != (total < threshold.value)) {
+          threshold.callback(mint, previous, total);
+        }
+      }
+    }
+
+  public:
+
+    /**
+     * Returns the total amount of a mint, without decimals, or the total lamports for SYSTEM_PROGRAM.
+     *
+     * @param mint The mint to query
+     */
+    uint64_t total(const PublicKey& mint) const {
+      auto it = _totals.find(mint);
+      return it == _totals.end() ? 0 : it->second;
+    }
+
+    /**
+     * Returns the totals of every mint.
+     */
+    const std::map<PublicKey, uint64_t>& totals() const {
+      return _totals;
+    }
+
+    /**
+     * Registers a callback for when the total of a mint crosses a value.
+     *
+     * @param mint The mint to watch, or SYSTEM_PROGRAM for lamports
+     * @param value The threshold
+     * @param callback The callback function
+     */
+    void on_threshold(const PublicKey& mint, uint64_t value, ThresholdCallback callback) {
+      _thresholds[mint].push_back({value, callback});
+    }
+
+    /**
+     * Applies a new version of a token account.
+     *
+     * @param account The token account's Pubkey
+     * @param data The raw account data, empty if the account was closed
+     * @param length The length of the account data
+     */
+    void update_token_account(const PublicKey& account, const uint8_t* data, size_t length) {
+      if (length < token::ACCOUNT_SIZE) {
+        auto it = _holdings.find(account);
+        if (it != _holdings.end()) {
+          apply(account, it->second.mint, 0);
+        }
+        return;
+      }
+      token::AccountView view{data};
+      apply(account, view.mint(), view.amount());
+    }
+
+    /**
+     * Applies a new balance of an owner's system account.
+     *
+     * @param owner The owner's Pubkey
+     * @param lamports The balance in lamports
+     */
+    void update_owner(const PublicKey& owner, uint64_t lamports) {
+      apply(owner, SYSTEM_PROGRAM, lamports);
+    }
+
+    /**
+     * Subscribes to a token account.
+     *
+     * @param connection The connection to subscribe with
+     * @param account The token account's Pubkey
+     *
+     * @return The subscription ID
+     */
+    int subscribe_token_account(Connection& connection, const PublicKey& account) {
+      return connection.on_account_change(account, [this, account](Result<Account> result) {
+        if (result.ok()) {
+          size_t length = base64::decode(result._result->data, _data);
+          update_token_account(account, _data.data(), length);
+        } else {
+          update_token_account(account, nullptr, 0);
+        }
+      });
+    }
+
+    /**
+     * Loads the owner's balance and token accounts once, then subscribes to each of them.
+     *
+     * @param connection The connection to query and subscribe with
+     * @param owner The owner's Pubkey
+     *
+     * @return The subscription IDs
+     */
+    std::vector<int> subscribe_owner(Connection& connection, const PublicKey& owner) {
+      std::vector<int> subscriptions;
+
+      update_owner(owner, connection.get_balance(owner).unwrap());
+      subscriptions.push_back(connection.on_account_change(owner, [this, owner](Result<Account> result) {
+        update_owner(owner, result.ok() ? result._result->lamports : 0);
+      }));
+
+      for (auto& token_account : connection.get_token_accounts_by_owner(owner).unwrap()) {
+        const auto& info = token_account.account.data.parsed.info;
+        apply(token_account.pubkey, info.mint, info.token_amount.amount);
+        subscriptions.push_back(subscribe_token_account(connection, token_account.pubkey));
+      }
+      return subscriptions;
+    }
+  };
+
+  namespace openbook {
+
+    /** Offset of the slab header, after the 5 byte "serum" padding and the 8 byte account flags */
+    const size_t SLAB_HEADER_OFFSET = 13;
+    /** Offset of the first slab node */
+    const size_t SLAB_NODES_OFFSET = SLAB_HEADER_OFFSET + 32;
+    /** Size of a slab node */
+    const size_t SLAB_NODE_SIZE = 72;
+    /** Size of the trailing "padding" */
+    const size_t SLAB_TAIL_SIZE = 7;
+
+    enum class NodeTag : uint32_t {
+      Uninitialized = 0,
+      Inner = 1,
+      Leaf = 2,
+      Free = 3,
+      LastFree = 4,
+    };
+
+    enum class Side {
+      Bid,
+      Ask,
+    };
+
+    struct Order {
+      /** The critbit key, price in the upper 64 bits and sequence number in the lower 64 bits */
+      __uint128_t key;
+      /** Price in quote lots per base lot */
+      uint64_t price;
+      /** Quantity in base lots */
+      uint64_t quantity;
+      /** The open orders account that owns the order */
+      PublicKey owner;
+      /** The slot of the order in the open orders account */
+      uint8_t owner_slot;
+      /** The fee tier of the owner */
+      uint8_t fee_tier;
+      /** The client supplied order id */
+      uint64_t client_order_id;
+    };
+
+    struct PriceLevel {
+      /** Price in quote lots per base lot */
+      uint64_t price;
+      /** Total quantity in base lots */
+      uint64_t quantity;
+      /** Number of orders at this price */
+      uint32_t orders;
+    };
+
+    /**
+     * One side (bids or asks) of an OpenBook/Serum market, decoded from the critbit slab of the side's account.
+     *
+     * The first update walks the tree from the root. Later updates diff the slab against the previous bytes and only
+     * re-decode the nodes that changed, so the work is proportional to the number of changed nodes.
+     */
+    class OrderBookSide {
+      struct Compare {
+        bool descending;
+
+        bool operator()(const __uint128_t& a, const __uint128_t& b) const {
+          return descending ? a > b : a < b;
+        }
+
+        bool operator()(const uint64_t& a, const uint64_t& b) const {
+          return descending ? a > b : a < b;
+        }
+      };
+
+      Side _side;
+      std::map<__uint128_t, Order, Compare> _orders;
+      std::map<uint64_t, PriceLevel, Compare> _levels;
+
+      std::vector<uint8_t> _previous;
+      std::vector<uint8_t> _data;
+      std::vector<diff::ByteRange> _ranges;
+      std::vector<size_t> _changed_nodes;
+      /** Key of the leaf stored in each node, valid only where _is_leaf is set */
+      std::vector<__uint128_t> _node_keys;
+      std::vector<bool> _is_leaf;
+      /** The node that owns each order, the last one its key was decoded from */
+      std::map<__uint128_t, size_t> _owners;
+      bool _loaded = false;
+
+      static NodeTag tag(const uint8_t* node) {
+        return (NodeTag)endian::read_le<uint32_t>(node);
+      }
+
+      static Order decode_leaf(const uint8_t* node) {
+        Order order;
+        order.owner_slot = node[4];
+        order.fee_tier = node[5];
+        order.key = endian::read_le<__uint128_t>(&node[8]);
+        order.price = (uint64_t)(order.key >> 64);
+        order.owner = PublicKey(&node[24]);
+        order.quantity = endian::read_le<uint64_t>(&node[56]);
+        order.client_order_id = endian::read_le<uint64_t>(&node[64]);
+        return order;
+      }
+
+      static size_t node_count(size_t length) {
+        if (length < SLAB_NODES_OFFSET + SLAB_TAIL_SIZE) {
+          return 0;
+        }
+        return (length - SLAB_NODES_OFFSET - SLAB_TAIL_SIZE) / SLAB_NODE_SIZE;
+      }
+
+      void insert(size_t index, const uint8_t* node) {
+        Order order = decode_leaf(node);
+        auto level = _levels.try_emplace(order.price, PriceLevel{order.price, 0, 0}).first;
+        auto [existing, inserted] = _orders.try_emplace(order.key, order);
+        if (inserted) {
+          level->second.quantity += order.quantity;
+          level->second.orders += 1;
+        } else {
+          // The same key in another node, overwrite the order in place (the price is part of the key, so the level is the same)
+          level->second.quantity = level->second.quantity - existing->second.quantity + order.quantity;
+          existing->second = order;
+        }
+        auto [owner, owned] = _owners.try_emplace(order.key, index);
+        if (!owned && owner->second != index) {
+          // The previous node no longer owns the order, freeing it later must not remove it
+          _is_leaf[owner->second] = false;
+          owner->second = index;
+        }
+        _node_keys[index] = order.key;
+        _is_leaf[index] = true;
+      }
+
+      /** Removes the order of a leaf node, if the node still owns it */
+      void remove(size_t index) {
+        __uint128_t key = _node_keys[index];
+        _is_leaf[index] = false;
+        auto owner = _owners.find(key);
+        if (owner == _owners.end() || owner->second != index) {
+          return;
+        }
+        _owners.erase(owner);
+        auto order = _orders.find(key);
+        if (order == _orders.end()) {
+          return;
+        }
+        auto level = _levels.find(order->second.price);
+        ASSERT(level != _levels.end());
+        level->second.quantity -= order->second.quantity;
+        level->second.orders -= 1;
+        if (level->second.orders == 0) {
+          _levels.erase(level);
+        }
+        _orders.erase(order);
+      }
+
+      void load(const uint8_t* data, size_t length) {
+        _orders.clear();
+        _levels.clear();
+        _owners.clear();
+        size_t count = node_count(length);
+        _node_keys.assign(count, 0);
+        _is_leaf.assign(count, false);
+        _loaded = true;
+
+        if (count == 0 || endian::read_le<uint64_t>(&data[SLAB_HEADER_OFFSET + 24]) == 0) {
+          return;
+        }
+
+        std::vector<uint32_t> stack = { endian::read_le<uint32_t>(&data[SLAB_HEADER_OFFSET + 20]) };
+        while (!stack.empty()) {
+          uint32_t index = stack.back();
+          stack.pop_back();
+          if (index >= count) {
+            throw std::runtime_error("Slab node index out of range");
+          }
+          const uint8_t* node = &data[SLAB_NODES_OFFSET + index * SLAB_NODE_SIZE];
+          switch (tag(node)) {
+            case NodeTag::Inner:
+              stack.push_back(endian::read_le<uint32_t>(&node[24]));
+              stack.push_back(endian::read_le<uint32_t>(&node[28]));
+              break;
+            case NodeTag::Leaf:
+              insert(index, node);
+              break;
+            default:
+              throw std::runtime_error("Unexpected slab node tag");
+          }
+        }
+      }
+
+    public:
+
+      OrderBookSide(Side side)
+        : _side(side),
+        _orders(Compare{side == Side::Bid}),
+        _levels(Compare{side == Side::Bid})
+      {}
+
+      Side side() const {
+        return _side;
+      }
+
+      /**
+       * Applies a new version of the slab account data.
+       *
+       * @param data The raw account data
+       * @param length The length of the account data
+       */
+      void update(const uint8_t* data, size_t length) {
+        if (!_loaded || length != _previous.size()) {
+          load(data, length);
+          _previous.assign(data, data + length);
+          return;
+        }
+
+        _ranges.clear();
+        diff::changed_ranges(_previous.data(), data, length, _ranges);
+        if (_ranges.empty()) {
+          return;
+        }
+
+        size_t count = _node_keys.size();
+        if (count == 0) {
+          memcpy(_previous.data(), data, length);
+          return;
+        }
+
+        _changed_nodes.clear();
+        for (auto& range : _ranges) {
+          if (range.end <= SLAB_NODES_OFFSET) {
+            continue;
+          }
+          size_t first = (std::max(range.start, SLAB_NODES_OFFSET) - SLAB_NODES_OFFSET) / SLAB_NODE_SIZE;
+          size_t last = std::min((range.end - 1 - SLAB_NODES_OFFSET) / SLAB_NODE_SIZE, count - 1);
+          for (size_t index = first; index <= last && index < count; index++) {
+            if (_changed_nodes.empty() || _changed_nodes.back() != index) {
+              _changed_nodes.push_back(index);
+            }
+          }
+        }
+
+        // Remove every changed leaf before inserting, since an order can move between nodes in a single update
+        for (size_t index : _changed_nodes) {
+          if (_is_leaf[index]) {
+            remove(index);
+          }
+        }
+        for (size_t index : _changed_nodes) {
+          const uint8_t* node = &data[SLAB_NODES_OFFSET + index * SLAB_NODE_SIZE];
+          if (tag(node) == NodeTag::Leaf) {
+            insert(index, node);
+          }
+        }
+
+        memcpy(_previous.data(), data, length);
+      }
+
+      /**
+       * Applies a new version of the slab account.
+       *
+       * @param account The account, with base64 encoded data
+       */
+      void update(const Account& account) {
+        size_t length = base64::decode(account.data, _data);
+        update(_data.data(), length);
+      }
+
+      /**
+       * Returns the best price level, or nullptr if the side is empty.
+       */
+      const PriceLevel* best() const {
+        return _levels.empty() ? nullptr : &_levels.begin()->second;
+      }
+
+      /**
+       * Returns the price levels (L2), best first.
+       */
+      const std::map<uint64_t, PriceLevel, Compare>& levels() const {
+        return _levels;
+      }
+
+      /**
+       * Returns the orders (L3), in price-time priority.
+       */
+      const std::map<__uint128_t, Order, Compare>& orders() const {
+        return _orders;
+      }
+    };
+
+    struct OrderBook {
+      OrderBookSide bids = OrderBookSide(Side::Bid);
+      OrderBookSide asks = OrderBookSide(Side::Ask);
+    };
+
+  } // namespace openbook
+
+  namespace amm {
+
+    struct Quote {
+      /** Amount of the input token consumed, including fees */
+      uint64_t amount_in;
+      /** Amount of the output token received */
+      uint64_t amount_out;
+      /** Part of amount_in paid as fees */
+      uint64_t fee;
+    };
+
+    /**
+     * A constant product pool of the SPL Token Swap program (and forks with the same layout).
+     *
+     * Quotes use the same u128 integer math and fee rounding as the program, so they match the on-chain result exactly
+     * given the same vault balances.
+     */
+    struct ConstantProductPool {
+      /** Size of the SwapV1 account data */
+      static const size_t SIZE = 324;
+
+      PublicKey token_a_vault;
+      PublicKey token_b_vault;
+      PublicKey pool_mint;
+      PublicKey token_a_mint;
+      PublicKey token_b_mint;
+      struct Fees {
+        uint64_t trade_fee_numerator;
+        uint64_t trade_fee_denominator;
+        uint64_t owner_trade_fee_numerator;
+        uint64_t owner_trade_fee_denominator;
+      } fees;
+      /** Balance of the token A vault */
+      uint64_t reserve_a = 0;
+      /** Balance of the token B vault */
+      uint64_t reserve_b = 0;
+
+      /**
+       * Decodes a SwapV1 account.
+       *
+       * @throws error if the account is not an initialized constant product pool
+       *
+       * @param data The raw account data
+       * @param length The length of the account data
+       */
+      static ConstantProductPool decode(const uint8_t* data, size_t length) {
+        if (length < SIZE || data[0] != 1 || data[1] != 1) {
+          throw std::runtime_error("Invalid token swap account");
+        }
+        if (data[291] != 0) {
+          throw std::runtime_error("Unsupported swap curve");
+        }
+        ConstantProductPool pool;
+        pool.token_a_vault = PublicKey(&data[35]);
+        pool.token_b_vault = PublicKey(&data[67]);
+        pool.pool_mint = PublicKey(&data[99]);
+        pool.token_a_mint = PublicKey(&data[131]);
+        pool.token_b_mint = PublicKey(&data[163]);
+        pool.fees.trade_fee_numerator = endian::read_le<uint64_t>(&data[227]);
+        pool.fees.trade_fee_denominator = endian::read_le<uint64_t>(&data[235]);
+        pool.fees.owner_trade_fee_numerator = endian::read_le<uint64_t>(&data[243]);
+        pool.fees.owner_trade_fee_denominator = endian::read_le<uint64_t>(&data[251]);
+        return pool;
+      }
+
+      /**
+       * Reads the vault balances from the account cache, returning false if either vault is not cached.
+       *
+       * @param cache The cache mirroring the vault accounts
+       */
+      bool update_reserves(const AccountCache& cache) {
+        const AccountCache::Entry* a = cache.get(token_a_vault);
+        const AccountCache::Entry* b = cache.get(token_b_vault);
+        if (a == nullptr || b == nullptr || a->data.size() < token::ACCOUNT_SIZE || b->data.size() < token::ACCOUNT_SIZE) {
+          return false;
+        }
+        reserve_a = token::AccountView{a->data.data()}.amount();
+        reserve_b = token::AccountView{b->data.data()}.amount();
+        return true;
+      }
+
+      static __uint128_t fee(__uint128_t amount, __uint128_t numerator, __uint128_t denominator) {
+        if (numerator == 0 || amount == 0) {
+          return 0;
+        }
+        __uint128_t fee = amount * numerator / denominator;
+        return fee == 0 ? 1 : fee;
+      }
+
+      /**
+       * Quotes a swap with an exact input amount.
+       *
+       * @param amount_in The amount of the input token
+       * @param a_to_b True to swap token A for token B
+       */
+      Quote quote(uint64_t amount_in, bool a_to_b) const {
+        Quote result;
+        quote(&amount_in, &result, 1, a_to_b);
+        return result;
+      }
+
+      /**
+       * Quotes many input sizes at once. The pool invariant is computed once for the whole batch.
+       *
+       * @param amounts_in The amounts of the input token
+       * @param quotes Receives one quote per input amount, zeroed where the program would reject the swap
+       * @param count The number of amounts
+       * @param a_to_b True to swap token A for token B
+       */
+      void quote(const uint64_t* amounts_in, Quote* quotes, size_t count, bool a_to_b) const {
+        const __uint128_t source_reserve = a_to_b ? reserve_a : reserve_b;
+        const __uint128_t destination_reserve = a_to_b ? reserve_b : reserve_a;
+        const __uint128_t invariant = source_reserve * destination_reserve;
+
+        for (size_t i = 0; i < count; i++) {
+          quotes[i] = {0, 0, 0};
+          __uint128_t source_amount = amounts_in[i];
+          __uint128_t total_fees = fee(source_amount, fees.trade_fee_numerator, fees.trade_fee_denominator)
+            + fee(source_amount, fees.owner_trade_fee_numerator, fees.owner_trade_fee_denominator);
+          if (total_fees > source_amount || invariant == 0) {
+            continue;
+          }
+          __uint128_t new_source = source_reserve + (source_amount - total_fees);
+
+          // checked_ceil_div from spl-math: rounds the new destination balance up, then shrinks the source to match
+          __uint128_t new_destination = invariant / new_source;
+          if (new_destination == 0) {
+            continue;
+          }
+          if (invariant % new_source > 0) {
+            new_destination += 1;
+            new_source = invariant / new_destination;
+            if (invariant % new_destination > 0) {
+              new_source += 1;
+            }
+          }
+
+          if (new_destination >= destination_reserve) {
+            continue;
+          }
+          quotes[i].amount_in = (uint64_t)(new_source - source_reserve + total_fees);
+          quotes[i].amount_out = (uint64_t)(destination_reserve - new_destination);
+          quotes[i].fee = (uint64_t)total_fees;
+        }
+      }
+    };
+
+    /** Lowest sqrt price supported by Whirlpools, as Q64.64 */
+    const __uint128_t MIN_SQRT_PRICE_X64 = 4295048016;
+    /** Highest sqrt price supported by Whirlpools, as Q64.64 */
+    const __uint128_t MAX_SQRT_PRICE_X64 = ((__uint128_t)4294886577 << 64) | 3871828160200520623ULL;
+    /** Fee rates are in hundredths of a basis point */
+    const uint64_t FEE_RATE_DENOMINATOR = 1000000;
+
+    /**
+     * A concentrated liquidity pool of the Orca Whirlpool program.
+     *
+     * Quotes follow the program's swap step math (Q64.64 sqrt prices, 256-bit intermediates, same rounding). The pool
+     * account alone only describes the active tick range, so a quote is exact while the swap stays within it; pass the
+     * sqrt price of the next initialized tick as the limit to stop a quote there.
+     */
+    struct ConcentratedLiquidityPool {
+      /** Minimum size of the Whirlpool account data */
+      static const size_t SIZE = 261;
+
+      uint16_t tick_spacing;
+      uint16_t fee_rate;
+      uint16_t protocol_fee_rate;
+      __uint128_t liquidity;
+      __uint128_t sqrt_price;
+      int32_t tick_current_index;
+      PublicKey token_mint_a;
+      PublicKey token_vault_a;
+      PublicKey token_mint_b;
+      PublicKey token_vault_b;
+      /** Balance of the token A vault */
+      uint64_t reserve_a = 0;
+      /** Balance of the token B vault */
+      uint64_t reserve_b = 0;
+
+      /**
+       * Decodes a Whirlpool account.
+       *
+       * @throws error if the account is too small
+       *
+       * @param data The raw account data
+       * @param length The length of the account data
+       */
+      static ConcentratedLiquidityPool decode(const uint8_t* data, size_t length) {
+        if (length < SIZE) {
+          throw std::runtime_error("Invalid whirlpool account");
+        }
+        ConcentratedLiquidityPool pool;
+        pool.tick_spacing = endian::read_le<uint16_t>(&data[41]);
+        pool.fee_rate = endian::read_le<uint16_t>(&data[45]);
+        pool.protocol_fee_rate = endian::read_le<uint16_t>(&data[47]);
+        pool.liquidity = endian::read_le<__uint128_t>(&data[49]);
+        pool.sqrt_price = endian::read_le<__uint128_t>(&data[65]);
+        pool.tick_current_index = endian::read_le<int32_t>(&data[81]);
+        pool.token_mint_a = PublicKey(&data[101]);
+        pool.token_vault_a = PublicKey(&data[133]);
+        pool.token_mint_b = PublicKey(&data[181]);
+        pool.token_vault_b = PublicKey(&data[213]);
+        return pool;
+      }
+
+      /**
+       * Reads the vault balances from the account cache, returning false if either vault is not cached.
+       *
+       * @param cache The cache mirroring the vault accounts
+       */
+      bool update_reserves(const AccountCache& cache) {
+        const AccountCache::Entry* a = cache.get(token_vault_a);
+        const AccountCache::Entry* b = cache.get(token_vault_b);
+        if (a == nullptr || b == nullptr || a->data.size() < token::ACCOUNT_SIZE || b->data.size() < token::ACCOUNT_SIZE) {
+          return false;
+        }
+        reserve_a = token::AccountView{a->data.data()}.amount();
+        reserve_b = token::AccountView{b->data.data()}.amount();
+        return true;
+      }
+
+      /**
+       * Amount of token A between two sqrt prices, or nullopt if it exceeds a u64.
+       */
+      static std::optional<uint64_t> amount_delta_a(__uint128_t sqrt_price_0, __uint128_t sqrt_price_1, __uint128_t liquidity, bool round_up) {
+        __uint128_t lower = std::min(sqrt_price_0, sqrt_price_1);
+        __uint128_t upper = std::max(sqrt_price_0, sqrt_price_1);
+        math::uint256 numerator = math::uint256::mul(liquidity, upper - lower);
+        if (!numerator.shift_word_left()) {
+          return std::nullopt;
+        }
+        math::uint256 result = numerator.div(math::uint256::mul(upper, lower), round_up);
+        if (!result.fits_u128() || result.low_u128() > UINT64_MAX) {
+          return std::nullopt;
+        }
+        return (uint64_t)result.low_u128();
+      }
+
+      /**
+       * Amount of token B between two sqrt prices, or nullopt if it exceeds a u64.
+       */
+      static std::optional<uint64_t> amount_delta_b(__uint128_t sqrt_price_0, __uint128_t sqrt_price_1, __uint128_t liquidity, bool round_up) {
+        __uint128_t lower = std::min(sqrt_price_0, sqrt_price_1);
+        __uint128_t upper = std::max(sqrt_price_0, sqrt_price_1);
+        math::uint256 product = math::uint256::mul(liquidity, upper - lower);
+        bool remainder = product.shift_word_right() != 0;
+        if (!product.fits_u128()) {
+          return std::nullopt;
+        }
+        __uint128_t result = product.low_u128() + ((round_up && remainder) ? 1 : 0);
+        if (result > UINT64_MAX) {
+          return std::nullopt;
+        }
+        return (uint64_t)result;
+      }
+
+      static std::optional<__uint128_t> next_sqrt_price_from_a_round_up(__uint128_t sqrt_price, __uint128_t liquidity, uint64_t amount) {
+        if (amount == 0) {
+          return sqrt_price;
+        }
+        math::uint256 product = math::uint256::mul(sqrt_price, amount);
+        math::uint256 numerator = math::uint256::mul(liquidity, sqrt_price);
+        math::uint256 denominator(liquidity);
+        if (!numerator.shift_word_left() || !denominator.shift_word_left()) {
+          return std::nullopt;
+        }
+        math::uint256 price = numerator.div(denominator + product, true);
+        if (!price.fits_u128() || price.low_u128() < MIN_SQRT_PRICE_X64) {
+          return std::nullopt;
+        }
+        return price.low_u128();
+      }
+
+      static std::optional<__uint128_t> next_sqrt_price_from_b_round_down(__uint128_t sqrt_price, __uint128_t liquidity, uint64_t amount) {
+        math::uint256 amount_x64((__uint128_t)amount << 64);
+        math::uint256 delta = amount_x64.div(math::uint256(liquidity), false);
+        if (!delta.fits_u128()) {
+          return std::nullopt;
+        }
+        __uint128_t price = sqrt_price + delta.low_u128();
+        if (price < sqrt_price || price > MAX_SQRT_PRICE_X64) {
+          return std::nullopt;
+        }
+        return price;
+      }
+
+      /**
+       * Quotes a swap with an exact input amount.
+       *
+       * @param amount_in The amount of the input token
+       * @param a_to_b True to swap token A for token B
+       * @param sqrt_price_limit The sqrt price (Q64.64) at which to stop, or 0 for the price bound in the swap direction
+       */
+      Quote quote(uint64_t amount_in, bool a_to_b, __uint128_t sqrt_price_limit = 0) const {
+        Quote result;
+        quote(&amount_in, &result, 1, a_to_b, sqrt_price_limit);
+        return result;
+      }
+
+      /**
+       * Quotes many input sizes at once. The amount needed to reach the price limit is computed once for the batch.
+       *
+       * @param amounts_in The amounts of the input token
+       * @param quotes Receives one quote per input amount, zeroed where the program would reject the swap
+       * @param count The number of amounts
+       * @param a_to_b True to swap token A for token B
+       * @param sqrt_price_limit The sqrt price (Q64.64) at which to stop, or 0 for the price bound in the swap direction
+       */
+      void quote(const uint64_t* amounts_in, Quote* quotes, size_t count, bool a_to_b, __uint128_t sqrt_price_limit = 0) const {
+        __uint128_t target = sqrt_price_limit != 0 ? sqrt_price_limit : (a_to_b ? MIN_SQRT_PRICE_X64 : MAX_SQRT_PRICE_X64);
+        bool valid_target = liquidity > 0 && (a_to_b ? target < sqrt_price : target > sqrt_price);
+
+        // Input needed to move the price all the way to the target
+        std::optional<uint64_t> max_amount_in = valid_target
+          ? (a_to_b ? amount_delta_a(sqrt_price, target, liquidity, true) : amount_delta_b(sqrt_price, target, liquidity, true))
+          : std::nullopt;
+
+        for (size_t i = 0; i < count; i++) {
+          quotes[i] = {0, 0, 0};
+          if (!valid_target || amounts_in[i] == 0) {
+            continue;
+          }
+
+          uint64_t amount_remaining = amounts_in[i];
+          uint64_t amount_calc = (uint64_t)((__uint128_t)amount_remaining * (FEE_RATE_DENOMINATOR - fee_rate) / FEE_RATE_DENOMINATOR);
+
+          bool is_max_swap = max_amount_in.has_value() && max_amount_in.value() <= amount_calc;
+          std::optional<__uint128_t> next_sqrt_price = target;
+          if (!is_max_swap) {
+            next_sqrt_price = a_to_b
+              ? next_sqrt_price_from_a_round_up(sqrt_price, liquidity, amount_calc)
+              : next_sqrt_price_from_b_round_down(sqrt_price, liquidity, amount_calc);
+            if (!next_sqrt_price.has_value()) {
+              continue;
+            }
+            is_max_swap = next_sqrt_price.value() == target;
+          }
+
+          std::optional<uint64_t> amount_out = a_to_b
+            ? amount_delta_b(sqrt_price, next_sqrt_price.value(), liquidity, false)
+            : amount_delta_a(sqrt_price, next_sqrt_price.value(), liquidity, false);
+          std::optional<uint64_t> amount_fixed = (is_max_swap && max_amount_in.has_value())
+            ? max_amount_in
+            : (a_to_b
+              ? amount_delta_a(sqrt_price, next_sqrt_price.value(), liquidity, true)
+              : amount_delta_b(sqrt_price, next_sqrt_price.value(), liquidity, true));
+          if (!amount_out.has_value() || !amount_fixed.has_value()) {
+            continue;
+          }
+
+          uint64_t fee;
+          if (!is_max_swap) {
+            fee = amount_remaining - amount_fixed.value();
+          } else {
+            __uint128_t numerator = (__uint128_t)amount_fixed.value() * fee_rate;
+            __uint128_t denominator = FEE_RATE_DENOMINATOR - fee_rate;
+            fee = (uint64_t)((numerator + denominator - 1) / denominator);
+          }
+
+          quotes[i].amount_in = amount_fixed.value() + fee;
+          quotes[i].amount_out = amount_out.value();
+          quotes[i].fee = fee;
+        }
+      }
+    };
+
+    /**
+     * Finds the best 1 to 3 hop routes between two mints over a set of mirrored pools.
+     *
+     * Mints are the vertices and every pool adds an edge in each direction. Pools are updated one at a time as their
+     * pool or vault accounts change, so the graph never has to be rebuilt. Searches must not run concurrently with
+     * updates.
+     */
+    class Router {
+    public:
+
+      struct Pool {
+        enum class Type {
+          ConstantProduct,
+          ConcentratedLiquidity,
+        } type;
+        PublicKey address;
+        PublicKey mint_a;
+        PublicKey mint_b;
+        ConstantProductPool constant_product;
+        ConcentratedLiquidityPool concentrated_liquidity;
+
+        uint64_t quote(uint64_t amount_in, bool a_to_b) const {
+          return type == Type::ConstantProduct
+            ? constant_product.quote(amount_in, a_to_b).amount_out
+            : concentrated_liquidity.quote(amount_in, a_to_b).amount_out;
+        }
+      };
+
+      struct Hop {
+        /** Index of the pool, see pool() */
+        uint32_t pool;
+        /** True if the hop swaps the pool's token A for token B */
+        bool a_to_b;
+        /** Amount received from this hop */
+        uint64_t amount_out;
+      };
+
+      struct Route {
+        uint64_t amount_in;
+        uint64_t amount_out;
+        std::vector<Hop> hops;
+      };
+
+    private:
+
+      struct Edge {
+        uint32_t pool;
+        bool a_to_b;
+        uint32_t to;
+      };
+
+      std::vector<Pool> _pools;
+      std::map<PublicKey, uint32_t> _mint_ids;
+      std::vector<std::vector<Edge>> _edges;
+      /** Pools to update when a pool or vault account changes */
+      std::map<PublicKey, std::vector<uint32_t>> _pools_by_account;
+      threading::ThreadPool& _threads;
+
+      uint32_t mint_id(const PublicKey& mint) {
+        auto it = _mint_ids.find(mint);
+        if (it != _mint_ids.end()) {
+          return it->second;
+        }
+        uint32_t id = (uint32_t)_edges.size();
+        _mint_ids[mint] = id;
+        _edges.emplace_back();
+        return id;
+      }
+
+      /** Edges are kept sorted by destination, so the last hop of a route only visits the edges to the target */
+      void insert_edge(uint32_t from, const Edge& edge) {
+        auto& edges = _edges[from];
+        edges.insert(std::upper_bound(edges.begin(), edges.end(), edge, [](const Edge& a, const Edge& b) {
+          return a.to < b.to;
+        }), edge);
+      }
+
+      std::pair<std::vector<Edge>::const_iterator, std::vector<Edge>::const_iterator> edges_to(uint32_t from, uint32_t to) const {
+        return std::equal_range(_edges[from].begin(), _edges[from].end(), Edge{0, false, to}, [](const Edge& a, const Edge& b) {
+          return a.to < b.to;
+        });
+      }
+
+      uint32_t add(Pool pool, const PublicKey& vault_a, const PublicKey& vault_b) {
+        uint32_t index = (uint32_t)_pools.size();
+        uint32_t a = mint_id(pool.mint_a);
+        uint32_t b = mint_id(pool.mint_b);
+        insert_edge(a, {index, true, b});
+        insert_edge(b, {index, false, a});
+        _pools_by_account[pool.address].push_back(index);
+        _pools_by_account[vault_a].push_back(index);
+        _pools_by_account[vault_b].push_back(index);
+        _pools.push_back(pool);
+        _estimates.emplace_back();
+        update_estimate(index);
+        return index;
+      }
+
+      /** A path ranked by its estimated output */
+      struct Candidate {
+        double amount_out;
+        Edge edges[3];
+        size_t hop_count;
+      };
+
+      /** Floating point pool parameters for cheap output estimates */
+      struct Estimate {
+        Pool::Type type;
+        double reserve_a;
+        double reserve_b;
+        double fee_factor;
+        double liquidity;
+        double sqrt_price;
+
+        double estimate(double amount_in, bool a_to_b) const {
+          double x = amount_in * fee_factor;
+          if (type == Pool::Type::ConstantProduct) {
+            double reserve_in = a_to_b ? reserve_a : reserve_b;
+            double reserve_out = a_to_b ? reserve_b : reserve_a;
+            return reserve_out * x / (reserve_in + x);
+          }
+          if (liquidity <= 0 || sqrt_price <= 0) {
+            return 0;
+          }
+          if (a_to_b) {
+            double next_sqrt_price = liquidity * sqrt_price / (liquidity + x * sqrt_price);
+            return liquidity * (sqrt_price - next_sqrt_price);
+          }
+          double next_sqrt_price = sqrt_price + x / liquidity;
+          return liquidity * (1 / sqrt_price - 1 / next_sqrt_price);
+        }
+      };
+
+      std::vector<Estimate> _estimates;
+
+      void update_estimate(uint32_t index) {
+        const Pool& pool = _pools[index];
+        Estimate& estimate = _estimates[index];
+        estimate.type = pool.type;
+        if (pool.type == Pool::Type::ConstantProduct) {
+          const auto& fees = pool.constant_product.fees;
+          estimate.reserve_a = (double)pool.constant_product.reserve_a;
+          estimate.reserve_b = (double)pool.constant_product.reserve_b;
+          estimate.fee_factor = 1.0
+            - (fees.trade_fee_denominator ? (double)fees.trade_fee_numerator / fees.trade_fee_denominator : 0)
+            - (fees.owner_trade_fee_denominator ? (double)fees.owner_trade_fee_numerator / fees.owner_trade_fee_denominator : 0);
+        } else {
+          const auto& clmm = pool.concentrated_liquidity;
+          estimate.liquidity = (double)clmm.liquidity;
+          estimate.sqrt_price = (double)clmm.sqrt_price / 18446744073709551616.0;
+          estimate.fee_factor = 1.0 - (double)clmm.fee_rate / FEE_RATE_DENOMINATOR;
+        }
+      }
+
+      template <typename T, typename Less>
+      static void keep_best(std::vector<T>& items, T&& item, size_t k, Less less) {
+        auto it = std::upper_bound(items.begin(), items.end(), item, less);
+        if ((size_t)(it - items.begin()) >= k) {
+          return;
+        }
+        items.insert(it, std::move(item));
+        if (items.size() > k) {
+          items.pop_back();
+        }
+      }
+
+      static void keep_best(std::vector<Route>& routes, Route&& route, size_t k) {
+        keep_best(routes, std::move(route), k, [](const Route& a, const Route& b) {
+          return a.amount_out > b.amount_out;
+        });
+      }
+
+      static void keep_best(std::vector<Candidate>& candidates, Candidate&& candidate, size_t k) {
+        keep_best(candidates, std::move(candidate), k, [](const Candidate& a, const Candidate& b) {
+          return a.amount_out > b.amount_out;
+        });
+      }
+
+    public:
+
+      /**
+       * @param threads The workers to spread searches over
+       */
+      Router(threading::ThreadPool& threads) : _threads(threads) {}
+
+      /**
+       * Adds a constant product pool, returning its index.
+       *
+       * @param address The pool account's Pubkey
+       * @param pool The decoded pool
+       */
+      uint32_t add_pool(const PublicKey& address, const ConstantProductPool& pool) {
+        Pool entry = {};
+        entry.type = Pool::Type::ConstantProduct;
+        entry.address = address;
+        entry.mint_a = pool.token_a_mint;
+        entry.mint_b = pool.token_b_mint;
+        entry.constant_product = pool;
+        return add(entry, pool.token_a_vault, pool.token_b_vault);
+      }
+
+      /**
+       * Adds a concentrated liquidity pool, returning its index.
+       *
+       * @param address The pool account's Pubkey
+       * @param pool The decoded pool
+       */
+      uint32_t add_pool(const PublicKey& address, const ConcentratedLiquidityPool& pool) {
+        Pool entry = {};
+        entry.type = Pool::Type::ConcentratedLiquidity;
+        entry.address = address;
+        entry.mint_a = pool.token_mint_a;
+        entry.mint_b = pool.token_mint_b;
+        entry.concentrated_liquidity = pool;
+        return add(entry, pool.token_vault_a, pool.token_vault_b);
+      }
+
+      const Pool& pool(uint32_t index) const {
+        return _pools[index];
+      }
+
+      size_t pool_count() const {
+        return _pools.size();
+      }
+
+      size_t mint_count() const {
+        return _mint_ids.size();
+      }
+
+      /**
+       * Applies a change of a pool or vault account to the pools that use it.
+       *
+       * @param cache The cache holding the pool and vault accounts
+       * @param pubkey The account that changed
+       */
+      void update(const AccountCache& cache, const PublicKey& pubkey) {
+        auto it = _pools_by_account.find(pubkey);
+        if (it == _pools_by_account.end()) {
+          return;
+        }
+        for (uint32_t index : it->second) {
+          Pool& pool = _pools[index];
+          const AccountCache::Entry* entry = cache.get(pool.address);
+          if (pool.type == Pool::Type::ConstantProduct) {
+            if (pubkey == pool.address && entry != nullptr) {
+              auto decoded = ConstantProductPool::decode(entry->data.data(), entry->data.size());
+              decoded.reserve_a = pool.constant_product.reserve_a;
+              decoded.reserve_b = pool.constant_product.reserve_b;
+              pool.constant_product = decoded;
+            }
+            pool.constant_product.update_reserves(cache);
+          } else {
+            if (pubkey == pool.address && entry != nullptr) {
+              auto decoded = ConcentratedLiquidityPool::decode(entry->data.data(), entry->data.size());
+              decoded.reserve_a = pool.concentrated_liquidity.reserve_a;
+              decoded.reserve_b = pool.concentrated_liquidity.reserve_b;
+              pool.concentrated_liquidity = decoded;
+            }
+            pool.concentrated_liquidity.update_reserves(cache);
+          }
+          update_estimate(index);
+        }
+      }
+
+      /**
+       * Keeps the pools up to date with every update of the cache.
+       *
+       * @param cache The cache mirroring the pool and vault accounts, which must outlive the router
+       */
+      void attach(AccountCache& cache) {
+        cache.on_update([this, &cache](const PublicKey& pubkey, const AccountCache::Entry&) {
+          update(cache, pubkey);
+        });
+      }
+
+      /**
+       * Returns the best routes for an exact input amount, best first.
+       *
+       * Paths are ranked with floating point estimates first, then a shortlist of 4k paths is quoted with the exact
+       * integer math of the pools. Amounts of the returned routes are exact.
+       *
+       * @param input_mint The mint of the input token
+       * @param output_mint The mint of the output token, which may equal input_mint to search for cycles
+       * @param amount_in The amount of the input token
+       * @param k The maximum number of routes to return
+       * @param max_hops The maximum number of hops per route, from 1 to 3
+       * @param budget The time after which the search stops and returns the best routes found so far
+       */
+      std::vector<Route> search(
+        const PublicKey& input_mint,
+        const PublicKey& output_mint,
+        uint64_t amount_in,
+        size_t k = 5,
+        size_t max_hops = 3,
+        std::chrono::nanoseconds budget = std::chrono::milliseconds(1)
+      ) const {
+        ASSERT(max_hops >= 1 && max_hops <= 3);
+        std::vector<Route> best;
+        auto input = _mint_ids.find(input_mint);
+        auto output = _mint_ids.find(output_mint);
+        if (input == _mint_ids.end() || output == _mint_ids.end() || k == 0) {
+          return best;
+        }
+        const uint32_t source = input->second;
+        const uint32_t target = output->second;
+        const auto deadline = std::chrono::steady_clock::now() + budget;
+        const std::vector<Edge>& first_edges = _edges[source];
+        const size_t shortlist_size = k * 4;
+
+        std::atomic<bool> expired(false);
+        std::vector<std::vector<Candidate>> shortlists(first_edges.size());
+
+        // One task per first hop, each keeping its own shortlist
+        _threads.parallel_for(first_edges.size(), [&](size_t task) {
+          std::vector<Candidate>& shortlist = shortlists[task];
+          const Edge& first = first_edges[task];
+          double amount_1 = _estimates[first.pool].estimate(amount_in, first.a_to_b);
+          if (amount_1 <= 0) {
+            return;
+          }
+          if (first.to == target) {
+            keep_best(shortlist, Candidate{amount_1, {first}, 1}, shortlist_size);
+            return;
+          }
+          if (max_hops == 1) {
+            return;
+          }
+
+          size_t expansions = 0;
+          auto out_of_time = [&]() {
+            if (expired.load(std::memory_order_relaxed)) {
+              return true;
+            }
+            if ((++expansions & 63) == 0 && std::chrono::steady_clock::now() > deadline) {
+              expired.store(true, std::memory_order_relaxed);
+              return true;
+            }
+            return false;
+          };
+
+          if (max_hops == 2) {
+            auto last = edges_to(first.to, target);
+            for (auto third = last.first; third != last.second; third++) {
+              if (out_of_time()) {
+                return;
+              }
+              double amount_2 = _estimates[third->pool].estimate(amount_1, third->a_to_b);
+              keep_best(shortlist, Candidate{amount_2, {first, *third}, 2}, shortlist_size);
+            }
+            return;
+          }
+
+          for (const Edge& second : _edges[first.to]) {
+            if (out_of_time()) {
+              return;
+            }
+            if (second.to == source && source != target) {
+              continue;
+            }
+            double amount_2 = _estimates[second.pool].estimate(amount_1, second.a_to_b);
+            if (amount_2 <= 0) {
+              continue;
+            }
+            if (second.to == target) {
+              keep_best(shortlist, Candidate{amount_2, {first, second}, 2}, shortlist_size);
+              continue;
+            }
+            auto last = edges_to(second.to, target);
+            for (auto third = last.first; third != last.second; third++) {
+              double amount_3 = _estimates[third->pool].estimate(amount_2, third->a_to_b);
+              keep_best(shortlist, Candidate{amount_3, {first, second, *third}, 3}, shortlist_size);
+            }
+          }
+        });
+
+        std::vector<Candidate> candidates;
+        for (auto& shortlist : shortlists) {
+          for (auto& candidate : shortlist) {
+            keep_best(candidates, std::move(candidate), shortlist_size);
+          }
+        }
+
+        for (auto& candidate : candidates) {
+          Route route = { amount_in, amount_in, {} };
+          for (size_t i = 0; i < candidate.hop_count && route.amount_out > 0; i++) {
+            const Edge& edge = candidate.edges[i];
+            route.amount_out = _pools[edge.pool].quote(route.amount_out, edge.a_to_b);
+            route.hops.push_back({ edge.pool, edge.a_to_b, route.amount_out });
+          }
+          if (route.amount_out > 0) {
+            keep_best(best, std::move(route), k);
+          }
+        }
+        return best;
+      }
+    };
+
+  } // namespace amm
+
+  namespace oracle {
+
+    enum class PriceStatus : uint32_t {
+      Unknown = 0,
+      Trading = 1,
+      Halted = 2,
+      Auction = 3,
+      Ignored = 4,
+    };
+
+    /**
+     * Zero-copy view over a Pyth v2 price account (push oracle)
+     */
+    struct PythPriceView {
+      static const uint32_t MAGIC = 0xa1b2c3d4;
+      static const uint32_t ACCOUNT_TYPE_PRICE = 3;
+      static const size_t SIZE = 240;
+
+      const uint8_t* data;
+
+      static bool is_valid(const uint8_t* data, size_t length) {
+        return length >= SIZE
+          && endian::read_le<uint32_t>(&data[0]) == MAGIC
+          && endian::read_le<uint32_t>(&data[8]) == ACCOUNT_TYPE_PRICE;
+      }
+
+      int32_t exponent() const { return endian::read_le<int32_t>(&data[20]); }
+      uint64_t valid_slot() const { return endian::read_le<uint64_t>(&data[40]); }
+      int64_t ema_price() const { return endian::read_le<int64_t>(&data[48]); }
+      int64_t timestamp() const { return endian::read_le<int64_t>(&data[96]); }
+      PublicKey product() const { return PublicKey(&data[112]); }
+      int64_t price() const { return endian::read_le<int64_t>(&data[208]); }
+      uint64_t confidence() const { return endian::read_le<uint64_t>(&data[216]); }
+      PriceStatus status() const { return (PriceStatus)endian::read_le<uint32_t>(&data[224]); }
+      uint64_t publish_slot() const { return endian::read_le<uint64_t>(&data[232]); }
+    };
+
+    /**
+     * Zero-copy view over a Pyth PriceUpdateV2 account (pull oracle, posted by the Pyth receiver program)
+     */
+    struct PythPriceUpdateView {
+      /** Size of the account with full verification */
+      static const size_t FULL_SIZE = 133;
+      /** Size of the account with partial verification, whose variant carries the number of signatures */
+      static const size_t PARTIAL_SIZE = 134;
+      /** Anchor discriminator of the account, the first 8 bytes of sha256("account:PriceUpdateV2") */
+      static constexpr uint8_t DISCRIMINATOR[8] = {34, 241, 35, 99, 157, 126, 244, 205};
+
+      const uint8_t* data;
+
+      /** The message follows a Borsh enum at byte 40, which is one byte longer for partial verification */
+      static size_t message_offset(uint8_t verification) {
+        return verification == 0 ? 42 : 41;
+      }
+
+      size_t message_offset() const {
+        return message_offset(data[40]);
+      }
+
+      static bool is_valid(const uint8_t* data, size_t length) {
+        return length > 40 && memcmp(data, DISCRIMINATOR, sizeof(DISCRIMINATOR)) == 0 && data[40] <= 1 &&
+          length >= (data[40] == 0 ? PARTIAL_SIZE : FULL_SIZE);
+      }
+
+      /** Whether the update was checked against the full Wormhole guardian quorum rather than a subset of signatures */
+      bool fully_verified() const {
+        return data[40] == 1;
+      }
+
+      const uint8_t* feed_id() const { return &data[message_offset()]; }
+      int64_t price() const { return endian::read_le<int64_t>(&data[message_offset() + 32]); }
+      uint64_t confidence() const { return endian::read_le<uint64_t>(&data[message_offset() + 40]); }
+      int32_t exponent() const { return endian::read_le<int32_t>(&data[message_offset() + 48]); }
+      int64_t publish_time() const { return endian::read_le<int64_t>(&data[message_offset() + 52]); }
+      int64_t ema_price() const { return endian::read_le<int64_t>(&data[message_offset() + 68]); }
+      uint64_t posted_slot() const { return endian::read_le<uint64_t>(&data[message_offset() + 84]); }
+    };
+
+    struct Price {
+      /** Price in units of 10^exponent */
+      int64_t price;
+      /** Confidence interval in units of 10^exponent */
+      uint64_t confidence;
+      int32_t exponent;
+      PriceStatus status;
+      /** The slot the price was published in */
+      uint64_t publish_slot;
+      /** Unix timestamp of the price */
+      int64_t publish_time;
+      /** Number of slots since the price was published, from the cache's current slot */
+      uint64_t staleness;
+      /** False for a pull oracle update that was posted with only part of the Wormhole signatures */
+      bool fully_verified;
+
+      double value() const {
+        return (double)price * pow(10, exponent);
+      }
+    };
+
+    /**
+     * Latest price of a fixed set of feeds, written by the thread that polls the connection and readable from any
+     * thread without locks.
+     *
+     * Every feed lives in its own cache line behind a sequence lock, so a read is one cache line plus the current slot.
+     */
+    class PriceCache {
+      struct alignas(64) Slot {
+        /** Odd while a write is in progress, 0 until the first write */
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<int64_t> price{0};
+        std::atomic<uint64_t> confidence{0};
+        std::atomic<int32_t> exponent{0};
+        std::atomic<uint32_t> status{0};
+        std::atomic<uint64_t> publish_slot{0};
+        std::atomic<int64_t> publish_time{0};
+        std::atomic<bool> fully_verified{false};
+      };
+
+      const size_t _capacity;
+      std::unique_ptr<Slot[]> _slots;
+      std::map<PublicKey, size_t> _feeds;
+      std::vector<uint8_t> _data;
+      alignas(64) std::atomic<uint64_t> _current_slot{0};
+
+      void store(Slot& slot, int64_t price, uint64_t confidence, int32_t exponent, PriceStatus status, uint64_t publish_slot, int64_t publish_time,
+                 bool fully_verified) {
+        uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.price.store(price, std::memory_order_relaxed);
+        slot.confidence.store(confidence, std::memory_order_relaxed);
+        slot.exponent.store(exponent, std::memory_order_relaxed);
+        slot.status.store((uint32_t)status, std::memory_order_relaxed);
+        slot.publish_slot.store(publish_slot, std::memory_order_relaxed);
+        slot.publish_time.store(publish_time, std::memory_order_relaxed);
+        slot.fully_verified.store(fully_verified, std::memory_order_relaxed);
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+      }
+
+    public:
+
+      /**
+       * @param capacity The maximum number of feeds
+       */
+      PriceCache(size_t capacity = 256) : _capacity(capacity), _slots(new Slot[capacity]) {}
+
+      PriceCache(const PriceCache&) = delete;
+      PriceCache& operator=(const PriceCache&) = delete;
+
+      /**
+       * Registers a feed, returning its index. Feeds must be registered before readers start.
+       *
+       * @param price_account The Pubkey of the oracle price account
+       */
+      size_t add_feed(const PublicKey& price_account) {
+        auto it = _feeds.find(price_account);
+        if (it != _feeds.end()) {
+          return it->second;
+        }
+        if (_feeds.size() == _capacity) {
+          throw std::runtime_error("Price cache is full");
+        }
+        size_t index = _feeds.size();
+        _feeds[price_account] = index;
+        return index;
+      }
+
+      /**
+       * Returns the index of a registered feed, or nullopt.
+       */
+      std::optional<size_t> feed(const PublicKey& price_account) const {
+        auto it = _feeds.find(price_account);
+        if (it == _feeds.end()) {
+          return std::nullopt;
+        }
+        return it->second;
+      }
+
+      /**
+       * Decodes a price account and stores its price, returning false if the layout is not recognized.
+       *
+       * Pull oracle updates have no status and are stored as Trading; callers that need the full guardian quorum
+       * should check Price::fully_verified.
+       *
+       * @param feed The index of the feed
+       * @param data The raw account data
+       * @param length The length of the account data
+       */
+      bool update(size_t feed, const uint8_t* data, size_t length) {
+        ASSERT(feed < _feeds.size());
+        if (PythPriceView::is_valid(data, length)) {
+          PythPriceView view{data};
+          store(_slots[feed], view.price(), view.confidence(), view.exponent(), view.status(), view.publish_slot(), view.timestamp(), true);
+          return true;
+        }
+        if (PythPriceUpdateView::is_valid(data, length)) {
+          PythPriceUpdateView view{data};
+          store(_slots[feed], view.price(), view.confidence(), view.exponent(), PriceStatus::Trading, view.posted_slot(), view.publish_time(),
+                view.fully_verified());
+          return true;
+        }
+        return false;
+      }
+
+      /**
+       * Sets the slot that staleness is computed from.
+       */
+      void set_current_slot(uint64_t slot) {
+        _current_slot.store(slot, std::memory_order_relaxed);
+      }
+
+      uint64_t current_slot() const {
+        return _current_slot.load(std::memory_order_relaxed);
+      }
+
+      /**
+       * Reads the latest price of a feed from any thread, returning false if the feed has no price yet.
+       *
+       * @param feed The index of the feed
+       * @param price Receives the price
+       */
+      bool read(size_t feed, Price& price) const {
+        ASSERT(feed < _capacity);
+        const Slot& slot = _slots[feed];
+        uint64_t before, after;
+        do {
+          before = slot.sequence.load(std::memory_order_acquire);
+          price.price = slot.price.load(std::memory_order_relaxed);
+          price.confidence = slot.confidence.load(std::memory_order_relaxed);
+          price.exponent = slot.exponent.load(std::memory_order_relaxed);
+          price.status = (PriceStatus)slot.status.load(std::memory_order_relaxed);
+          price.publish_slot = slot.publish_slot.load(std::memory_order_relaxed);
+          price.publish_time = slot.publish_time.load(std::memory_order_relaxed);
+          price.fully_verified = slot.fully_verified.load(std::memory_order_relaxed);
+          std::atomic_thread_fence(std::memory_order_acquire);
+          after = slot.sequence.load(std::memory_order_relaxed);
+        } while (before != after || (before & 1) != 0);
+
+        uint64_t current = current_slot();
+        price.staleness = current > price.publish_slot ? current - price.publish_slot : 0;
+        return before != 0;
+      }
+
+      /**
+       * Subscribes to a price account, registering it as a feed if needed.
+       *
+       * @param connection The connection to subscribe with
+       * @param price_account The Pubkey of the oracle price account
+       *
+       * @return The subscription ID
+       */
+      int subscribe(Connection& connection, const PublicKey& price_account) {
+        size_t index = add_feed(price_account);
+        return connection.on_account_change(price_account, [this, index](Result<Account> result) {
+          if (result.ok()) {
+            size_t length = base64::decode(result._result->data, _data);
+            update(index, _data.data(), length);
+          }
+        });
+      }
+
+      /**
+       * Keeps the current slot up to date from slot notifications.
+       *
+       * @param connection The connection to subscribe with
+       *
+       * @return The subscription ID
+       */
+      int track_slot(Connection& connection) {
+        return connection.on_slot_change([this](Result<SlotInfo> result) {
+          if (result.ok()) {
+            set_current_slot(result._result->slot);
+          }
+        });
+      }
+    };
+
+  } // namespace oracle
+
+}
+
+#ifndef MANY_COMPILED_LIB
+#include "solana_impl.hpp"
+#endif
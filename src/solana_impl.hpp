@@ -0,0 +1,495 @@
+//  ____ _____ __    _____ _____ _____
+// |  __|     |  |  |  _  |   | |  _  |  Solana C++ SDK
+// |__  |  |  |  |__|     | | | |     |  version 0.0.1
+// |____|_____|_____|__|__|_|___|__|__|  https://github.com/many-exchange/many-exchange-cpp
+//
+// Copyright (c) 2022-2023 Many Exchange
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+#pragma once
+
+// The functions declared in solana.hpp. Header-only builds include them from the end of solana.hpp as inline
+// definitions, the many library defines MANY_COMPILED_LIB and compiles them once in src/solana.cpp.
+
+namespace solana {
+
+  MANY_INLINE std::string cluster_api_url(Cluster cluster) {
+    switch (cluster) {
+      case Cluster::MainnetBeta:
+        return "https://api.mainnet-beta.solana.com";
+      case Cluster::Devnet:
+        return "https://api.devnet.solana.com";
+      case Cluster::Testnet:
+        return "https://api.testnet.solana.com";
+      case Cluster::Localnet:
+        return "http://127.0.0.1:8899";
+      default:
+        throw std::runtime_error("Invalid cluster.");
+    }
+  }
+
+  MANY_INLINE void from_json(const json& j, Blockhash& blockhash) {
+    blockhash.blockhash = j["blockhash"].get<std::string>();
+    blockhash.last_valid_block_height = j.value("lastValidBlockHeight", (uint64_t)0);
+  }
+
+  MANY_INLINE void from_json(const json& j, Version& version) {
+    if (j.contains("feature-set")) {
+      version.feature_set = j["feature-set"].get<uint64_t>();
+    }
+    if (j.contains("solana-core")) {
+      version.version = j["solana-core"].get<std::string>();
+    }
+  }
+
+  MANY_INLINE void from_json(const nlohmann::json& j, PublicKey& pubkey) {
+    pubkey = PublicKey(j.get<std::string>());
+  }
+
+  MANY_INLINE void from_json(const json& j, Account& account) {
+    account.lamports = j["lamports"].get<uint64_t>();
+    account.owner = j["owner"].get<PublicKey>();
+
+    if (j["data"].is_string()) {
+      account.data = j["data"].get<std::string>();
+    } else {
+      auto encoding = j["data"][1].get<std::string>();
+      ASSERT(encoding == "base64");
+      account.data = j["data"][0].get<std::string>();
+    }
+
+    account.executable = j["executable"].get<bool>();
+    account.rent_epoch = j["rentEpoch"].get<uint64_t>();
+  }
+
+  MANY_INLINE void from_json(const json& j, AccountInfo& accountInfo) {
+    accountInfo.pubkey = j["pubkey"].get<PublicKey>();
+    accountInfo.account = j["account"].get<Account>();
+  }
+
+  MANY_INLINE void from_json(const json& j, TokenBalance& tokenAmount) {
+    // Transaction metadata wraps the amount of each balance in a uiTokenAmount object
+    const json& amount = j.contains("uiTokenAmount") ? j["uiTokenAmount"] : j;
+    tokenAmount.amount = stoull(amount["amount"].get<std::string>());
+    tokenAmount.decimals = amount["decimals"].get<uint64_t>();
+  }
+
+  MANY_INLINE void from_json(const json& j, ClusterNode& cluster_node) {
+    if (!j["featureSet"].is_null()) {
+      cluster_node.feature_set = j["featureSet"].get<uint64_t>();
+    }
+    cluster_node.gossip = j["gossip"].get<std::string>();
+    cluster_node.pubkey = j["pubkey"].get<PublicKey>();
+    if (!j["rpc"].is_null()) {
+      cluster_node.rpc = j["rpc"].get<std::string>();
+    }
+    cluster_node.shred_version = j["shredVersion"].get<uint64_t>();
+    if (!j["tpu"].is_null()) {
+      cluster_node.tpu = j["tpu"].get<std::string>();
+    }
+    if (!j["version"].is_null()) {
+      cluster_node.version = j["version"].get<std::string>();
+    }
+  }
+
+  MANY_INLINE void from_json(const json& j, Identity& identity) {
+    identity.identity = PublicKey(j["identity"].get<std::string>());
+  }
+
+  MANY_INLINE void from_json(const json& j, LeaderSchedule& leader_schedule) {
+    auto it = j.begin();
+    leader_schedule.leader = PublicKey(it.key());
+    leader_schedule.schedule = it.value().get<std::vector<int>>();
+  }
+
+  MANY_INLINE void from_json(const json& j, Logs& logs) {
+    logs.logs = j["logs"].get<std::vector<std::string>>();
+    logs.signature = j["signature"].get<std::string>();
+  }
+
+  MANY_INLINE void from_json(const json& j, ResultError& t) {
+    t.code = j["code"].get<int64_t>();
+    t.message = j["message"].get<std::string>();
+  }
+
+  MANY_INLINE void from_json(const json& j, SlotInfo& slot_info) {
+    slot_info.slot = j["slot"].get<uint64_t>();
+    slot_info.parent = j["parent"].get<uint64_t>();
+    slot_info.root = j["root"].get<uint64_t>();
+  }
+
+  MANY_INLINE void from_json(const json& j, EpochInfo& epoch_info) {
+    epoch_info.absolute_slot = j["absoluteSlot"].get<uint64_t>();
+    epoch_info.block_height = j["blockHeight"].get<uint64_t>();
+    epoch_info.epoch = j["epoch"].get<uint64_t>();
+    epoch_info.slot_index = j["slotIndex"].get<uint64_t>();
+    epoch_info.slots_in_epoch = j["slotsInEpoch"].get<uint64_t>();
+  }
+
+  MANY_INLINE void from_json(const json& j, TokenAccount::Account::Data::Parsed::Info& parsedAccountInfo) {
+    parsedAccountInfo.is_native = j["isNative"].get<bool>();
+    parsedAccountInfo.mint = j["mint"].get<PublicKey>();
+    parsedAccountInfo.owner = j["owner"].get<PublicKey>();
+    parsedAccountInfo.token_amount = j["tokenAmount"].get<TokenBalance>();
+    if (j.contains("delegate")) {
+      parsedAccountInfo.delegate = j["account"]["data"]["parsed"]["info"]["delegate"].get<PublicKey>();
+      parsedAccountInfo.delegated_amount = j["account"]["data"]["parsed"]["info"]["delegatedAmount"].get<TokenBalance>();
+    }
+    parsedAccountInfo.state = j["state"].get<std::string>();
+  }
+
+  MANY_INLINE void from_json(const json& j, TokenAccount::Account::Data::Parsed& parsedAccountData) {
+    parsedAccountData.info = j["info"].get<TokenAccount::Account::Data::Parsed::Info>();
+    parsedAccountData.type = j["type"].get<std::string>();
+  }
+
+  MANY_INLINE void from_json(const json& j, TokenAccount::Account::Data& accountData) {
+    accountData.program = j["program"].get<std::string>();
+    accountData.parsed = j["parsed"].get<TokenAccount::Account::Data::Parsed>();
+    accountData.space = j["space"].get<uint64_t>();
+  }
+
+  MANY_INLINE void from_json(const json& j, TokenAccount::Account& account) {
+    account.lamports = j["lamports"].get<uint64_t>();
+    account.owner = j["owner"].get<PublicKey>();
+    account.data.program = j["data"]["program"].get<std::string>();
+    account.data.parsed = j["data"]["parsed"].get<TokenAccount::Account::Data::Parsed>();
+    account.data.space = j["data"]["space"].get<uint64_t>();
+    account.executable = j["executable"].get<bool>();
+    account.rent_epoch = j["rentEpoch"].get<uint64_t>();
+  }
+
+  MANY_INLINE void from_json(const json& j, TokenAccount& tokenAccount) {
+    tokenAccount.pubkey = j["pubkey"].get<PublicKey>();
+    tokenAccount.account = j["account"].get<TokenAccount::Account>();
+  }
+
+  MANY_INLINE void from_json(const json& j, TransactionMessageHeader& header) {
+    header.num_required_signatures = j["numRequiredSignatures"].get<uint8_t>();
+    header.num_readonly_signed_accounts = j["numReadonlySignedAccounts"].get<uint8_t>();
+    header.num_readonly_unsigned_accounts = j["numReadonlyUnsignedAccounts"].get<uint8_t>();
+  }
+
+  MANY_INLINE void from_json(const json& j, CompiledTransaction::Message::Instruction& instruction) {
+    instruction.accounts = j["accounts"].get<std::vector<uint8_t>>();
+    // Instruction data of the json transaction encoding is base-58
+    std::string data = base58::decode(j["data"].get<std::string>());
+    instruction.data = std::vector<uint8_t>(data.begin(), data.end());
+    instruction.program_id_index = j["programIdIndex"].get<uint8_t>();
+  }
+
+  MANY_INLINE void from_json(const json& j, CompiledTransaction::Message& message) {
+    message.account_keys = j["accountKeys"].get<std::vector<PublicKey>>();
+    message.header.num_readonly_signed_accounts = j["header"]["numReadonlySignedAccounts"].get<uint8_t>();
+    message.header.num_readonly_unsigned_accounts = j["header"]["numReadonlyUnsignedAccounts"].get<uint8_t>();
+    message.header.num_required_signatures = j["header"]["numRequiredSignatures"].get<uint8_t>();
+    message.instructions = j["instructions"].get<std::vector<CompiledTransaction::Message::Instruction>>();
+    message.recent_blockhash = PublicKey(j["recentBlockhash"].get<std::string>());
+  }
+
+  MANY_INLINE void from_json(const json& j, CompiledTransaction& transaction) {
+    transaction.message = j["message"].get<CompiledTransaction::Message>();
+    transaction.signatures = j["signatures"].get<std::vector<std::string>>();
+  }
+
+  MANY_INLINE void from_json(const json& j, Transaction::Message::Instruction::AccountMeta& accountMeta) {
+    accountMeta.pubkey = j["pubkey"].get<PublicKey>();
+    accountMeta.is_signer = j["isSigner"].get<bool>();
+    accountMeta.is_writable = j["isWritable"].get<bool>();
+  }
+
+  MANY_INLINE void from_json(const json& j, TransactionResponseReturnData& transactionReturnData) {
+    transactionReturnData.program_d = j["programId"].get<PublicKey>();
+    transactionReturnData.data = j["data"].get<std::string>();
+  }
+
+  MANY_INLINE void from_json(const json& j, TransactionResponse::Meta::InnerInstruction::Instruction& metaInstruction) {
+    metaInstruction.program_id_index = j["programIdIndex"].get<uint64_t>();
+    metaInstruction.accounts = j["accounts"].get<std::vector<uint64_t>>();
+    metaInstruction.data = j["data"].get<std::string>();
+  }
+
+  MANY_INLINE void from_json(const json& j, TransactionResponse::Meta::InnerInstruction& metaInnerInstruction) {
+    metaInnerInstruction.index = j["index"].get<uint64_t>();
+    metaInnerInstruction.instructions = j["instructions"].get<std::vector<TransactionResponse::Meta::InnerInstruction::Instruction>>();
+  }
+
+  MANY_INLINE void from_json(const json& j, TransactionResponse::Meta::TransactionReward& reward) {
+    reward.pubkey = j["pubkey"].get<PublicKey>();
+    reward.lamports = j["lamports"].get<uint64_t>();
+    reward.post_balance = j["postBalance"].get<uint64_t>();
+    reward.reward_type = j["rewardType"].get<std::string>();
+    if (j.find("commission") != j.end()) {
+      reward.commission = j["commission"].get<uint8_t>();
+    }
+  }
+
+  MANY_INLINE void from_json(const json& j, TransactionResponse::Meta::LoadedAddresses& loadedAddresses) {
+    loadedAddresses.readonly = j["readonly"].get<std::vector<PublicKey>>();
+    loadedAddresses.writable = j["writable"].get<std::vector<PublicKey>>();
+  }
+
+  MANY_INLINE void from_json(const json& j, TransactionResponse::Meta& meta) {
+    if (!j.at("err").is_null()) {
+      meta.err = j["err"].dump();
+    } else {
+      meta.err = "";
+    }
+    meta.fee = j["fee"].get<uint64_t>();
+    if (!j["innerInstructions"].is_null()) {
+      meta.inner_instructions = j["innerInstructions"].get<std::vector<TransactionResponse::Meta::InnerInstruction>>();
+    }
+    if (!j["logMessages"].is_null()) {
+      meta.log_messages = j["logMessages"].get<std::vector<std::string>>();
+    }
+    if (j.contains("loadedAddresses")) {
+      meta.loaded_addresses = j["loadedAddresses"].get<TransactionResponse::Meta::LoadedAddresses>();
+    }
+    meta.post_balances = j["postBalances"].get<std::vector<uint64_t>>();
+    meta.post_token_balances = j["postTokenBalances"].get<std::vector<TokenBalance>>();
+    meta.pre_balances = j["preBalances"].get<std::vector<uint64_t>>();
+    meta.pre_token_balances = j["preTokenBalances"].get<std::vector<TokenBalance>>();
+    if (j.contains("rewards") && !j["rewards"].is_null()) {
+      meta.rewards = j["rewards"].get<std::vector<TransactionResponse::Meta::TransactionReward>>();
+    }
+  }
+
+  MANY_INLINE void from_json(const json& j, TransactionResponse& transactionResponse) {
+    transactionResponse.slot = j["slot"].get<uint64_t>();
+    transactionResponse.block_time = j["blockTime"].is_null() ? 0 : j["blockTime"].get<uint64_t>();
+    transactionResponse.transaction = j["transaction"].get<CompiledTransaction>();
+    transactionResponse.meta = j["meta"].get<TransactionResponse::Meta>();
+    if (j.contains("returnData")) {
+      transactionResponse.return_data = j["returnData"].get<TransactionResponseReturnData>();
+    }
+  }
+
+  MANY_INLINE void from_json(const json& j, SimulatedTransactionResponse& simulatedTransactoinResponse) {
+    if (j.contains("err") && !j["err"].is_null()) {
+      simulatedTransactoinResponse.err = j["err"].dump();
+    }
+    if (j.contains("logs") && !j["logs"].is_null()) {
+      simulatedTransactoinResponse.logs = j["logs"].get<std::vector<std::string>>();
+    }
+    if (j.contains("accounts") && !j["accounts"].is_null()) {
+      simulatedTransactoinResponse.accounts = j["accounts"].get<std::vector<AccountInfo>>();
+    }
+    simulatedTransactoinResponse.units_consumed = j.value("unitsConsumed", (uint64_t)0);
+    if (j.contains("returnData") && !j["returnData"].is_null()) {
+      simulatedTransactoinResponse.return_data = j["returnData"].get<TransactionResponseReturnData>();
+    }
+  }
+
+  MANY_INLINE void from_json(const json& j, PrioritizationFee& fee) {
+    fee.slot = j["slot"].get<uint64_t>();
+    fee.prioritization_fee = j["prioritizationFee"].get<uint64_t>();
+  }
+
+  MANY_INLINE void from_json(const json& j, SignatureStatus& status) {
+    status = SignatureStatus{};
+    if (j.is_null()) {
+      return;
+    }
+    status.found = true;
+    status.slot = j.value("slot", (uint64_t)0);
+    if (j.contains("confirmations") && !j["confirmations"].is_null()) {
+      status.confirmations = j["confirmations"].get<uint64_t>();
+    }
+    if (j.contains("err") && !j["err"].is_null()) {
+      status.err = j["err"].dump();
+    }
+    if (j.contains("confirmationStatus") && !j["confirmationStatus"].is_null()) {
+      status.confirmation_status = j["confirmationStatus"].get<Commitment>();
+    }
+  }
+
+  MANY_INLINE void from_json(const json& j, SignatureInfo& info) {
+    info = SignatureInfo{};
+    info.signature = j["signature"].get<std::string>();
+    info.slot = j["slot"].get<uint64_t>();
+    if (j.contains("err") && !j["err"].is_null()) {
+      info.err = j["err"].dump();
+    }
+    if (j.contains("memo") && !j["memo"].is_null()) {
+      info.memo = j["memo"].get<std::string>();
+    }
+    if (j.contains("blockTime") && !j["blockTime"].is_null()) {
+      info.block_time = j["blockTime"].get<int64_t>();
+    }
+    if (j.contains("confirmationStatus") && !j["confirmationStatus"].is_null()) {
+      info.confirmation_status = j["confirmationStatus"].get<Commitment>();
+    }
+  }
+
+  namespace token {
+
+    MANY_INLINE Transaction::Message::Instruction create_associated_token_account_instruction(
+      const PublicKey& payer,
+      const PublicKey& associated_token,
+      const PublicKey& owner,
+      const PublicKey& mint,
+      const PublicKey& program_id,
+      const PublicKey& associated_token_program_id
+    ) {
+      json accounts = {
+        {
+          { "pubkey", payer.to_base58() },
+          { "isSigner", true },
+          { "isWritable", true },
+        },
+        {
+          { "pubkey", associated_token.to_base58() },
+          { "isSigner", false },
+          { "isWritable", true },
+        },
+        {
+          { "pubkey", owner.to_base58() },
+          { "isSigner", false },
+          { "isWritable", false },
+        },
+        {
+          { "pubkey", mint.to_base58() },
+          { "isSigner", false },
+          { "isWritable", false },
+        },
+        {
+          { "pubkey", SYSTEM_PROGRAM.to_base58() },
+          { "isSigner", false },
+          { "isWritable", false },
+        },
+        {
+          { "pubkey", program_id.to_base58() },
+          { "isSigner", false },
+          { "isWritable", false },
+        },
+      };
+
+      return {
+        associated_token_program_id,
+        accounts,
+        {}
+      };
+    }
+
+    MANY_INLINE Transaction create_associated_token_account_transaction(
+      const PublicKey& payer,
+      const PublicKey& associated_token,
+      const PublicKey& owner,
+      const PublicKey& mint,
+      const PublicKey& program_id,
+      const PublicKey& associated_token_program_id
+    ) {
+      Transaction tx;
+      tx.add(
+        create_associated_token_account_instruction(
+          payer,
+          associated_token,
+          owner,
+          mint,
+          program_id,
+          associated_token_program_id
+        )
+      );
+
+      return tx;
+    }
+
+    MANY_INLINE PublicKey get_associated_token_address(
+      const PublicKey& mint,
+      const PublicKey& owner,
+      const bool& allow_owner_off_curve,
+      const PublicKey& program_id,
+      const PublicKey& associated_token_program_id
+    ) {
+      if (!allow_owner_off_curve && !owner.is_on_curve()) {
+        throw std::runtime_error("Token owner is off curve.");
+      }
+
+      std::tuple<PublicKey, uint8_t> pda = PublicKey::find_program_address(
+        {
+          owner.to_buffer(),
+          program_id.to_buffer(),
+          mint.to_buffer()
+        },
+        associated_token_program_id
+      );
+
+      return std::get<0>(pda);
+    }
+
+    MANY_INLINE Result<PublicKey> create_associated_token_account(
+      const Connection& connection,
+      const Keypair& payer,
+      const PublicKey& mint,
+      const PublicKey& owner,
+      const ConfirmOptions& /* confirm_options */,
+      const PublicKey& program_id,
+      const PublicKey& associated_token_program_id
+    ) {
+      const PublicKey associated_token = get_associated_token_address(mint, owner, false, program_id, associated_token_program_id);
+
+      Transaction transaction = create_associated_token_account_transaction(
+        payer.public_key,
+        associated_token,
+        owner,
+        mint,
+        program_id,
+        associated_token_program_id
+      );
+
+      std::string txid = connection.sign_and_send_transaction(transaction, {payer}).unwrap();
+
+      return Result<PublicKey>(associated_token);;
+    }
+
+  } // namespace token
+
+  namespace compute_budget {
+
+    MANY_INLINE Transaction::Message::Instruction set_compute_unit_limit_instruction(uint32_t units) {
+      std::vector<uint8_t> data(5);
+      data[0] = 2;
+      memcpy(&data[1], &units, sizeof(units));
+      return {
+        COMPUTE_BUDGET_PROGRAM_ID,
+        {},
+        data
+      };
+    }
+
+    MANY_INLINE Transaction::Message::Instruction set_compute_unit_price_instruction(uint64_t micro_lamports) {
+      std::vector<uint8_t> data(9);
+      data[0] = 3;
+      memcpy(&data[1], &micro_lamports, sizeof(micro_lamports));
+      return {
+        COMPUTE_BUDGET_PROGRAM_ID,
+        {},
+        data
+      };
+    }
+
+    MANY_INLINE bool is_compute_unit_limit_or_price(const Transaction::Message::Instruction& instruction) {
+      return instruction.program_id == COMPUTE_BUDGET_PROGRAM_ID
+        && !instruction.data.empty()
+        && (instruction.data[0] == 2 || instruction.data[0] == 3);
+    }
+
+    MANY_INLINE void set_compute_budget(Transaction& transaction, uint32_t units, uint64_t micro_lamports) {
+      auto& instructions = transaction.message.instructions;
+      instructions.erase(std::remove_if(instructions.begin(), instructions.end(), is_compute_unit_limit_or_price), instructions.end());
+
+      std::vector<Transaction::Message::Instruction> budget;
+      if (units > 0) {
+        budget.push_back(set_compute_unit_limit_instruction(units));
+      }
+      if (micro_lamports > 0) {
+        budget.push_back(set_compute_unit_price_instruction(micro_lamports));
+      }
+      instructions.insert(instructions.begin(), budget.begin(), budget.end());
+    }
+
+  } // namespace compute_budget
+
+}
@@ -0,0 +1,175 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/allocation_counter.hpp"
+#include "../../src/mock_server.hpp"
+
+using namespace solana;
+
+const std::string CAPTURE = "/tmp/allocations_test.cap";
+
+/** An unmasked server-to-client websocket text frame */
+std::string text_frame(const std::string& payload) {
+  std::string frame;
+  frame.push_back((char)0x81);
+  if (payload.size() <= 125) {
+    frame.push_back((char)payload.size());
+  } else {
+    frame.push_back((char)126);
+    frame.push_back((char)(payload.size() >> 8));
+    frame.push_back((char)(payload.size() & 0xff));
+  }
+  return frame + payload;
+}
+
+TEST_CASE("Allocations are counted for the calling thread and the process") {
+  auto counts = allocations::count([]() {
+    for (int i = 0; i < 3; i++) {
+      void* pointer = malloc(100);
+      free(pointer);
+    }
+    delete new std::string(1000, 'x');
+    std::vector<uint8_t> buffer(10);
+    buffer.resize(1000);
+  });
+  ASSERT(counts.allocations == 7);
+  ASSERT(counts.bytes >= 300 + 1000 + 1010);
+
+  // Another thread's allocations are only seen by the process counts
+  auto process = allocations::process();
+  std::string allocated;
+  auto thread = allocations::count([&]() {
+    std::thread([&]() { allocated.assign(4096, 'x'); }).join();
+  });
+  ASSERT(allocations::process().bytes - process.bytes >= 4096);
+  ASSERT(thread.bytes < 4096);
+}
+
+TEST_CASE("Hot paths declared allocation-free stay allocation-free") {
+  auto keypair = Keypair::generate();
+  std::string address = keypair.public_key.to_base58();
+  auto counts = allocations::count([&]() {
+    char b58[64];
+    size_t b58_size = sizeof(b58);
+    ASSERT(base58::b58enc(b58, &b58_size, keypair.public_key.bytes.data(), PUBLIC_KEY_LENGTH));
+    uint8_t bin[PUBLIC_KEY_LENGTH];
+    size_t bin_size = sizeof(bin);
+    ASSERT(base58::b58tobin(bin, &bin_size, address.c_str(), address.size()));
+  });
+  ASSERT(counts.allocations == 0);
+
+  // Reused buffers and views only allocate until they have grown to the largest input
+  std::vector<uint8_t> data(165);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = (uint8_t)i;
+  }
+  std::string encoded = base64::encode(data);
+  std::vector<uint8_t> decoded;
+  base64::decode(encoded, decoded);
+  counts = allocations::count([&]() {
+    for (int i = 0; i < 10; i++) {
+      base64::decode(encoded, decoded);
+    }
+  });
+  ASSERT(counts.allocations == 0);
+
+  Transaction transaction;
+  transaction.add(compute_budget::set_compute_unit_limit_instruction(200000));
+  transaction.add(compute_budget::set_compute_unit_price_instruction(1000));
+  transaction.message.recent_blockhash = PublicKey().to_base58();
+  std::vector<uint8_t> serialized = transaction.sign({keypair});
+  TransactionView view;
+  ASSERT(view.parse(serialized.data(), serialized.size()));
+  counts = allocations::count([&]() {
+    for (int i = 0; i < 10; i++) {
+      ASSERT(view.parse(serialized.data(), serialized.size()));
+    }
+  });
+  ASSERT(counts.allocations == 0);
+  ASSERT(view.instructions.size() == 2);
+
+  size_t changes = 0;
+  diff::ByteDiffer differ;
+  differ.watch(64, 8, [&](const uint8_t*, const uint8_t*, size_t) { changes++; });
+  differ.update(data.data(), data.size());
+  counts = allocations::count([&]() {
+    for (int i = 0; i < 10; i++) {
+      data[64 + i % 8]++;
+      differ.update(data.data(), data.size());
+    }
+  });
+  ASSERT(counts.allocations == 0);
+  ASSERT(changes == 11);
+}
+
+TEST_CASE("HTTP requests and notifications stay within their allocation budgets") {
+  mock::MockServer server;
+
+  // A request on a kept-alive connection allocates the request and the parsed response, not a receive buffer
+  http::ConnectionPool pool(server.endpoint(), 1);
+  json request = {{"jsonrpc", "2.0"}, {"id", 1}, {"method", "getSlot"}};
+  pool.post(request);
+  auto counts = allocations::count([&]() {
+    for (int i = 0; i < 10; i++) {
+      pool.post(request);
+    }
+  });
+  ASSERT(counts.allocations <= 10 * 30);
+  ASSERT(counts.bytes <= 10 * 2048);
+
+  // A connection per request pays for the connection, but the buffers are sized for the responses
+  counts = allocations::count([&]() {
+    http::post(server.endpoint(), request);
+  });
+  ASSERT(counts.bytes <= 256 * 1024);
+
+  // A notification is parsed once and its params moved to the subscription callback
+  auto address = Keypair::generate().public_key;
+  {
+    websockets::capture::Writer writer(CAPTURE);
+    std::string subscribe = json({{"jsonrpc", "2.0"}, {"id", 1}, {"method", "accountSubscribe"}}).dump();
+    int64_t now = websockets::capture::now();
+    writer.write(websockets::capture::SUBSCRIBED, now, subscribe.data(), subscribe.size());
+    std::string ack = text_frame(json({{"jsonrpc", "2.0"}, {"id", 1}, {"result", 100}}).dump());
+    writer.write(websockets::capture::RECEIVED, now, ack.data(), ack.size());
+    for (int i = 0; i < 100; i++) {
+      std::string notification = text_frame(json({
+        {"jsonrpc", "2.0"},
+        {"method", "accountNotification"},
+        {"params", {
+          {"subscription", 100},
+          {"result", {
+            {"context", {{"slot", 1000 + i}}},
+            {"value", {
+              {"lamports", i},
+              {"owner", SYSTEM_PROGRAM.to_base58()},
+              {"data", {"", "base64"}},
+              {"executable", false},
+              {"rentEpoch", 0},
+            }},
+          }},
+        }},
+      }).dump());
+      writer.write(websockets::capture::RECEIVED, now, notification.data(), notification.size());
+    }
+  }
+  Connection connection("http://127.0.0.1:1", Commitment::Processed);
+  connection.replay(CAPTURE, 0);
+  uint64_t notifications = 0;
+  connection.on_account_change(address, [&](Result<Account> result) {
+    notifications += result.unwrap().lamports == notifications;
+  });
+  connection.poll();
+  counts = allocations::count([&]() {
+    while (connection.is_replaying()) {
+      connection.poll();
+    }
+  });
+  ASSERT(notifications == 100);
+  ASSERT(counts.allocations <= 100 * 55);
+  unlink(CAPTURE.c_str());
+}
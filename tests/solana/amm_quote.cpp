@@ -0,0 +1,102 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+Account token_account(const PublicKey& mint, uint64_t amount) {
+  std::vector<uint8_t> data(token::ACCOUNT_SIZE, 0);
+  memcpy(&data[0], mint.bytes.data(), PUBLIC_KEY_LENGTH);
+  memcpy(&data[64], &amount, 8);
+  return Account{ 2039280, TOKEN_PROGRAM_ID, base64::encode(data), false, 0 };
+}
+
+std::vector<uint8_t> token_swap_account(const PublicKey& vault_a, const PublicKey& vault_b) {
+  std::vector<uint8_t> data(amm::ConstantProductPool::SIZE, 0);
+  data[0] = 1;
+  data[1] = 1;
+  memcpy(&data[35], vault_a.bytes.data(), PUBLIC_KEY_LENGTH);
+  memcpy(&data[67], vault_b.bytes.data(), PUBLIC_KEY_LENGTH);
+  uint64_t fees[4] = { 25, 10000, 5, 10000 };
+  memcpy(&data[227], fees, sizeof(fees));
+  return data;
+}
+
+TEST_CASE("ConstantProductPool matches the token swap program") {
+  PublicKey vault_a("8VBafTNv1F8k5Bg7DTVwhitw3MGAMTmekHsgLuMJxLC8");
+  PublicKey vault_b("6Cust2JhvweKLh4CVo1dt21s2PJ86uNGkziudpkNPaCj");
+  auto data = token_swap_account(vault_a, vault_b);
+  auto pool = amm::ConstantProductPool::decode(data.data(), data.size());
+  ASSERT(pool.token_a_vault == vault_a);
+  ASSERT(pool.fees.trade_fee_numerator == 25);
+
+  AccountCache cache;
+  ASSERT(!pool.update_reserves(cache));
+  cache.update(vault_a, token_account(NATIVE_MINT, 1000000));
+  cache.update(vault_b, token_account(NATIVE_MINT, 2000000));
+  ASSERT(pool.update_reserves(cache));
+  ASSERT(pool.reserve_a == 1000000 && pool.reserve_b == 2000000);
+
+  amm::Quote quote = pool.quote(10000, true);
+  ASSERT(quote.amount_in == 10000);
+  ASSERT(quote.amount_out == 19743);
+  ASSERT(quote.fee == 30);
+
+  // Fees larger than the input are rejected by the program
+  quote = pool.quote(1, true);
+  ASSERT(quote.amount_out == 0);
+
+  pool.reserve_a = 5000000000;
+  pool.reserve_b = 7000000000000;
+  uint64_t amounts[3] = { 10000, 1, 123456789 };
+  amm::Quote quotes[3];
+  pool.quote(amounts, quotes, 3, true);
+  ASSERT(quotes[2].amount_out == 168180832678);
+  ASSERT(quotes[2].fee == 370369);
+  ASSERT(quotes[1].amount_out == 0);
+}
+
+TEST_CASE("ConcentratedLiquidityPool swap step") {
+  amm::ConcentratedLiquidityPool pool;
+  pool.fee_rate = 3000;
+  pool.liquidity = 1000000000000;
+  pool.sqrt_price = (__uint128_t)1 << 64;
+
+  amm::Quote quote = pool.quote(1000000, true);
+  ASSERT(quote.amount_in == 1000000);
+  ASSERT(quote.amount_out == 996999);
+  ASSERT(quote.fee == 3000);
+
+  quote = pool.quote(1000000, false);
+  ASSERT(quote.amount_out == 996999);
+
+  pool.fee_rate = 300;
+  pool.liquidity = 91000000000;
+  pool.sqrt_price = ((__uint128_t)12 << 64) | 4752816009224650752ULL;
+  uint64_t amounts[2] = { 5000000000, 0 };
+  amm::Quote quotes[2];
+  pool.quote(amounts, quotes, 2, true);
+  ASSERT(quotes[0].amount_out == 448829714461);
+  ASSERT(quotes[0].fee == 1500000);
+  ASSERT(quotes[1].amount_out == 0);
+  pool.quote(amounts, quotes, 2, false);
+  ASSERT(quotes[0].amount_out == 33119472);
+
+  // Stops at the price limit and only consumes what is needed to get there
+  quote = pool.quote(5000000000, true, pool.sqrt_price - ((__uint128_t)1 << 60));
+  ASSERT(quote.amount_in < 5000000000);
+  ASSERT(quote.amount_out > 0);
+}
+
+TEST_CASE("uint256 division") {
+  math::uint256 a = math::uint256::mul(((__uint128_t)1 << 100) + 12345, ((__uint128_t)1 << 90) + 678);
+  math::uint256 remainder;
+  math::uint256 quotient = a.div(math::uint256(((__uint128_t)1 << 90) + 678), remainder);
+  ASSERT(quotient == math::uint256(((__uint128_t)1 << 100) + 12345));
+  ASSERT(remainder.is_zero());
+}
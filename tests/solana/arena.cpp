@@ -0,0 +1,166 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/allocation_counter.hpp"
+#include "../../src/mock_server.hpp"
+
+using namespace solana;
+
+TEST_CASE("Arena aligns addresses beyond the alignment of its blocks") {
+  memory::Arena arena(256);
+  for (size_t alignment = 32; alignment <= 4096; alignment *= 2) {
+    (void)arena.allocate(1, 1);
+    void* pointer = arena.allocate(8, alignment);
+    ASSERT((uintptr_t)pointer % alignment == 0);
+  }
+
+  struct alignas(64) Line {
+    uint64_t values[8];
+  };
+  for (int i = 0; i < 4; i++) {
+    (void)arena.allocate(1, 1);
+    ASSERT((uintptr_t)&arena.make<Line>() % 64 == 0);
+  }
+}
+
+TEST_CASE("Arena bumps aligned allocations, grows, and merges its blocks on reset") {
+  memory::Arena arena(256);
+  void* first = arena.allocate(3, 1);
+  void* aligned = arena.allocate(16, 16);
+  ASSERT((uintptr_t)aligned % 16 == 0);
+  ASSERT((char*)aligned > (char*)first);
+  ASSERT(arena.used() == 19);
+  arena.deallocate(aligned, 16, 16);
+  ASSERT(arena.used() == 19);
+
+  // Outgrowing the first block takes a second one from the heap
+  (void)arena.allocate(1000, 8);
+  ASSERT(arena.heap_allocations() == 2);
+  ASSERT(arena.capacity() >= 1256);
+  size_t capacity = arena.capacity();
+
+  // The reset merges the blocks, so the same workload then fits without the heap
+  arena.reset();
+  ASSERT(arena.used() == 0);
+  ASSERT(arena.peak() == 1019);
+  ASSERT(arena.heap_allocations() == 3);
+  ASSERT(arena.capacity() == capacity);
+  auto counts = allocations::count([&]() {
+    for (int i = 0; i < 10; i++) {
+      (void)arena.allocate(3, 1);
+      (void)arena.allocate(16, 16);
+      (void)arena.allocate(1000, 8);
+      arena.reset();
+    }
+  });
+  ASSERT(counts.allocations == 0);
+  ASSERT(arena.heap_allocations() == 3);
+
+  // Containers and JSON documents allocate from the arena of the current scope
+  {
+    memory::Scope scope(arena);
+    ASSERT(memory::current_resource() == &arena);
+    counts = allocations::count([&]() {
+      std::pmr::vector<uint64_t> values(&arena);
+      values.assign(100, 7);
+      pmr::json& document = arena.make<pmr::json>();
+      document["key"] = "a value longer than the small string buffer";
+      document["values"][3] = 1;
+    });
+    ASSERT(counts.allocations == 0);
+    ASSERT(arena.used() > 800);
+  }
+  ASSERT(memory::current_resource() == std::pmr::new_delete_resource());
+}
+
+TEST_CASE("Connection decodes results into an arena") {
+  mock::MockServer server;
+  Connection connection(server.endpoint(), Commitment::Processed);
+  connection.keep_alive();
+
+  auto keypair = Keypair::generate();
+  std::string signature = connection.request_airdrop(keypair.public_key, 1000000000).unwrap();
+  memory::Arena& arena = connection.arena();
+
+  auto account = connection.get_account_info(keypair.public_key).unwrap();
+  auto arena_account = connection.get_account_info(keypair.public_key, arena).unwrap();
+  ASSERT(arena_account.lamports == 1000000000);
+  ASSERT(arena_account.lamports == account.lamports);
+  ASSERT(arena_account.owner == account.owner);
+  ASSERT(std::string(arena_account.data) == account.data);
+  ASSERT(arena_account.data.get_allocator().resource() == &arena);
+
+  auto program = Keypair::generate().public_key;
+  auto owned = Keypair::generate().public_key;
+  server.set_account(owned, 5000, program, {1, 2, 3});
+  auto accounts = connection.get_program_accounts(program).unwrap();
+  auto arena_accounts = connection.get_program_accounts(program, arena).unwrap();
+  ASSERT(accounts.size() == 1);
+  ASSERT(arena_accounts.size() == 1);
+  ASSERT(arena_accounts[0].pubkey == owned);
+  ASSERT(arena_accounts[0].account.lamports == 5000);
+  ASSERT(std::string(arena_accounts[0].account.data) == accounts[0].account.data);
+  ASSERT(arena_accounts[0].account.data.get_allocator().resource() == &arena);
+
+  auto transaction = connection.get_transaction(signature).unwrap();
+  auto arena_transaction = connection.get_transaction(signature, arena).unwrap();
+  ASSERT(arena_transaction.slot == transaction.slot);
+  ASSERT(arena_transaction.meta.fee == transaction.meta.fee);
+  ASSERT(arena_transaction.transaction.signatures.size() == transaction.transaction.signatures.size());
+  ASSERT(std::string(arena_transaction.transaction.signatures[0]) == transaction.transaction.signatures[0]);
+  ASSERT(arena_transaction.transaction.message.account_keys == std::pmr::vector<PublicKey>(
+    transaction.transaction.message.account_keys.begin(), transaction.transaction.message.account_keys.end()));
+  arena.reset();
+}
+
+TEST_CASE("Arena results stay within their allocation budgets once warm") {
+  mock::MockServer server;
+  Connection connection(server.endpoint(), Commitment::Processed);
+  connection.keep_alive();
+
+  auto keypair = Keypair::generate();
+  std::string signature = connection.request_airdrop(keypair.public_key).unwrap();
+  memory::Arena& arena = connection.arena();
+  for (int i = 0; i < 3; i++) {
+    connection.get_account_info(keypair.public_key, arena).unwrap();
+    connection.get_transaction(signature, arena).unwrap();
+    arena.reset();
+  }
+  uint64_t heap_allocations = arena.heap_allocations();
+
+  // What is left is the parser's own token and stack buffers, nlohmann allocates them with std::allocator
+  uint64_t lamports = 0;
+  auto counts = allocations::count([&]() {
+    for (int i = 0; i < 10; i++) {
+      lamports += connection.get_account_info(keypair.public_key, arena).unwrap().lamports;
+      arena.reset();
+    }
+  });
+  auto regular = allocations::count([&]() {
+    for (int i = 0; i < 10; i++) {
+      connection.get_account_info(keypair.public_key).unwrap();
+    }
+  });
+  ASSERT(lamports > 0);
+  ASSERT(counts.allocations <= 10 * 16);
+  ASSERT(counts.allocations * 4 < regular.allocations);
+
+  counts = allocations::count([&]() {
+    for (int i = 0; i < 10; i++) {
+      connection.get_transaction(signature, arena).unwrap();
+      arena.reset();
+    }
+  });
+  regular = allocations::count([&]() {
+    for (int i = 0; i < 10; i++) {
+      connection.get_transaction(signature).unwrap();
+    }
+  });
+  ASSERT(counts.allocations <= 10 * 20);
+  ASSERT(counts.allocations * 4 < regular.allocations);
+  ASSERT(arena.heap_allocations() == heap_allocations);
+}
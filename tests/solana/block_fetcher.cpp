@@ -0,0 +1,246 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+const PublicKey PAYER("4Nd1mBQtrMJVYVfKf2PJy9NZUZdTAsp7D4xWLs4gDB4T");
+const PublicKey MARKET_PROGRAM("srmqPvymJeFKQ4zGQed1GFppgkRHL9kaELCbyksJtPX");
+const PublicKey OTHER_PROGRAM("Memo1UhkJRfHyvLMcVucJwxXeuD728EqVDDwQDxFMNo");
+
+/** A serialized transaction from PAYER with one instruction for each program, signed with a fake signature */
+std::vector<uint8_t> serialized_transaction(const std::vector<PublicKey>& programs, uint8_t seed, bool versioned = false) {
+  CompiledTransaction transaction;
+  transaction.message.header = {1, 0, (uint8_t)programs.size()};
+  transaction.message.account_keys = {PAYER};
+  transaction.message.account_keys.insert(transaction.message.account_keys.end(), programs.begin(), programs.end());
+  transaction.message.recent_blockhash = PAYER;
+  for (size_t i = 0; i < programs.size(); i++) {
+    transaction.message.instructions.push_back({{0}, {seed, (uint8_t)i}, (uint8_t)(i + 1)});
+  }
+  transaction.signatures = {std::string(64, (char)seed)};
+
+  std::vector<uint8_t> message;
+  transaction.message.serialize(message);
+  if (versioned) {
+    // A v0 message is prefixed with its version and ends with one lookup table loading accounts 1, 2 and 3
+    message.insert(message.begin(), 0x80);
+    message.push_back(1);
+    message.insert(message.end(), OTHER_PROGRAM.bytes.begin(), OTHER_PROGRAM.bytes.end());
+    message.insert(message.end(), {2, 1, 2, 1, 3});
+  }
+  return transaction.serialize(message);
+}
+
+TEST_CASE("TransactionView parses legacy and v0 transactions in place") {
+  auto legacy = serialized_transaction({MARKET_PROGRAM, OTHER_PROGRAM}, 7);
+  TransactionView view;
+  ASSERT(view.parse(legacy.data(), legacy.size()));
+  ASSERT(!view.versioned);
+  ASSERT(view.num_signatures == 1);
+  ASSERT(view.signature() == base58::encode(std::string(64, (char)7)));
+  ASSERT(view.header.num_required_signatures == 1 && view.header.num_readonly_unsigned_accounts == 2);
+  ASSERT(view.num_account_keys == 3);
+  ASSERT(view.account_key(0) == PAYER);
+  ASSERT(view.instructions.size() == 2);
+  ASSERT(view.program_id(view.instructions[0]) == MARKET_PROGRAM);
+  ASSERT(view.program_id(view.instructions[1]) == OTHER_PROGRAM);
+  ASSERT(view.instructions[1].num_accounts == 1 && view.instructions[1].accounts[0] == 0);
+  ASSERT(view.instructions[1].data_size == 2 && view.instructions[1].data[0] == 7 && view.instructions[1].data[1] == 1);
+  // The view points into the serialized bytes
+  ASSERT(view.account_keys >= legacy.data() && view.account_keys < legacy.data() + legacy.size());
+  ASSERT(view.instructions[0].data > legacy.data() && view.instructions[0].data < legacy.data() + legacy.size());
+
+  auto v0 = serialized_transaction({MARKET_PROGRAM}, 8, true);
+  ASSERT(view.parse(v0.data(), v0.size()));
+  ASSERT(view.versioned);
+  ASSERT(view.instructions.size() == 1);
+  ASSERT(view.program_id(view.instructions[0]) == MARKET_PROGRAM);
+  ASSERT(view.address_table_lookups.size() == 1);
+  ASSERT(PublicKey(view.address_table_lookups[0].account_key) == OTHER_PROGRAM);
+  ASSERT(view.address_table_lookups[0].num_writable_indexes == 2 && view.address_table_lookups[0].writable_indexes[1] == 2);
+  ASSERT(view.address_table_lookups[0].num_readonly_indexes == 1 && view.address_table_lookups[0].readonly_indexes[0] == 3);
+
+  for (size_t size = 0; size < legacy.size(); size++) {
+    ASSERT(!view.parse(legacy.data(), size));
+  }
+  legacy.push_back(0);
+  ASSERT(!view.parse(legacy.data(), legacy.size()));
+}
+
+TEST_CASE("TransactionView prefilters on the invoked programs") {
+  auto both = serialized_transaction({MARKET_PROGRAM, OTHER_PROGRAM}, 1);
+  auto other = serialized_transaction({OTHER_PROGRAM}, 2);
+  auto v0 = serialized_transaction({MARKET_PROGRAM}, 3, true);
+  ASSERT(TransactionView::invokes(both.data(), both.size(), {MARKET_PROGRAM}));
+  ASSERT(!TransactionView::invokes(other.data(), other.size(), {MARKET_PROGRAM}));
+  ASSERT(TransactionView::invokes(other.data(), other.size(), {MARKET_PROGRAM, OTHER_PROGRAM}));
+  ASSERT(TransactionView::invokes(v0.data(), v0.size(), {MARKET_PROGRAM}));
+  ASSERT(!TransactionView::invokes(both.data(), both.size() - 1, {MARKET_PROGRAM}));
+}
+
+/** A getBlock response with transactions alternating between the market program and another program, and one garbled transaction */
+json block_response(uint64_t slot, size_t count) {
+  json transactions = json::array();
+  for (size_t i = 0; i < count; i++) {
+    std::vector<uint8_t> bytes = i % 2 == 0
+      ? serialized_transaction({OTHER_PROGRAM, MARKET_PROGRAM}, (uint8_t)i, i % 4 == 0)
+      : serialized_transaction({OTHER_PROGRAM}, (uint8_t)i);
+    if (i == 6) {
+      bytes.resize(bytes.size() - 3);
+    }
+    transactions.push_back({
+      {"transaction", {base64::encode(bytes), "base64"}},
+      {"meta", {{"fee", 5000 + i}, {"err", nullptr}}},
+      {"version", i % 4 == 0 ? json(0) : json("legacy")},
+    });
+  }
+  return {
+    {"jsonrpc", "2.0"},
+    {"id", 1},
+    {"result", {
+      {"blockHeight", slot - 100},
+      {"blockTime", 1700000000 + slot},
+      {"blockhash", PAYER.to_base58()},
+      {"parentSlot", slot - 1},
+      {"previousBlockhash", PAYER.to_base58()},
+      {"transactions", transactions},
+    }},
+  };
+}
+
+json error_response(int64_t code) {
+  return {{"jsonrpc", "2.0"}, {"id", 1}, {"error", {{"code", code}, {"message", "error " + std::to_string(code)}}}};
+}
+
+TEST_CASE("BlockFetcher fetches requested slots, decodes matching transactions and delivers in slot order") {
+  threading::ThreadPool pool(4);
+  std::mutex mutex;
+  std::map<uint64_t, int> attempts;
+  BlockFetcher fetcher([&](uint64_t slot) {
+    int attempt;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      attempt = ++attempts[slot];
+    }
+    usleep((slot % 3) * 2000);
+    if (slot % 5 == 3) {
+      return error_response(BlockFetcher::SLOT_SKIPPED);
+    }
+    if (slot == 17 && attempt < 3) {
+      return error_response(BlockFetcher::BLOCK_NOT_AVAILABLE);
+    }
+    if (slot == 19) {
+      return error_response(-32000);
+    }
+    return block_response(slot, 200);
+  }, pool, {MARKET_PROGRAM}, 4, 5, std::chrono::milliseconds(5));
+
+  fetcher.request(10);
+  fetcher.request(20);
+  fetcher.request(15);
+  ASSERT(fetcher.pending() == 11);
+  fetcher.wait();
+
+  std::vector<std::shared_ptr<const BlockFetcher::Block>> blocks;
+  ASSERT(fetcher.poll([&](const std::shared_ptr<const BlockFetcher::Block>& block) { blocks.push_back(block); }) == 11);
+  ASSERT(fetcher.pending() == 0);
+  ASSERT(attempts[17] == 3);
+  ASSERT(attempts[15] == 1);
+
+  for (size_t i = 0; i < blocks.size(); i++) {
+    auto& block = *blocks[i];
+    ASSERT(block.slot == 10 + i);
+    if (block.slot == 13 || block.slot == 18) {
+      ASSERT(block.skipped);
+      continue;
+    }
+    ASSERT(!block.skipped);
+    if (block.slot == 19) {
+      ASSERT(block.error == "error -32000");
+      continue;
+    }
+    ASSERT(block.error.empty());
+    ASSERT(block.parent_slot == block.slot - 1);
+    ASSERT(block.block_height == block.slot - 100);
+    ASSERT(block.block_time == 1700000000 + (int64_t)block.slot);
+    ASSERT(block.num_transactions == 200);
+    // The garbled transaction no longer parses far enough to show an instruction for the market program
+    ASSERT(block.malformed == 0);
+    ASSERT(block.transactions.size() == 99);
+    for (size_t t = 0; t < block.transactions.size(); t++) {
+      auto& transaction = block.transactions[t];
+      ASSERT(t == 0 || transaction.index > block.transactions[t - 1].index);
+      ASSERT(transaction.index % 2 == 0 && transaction.index != 6);
+      ASSERT(transaction.view.versioned == (transaction.index % 4 == 0));
+      ASSERT(transaction.view.program_id(transaction.view.instructions[1]) == MARKET_PROGRAM);
+      ASSERT(transaction.view.instructions[1].data[0] == (uint8_t)transaction.index);
+      ASSERT((*transaction.meta)["fee"] == 5000 + transaction.index);
+      ASSERT(transaction.view.data >= block.buffer.data() && transaction.view.data < block.buffer.data() + block.buffer.size());
+    }
+  }
+
+  auto stats = fetcher.stats();
+  ASSERT(stats.blocks == 8);
+  ASSERT(stats.skipped == 2);
+  ASSERT(stats.errors == 1);
+  ASSERT(stats.retries == 2);
+  ASSERT(stats.transactions == 8 * 200);
+  ASSERT(stats.matched == 8 * 99);
+  ASSERT(stats.malformed == 0);
+  ASSERT(stats.fetch_latency > std::chrono::nanoseconds::zero());
+  ASSERT(stats.decode_latency > std::chrono::nanoseconds::zero());
+}
+
+TEST_CASE("BlockFetcher holds blocks back until the slots before them are complete") {
+  threading::ThreadPool pool(2);
+  std::atomic<bool> release{false};
+  BlockFetcher fetcher([&](uint64_t slot) {
+    while (slot == 100 && !release) {
+      usleep(1000);
+    }
+    return block_response(slot, 8);
+  }, pool, {}, 2);
+
+  fetcher.request(100);
+  fetcher.request(101);
+  while (fetcher.stats().blocks < 1) {
+    usleep(1000);
+  }
+  size_t delivered = fetcher.poll([](const std::shared_ptr<const BlockFetcher::Block>&) {});
+  ASSERT(delivered == 0);
+
+  release = true;
+  fetcher.wait();
+  std::vector<uint64_t> slots;
+  fetcher.poll([&](const std::shared_ptr<const BlockFetcher::Block>& block) {
+    slots.push_back(block->slot);
+    // Without a filter every well-formed transaction is decoded
+    ASSERT(block->transactions.size() == 7);
+    ASSERT(block->malformed == 1);
+  });
+  ASSERT(slots == std::vector<uint64_t>({100, 101}));
+}
+
+TEST_CASE("BlockFetcher fills small gaps between requested slots only") {
+  threading::ThreadPool pool(2);
+  std::atomic<int> fetches{0};
+  BlockFetcher fetcher([&](uint64_t slot) {
+    fetches++;
+    return block_response(slot, 0);
+  }, pool, {}, 2, 10, std::chrono::milliseconds(1), 8);
+
+  fetcher.request(1000);
+  fetcher.request(1004);
+  fetcher.request(2000);
+  fetcher.wait();
+  ASSERT(fetches == 1 + 4 + 1);
+  ASSERT(fetcher.poll([](const std::shared_ptr<const BlockFetcher::Block>& block) {
+    ASSERT(block->num_transactions == 0);
+  }) == 6);
+}
@@ -0,0 +1,67 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+TEST_CASE("changed_ranges merges adjacent bytes across blocks") {
+  std::vector<uint8_t> previous(100, 0);
+  std::vector<uint8_t> current(100, 0);
+  current[3] = 1;
+  for (int i = 14; i < 20; i++) {
+    current[i] = 1;
+  }
+  current[99] = 1;
+
+  std::vector<diff::ByteRange> ranges;
+  diff::changed_ranges(previous.data(), current.data(), current.size(), ranges);
+  ASSERT(ranges.size() == 3);
+  ASSERT(ranges[0].start == 3 && ranges[0].end == 4);
+  ASSERT(ranges[1].start == 14 && ranges[1].end == 20);
+  ASSERT(ranges[2].start == 99 && ranges[2].end == 100);
+}
+
+TEST_CASE("ByteDiffer only calls back for changed fields") {
+  diff::ByteDiffer differ;
+  int price_changes = 0;
+  int size_changes = 0;
+  differ.watch(64, 8, [&](const uint8_t*, const uint8_t*, size_t) {
+    price_changes++;
+  });
+  differ.watch(72, 8, [&](const uint8_t*, const uint8_t*, size_t) {
+    size_changes++;
+  });
+
+  std::vector<uint8_t> data(128, 0);
+  differ.update(data.data(), data.size());
+  ASSERT(price_changes == 1 && size_changes == 1);
+
+  data[10] = 1;
+  differ.update(data.data(), data.size());
+  ASSERT(price_changes == 1 && size_changes == 1);
+
+  data[71] = 1;
+  differ.update(data.data(), data.size());
+  ASSERT(price_changes == 2 && size_changes == 1);
+
+  differ.update(data.data(), data.size());
+  ASSERT(price_changes == 2 && size_changes == 1);
+  ASSERT(differ.ranges().empty());
+
+  data[64] = 2;
+  data[79] = 2;
+  differ.update(data.data(), data.size());
+  ASSERT(price_changes == 3 && size_changes == 2);
+}
+
+TEST_CASE("Decode base64 into a reusable buffer") {
+  std::vector<uint8_t> buffer;
+  size_t length = base64::decode(std::string("AAEAAg=="), buffer);
+  ASSERT(length == 4);
+  ASSERT(buffer[0] == 0 && buffer[1] == 1 && buffer[2] == 0 && buffer[3] == 2);
+}
@@ -0,0 +1,93 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+#define POOL PublicKey("58oQChx4yWmvKdwLLZzBi4ChoCc2fqCUWBkwMihLYQo2")
+#define MARKET PublicKey("8BnEgHoWFysVcuFFX7QztDmzuH8r5ZTDzKHNxWZn2vdP")
+
+Transaction swap(const PublicKey& payer, uint8_t amount) {
+  Transaction transaction;
+  transaction.add({
+    .program_id = TOKEN_PROGRAM_ID,
+    .accounts = {
+      {payer, true, true},
+      {POOL, false, true},
+    },
+    .data = {9, amount},
+  });
+  return transaction;
+}
+
+TEST_CASE("Compute budget instructions") {
+  auto limit = compute_budget::set_compute_unit_limit_instruction(300000);
+  ASSERT(limit.program_id == COMPUTE_BUDGET_PROGRAM_ID);
+  ASSERT(limit.accounts.empty());
+  ASSERT((limit.data == std::vector<uint8_t>{2, 0xe0, 0x93, 0x04, 0x00}));
+
+  auto price = compute_budget::set_compute_unit_price_instruction(10000);
+  ASSERT((price.data == std::vector<uint8_t>{3, 0x10, 0x27, 0, 0, 0, 0, 0, 0}));
+
+  auto payer = Keypair::generate();
+  Transaction transaction = swap(payer.public_key, 1);
+  compute_budget::set_compute_budget(transaction, 300000, 1);
+  compute_budget::set_compute_budget(transaction, 200000, 0);
+  ASSERT(transaction.message.instructions.size() == 2);
+  ASSERT(transaction.message.instructions[0].data[0] == 2);
+  ASSERT(transaction.message.instructions[1].program_id == TOKEN_PROGRAM_ID);
+
+  // A heap frame request (discriminator 1) set by the caller is kept
+  transaction.add({
+    .program_id = COMPUTE_BUDGET_PROGRAM_ID,
+    .accounts = {},
+    .data = {1, 0, 0, 4, 0},
+  });
+  compute_budget::set_compute_budget(transaction, 100000, 7);
+  ASSERT(transaction.message.instructions.size() == 4);
+  ASSERT(transaction.message.instructions[0].data[0] == 2);
+  ASSERT(transaction.message.instructions[1].data[0] == 3);
+  ASSERT(transaction.message.instructions[3].program_id == COMPUTE_BUDGET_PROGRAM_ID);
+  ASSERT(transaction.message.instructions[3].data[0] == 1);
+}
+
+TEST_CASE("PriorityFeeEstimator keeps a rolling window per account") {
+  compute_budget::PriorityFeeEstimator estimator(4);
+  estimator.update(POOL, {{100, 10}, {101, 0}, {102, 30}, {103, 20}});
+  ASSERT(estimator.percentile(POOL, 50) == 10);
+  ASSERT(estimator.percentile(POOL, 75) == 20);
+  ASSERT(estimator.percentile(POOL, 100) == 30);
+  ASSERT(estimator.percentile(POOL, 0) == 0);
+
+  // Slots 100 and 101 fall out of the window
+  estimator.update(POOL, {{104, 50}, {105, 40}});
+  ASSERT(estimator.percentile(POOL, 50) == 30);
+  ASSERT(estimator.percentile(POOL, 0) == 20);
+
+  estimator.update(MARKET, {{105, 100}});
+  ASSERT(estimator.percentile(MARKET, 50) == 100);
+  ASSERT(estimator.percentile(NATIVE_MINT, 50) == 0);
+  ASSERT(estimator.estimate({POOL, MARKET}, 50) == 100);
+  ASSERT(estimator.estimate({POOL, NATIVE_MINT}, 50) == 30);
+}
+
+TEST_CASE("ComputeUnitSizer caches limits per transaction template") {
+  compute_budget::ComputeUnitSizer sizer(0.1);
+  auto payer = Keypair::generate();
+  Transaction first = swap(payer.public_key, 1);
+  ASSERT(!sizer.cached(first));
+  ASSERT(sizer.record(first, 50000) == 55000);
+
+  Transaction second = swap(payer.public_key, 2);
+  compute_budget::set_compute_budget(second, 1000, 5);
+  ASSERT(sizer.cached(second) == 55000u);
+
+  Transaction other = swap(Keypair::generate().public_key, 1);
+  ASSERT(!sizer.cached(other));
+  ASSERT(sizer.record(other, MAX_COMPUTE_UNIT_LIMIT) == MAX_COMPUTE_UNIT_LIMIT);
+}
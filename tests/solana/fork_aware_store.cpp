@@ -0,0 +1,80 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+#define ACCOUNT PublicKey("8VBafTNv1F8k5Bg7DTVwhitw3MGAMTmekHsgLuMJxLC8")
+
+AccountCache::Entry version(uint64_t slot, uint64_t lamports) {
+  return {lamports, SYSTEM_PROGRAM, slot, {}};
+}
+
+uint64_t lamports(const ForkAwareAccountStore& store, Commitment commitment) {
+  auto entry = store.get(ACCOUNT, commitment);
+  return entry ? entry->lamports : 0;
+}
+
+TEST_CASE("ForkAwareAccountStore layers versions by commitment") {
+  ForkAwareAccountStore store;
+  store.update_slot({100, 99, 90});
+  store.update(ACCOUNT, version(100, 1));
+  store.update_slot({101, 100, 90});
+  store.update(ACCOUNT, version(101, 2));
+  store.confirm(100);
+
+  ASSERT(lamports(store, Commitment::Processed) == 2);
+  ASSERT(lamports(store, Commitment::Confirmed) == 1);
+  ASSERT(lamports(store, Commitment::Finalized) == 0);
+
+  // A version that arrives before its slot notification is visible at processed
+  store.update(ACCOUNT, version(102, 3));
+  ASSERT(lamports(store, Commitment::Processed) == 3);
+  store.update_slot({102, 101, 100});
+  ASSERT(lamports(store, Commitment::Processed) == 3);
+  ASSERT(lamports(store, Commitment::Finalized) == 1);
+  ASSERT(store.slot(Commitment::Confirmed) == 100);
+}
+
+TEST_CASE("ForkAwareAccountStore rolls back abandoned forks") {
+  ForkAwareAccountStore store;
+  std::vector<uint64_t> orphaned;
+  store.on_rollback([&](const PublicKey& pubkey, const AccountCache::Entry& entry) {
+    ASSERT(pubkey == ACCOUNT);
+    orphaned.push_back(entry.slot);
+  });
+
+  store.update_slot({100, 99, 90});
+  store.update(ACCOUNT, version(100, 1));
+
+  // Fork A: 100 -> 101 -> 103
+  store.update_slot({101, 100, 90});
+  store.update(ACCOUNT, version(101, 2));
+  store.update_slot({103, 101, 90});
+  store.update(ACCOUNT, version(103, 4));
+  ASSERT(lamports(store, Commitment::Processed) == 4);
+
+  // The node switches to fork B: 100 -> 102, fork A is not visible anymore
+  store.update_slot({102, 100, 90});
+  ASSERT(lamports(store, Commitment::Processed) == 1);
+  store.update(ACCOUNT, version(102, 3));
+  ASSERT(lamports(store, Commitment::Processed) == 3);
+  ASSERT(store.versions(ACCOUNT) == 4);
+
+  // Rooting fork B drops the versions of fork A and collapses the rooted ones
+  store.update_slot({104, 102, 102});
+  ASSERT((orphaned == std::vector<uint64_t>{101, 103}));
+  ASSERT(store.versions(ACCOUNT) == 1);
+  ASSERT(lamports(store, Commitment::Finalized) == 3);
+  ASSERT(lamports(store, Commitment::Confirmed) == 3);
+  ASSERT(lamports(store, Commitment::Processed) == 3);
+
+  // Versions older than the root are ignored
+  store.update(ACCOUNT, version(101, 9));
+  ASSERT(store.versions(ACCOUNT) == 1);
+}
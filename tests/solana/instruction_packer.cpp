@@ -0,0 +1,155 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+Transaction::Message::Instruction close_account(const PublicKey& account, const PublicKey& owner) {
+  return {
+    .program_id = TOKEN_PROGRAM_ID,
+    .accounts = {
+      {account, false, true},
+      {owner, false, true},
+      {owner, true, false},
+    },
+    .data = {9},
+  };
+}
+
+TEST_CASE("InstructionPacker sizes transactions exactly") {
+  auto payer = Keypair::generate();
+  auto other_signer = Keypair::generate();
+
+  Transaction transaction;
+  transaction.add(compute_budget::set_compute_unit_price_instruction(1000));
+  transaction.add(close_account(Keypair::generate().public_key, payer.public_key));
+  transaction.add(close_account(Keypair::generate().public_key, other_signer.public_key));
+  transaction.add({
+    .program_id = SYSTEM_PROGRAM,
+    .accounts = {
+      {payer.public_key, true, true},
+      {TOKEN_PROGRAM_ID, false, false},
+    },
+    .data = std::vector<uint8_t>(300, 1),
+  });
+
+  size_t size = InstructionPacker::serialized_size(transaction, payer.public_key);
+  ASSERT(size == transaction.sign({payer, other_signer}).size());
+}
+
+TEST_CASE("InstructionPacker packs into the fewest transactions") {
+  auto payer = Keypair::generate();
+  InstructionPacker packer(payer.public_key, {compute_budget::set_compute_unit_price_instruction(1000)});
+  for (int i = 0; i < 60; i++) {
+    packer.add(close_account(Keypair::generate().public_key, payer.public_key));
+  }
+
+  auto transactions = packer.pack();
+  ASSERT(transactions.size() == 3);
+  size_t count = 0;
+  for (auto& transaction : transactions) {
+    ASSERT(transaction.message.instructions[0].program_id == COMPUTE_BUDGET_PROGRAM_ID);
+    size_t size = transaction.sign({payer}).size();
+    ASSERT(size == InstructionPacker::serialized_size(transaction, payer.public_key));
+    ASSERT(size <= PACKET_DATA_SIZE);
+    count += transaction.message.instructions.size() - 1;
+  }
+  ASSERT(count == 60);
+}
+
+TEST_CASE("InstructionPacker counts a key that becomes a signer later in the instruction") {
+  auto payer = Keypair::generate();
+  InstructionPacker packer(payer.public_key);
+  // Every owner first appears as a writable non-signer, then as a signer
+  for (int i = 0; i < 20; i++) {
+    packer.add(close_account(Keypair::generate().public_key, Keypair::generate().public_key));
+  }
+
+  auto transactions = packer.pack();
+  size_t count = 0;
+  for (auto& transaction : transactions) {
+    ASSERT(InstructionPacker::serialized_size(transaction, payer.public_key) <= PACKET_DATA_SIZE);
+    count += transaction.message.instructions.size();
+  }
+  ASSERT(count == 20);
+  ASSERT(transactions.size() == 3);
+}
+
+TEST_CASE("InstructionPacker respects the account lock limit") {
+  auto payer = Keypair::generate();
+  InstructionPacker packer(payer.public_key, {}, PACKET_DATA_SIZE, 8);
+  for (int i = 0; i < 12; i++) {
+    packer.add(close_account(Keypair::generate().public_key, payer.public_key));
+  }
+  // Every transaction has the payer, the token program and 6 accounts to close
+  auto transactions = packer.pack();
+  ASSERT(transactions.size() == 2);
+  ASSERT(transactions[0].message.instructions.size() == 6);
+}
+
+TEST_CASE("InstructionPacker keeps ordering constraints") {
+  auto payer = Keypair::generate();
+  InstructionPacker packer(payer.public_key, {}, 500);
+  auto large = [](uint8_t tag) {
+    return Transaction::Message::Instruction{
+      .program_id = SYSTEM_PROGRAM,
+      .accounts = {},
+      .data = std::vector<uint8_t>(150, tag),
+    };
+  };
+  size_t first = packer.add(large(1));
+  packer.add(large(2));
+  packer.add(large(3), {first});
+  size_t fourth = packer.add(large(4));
+  packer.add(large(5), {fourth});
+
+  auto transactions = packer.pack();
+  std::vector<std::vector<uint8_t>> order;
+  for (auto& transaction : transactions) {
+    ASSERT(transaction.sign({payer}).size() <= 500);
+    std::vector<uint8_t> tags;
+    for (auto& instruction : transaction.message.instructions) {
+      tags.push_back(instruction.data[0]);
+    }
+    order.push_back(tags);
+  }
+  ASSERT(order.size() == 3);
+  ASSERT((order[0] == std::vector<uint8_t>{1, 3}));
+  ASSERT((order[1] == std::vector<uint8_t>{4, 5}));
+  ASSERT((order[2] == std::vector<uint8_t>{2}));
+
+  InstructionPacker tiny(payer.public_key, {}, 200);
+  tiny.add(large(1));
+  bool thrown = false;
+  try {
+    tiny.pack();
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+TEST_CASE("Transaction compile merges the flags of repeated accounts") {
+  auto payer = Keypair::generate();
+  PublicKey account = Keypair::generate().public_key;
+  Transaction transaction;
+  transaction.add({
+    .program_id = TOKEN_PROGRAM_ID,
+    .accounts = {{account, false, false}},
+    .data = {},
+  });
+  transaction.add({
+    .program_id = TOKEN_PROGRAM_ID,
+    .accounts = {{account, false, true}},
+    .data = {},
+  });
+  auto message = transaction.message.compile({payer});
+  ASSERT(message.account_keys.size() == 3);
+  ASSERT(message.account_keys[1] == account);
+  ASSERT(message.header.num_readonly_unsigned_accounts == 1);
+}
@@ -0,0 +1,142 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/allocation_counter.hpp"
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+const std::string OUTPUT = "/tmp/logging_test.log";
+
+/** Sends the log to a fresh file, returns its descriptor */
+int capture() {
+  int fd = open(OUTPUT.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+  ASSERT(fd != -1);
+  logging::set_output(fd);
+  return fd;
+}
+
+/** Writes out what was logged, restores stderr and returns the lines */
+std::vector<std::string> captured(int fd) {
+  logging::set_output(2);
+  close(fd);
+  std::ifstream file(OUTPUT);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(file, line)) {
+    lines.push_back(line);
+  }
+  unlink(OUTPUT.c_str());
+  return lines;
+}
+
+bool ends_with(const std::string& line, const std::string& suffix) {
+  return line.size() >= suffix.size() && line.compare(line.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+TEST_CASE("Log records are formatted later from copies of their arguments") {
+  int fd = capture();
+  char buffer[32];
+  strcpy(buffer, "before");
+  LOG_ERROR("%s failed: %d %llu %.2f", buffer, -1, (unsigned long long)18446744073709551615ull, 0.25);
+  strcpy(buffer, "after");
+  LOG_WARNING("no arguments");
+  LOG_INFO("%s", std::string(1000, 'x').c_str());
+  auto lines = captured(fd);
+
+  ASSERT(lines.size() == 3);
+  ASSERT(ends_with(lines[0], " ERROR [1] before failed: -1 18446744073709551615 0.25"));
+  ASSERT(ends_with(lines[1], " WARNING [1] no arguments"));
+  // Long strings are truncated to the record
+  ASSERT(lines[2].find(" INFO [1] xxxx") != std::string::npos);
+  ASSERT(lines[2].size() < 300);
+}
+
+TEST_CASE("Log records keep the precision of strings") {
+  int fd = capture();
+  const char body[] = "{\"result\":1}trailing bytes";
+  LOG_WARNING("Response: %.*s", 12, body);
+  auto lines = captured(fd);
+
+  ASSERT(lines.size() == 1);
+  ASSERT(ends_with(lines[0], " WARNING [1] Response: {\"result\":1}"));
+}
+
+TEST_CASE("Log levels are filtered at runtime and compiled out below MANY_LOG_LEVEL") {
+  int evaluated = 0;
+  auto argument = [&]() { return ++evaluated; };
+
+  int fd = capture();
+  // Debug is below the default MANY_LOG_LEVEL, its arguments are not even evaluated
+  LOG_DEBUG("debug %d", argument());
+  logging::set_level(logging::Level::Debug);
+  LOG_DEBUG("debug %d", argument());
+  logging::set_level(logging::Level::Warning);
+  LOG_INFO("info %d", argument());
+  LOG_WARNING("warning %d", argument());
+  logging::set_level(logging::Level::Info);
+  auto lines = captured(fd);
+
+  ASSERT(evaluated == 1);
+  ASSERT(lines.size() == 1);
+  ASSERT(ends_with(lines[0], " WARNING [1] warning 1"));
+}
+
+TEST_CASE("Logging from a thread with its ring does not allocate") {
+  int fd = capture();
+  LOG_INFO("registers the ring of the thread");
+  auto counts = allocations::count([&]() {
+    for (int i = 0; i < 100; i++) {
+      LOG_ERROR("read() failed on socket %d: %s", i, "connection closed");
+    }
+  });
+  auto lines = captured(fd);
+  ASSERT(counts.allocations == 0);
+  ASSERT(lines.size() == 101);
+}
+
+TEST_CASE("Every thread logs through its own ring, full rings drop and report") {
+  int fd = capture();
+  const int threads = 4;
+  const int records = 3000;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([t]() {
+      for (int i = 0; i < records; i++) {
+        LOG_INFO("thread %d record %d", t, i);
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  auto lines = captured(fd);
+
+  // Each thread's records are in order, and every record is either written or counted as dropped
+  std::map<int, int> last;
+  std::map<int, long> accounted;
+  std::map<std::string, int> thread_of;
+  for (auto& line : lines) {
+    std::string id = line.substr(line.find('['), line.find(']') - line.find('[') + 1);
+    int t, i;
+    unsigned long long dropped;
+    if (sscanf(line.c_str() + line.find(']') + 2, "thread %d record %d", &t, &i) == 2) {
+      ASSERT(last.count(t) == 0 || i > last[t]);
+      last[t] = i;
+      accounted[t]++;
+      thread_of[id] = t;
+    } else {
+      ASSERT(sscanf(line.c_str() + line.find(']') + 2, "%llu log records dropped", &dropped) == 1);
+      ASSERT(thread_of.count(id) == 1);
+      accounted[thread_of[id]] += dropped;
+    }
+  }
+  ASSERT(accounted.size() == threads);
+  for (auto& thread : accounted) {
+    ASSERT(thread.second == records);
+  }
+}
@@ -0,0 +1,207 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/mock_server.hpp"
+
+using namespace solana;
+
+/** Polls the connection until the condition holds, or fails after two seconds */
+template <typename F>
+void poll_until(Connection& connection, F condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (!condition()) {
+    ASSERT(std::chrono::steady_clock::now() < deadline);
+    connection.poll();
+    usleep(500);
+  }
+}
+
+TEST_CASE("MockServer answers the Connection methods from its simulated cluster") {
+  mock::MockServer server;
+  Connection connection(server.endpoint(), Commitment::Processed);
+
+  ASSERT(connection.get_version().unwrap().version == "1.18.0");
+  ASSERT(connection.get_identity().unwrap().identity == server.identity());
+  ASSERT(connection.get_slot().unwrap() >= 1000);
+  PublicKey leader = connection.get_slot_leader().unwrap();
+  ASSERT(leader == server.identity());
+  ASSERT(connection.get_leader_schedule(leader).unwrap().schedule.size() > 0);
+  ASSERT(connection.get_cluster_nodes().unwrap()[0].pubkey == server.identity());
+  ASSERT(connection.get_latest_blockhash().unwrap().blockhash.size() > 0);
+  ASSERT(connection.get_token_supply(NATIVE_MINT).unwrap().amount > 0);
+
+  auto keypair = Keypair::generate();
+  ASSERT(connection.get_balance(keypair.public_key).unwrap() == 0);
+  ASSERT(!connection.get_account_info(keypair.public_key).ok());
+  std::string airdrop = connection.request_airdrop(keypair.public_key).unwrap();
+  ASSERT(connection.get_balance(keypair.public_key).unwrap() == LAMPORTS_PER_SOL);
+  ASSERT(connection.get_account_info(keypair.public_key).unwrap().lamports == LAMPORTS_PER_SOL);
+  auto account_keys = connection.get_transaction(airdrop).unwrap().transaction.message.account_keys;
+  ASSERT(std::find(account_keys.begin(), account_keys.end(), keypair.public_key) != account_keys.end());
+
+  // Sent transactions land in the current slot
+  Transaction transaction;
+  transaction.add(compute_budget::set_compute_unit_price_instruction(1000));
+  std::string signature = connection.sign_and_send_transaction(transaction, {keypair}).unwrap();
+  auto statuses = connection.get_signature_statuses({signature, airdrop, "unknown"}).unwrap();
+  ASSERT(statuses[0].found && statuses[1].found && !statuses[2].found);
+  auto history = connection.get_signatures_for_address(keypair.public_key).unwrap();
+  ASSERT(history.size() == 2);
+  ASSERT(history[0].signature == signature && history[1].signature == airdrop);
+
+  // Token accounts are read from the account data
+  PublicKey token_account = Keypair::generate().public_key;
+  std::vector<uint8_t> data(165, 0);
+  memcpy(&data[0], NATIVE_MINT.bytes.data(), PUBLIC_KEY_LENGTH);
+  memcpy(&data[32], keypair.public_key.bytes.data(), PUBLIC_KEY_LENGTH);
+  data[64] = 42;
+  server.set_account(token_account, 2039280, TOKEN_PROGRAM_ID, data);
+  ASSERT(connection.get_token_account_balance(token_account).unwrap().amount == 42);
+  auto token_accounts = connection.get_token_accounts_by_owner(keypair.public_key).unwrap();
+  ASSERT(token_accounts.size() == 1);
+  ASSERT(token_accounts[0].pubkey == token_account);
+  ASSERT(token_accounts[0].account.data.parsed.info.mint == NATIVE_MINT);
+
+  // Handlers can be replaced, unknown methods and handler errors are error responses
+  server.on("getSlot", [](const json&) -> json { return 7; });
+  ASSERT(connection.get_slot().unwrap() == 7);
+  server.on("getBalance", [](const json&) -> json { throw mock::RpcError(-32005, "Node is behind"); });
+  Result<uint64_t> balance = connection.get_balance(keypair.public_key);
+  ASSERT(!balance.ok() && balance._error->code == -32005);
+  json response = http::post(server.endpoint(), {{"jsonrpc", "2.0"}, {"id", 3}, {"method", "getNothing"}});
+  ASSERT(response["error"]["code"] == -32601 && response["id"] == 3);
+
+  // Batches are answered in order
+  http::ConnectionPool pool(server.endpoint(), 1);
+  json batch = json::array();
+  for (int i = 0; i < 5; i++) {
+    batch.push_back({{"jsonrpc", "2.0"}, {"id", i}, {"method", i % 2 == 0 ? "getVersion" : "getIdentity"}});
+  }
+  for (int round = 0; round < 3; round++) {
+    json responses = pool.post(batch);
+    ASSERT(responses.size() == 5);
+    ASSERT(responses[4]["id"] == 4 && responses[4]["result"].contains("solana-core"));
+  }
+  ASSERT(pool.connects() == 1);
+  ASSERT(server.stats().requests >= 3);
+
+  // Kept-alive requests share one connection
+  connection.keep_alive();
+  ASSERT(connection.is_kept_alive());
+  uint64_t connections = server.stats().http_connections;
+  for (int i = 0; i < 3; i++) {
+    ASSERT(connection.get_version().unwrap().version == "1.18.0");
+  }
+  ASSERT(server.stats().http_connections == connections + 1);
+  connection.keep_alive(0);
+  ASSERT(!connection.is_kept_alive());
+}
+
+TEST_CASE("MockServer pushes slot, root, account and signature notifications") {
+  mock::MockServer::Config config;
+  config.slot_interval = std::chrono::milliseconds(2);
+  config.account_changes_per_second = 500;
+  mock::MockServer server(config);
+  Connection connection(server.endpoint(), Commitment::Processed);
+  auto keypair = Keypair::generate();
+
+  std::vector<uint64_t> slots;
+  int slot_subscription = connection.on_slot_change([&](Result<SlotInfo> result) {
+    slots.push_back(result.unwrap().slot);
+  });
+  uint64_t root = 0;
+  connection.on_root([&](Result<uint64_t> result) {
+    root = result.unwrap();
+  });
+  std::vector<uint64_t> lamports;
+  int account_subscription = connection.on_account_change(keypair.public_key, [&](Result<Account> result) {
+    lamports.push_back(result.unwrap().lamports);
+  });
+  poll_until(connection, [&]() { return server.subscriptions() == 3; });
+
+  poll_until(connection, [&]() { return slots.size() >= 20 && lamports.size() >= 10 && root > 0; });
+  for (size_t i = 1; i < slots.size(); i++) {
+    ASSERT(slots[i] == slots[i - 1] + 1);
+  }
+  ASSERT(root <= slots.back() - mock::MockServer::ROOT_DISTANCE);
+  // Every change bumps the account by a lamport, an airdrop is seen by the subscription too
+  ASSERT(lamports[1] == lamports[0] + 1);
+  connection.request_airdrop(keypair.public_key, 1000000);
+  poll_until(connection, [&]() { return lamports.back() > 1000000; });
+
+  std::string signature = connection.request_airdrop(keypair.public_key).unwrap();
+  bool confirmed = false;
+  connection.on_signature(signature, Commitment::Confirmed, [&](Result<SignatureStatus> result) {
+    confirmed = result.unwrap().found;
+  });
+  poll_until(connection, [&]() { return confirmed; });
+  ASSERT(server.stats().notifications >= slots.size() + lamports.size());
+
+  // Removed listeners are unsubscribed on the server by the subscription id it acknowledged
+  connection.remove_account_listener(account_subscription);
+  connection.remove_slot_change_listener(slot_subscription);
+  poll_until(connection, [&]() { return server.subscriptions() == 1; });
+}
+
+TEST_CASE("MockServer injects latency, drops and disconnects") {
+  mock::MockServer::Config config;
+  config.slot_interval = std::chrono::milliseconds(1);
+  config.faults.latency = std::chrono::milliseconds(20);
+  config.faults.jitter = std::chrono::milliseconds(5);
+  mock::MockServer server(config);
+  Connection connection(server.endpoint(), Commitment::Processed);
+
+  auto start = std::chrono::steady_clock::now();
+  connection.get_slot().unwrap();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  ASSERT(elapsed >= std::chrono::milliseconds(20));
+
+  mock::Faults faults;
+  faults.drop_rate = 1;
+  server.set_faults(faults);
+  bool failed = false;
+  try {
+    connection.get_slot();
+  } catch (const std::exception& e) {
+    failed = true;
+  }
+  ASSERT(failed);
+  ASSERT(server.stats().drops == 1);
+
+  faults = mock::Faults();
+  server.set_faults(faults);
+  size_t notifications = 0;
+  connection.on_slot_change([&](Result<SlotInfo>) { notifications++; });
+  poll_until(connection, [&]() { return notifications >= 5; });
+
+  faults.disconnect_rate = 1;
+  server.set_faults(faults);
+  poll_until(connection, [&]() { return !connection.is_connected(); });
+  ASSERT(server.stats().disconnects >= 1);
+}
+
+TEST_CASE("MockServer serves HTTPS and secure websockets with a self-signed certificate") {
+  std::string certificate = "/tmp/mock_server_test.crt";
+  std::string key = "/tmp/mock_server_test.key";
+  mock::MockServer::generate_certificate(certificate, key);
+
+  mock::MockServer::Config config;
+  config.certificate_file = certificate;
+  config.private_key_file = key;
+  config.slot_interval = std::chrono::milliseconds(2);
+  mock::MockServer server(config);
+  ASSERT(server.endpoint().rfind("https://", 0) == 0);
+
+  Connection connection(server.endpoint(), Commitment::Processed);
+  ASSERT(connection.get_version().unwrap().version == "1.18.0");
+  size_t notifications = 0;
+  connection.on_slot_change([&](Result<SlotInfo>) { notifications++; });
+  poll_until(connection, [&]() { return notifications >= 5; });
+
+  unlink(certificate.c_str());
+  unlink(key.c_str());
+}
@@ -0,0 +1,116 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+template <typename T>
+void write(std::vector<uint8_t>& data, size_t offset, T value) {
+  memcpy(&data[offset], &value, sizeof(T));
+}
+
+std::vector<uint8_t> pyth_price_account(int64_t price, uint64_t confidence, uint64_t publish_slot) {
+  std::vector<uint8_t> data(3312, 0);
+  write<uint32_t>(data, 0, oracle::PythPriceView::MAGIC);
+  write<uint32_t>(data, 4, 2);
+  write<uint32_t>(data, 8, oracle::PythPriceView::ACCOUNT_TYPE_PRICE);
+  write<int32_t>(data, 20, -8);
+  write<int64_t>(data, 96, 1700000000);
+  write<int64_t>(data, 208, price);
+  write<uint64_t>(data, 216, confidence);
+  write<uint32_t>(data, 224, (uint32_t)oracle::PriceStatus::Trading);
+  write<uint64_t>(data, 232, publish_slot);
+  return data;
+}
+
+std::vector<uint8_t> pyth_price_update_account(bool partial, int64_t price, uint64_t posted_slot) {
+  std::vector<uint8_t> data(134, 0);
+  std::copy(std::begin(oracle::PythPriceUpdateView::DISCRIMINATOR), std::end(oracle::PythPriceUpdateView::DISCRIMINATOR), data.begin());
+  data[40] = partial ? 0 : 1;
+  size_t message = partial ? 42 : 41;
+  write<int64_t>(data, message + 32, price);
+  write<uint64_t>(data, message + 40, 7);
+  write<int32_t>(data, message + 48, -6);
+  write<int64_t>(data, message + 52, 1700000001);
+  write<uint64_t>(data, message + 84, posted_slot);
+  return data;
+}
+
+TEST_CASE("PriceCache decodes Pyth price accounts") {
+  oracle::PriceCache cache(4);
+  size_t sol = cache.add_feed(PublicKey("H6ARHf6YXhGYeQfUzQNGk6rDNnLBQKrenN712K4AQJEG"));
+  size_t btc = cache.add_feed(PublicKey("GVXRSBjFk6e6J3NbVPXohDJetcTjaeeuykUpbQF8UoMU"));
+  ASSERT(cache.add_feed(PublicKey("H6ARHf6YXhGYeQfUzQNGk6rDNnLBQKrenN712K4AQJEG")) == sol);
+
+  oracle::Price price;
+  ASSERT(!cache.read(sol, price));
+
+  auto data = pyth_price_account(2512345678, 1000, 100);
+  ASSERT(cache.update(sol, data.data(), data.size()));
+  cache.set_current_slot(105);
+  ASSERT(cache.read(sol, price));
+  ASSERT(price.price == 2512345678);
+  ASSERT(price.confidence == 1000);
+  ASSERT(price.exponent == -8);
+  ASSERT(price.status == oracle::PriceStatus::Trading);
+  ASSERT(price.fully_verified);
+  ASSERT(price.staleness == 5);
+  ASSERT(fabs(price.value() - 25.12345678) < 1e-9);
+
+  data = pyth_price_update_account(true, 42, 103);
+  ASSERT(cache.update(btc, data.data(), data.size()));
+  ASSERT(cache.read(btc, price));
+  ASSERT(price.price == 42 && price.exponent == -6 && price.staleness == 2);
+  ASSERT(!price.fully_verified);
+
+  data = pyth_price_update_account(false, 43, 104);
+  ASSERT(cache.update(btc, data.data(), data.size()));
+  ASSERT(cache.read(btc, price));
+  ASSERT(price.price == 43 && price.confidence == 7 && price.publish_time == 1700000001);
+  ASSERT(price.fully_verified && price.status == oracle::PriceStatus::Trading);
+
+  // A partially verified update needs one more byte than a fully verified one
+  data = pyth_price_update_account(true, 44, 105);
+  data.resize(oracle::PythPriceUpdateView::FULL_SIZE);
+  ASSERT(!cache.update(btc, data.data(), data.size()));
+  data = pyth_price_update_account(false, 45, 105);
+  data.resize(oracle::PythPriceUpdateView::FULL_SIZE);
+  ASSERT(cache.update(btc, data.data(), data.size()));
+
+  // Any other account of the same size is not a price update
+  data = pyth_price_update_account(false, 46, 106);
+  data[0] ^= 1;
+  ASSERT(!cache.update(btc, data.data(), data.size()));
+  ASSERT(cache.read(btc, price) && price.price == 45);
+
+  std::vector<uint8_t> garbage(16, 0xFF);
+  ASSERT(!cache.update(btc, garbage.data(), garbage.size()));
+}
+
+TEST_CASE("PriceCache reads are consistent while writing") {
+  oracle::PriceCache cache(1);
+  size_t feed = cache.add_feed(PublicKey("H6ARHf6YXhGYeQfUzQNGk6rDNnLBQKrenN712K4AQJEG"));
+  std::atomic<bool> done(false);
+
+  std::thread reader([&]() {
+    oracle::Price price;
+    while (!done.load()) {
+      if (cache.read(feed, price)) {
+        ASSERT((uint64_t)price.price == price.confidence);
+        ASSERT(price.publish_slot == price.confidence);
+      }
+    }
+  });
+
+  for (uint64_t i = 1; i <= 100000; i++) {
+    auto data = pyth_price_account((int64_t)i, i, i);
+    cache.update(feed, data.data(), data.size());
+  }
+  done.store(true);
+  reader.join();
+}
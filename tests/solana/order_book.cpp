@@ -0,0 +1,168 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+const size_t NODE_COUNT = 8;
+
+std::vector<uint8_t> empty_slab() {
+  return std::vector<uint8_t>(openbook::SLAB_NODES_OFFSET + NODE_COUNT * openbook::SLAB_NODE_SIZE + openbook::SLAB_TAIL_SIZE, 0);
+}
+
+uint8_t* node(std::vector<uint8_t>& slab, uint32_t index) {
+  return &slab[openbook::SLAB_NODES_OFFSET + index * openbook::SLAB_NODE_SIZE];
+}
+
+void set_header(std::vector<uint8_t>& slab, uint32_t root, uint64_t leaf_count) {
+  memcpy(&slab[openbook::SLAB_HEADER_OFFSET + 20], &root, 4);
+  memcpy(&slab[openbook::SLAB_HEADER_OFFSET + 24], &leaf_count, 8);
+}
+
+void set_inner(std::vector<uint8_t>& slab, uint32_t index, uint32_t left, uint32_t right) {
+  uint32_t tag = (uint32_t)openbook::NodeTag::Inner;
+  memcpy(node(slab, index), &tag, 4);
+  memcpy(node(slab, index) + 24, &left, 4);
+  memcpy(node(slab, index) + 28, &right, 4);
+}
+
+void set_leaf(std::vector<uint8_t>& slab, uint32_t index, uint64_t price, uint64_t sequence, uint64_t quantity) {
+  uint32_t tag = (uint32_t)openbook::NodeTag::Leaf;
+  __uint128_t key = ((__uint128_t)price << 64) | sequence;
+  memcpy(node(slab, index), &tag, 4);
+  memcpy(node(slab, index) + 8, &key, 16);
+  memcpy(node(slab, index) + 56, &quantity, 8);
+}
+
+void set_free(std::vector<uint8_t>& slab, uint32_t index) {
+  memset(node(slab, index), 0, openbook::SLAB_NODE_SIZE);
+  uint32_t tag = (uint32_t)openbook::NodeTag::Free;
+  memcpy(node(slab, index), &tag, 4);
+}
+
+void check_same_levels(const openbook::OrderBookSide& a, const openbook::OrderBookSide& b) {
+  ASSERT(a.levels().size() == b.levels().size());
+  auto it = b.levels().begin();
+  for (auto& level : a.levels()) {
+    ASSERT(level.second.price == it->second.price);
+    ASSERT(level.second.quantity == it->second.quantity);
+    ASSERT(level.second.orders == it->second.orders);
+    it++;
+  }
+}
+
+TEST_CASE("OrderBookSide decodes a slab and applies diffs") {
+  auto slab = empty_slab();
+  set_inner(slab, 0, 1, 2);
+  set_inner(slab, 2, 3, 4);
+  set_leaf(slab, 1, 100, 1, 5);
+  set_leaf(slab, 3, 101, 2, 7);
+  set_leaf(slab, 4, 101, 3, 1);
+  set_header(slab, 0, 3);
+
+  openbook::OrderBookSide bids(openbook::Side::Bid);
+  bids.update(slab.data(), slab.size());
+  ASSERT(bids.orders().size() == 3);
+  ASSERT(bids.levels().size() == 2);
+  ASSERT(bids.best()->price == 101);
+  ASSERT(bids.best()->quantity == 8);
+  ASSERT(bids.best()->orders == 2);
+
+  // Partial fill of the best bid
+  set_leaf(slab, 3, 101, 2, 3);
+  bids.update(slab.data(), slab.size());
+  ASSERT(bids.best()->quantity == 4);
+
+  // Cancel both orders at 101
+  set_free(slab, 3);
+  set_free(slab, 4);
+  set_leaf(slab, 2, 100, 1, 5);
+  set_free(slab, 1);
+  set_header(slab, 2, 1);
+  bids.update(slab.data(), slab.size());
+  ASSERT(bids.orders().size() == 1);
+  ASSERT(bids.best()->price == 100);
+  ASSERT(bids.best()->quantity == 5);
+
+  // A new best bid in a previously unused node
+  set_inner(slab, 0, 2, 5);
+  set_leaf(slab, 5, 102, 4, 9);
+  set_header(slab, 0, 2);
+  bids.update(slab.data(), slab.size());
+  ASSERT(bids.best()->price == 102);
+
+  openbook::OrderBookSide reloaded(openbook::Side::Bid);
+  reloaded.update(slab.data(), slab.size());
+  check_same_levels(bids, reloaded);
+}
+
+TEST_CASE("OrderBookSide overwrites an order whose key appears in another node") {
+  auto slab = empty_slab();
+  set_inner(slab, 0, 1, 2);
+  set_leaf(slab, 1, 100, 1, 5);
+  set_leaf(slab, 2, 101, 2, 7);
+  set_header(slab, 0, 2);
+
+  openbook::OrderBookSide bids(openbook::Side::Bid);
+  bids.update(slab.data(), slab.size());
+
+  // The order at node 1 is written to node 3 with a new quantity and client order id before node 1 is freed
+  set_inner(slab, 0, 3, 2);
+  set_leaf(slab, 3, 100, 1, 2);
+  uint64_t client_order_id = 42;
+  memcpy(node(slab, 3) + 64, &client_order_id, 8);
+  bids.update(slab.data(), slab.size());
+  ASSERT(bids.orders().size() == 2);
+  auto& order = bids.orders().rbegin()->second;
+  ASSERT(order.price == 100);
+  ASSERT(order.quantity == 2);
+  ASSERT(order.client_order_id == 42);
+  auto& level = bids.levels().rbegin()->second;
+  ASSERT(level.quantity == 2);
+  ASSERT(level.orders == 1);
+
+  // Freeing the node the order moved from keeps the order, which node 3 owns now
+  set_free(slab, 1);
+  bids.update(slab.data(), slab.size());
+  ASSERT(bids.orders().size() == 2);
+  ASSERT(bids.orders().rbegin()->second.quantity == 2);
+  ASSERT(bids.levels().rbegin()->second.quantity == 2);
+  ASSERT(bids.levels().rbegin()->second.orders == 1);
+
+  // Freeing node 3 then removes it
+  set_free(slab, 0);
+  set_free(slab, 3);
+  set_header(slab, 2, 1);
+  bids.update(slab.data(), slab.size());
+  ASSERT(bids.orders().size() == 1);
+  ASSERT(bids.best()->price == 101);
+
+  openbook::OrderBookSide reloaded(openbook::Side::Bid);
+  reloaded.update(slab.data(), slab.size());
+  check_same_levels(bids, reloaded);
+}
+
+TEST_CASE("OrderBookSide sorts asks ascending") {
+  auto slab = empty_slab();
+  set_inner(slab, 0, 1, 2);
+  set_leaf(slab, 1, 100, 1, 5);
+  set_leaf(slab, 2, 99, 2, 7);
+  set_header(slab, 0, 2);
+
+  openbook::OrderBookSide asks(openbook::Side::Ask);
+  asks.update(slab.data(), slab.size());
+  ASSERT(asks.best()->price == 99);
+  ASSERT(asks.levels().rbegin()->second.price == 100);
+}
+
+TEST_CASE("OrderBookSide handles an empty slab") {
+  auto slab = empty_slab();
+  openbook::OrderBookSide asks(openbook::Side::Ask);
+  asks.update(slab.data(), slab.size());
+  ASSERT(asks.best() == nullptr);
+}
@@ -0,0 +1,159 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/mock_server.hpp"
+
+#include <sys/resource.h>
+
+using namespace solana;
+
+/** Returns the number of base pages of the buffer that are in memory */
+size_t resident_pages(const memory::Pages& pages) {
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  size_t count = (pages.size() + page_size - 1) / page_size;
+  std::vector<unsigned char> residency(count);
+  ASSERT(mincore(pages.data(), count * page_size, residency.data()) == 0);
+  size_t resident = 0;
+  for (auto page : residency) {
+    resident += page & 1;
+  }
+  return resident;
+}
+
+TEST_CASE("Pages map buffers with the page options") {
+  memory::Pages heap(1000);
+  ASSERT(heap.backing() == memory::Pages::HEAP);
+  ASSERT(heap.size() == 1000);
+
+  // A mapping is only faulted in on first use, unless it is prefaulted
+  size_t size = 64 * 4096;
+  memory::Pages prefaulted(size, {false, true, false});
+  ASSERT(prefaulted.backing() == memory::Pages::PAGES);
+  ASSERT(resident_pages(prefaulted) == 64);
+
+  // Without reserved huge pages the buffers fall back to transparent ones, aligned so that they can back them
+  memory::Pages lazy(3 * memory::HUGE_PAGE_SIZE + 1, {true, false, false});
+  memory::Pages huge(3 * memory::HUGE_PAGE_SIZE + 1, {true, true, false});
+  for (auto pages : {&lazy, &huge}) {
+    ASSERT(pages->backing() != memory::Pages::HEAP);
+    if (pages->backing() != memory::Pages::PAGES) {
+      ASSERT((uintptr_t)pages->data() % memory::HUGE_PAGE_SIZE == 0);
+    }
+  }
+  ASSERT(resident_pages(lazy) == 0);
+  ASSERT(resident_pages(huge) == (huge.size() + 4095) / 4096);
+
+  // Locking can be refused by RLIMIT_MEMLOCK, the buffer is usable either way
+  memory::Pages locked(4096, {false, false, true});
+  locked.data()[4095] = 1;
+  struct rlimit limit;
+  ASSERT(getrlimit(RLIMIT_MEMLOCK, &limit) == 0);
+  if (limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur >= 1024 * 1024) {
+    ASSERT(locked.is_locked());
+  }
+  ASSERT(!heap.is_locked() && !prefaulted.is_locked());
+}
+
+TEST_CASE("Pages keep their contents when resized and moved") {
+  for (auto options : {memory::PageOptions{}, memory::PageOptions{false, true, false}, memory::PageOptions{true, false, false}}) {
+    memory::Pages pages(100, options);
+    memcpy(pages.data(), "0123456789", 10);
+    auto backing = pages.backing();
+
+    pages.resize(3 * memory::HUGE_PAGE_SIZE);
+    ASSERT(pages.size() == 3 * memory::HUGE_PAGE_SIZE);
+    ASSERT(memcmp(pages.data(), "0123456789", 10) == 0);
+    ASSERT(pages.backing() == backing);
+    pages.data()[pages.size() - 1] = 1;
+
+    memory::Pages moved = std::move(pages);
+    ASSERT(pages.data() == nullptr);
+    ASSERT(memcmp(moved.data(), "0123456789", 10) == 0);
+  }
+}
+
+TEST_CASE("Caches allocate from huge pages through PageResource and Arena") {
+  memory::PageResource resource({true, true, false});
+  {
+    std::pmr::unsynchronized_pool_resource pool(&resource);
+    std::pmr::map<uint64_t, std::pmr::vector<uint8_t>> cache(&pool);
+    for (uint64_t i = 0; i < 1000; i++) {
+      cache[i].assign(165, (uint8_t)i);
+    }
+    ASSERT(cache[999][164] == (uint8_t)999);
+    ASSERT(resource.backing(cache[999].data()) != memory::Pages::HEAP);
+    // The pool's chunks share regions instead of a mapping each
+    ASSERT(resource.regions() == 1);
+
+    std::pmr::vector<uint8_t> large(3 * memory::HUGE_PAGE_SIZE, 1, &resource);
+    ASSERT(resource.regions() == 2);
+    large = std::pmr::vector<uint8_t>(&resource);
+    ASSERT(resource.regions() == 1);
+  }
+  // The current region is kept for the next allocations
+  ASSERT(resource.regions() == 1);
+
+  memory::Arena arena(memory::HUGE_PAGE_SIZE, {true, false, false});
+  std::pmr::vector<uint64_t> values(&arena);
+  values.assign(1000000, 7);
+  uint64_t blocks = arena.heap_allocations();
+  ASSERT(blocks > 1);
+  arena.reset();
+  ASSERT(arena.heap_allocations() == blocks + 1);
+  ASSERT(arena.capacity() >= 8000000);
+}
+
+TEST_CASE("AccountCache and ForkAwareAccountStore keep account data on huge pages") {
+  memory::PageResource resource({true, true, false});
+  std::pmr::unsynchronized_pool_resource pool(&resource);
+  auto pubkey = Keypair::generate().public_key;
+  Account account{2039280, TOKEN_PROGRAM_ID, base64::encode(std::vector<uint8_t>(165, 7)), false, 0};
+
+  AccountCache cache(&pool);
+  cache.update(pubkey, account, 10);
+  const AccountCache::Entry* entry = cache.get(pubkey);
+  ASSERT(entry->data.size() == 165 && entry->data[164] == 7);
+  ASSERT(entry->data.get_allocator().resource() == &pool);
+  ASSERT(resource.backing(entry->data.data()) != memory::Pages::HEAP);
+  cache.update(pubkey, account, 11);
+  ASSERT(cache.get(pubkey) == entry && entry->slot == 11);
+
+  ForkAwareAccountStore store(&pool);
+  store.update_slot({10, 9, 0});
+  store.update(pubkey, account, 10);
+  entry = store.get(pubkey, Commitment::Processed);
+  ASSERT(entry->data.get_allocator().resource() == &pool);
+  ASSERT(resource.backing(entry->data.data()) != memory::Pages::HEAP);
+
+  // A version decoded elsewhere is copied into the store's resource
+  store.update(pubkey, AccountCache::Entry{1, TOKEN_PROGRAM_ID, 10, {1, 2, 3}});
+  entry = store.get(pubkey, Commitment::Processed);
+  ASSERT(entry->lamports == 1 && entry->data.size() == 3);
+  ASSERT(entry->data.get_allocator().resource() == &pool);
+}
+
+TEST_CASE("Connection runs on buffers mapped with the buffer page options") {
+  mock::MockServer server;
+  memory::buffer_pages() = {true, true, false};
+  {
+    Connection connection(server.endpoint(), Commitment::Processed);
+    ASSERT(connection.get_slot().unwrap() > 0);
+    connection.keep_alive();
+    auto keypair = Keypair::generate();
+    connection.request_airdrop(keypair.public_key).unwrap();
+    ASSERT(connection.get_balance(keypair.public_key).unwrap() == LAMPORTS_PER_SOL);
+
+    uint64_t slot = 0;
+    connection.on_slot_change([&](Result<SlotInfo> result) { slot = result.unwrap().slot; });
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (slot == 0 && std::chrono::steady_clock::now() < deadline) {
+      connection.poll();
+    }
+    ASSERT(slot > 0);
+  }
+  memory::buffer_pages() = {};
+}
@@ -0,0 +1,62 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+#define USDC_MINT PublicKey("EPjFWdd5AufqSSqeM2qN1xzybapC8G4wEGGkZwyTDt1v")
+
+std::vector<uint8_t> token_account(const PublicKey& mint, uint64_t amount) {
+  std::vector<uint8_t> data(token::ACCOUNT_SIZE, 0);
+  memcpy(&data[0], mint.bytes.data(), PUBLIC_KEY_LENGTH);
+  memcpy(&data[64], &amount, 8);
+  return data;
+}
+
+TEST_CASE("Portfolio keeps totals per mint and notifies on threshold crossings") {
+  PublicKey account_1("8VBafTNv1F8k5Bg7DTVwhitw3MGAMTmekHsgLuMJxLC8");
+  PublicKey account_2("6Cust2JhvweKLh4CVo1dt21s2PJ86uNGkziudpkNPaCj");
+  PublicKey owner("CsfCXcswe5pjoW6M7rgAhXz1GRPAGAYsESozFFPg6AeY");
+
+  Portfolio portfolio;
+  std::vector<uint64_t> crossings;
+  portfolio.on_threshold(USDC_MINT, 1000, [&](const PublicKey& mint, uint64_t, uint64_t total) {
+    ASSERT(mint == USDC_MINT);
+    crossings.push_back(total);
+  });
+
+  auto data = token_account(USDC_MINT, 600);
+  portfolio.update_token_account(account_1, data.data(), data.size());
+  ASSERT(portfolio.total(USDC_MINT) == 600);
+  ASSERT(crossings.empty());
+
+  data = token_account(USDC_MINT, 500);
+  portfolio.update_token_account(account_2, data.data(), data.size());
+  ASSERT(portfolio.total(USDC_MINT) == 1100);
+  ASSERT(crossings.size() == 1 && crossings[0] == 1100);
+
+  data = token_account(USDC_MINT, 700);
+  portfolio.update_token_account(account_1, data.data(), data.size());
+  ASSERT(portfolio.total(USDC_MINT) == 1200);
+  ASSERT(crossings.size() == 1);
+
+  // Closing an account removes its amount
+  portfolio.update_token_account(account_1, nullptr, 0);
+  ASSERT(portfolio.total(USDC_MINT) == 500);
+  ASSERT(crossings.size() == 2 && crossings[1] == 500);
+
+  // Reopened for another mint
+  data = token_account(NATIVE_MINT, 5);
+  portfolio.update_token_account(account_2, data.data(), data.size());
+  ASSERT(portfolio.total(USDC_MINT) == 0);
+  ASSERT(portfolio.total(NATIVE_MINT) == 5);
+
+  portfolio.update_owner(owner, LAMPORTS_PER_SOL);
+  portfolio.update_owner(owner, 2 * LAMPORTS_PER_SOL);
+  ASSERT(portfolio.total(SYSTEM_PROGRAM) == 2 * LAMPORTS_PER_SOL);
+}
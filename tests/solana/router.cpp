@@ -0,0 +1,71 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+PublicKey key(uint8_t n) {
+  uint8_t bytes[PUBLIC_KEY_LENGTH];
+  memset(bytes, n, PUBLIC_KEY_LENGTH);
+  return PublicKey(bytes);
+}
+
+Account token_account(uint64_t amount) {
+  std::vector<uint8_t> data(token::ACCOUNT_SIZE, 0);
+  memcpy(&data[64], &amount, 8);
+  return Account{ 2039280, TOKEN_PROGRAM_ID, base64::encode(data), false, 0 };
+}
+
+amm::ConstantProductPool pool(uint8_t id, const PublicKey& mint_a, const PublicKey& mint_b, AccountCache& cache, uint64_t reserve_a, uint64_t reserve_b) {
+  amm::ConstantProductPool pool;
+  pool.token_a_mint = mint_a;
+  pool.token_b_mint = mint_b;
+  pool.token_a_vault = key(id + 100);
+  pool.token_b_vault = key(id + 200);
+  pool.fees = { 25, 10000, 0, 0 };
+  cache.update(pool.token_a_vault, token_account(reserve_a));
+  cache.update(pool.token_b_vault, token_account(reserve_b));
+  pool.update_reserves(cache);
+  return pool;
+}
+
+TEST_CASE("Router finds multi-hop routes and follows vault updates") {
+  PublicKey a = key(1), b = key(2), c = key(3), d = key(4);
+  AccountCache cache;
+  threading::ThreadPool threads(2);
+  amm::Router router(threads);
+  router.attach(cache);
+
+  // A -> B directly at 1:1, or A -> C -> B at 1:2 then 1:1
+  uint32_t direct = router.add_pool(key(11), pool(11, a, b, cache, 1000000000, 1000000000));
+  router.add_pool(key(12), pool(12, a, c, cache, 1000000000, 2000000000));
+  router.add_pool(key(13), pool(13, c, b, cache, 2000000000, 2000000000));
+  router.add_pool(key(14), pool(14, b, d, cache, 1000000000, 1000000000));
+  ASSERT(router.pool_count() == 4);
+  ASSERT(router.mint_count() == 4);
+
+  auto routes = router.search(a, b, 1000000, 5, 3, std::chrono::seconds(1));
+  ASSERT(routes.size() == 2);
+  ASSERT(routes[0].hops.size() == 2);
+  ASSERT(routes[0].amount_out > routes[1].amount_out);
+  ASSERT(routes[1].hops[0].pool == direct);
+  ASSERT(routes[1].amount_out == router.pool(direct).quote(1000000, true));
+
+  auto direct_only = router.search(a, b, 1000000, 5, 1, std::chrono::seconds(1));
+  ASSERT(direct_only.size() == 1);
+
+  // The direct pool becomes the better route once its B reserve grows
+  cache.update(key(11 + 200), token_account(3000000000));
+  routes = router.search(a, b, 1000000, 1, 3, std::chrono::seconds(1));
+  ASSERT(routes.size() == 1);
+  ASSERT(routes[0].hops.size() == 1);
+
+  routes = router.search(a, d, 1000000, 5, 3, std::chrono::seconds(1));
+  ASSERT(routes.size() == 2);
+  ASSERT(routes[0].hops.back().amount_out == routes[0].amount_out);
+}
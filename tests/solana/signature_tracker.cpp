@@ -0,0 +1,110 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+std::vector<SignatureStatus> statuses(const json& value) {
+  return json({{"result", {{"context", {{"slot", 100}}}, {"value", value}}}}).get<Result<std::vector<SignatureStatus>>>().unwrap();
+}
+
+TEST_CASE("SignatureStatus decodes known and unknown signatures") {
+  auto result = statuses(json::parse(R"([
+    null,
+    {"slot": 72, "confirmations": 10, "err": null, "confirmationStatus": "confirmed"},
+    {"slot": 48, "confirmations": null, "err": {"InstructionError": [0, {"Custom": 1}]}, "confirmationStatus": "finalized"}
+  ])"));
+  ASSERT(result.size() == 3);
+  ASSERT(!result[0].found);
+  ASSERT(result[1].found);
+  ASSERT(result[1].slot == 72);
+  ASSERT(result[1].confirmations == 10);
+  ASSERT(result[1].err.empty());
+  ASSERT(result[1].confirmation_status == Commitment::Confirmed);
+  ASSERT(!result[2].confirmations);
+  ASSERT(!result[2].err.empty());
+  ASSERT(result[2].confirmation_status == Commitment::Finalized);
+}
+
+TEST_CASE("SignatureTracker resolves, fails and expires signatures") {
+  SignatureTracker tracker;
+  std::vector<SignatureState> states;
+  auto landed = tracker.track("landed", 1000, Commitment::Confirmed, [&](const SignatureTracker::Update& update) {
+    states.push_back(update.state);
+  });
+  auto failed = tracker.track("failed", 1000);
+  auto expired = tracker.track("expired", 1000);
+  ASSERT(tracker.pending() == 3);
+
+  tracker.note_slot(72);
+  ASSERT(tracker.update({"landed", "failed", "expired"}, statuses(json::parse(R"([
+    {"slot": 72, "confirmations": 0, "err": null, "confirmationStatus": "processed"},
+    null,
+    null
+  ])"))));
+  ASSERT(tracker.state("landed") == SignatureState::Processed);
+  ASSERT(!tracker.update({"landed"}, statuses(json::parse(R"([
+    {"slot": 72, "confirmations": 0, "err": null, "confirmationStatus": "processed"}
+  ])"))));
+
+  ASSERT(!tracker.update_block_height(1000));
+  ASSERT(tracker.update({"landed", "failed"}, statuses(json::parse(R"([
+    {"slot": 72, "confirmations": 1, "err": null, "confirmationStatus": "confirmed"},
+    {"slot": 73, "confirmations": 0, "err": {"InstructionError": [0, {"Custom": 1}]}, "confirmationStatus": "processed"}
+  ])"))));
+  ASSERT(tracker.update_block_height(1001));
+  ASSERT(tracker.pending() == 0);
+
+  ASSERT((states == std::vector<SignatureState>{SignatureState::Processed, SignatureState::Confirmed}));
+  auto update = landed.get();
+  ASSERT(update.state == SignatureState::Confirmed);
+  ASSERT(update.slot == 72);
+  ASSERT(update.since_landed > std::chrono::nanoseconds::zero());
+  ASSERT(update.since_sent >= update.since_landed);
+
+  update = failed.get();
+  ASSERT(update.state == SignatureState::Failed);
+  ASSERT(update.slot == 73);
+  ASSERT(!update.err.empty());
+  ASSERT(update.since_landed == std::chrono::nanoseconds::zero());
+
+  update = expired.get();
+  ASSERT(update.state == SignatureState::Expired);
+  ASSERT(update.slot == 0);
+}
+
+TEST_CASE("SignatureTracker expires signatures processed on a dropped fork") {
+  SignatureTracker tracker;
+  std::vector<SignatureState> states;
+  auto dropped = tracker.track("dropped", 1000, Commitment::Finalized, [&](const SignatureTracker::Update& update) {
+    states.push_back(update.state);
+  });
+  auto confirmed = tracker.track("confirmed", 1000, Commitment::Finalized);
+  ASSERT(tracker.update({"dropped", "confirmed"}, statuses(json::parse(R"([
+    {"slot": 72, "confirmations": 0, "err": null, "confirmationStatus": "processed"},
+    {"slot": 73, "confirmations": 1, "err": null, "confirmationStatus": "confirmed"}
+  ])"))));
+
+  ASSERT(tracker.update_block_height(1001));
+  ASSERT(tracker.pending() == 1);
+  ASSERT((states == std::vector<SignatureState>{SignatureState::Processed, SignatureState::Expired}));
+  ASSERT(dropped.get().state == SignatureState::Expired);
+  ASSERT(tracker.state("confirmed") == SignatureState::Confirmed);
+}
+
+TEST_CASE("SignatureStatus decodes slots above INT_MAX") {
+  auto result = statuses(json::parse(R"([
+    {"slot": 5000000000, "confirmations": 0, "err": null, "confirmationStatus": "processed"}
+  ])"));
+  ASSERT(result[0].slot == 5000000000ULL);
+}
+
+TEST_CASE("Commitment serializes to its JSON name") {
+  ASSERT(json(Commitment::Processed) == "processed");
+  ASSERT(json(Commitment::Finalized) == "finalized");
+}
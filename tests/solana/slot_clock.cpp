@@ -0,0 +1,89 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+#define MS 1000000LL
+
+TEST_CASE("SlotClock extrapolates between notifications") {
+  SlotClock clock(400 * MS, 2, 0.5);
+  ASSERT(clock.estimate(0).slot == 0);
+
+  ASSERT(clock.update(1000, 10000 * MS));
+  ASSERT(!clock.update(999, 10100 * MS));
+  ASSERT(!clock.update(1000, 10100 * MS));
+
+  auto estimate = clock.estimate(10100 * MS);
+  ASSERT(estimate.slot == 1000);
+  ASSERT(estimate.progress_ns == 100 * MS);
+  ASSERT(estimate.slot_ns == 400 * MS);
+  ASSERT(clock.estimate(10500 * MS).slot == 1001);
+
+  // Bounded to two slots past the last notification
+  ASSERT(clock.estimate(20000 * MS).slot == 1002);
+  ASSERT(clock.estimate(20000 * MS).progress_ns == 0);
+}
+
+TEST_CASE("SlotClock measures the slot duration and stays monotonic") {
+  SlotClock clock(400 * MS, 2, 0.5);
+  clock.update(1000, 10000 * MS);
+
+  // Slots arrive every 300ms, the estimate lags behind and the rate speeds up
+  clock.update(1001, 10300 * MS);
+  ASSERT(clock.estimate(10300 * MS).slot == 1001);
+  ASSERT(clock.estimate(10300 * MS).slot_ns == 350 * MS);
+
+  // A late notification does not move the estimate backwards
+  clock.update(1002, 10600 * MS);
+  auto before = clock.estimate(11500 * MS);
+  ASSERT(before.slot == 1004);
+  clock.update(1003, 11500 * MS);
+  auto after = clock.estimate(11500 * MS);
+  ASSERT(after.slot == before.slot);
+  ASSERT(after.progress_ns >= before.progress_ns - 1);
+  ASSERT(clock.estimate(11600 * MS).slot == 1004);
+}
+
+TEST_CASE("SlotClock answers which leader is up after a delay") {
+  LeaderScheduleCache schedule;
+  schedule.set(1000, {
+    {"8VBafTNv1F8k5Bg7DTVwhitw3MGAMTmekHsgLuMJxLC8", {0, 1, 2, 3}},
+    {"6Cust2JhvweKLh4CVo1dt21s2PJ86uNGkziudpkNPaCj", {4, 5, 6, 7}},
+  });
+  ASSERT(schedule.contains(1007));
+  ASSERT(!schedule.contains(1008));
+
+  SlotClock clock;
+  clock.update(1002, SlotClock::now_ns());
+  ASSERT(clock.slot_in(std::chrono::milliseconds(0)) == 1002);
+  ASSERT(clock.slot_in(std::chrono::milliseconds(900)) == 1004);
+  ASSERT(clock.leader_in(schedule, std::chrono::milliseconds(0)) == PublicKey("8VBafTNv1F8k5Bg7DTVwhitw3MGAMTmekHsgLuMJxLC8"));
+  ASSERT(clock.leader_in(schedule, std::chrono::milliseconds(900)) == PublicKey("6Cust2JhvweKLh4CVo1dt21s2PJ86uNGkziudpkNPaCj"));
+  ASSERT(!clock.leader_in(schedule, std::chrono::seconds(10)));
+}
+
+TEST_CASE("SlotClock can be read while it is updated") {
+  SlotClock clock;
+  std::atomic<bool> done(false);
+  std::thread reader([&]() {
+    uint64_t previous = 0;
+    while (!done) {
+      auto estimate = clock.now();
+      ASSERT(estimate.slot >= previous);
+      ASSERT(estimate.slot == 0 || estimate.slot_ns > 0);
+      previous = estimate.slot;
+    }
+  });
+  int64_t start = SlotClock::now_ns();
+  for (uint64_t slot = 1; slot <= 10000; slot++) {
+    clock.update(slot, start + (int64_t)slot * 1000);
+  }
+  done = true;
+  reader.join();
+}
@@ -0,0 +1,45 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+TEST_CASE("SysvarCache computes rent exemption and time locally") {
+  SysvarCache cache;
+  ASSERT(!cache.ready());
+
+  std::vector<uint8_t> rent(sysvar::Rent::SIZE);
+  uint64_t lamports_per_byte_year = 3480;
+  double exemption_threshold = 2.0;
+  memcpy(&rent[0], &lamports_per_byte_year, 8);
+  memcpy(&rent[8], &exemption_threshold, 8);
+  rent[16] = 50;
+  ASSERT(!cache.update_rent(rent.data(), rent.size() - 1));
+  ASSERT(cache.update_rent(rent.data(), rent.size()));
+  ASSERT(cache.rent().burn_percent == 50);
+  ASSERT(cache.minimum_balance_for_rent_exemption(0) == 890880);
+  ASSERT(cache.minimum_balance_for_rent_exemption(token::ACCOUNT_SIZE) == 2039280);
+
+  std::vector<uint8_t> clock(sysvar::Clock::SIZE);
+  uint64_t fields[5] = {250000000, 1700000000, 580, 581, 1700100000};
+  memcpy(clock.data(), fields, sizeof(fields));
+  ASSERT(cache.update_clock(clock.data(), clock.size()));
+  ASSERT(cache.ready());
+  ASSERT(cache.clock().slot == 250000000);
+  ASSERT(cache.clock().epoch_start_timestamp == 1700000000);
+  ASSERT(cache.clock().leader_schedule_epoch == 581);
+  ASSERT(cache.epoch() == 580);
+  ASSERT(cache.unix_timestamp() >= 1700100000);
+  ASSERT(cache.unix_timestamp() <= 1700100001);
+}
+
+TEST_CASE("Transaction fee") {
+  ASSERT(sysvar::transaction_fee(1) == 5000);
+  ASSERT(sysvar::transaction_fee(2, 200000, 10000) == 12000);
+  ASSERT(sysvar::transaction_fee(1, 1, 1) == 5001);
+}
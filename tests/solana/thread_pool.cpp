@@ -0,0 +1,62 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+TEST_CASE("ThreadPool runs every submitted task, including tasks submitted by tasks") {
+  std::atomic<int> done{0};
+  {
+    threading::ThreadPool pool(4);
+    for (int i = 0; i < 100; i++) {
+      pool.submit([&pool, &done]() {
+        for (int j = 0; j < 10; j++) {
+          pool.submit([&done]() { done++; });
+        }
+        done++;
+      });
+    }
+    // The destructor runs the queued tasks before joining the workers
+  }
+  ASSERT(done == 100 * 11);
+}
+
+TEST_CASE("ThreadPool idle workers steal tasks queued by a busy worker") {
+  threading::ThreadPool pool(4);
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  std::atomic<int> done{0};
+
+  // All tasks are queued on the worker running the first task, the others can only get them by stealing
+  pool.submit([&]() {
+    for (int i = 0; i < 64; i++) {
+      pool.submit([&]() {
+        usleep(1000);
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          threads.insert(std::this_thread::get_id());
+        }
+        done++;
+      });
+    }
+  });
+  while (done < 64) {
+    usleep(1000);
+  }
+  ASSERT(pool.steals() > 0);
+  ASSERT(threads.size() > 1);
+}
+
+TEST_CASE("ThreadPool parallel_for visits every index once") {
+  threading::ThreadPool pool(3);
+  std::vector<std::atomic<int>> visits(1000);
+  pool.parallel_for(visits.size(), [&](size_t i) { visits[i]++; });
+  for (auto& count : visits) {
+    ASSERT(count == 1);
+  }
+}
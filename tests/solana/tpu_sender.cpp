@@ -0,0 +1,93 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+#define LEADER_A "8VBafTNv1F8k5Bg7DTVwhitw3MGAMTmekHsgLuMJxLC8"
+#define LEADER_B "6Cust2JhvweKLh4CVo1dt21s2PJ86uNGkziudpkNPaCj"
+#define LEADER_C "CsfCXcswe5pjoW6M7rgAhXz1GRPAGAYsESozFFPg6AeY"
+
+TEST_CASE("udp::parse_address") {
+  sockaddr_in sockaddr;
+  ASSERT(udp::parse_address("127.0.0.1:8001", sockaddr));
+  ASSERT(ntohs(sockaddr.sin_port) == 8001);
+  ASSERT(!udp::parse_address("127.0.0.1", sockaddr));
+  ASSERT(!udp::parse_address("localhost:8001", sockaddr));
+  ASSERT(!udp::parse_address("127.0.0.1:65536", sockaddr));
+  ASSERT(!udp::parse_address("127.0.0.1:", sockaddr));
+}
+
+TEST_CASE("TpuSender sends to the TPU of the current and next leaders") {
+  udp::UdpSocket sink;
+  ASSERT(sink.bind("127.0.0.1:0"));
+  std::string sink_address = "127.0.0.1:" + std::to_string(sink.port());
+
+  TpuSender sender(3);
+  ASSERT(sender.needs_schedule());
+  sender.set_schedule(1000, {
+    {LEADER_A, {0, 1, 2, 3, 12, 13, 14, 15}},
+    {LEADER_B, {4, 5, 6, 7}},
+    {LEADER_C, {8, 9, 10, 11}},
+  });
+  ClusterNode node_a{};
+  node_a.pubkey = PublicKey(LEADER_A);
+  node_a.tpu = sink_address;
+  ClusterNode node_c{};
+  node_c.pubkey = PublicKey(LEADER_C);
+  sender.set_cluster_nodes({node_a, node_c});
+  ASSERT(sender.set_tpu(PublicKey(LEADER_B), sink_address));
+
+  sender.set_slot(1006);
+  sender.set_slot(1002);
+  ASSERT(sender.slot() == 1006);
+  ASSERT(!sender.needs_schedule());
+  ASSERT(sender.leader(1006) == PublicKey(LEADER_B));
+  ASSERT(sender.leader(1012) == PublicKey(LEADER_A));
+  ASSERT(!sender.leader(999));
+  ASSERT(!sender.leader(1016));
+
+  auto leaders = sender.upcoming_leaders(3);
+  ASSERT(leaders.size() == 3);
+  ASSERT(leaders[0].first == 1006);
+  ASSERT(leaders[0].second == PublicKey(LEADER_B));
+  ASSERT(leaders[1].first == 1008);
+  ASSERT(leaders[2].first == 1012);
+
+  std::vector<uint8_t> transaction(200, 42);
+  ASSERT(sender.send(transaction) == 2);
+
+  uint8_t buffer[PACKET_DATA_SIZE];
+  int received = 0;
+  for (int i = 0; i < 100 && received < 2; i++) {
+    ssize_t length = sink.receive(buffer, sizeof(buffer));
+    if (length < 0) {
+      usleep(1000);
+      continue;
+    }
+    ASSERT(length == 200);
+    ASSERT(buffer[0] == 42);
+    received++;
+  }
+  ASSERT(received == 2);
+
+  auto& log = sender.log();
+  ASSERT(log.size() == 3);
+  ASSERT(log[0].leader == PublicKey(LEADER_B));
+  ASSERT(log[0].tpu == sink_address);
+  ASSERT(log[0].ok);
+  ASSERT(log[1].leader == PublicKey(LEADER_C));
+  ASSERT(log[1].tpu.empty());
+  ASSERT(!log[1].ok);
+  ASSERT(sender.stats().at(PublicKey(LEADER_A)).bytes == 200);
+  ASSERT(sender.stats().at(PublicKey(LEADER_C)).failures == 1);
+
+  sender.set_slot(1016);
+  ASSERT(sender.needs_schedule());
+  ASSERT(sender.send(transaction) == 0);
+}
@@ -0,0 +1,243 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+const PublicKey ADDRESS("11111111111111111111111111111111");
+
+/** A history of `count` transactions, one every two slots and one second apart, starting at slot 1000 and time 5000 */
+std::vector<SignatureInfo> history(size_t count) {
+  std::vector<SignatureInfo> signatures;
+  for (size_t i = 0; i < count; i++) {
+    SignatureInfo info{};
+    info.signature = "sig" + std::to_string(i);
+    info.slot = 1000 + 2 * i;
+    info.block_time = 5000 + (int64_t)i;
+    signatures.push_back(info);
+  }
+  return signatures;
+}
+
+/** Serves pages of the history newest first, as getSignaturesForAddress does */
+TransactionBackfill::PageFunction pages_of(const std::vector<SignatureInfo>& signatures, size_t page_size, std::atomic<int>& requests) {
+  return [signatures, page_size, &requests](const PublicKey&, const std::string& before) {
+    requests++;
+    size_t end = signatures.size();
+    for (size_t i = 0; i < signatures.size(); i++) {
+      if (signatures[i].signature == before) {
+        end = i;
+      }
+    }
+    std::vector<SignatureInfo> page;
+    for (size_t i = end; i > 0 && page.size() < page_size; i--) {
+      page.push_back(signatures[i - 1]);
+    }
+    return Result<std::vector<SignatureInfo>>(page);
+  };
+}
+
+json transaction_json(const std::string& signature, uint64_t slot) {
+  return {
+    {"slot", slot},
+    {"blockTime", 5000},
+    {"transaction", {
+      {"signatures", {signature}},
+      {"message", {
+        {"accountKeys", {"11111111111111111111111111111111"}},
+        {"header", {{"numRequiredSignatures", 1}, {"numReadonlySignedAccounts", 0}, {"numReadonlyUnsignedAccounts", 0}}},
+        {"instructions", {{{"programIdIndex", 0}, {"accounts", json::array()}, {"data", "StV1DL6CwTryKyV"}}}},
+        {"recentBlockhash", "11111111111111111111111111111111"},
+      }},
+    }},
+    {"meta", {
+      {"err", nullptr},
+      {"fee", 5000},
+      {"innerInstructions", json::array()},
+      {"logMessages", json::array()},
+      {"preBalances", {10}},
+      {"postBalances", {5}},
+      {"preTokenBalances", json::array()},
+      {"postTokenBalances", {{{"accountIndex", 0}, {"mint", "11111111111111111111111111111111"}, {"uiTokenAmount", {{"amount", "42"}, {"decimals", 6}}}}}},
+      {"rewards", nullptr},
+    }},
+  };
+}
+
+/** Answers batches with one response per request, in reverse order and after a delay */
+json respond(const json& batch) {
+  json responses = json::array();
+  for (auto& request : batch) {
+    std::string signature = request["params"][0].get<std::string>();
+    uint64_t slot = 1000 + 2 * std::stoull(signature.substr(3));
+    responses.push_back({
+      {"jsonrpc", "2.0"},
+      {"id", request["id"]},
+      {"result", transaction_json(signature, slot)},
+    });
+  }
+  std::reverse(responses.begin(), responses.end());
+  usleep(1000 + rand() % 3000);
+  return responses;
+}
+
+TEST_CASE("TransactionBackfill pages the range and emits it in ascending slot order") {
+  threading::ThreadPool pool(4);
+  std::atomic<int> page_requests{0};
+  std::atomic<int> in_flight{0};
+  std::atomic<int> max_in_flight{0};
+  TransactionBackfill backfill(pages_of(history(500), 100, page_requests), [&](const json& batch) {
+    int current = ++in_flight;
+    int seen = max_in_flight.load();
+    while (current > seen && !max_in_flight.compare_exchange_weak(seen, current)) {
+    }
+    ASSERT(batch.is_array() && batch.size() <= 8);
+    ASSERT(batch[0]["method"] == "getTransaction");
+    ASSERT(batch[0]["params"][1]["maxSupportedTransactionVersion"] == 0);
+    json responses = respond(batch);
+    in_flight--;
+    return responses;
+  }, pool, 4, 8, 64);
+
+  // Transactions 100 to 399 fall in the range, so the paging stops on the page holding transaction 99
+  std::vector<TransactionBackfill::Item> items;
+  size_t emitted = backfill.run(ADDRESS, 5100, 5399, [&](const TransactionBackfill::Item& item) {
+    items.push_back(item);
+  });
+
+  ASSERT(emitted == 300);
+  ASSERT(items.size() == 300);
+  ASSERT(page_requests == 5);
+  ASSERT(max_in_flight <= 4);
+  ASSERT(max_in_flight > 1);
+  for (size_t i = 0; i < items.size(); i++) {
+    ASSERT(items[i].signature.signature == "sig" + std::to_string(100 + i));
+    ASSERT(items[i].transaction.ok());
+    ASSERT(items[i].transaction._result->slot == items[i].signature.slot);
+    ASSERT(items[i].transaction._result->transaction.signatures[0] == items[i].signature.signature);
+    ASSERT(items[i].transaction._result->meta.post_token_balances[0].amount == 42);
+    ASSERT(items[i].transaction._result->transaction.message.instructions[0].data == std::vector<uint8_t>({'h', 'e', 'l', 'l', 'o', ' ', 'w', 'o', 'r', 'l', 'd'}));
+    ASSERT(items[i].raw["slot"] == items[i].signature.slot);
+  }
+
+  auto stats = backfill.stats();
+  ASSERT(stats.signatures.requests == 5);
+  ASSERT(stats.signatures.items == 500);
+  ASSERT(stats.fetch.items == 300);
+  ASSERT(stats.fetch.requests >= 300 / 8);
+  ASSERT(stats.fetch.errors == 0);
+  ASSERT(stats.fetch.max_latency >= std::chrono::milliseconds(1));
+  ASSERT(stats.fetch.mean_latency() <= stats.fetch.max_latency);
+  ASSERT(stats.fetch.throughput() > 0);
+  ASSERT(stats.decode.items == 300 && stats.decode.requests == 300 && stats.decode.errors == 0);
+  ASSERT(stats.emit.items == 300);
+}
+
+TEST_CASE("TransactionBackfill stalls fetching while the consumer is behind by a window") {
+  threading::ThreadPool pool(2);
+  std::atomic<int> page_requests{0};
+  std::atomic<size_t> fetched{0};
+  std::atomic<size_t> emitted{0};
+  std::atomic<size_t> max_ahead{0};
+  const size_t window = 32;
+  TransactionBackfill backfill(pages_of(history(200), 1000, page_requests), [&](const json& batch) {
+    size_t ahead = (fetched += batch.size()) - emitted;
+    size_t seen = max_ahead.load();
+    while (ahead > seen && !max_ahead.compare_exchange_weak(seen, ahead)) {
+    }
+    return respond(batch);
+  }, pool, 4, 8, window);
+
+  backfill.run(ADDRESS, 0, INT64_MAX, [&](const TransactionBackfill::Item&) {
+    emitted++;
+    usleep(200);
+  });
+
+  ASSERT(emitted == 200);
+  ASSERT(fetched == 200);
+  ASSERT(max_ahead <= window);
+  ASSERT(max_ahead >= 8);
+}
+
+TEST_CASE("TransactionBackfill retries failed batches and emits what cannot be fetched as errors") {
+  threading::ThreadPool pool(2);
+  std::atomic<int> page_requests{0};
+  std::mutex mutex;
+  std::map<std::string, int> attempts;
+  TransactionBackfill backfill(pages_of(history(40), 1000, page_requests), [&](const json& batch) {
+    std::string first = batch[0]["params"][0].get<std::string>();
+    int attempt;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      attempt = ++attempts[first];
+    }
+    // The batch starting with sig0 fails once, the one with sig10 always, sig25 is unknown to the node
+    if ((first == "sig0" && attempt == 1) || first == "sig10") {
+      throw std::runtime_error("connection reset");
+    }
+    json responses = respond(batch);
+    for (auto& response : responses) {
+      if (response["id"] == 25) {
+        response["result"] = nullptr;
+      }
+    }
+    return responses;
+  }, pool, 2, 10, 1000);
+
+  std::stringstream out;
+  auto write = TransactionBackfill::write_to(out);
+  std::vector<TransactionBackfill::Item> items;
+  backfill.run(ADDRESS, 0, INT64_MAX, [&](const TransactionBackfill::Item& item) {
+    items.push_back(item);
+    write(item);
+  });
+
+  ASSERT(items.size() == 40);
+  ASSERT(attempts["sig0"] == 2);
+  ASSERT(attempts["sig10"] == TransactionBackfill::MAX_FETCH_ATTEMPTS);
+  for (size_t i = 0; i < items.size(); i++) {
+    bool failed = (i >= 10 && i < 20) || i == 25;
+    ASSERT(items[i].transaction.ok() == !failed);
+    ASSERT(!failed || items[i].transaction._error);
+  }
+  ASSERT(items[25].raw.is_null());
+
+  auto stats = backfill.stats();
+  ASSERT(stats.fetch.errors == 1 + TransactionBackfill::MAX_FETCH_ATTEMPTS);
+  ASSERT(stats.decode.errors == 11);
+
+  std::string line;
+  size_t lines = 0;
+  while (std::getline(out, line)) {
+    json j = json::parse(line);
+    ASSERT(j["signature"] == "sig" + std::to_string(lines));
+    ASSERT(j["slot"] == 1000 + 2 * lines);
+    lines++;
+  }
+  ASSERT(lines == 40);
+}
+
+TEST_CASE("TransactionBackfill stops the fetch threads when the callback throws") {
+  threading::ThreadPool pool(2);
+  std::atomic<int> page_requests{0};
+  TransactionBackfill backfill(pages_of(history(100), 1000, page_requests), respond, pool, 2, 4, 8);
+
+  size_t calls = 0;
+  bool thrown = false;
+  try {
+    backfill.run(ADDRESS, 0, INT64_MAX, [&](const TransactionBackfill::Item&) {
+      if (++calls == 10) {
+        throw std::runtime_error("disk full");
+      }
+    });
+  } catch (const std::runtime_error& e) {
+    thrown = std::string(e.what()) == "disk full";
+  }
+  ASSERT(thrown);
+  ASSERT(backfill.stats().fetch.items < 100);
+}
@@ -0,0 +1,144 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/solana.hpp"
+
+using namespace solana;
+
+std::vector<uint8_t> signed_transaction(uint8_t seed) {
+  std::vector<uint8_t> transaction(1 + 64 + 32, seed);
+  transaction[0] = 1;
+  return transaction;
+}
+
+std::vector<SignatureStatus> landed_at(uint64_t slot, Commitment commitment) {
+  SignatureStatus status{};
+  status.found = true;
+  status.slot = slot;
+  status.confirmation_status = commitment;
+  return {status};
+}
+
+std::vector<SignatureStatus> processed(uint64_t slot) {
+  return landed_at(slot, Commitment::Processed);
+}
+
+TEST_CASE("TransactionSender fans out, rebroadcasts and stops once landed or expired") {
+  threading::ThreadPool pool(6);
+  SignatureTracker tracker;
+  std::atomic<int> sends[3] = {{0}, {0}, {0}};
+  TransactionSender sender({"a", "b", "c"}, [&](size_t endpoint, const std::string& signed_transaction) {
+    ASSERT(base64::decode(signed_transaction).size() == 1 + 64 + 32);
+    sends[endpoint]++;
+    if (endpoint == 2) {
+      return Result<std::string>(ResultError{-32002, "Transaction simulation failed"});
+    }
+    if (endpoint == 0) {
+      usleep(20000);
+    }
+    return Result<std::string>(std::string("signature"));
+  }, tracker, pool, std::chrono::milliseconds(0));
+
+  auto landing = signed_transaction(7);
+  auto expiring = signed_transaction(9);
+  std::string landing_signature = TransactionSender::signature_of(landing);
+  ASSERT(landing_signature == base58::encode(std::string(64, 7)));
+
+  std::vector<SignatureState> states;
+  auto landed = sender.send(landing, 1000, Commitment::Processed, [&](const SignatureTracker::Update& update) {
+    states.push_back(update.state);
+  });
+  auto expired = sender.send(expiring, 1000);
+  ASSERT(sender.pending() == 2);
+  ASSERT(sender.broadcasts(landing_signature) == 1);
+
+  sender.wait();
+  ASSERT(sender.poll() == 2);
+  ASSERT(sender.broadcasts(landing_signature) == 2);
+  sender.wait();
+
+  tracker.update({landing_signature}, processed(50));
+  ASSERT(landed.get().state == SignatureState::Processed);
+  ASSERT((states == std::vector<SignatureState>{SignatureState::Processed}));
+  ASSERT(sender.pending() == 1);
+  ASSERT(sender.broadcasts(landing_signature) == 0);
+
+  ASSERT(sender.poll() == 1);
+  sender.wait();
+  tracker.update_block_height(1001);
+  ASSERT(expired.get().state == SignatureState::Expired);
+  ASSERT(sender.pending() == 0);
+  ASSERT(sender.poll() == 0);
+
+  auto stats = sender.stats();
+  ASSERT(stats.size() == 3);
+  ASSERT(stats[0].endpoint == "a");
+  for (int i = 0; i < 3; i++) {
+    ASSERT(stats[i].sends == 5);
+    ASSERT(sends[i] == 5);
+  }
+  ASSERT(stats[2].errors == 5);
+  ASSERT(stats[2].acked == 0);
+  ASSERT(stats[2].mean_first_ack_latency() == std::chrono::nanoseconds::zero());
+  ASSERT(stats[0].acked == 2);
+  ASSERT(stats[1].acked == 2);
+  ASSERT(stats[0].first_acks + stats[1].first_acks == 2);
+  ASSERT(stats[1].landed_via == 1);
+  ASSERT(stats[0].landed_via == 0);
+  ASSERT(stats[0].mean_first_ack_latency() >= std::chrono::milliseconds(20));
+}
+
+TEST_CASE("TransactionSender keeps rebroadcasting a processed transaction until it is confirmed") {
+  threading::ThreadPool pool(2);
+  SignatureTracker tracker;
+  TransactionSender sender({"a", "b"}, [&](size_t, const std::string&) {
+    return Result<std::string>(std::string("signature"));
+  }, tracker, pool, std::chrono::milliseconds(0));
+
+  auto transaction = signed_transaction(11);
+  std::string signature = TransactionSender::signature_of(transaction);
+  auto confirmed = sender.send(transaction, 1000, Commitment::Confirmed);
+  sender.wait();
+
+  tracker.update({signature}, processed(50));
+  ASSERT(sender.pending() == 1);
+  ASSERT(sender.poll() == 1);
+  ASSERT(sender.broadcasts(signature) == 2);
+  sender.wait();
+
+  tracker.update({signature}, landed_at(50, Commitment::Confirmed));
+  ASSERT(confirmed.get().state == SignatureState::Confirmed);
+  ASSERT(sender.pending() == 0);
+  ASSERT(sender.poll() == 0);
+
+  auto stats = sender.stats();
+  ASSERT(stats[0].landed_via + stats[1].landed_via == 1);
+}
+
+TEST_CASE("TransactionSender can be destroyed before its transactions resolve") {
+  threading::ThreadPool pool(2);
+  SignatureTracker tracker;
+  auto transaction = signed_transaction(13);
+  std::string signature = TransactionSender::signature_of(transaction);
+  std::vector<SignatureState> states;
+  std::future<SignatureTracker::Update> confirmed;
+  {
+    TransactionSender sender({"a"}, [&](size_t, const std::string&) {
+      return Result<std::string>(std::string("signature"));
+    }, tracker, pool);
+    confirmed = sender.send(transaction, 1000, Commitment::Confirmed, [&](const SignatureTracker::Update& update) {
+      states.push_back(update.state);
+    });
+  }
+
+  ASSERT(tracker.pending() == 1);
+  tracker.update({signature}, processed(50));
+  tracker.update({signature}, landed_at(50, Commitment::Confirmed));
+  ASSERT(confirmed.get().state == SignatureState::Confirmed);
+  ASSERT((states == std::vector<SignatureState>{SignatureState::Processed, SignatureState::Confirmed}));
+  ASSERT(tracker.pending() == 0);
+}
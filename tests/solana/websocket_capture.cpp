@@ -0,0 +1,138 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../doctest.h"
+
+#include "../../src/json.hpp"
+
+using json = nlohmann::json;
+
+#include "../../src/mock_server.hpp"
+
+using namespace solana;
+
+const std::string CAPTURE = "/tmp/websocket_capture_test.cap";
+
+struct Notifications {
+  std::vector<uint64_t> slots;
+  std::vector<uint64_t> lamports;
+};
+
+/** Adds the listeners of the test in the same order for the recording and the replays */
+void listen(Connection& connection, const PublicKey& account, Notifications& notifications) {
+  connection.on_slot_change([&notifications](Result<SlotInfo> result) {
+    notifications.slots.push_back(result.unwrap().slot);
+  });
+  connection.on_account_change(account, [&notifications](Result<Account> result) {
+    notifications.lamports.push_back(result.unwrap().lamports);
+  });
+}
+
+/** Records notifications from the mock server until there are enough, returns the recorded span in nanoseconds */
+int64_t record(const PublicKey& account, Notifications& recorded) {
+  mock::MockServer::Config config;
+  config.slot_interval = std::chrono::milliseconds(5);
+  config.account_changes_per_second = 200;
+  mock::MockServer server(config);
+
+  Connection connection(server.endpoint(), Commitment::Processed);
+  int64_t start = websockets::capture::now();
+  connection.record(CAPTURE);
+  listen(connection, account, recorded);
+  while (recorded.slots.size() < 30 || recorded.lamports.size() < 15) {
+    connection.poll();
+    usleep(200);
+  }
+  connection.stop_recording();
+  int64_t end = websockets::capture::now();
+
+  // The capture holds the subscribe requests then the reads, with kernel timestamps within the recording
+  websockets::capture::Reader reader(CAPTURE);
+  websockets::capture::Record record;
+  std::vector<std::string> methods;
+  int64_t first = 0, last = 0;
+  size_t reads = 0;
+  while (reader.next(record)) {
+    if (record.type == websockets::capture::SUBSCRIBED) {
+      methods.push_back(json::parse(record.data)["method"]);
+      continue;
+    }
+    ASSERT(record.type == websockets::capture::RECEIVED);
+    ASSERT(record.timestamp >= start && record.timestamp <= end);
+    ASSERT(record.timestamp >= last);
+    first = first == 0 ? record.timestamp : first;
+    last = record.timestamp;
+    reads++;
+  }
+  ASSERT(methods == std::vector<std::string>({"slotSubscribe", "accountSubscribe"}));
+  ASSERT(reads >= 2);
+  return last - first;
+}
+
+/** Replays the capture and returns the wall time it took */
+std::chrono::nanoseconds replay(const PublicKey& account, double speed, Notifications& replayed) {
+  // Nothing listens on the endpoint, the replay never touches the network
+  Connection connection("http://127.0.0.1:1", Commitment::Processed);
+  auto start = std::chrono::steady_clock::now();
+  connection.replay(CAPTURE, speed);
+  listen(connection, account, replayed);
+  while (connection.is_replaying()) {
+    connection.poll();
+  }
+  ASSERT(!connection.is_connected());
+  return std::chrono::steady_clock::now() - start;
+}
+
+TEST_CASE("WebSocketClient replays a capture through the same dispatch at recorded, maximum and multiplied speed") {
+  auto account = Keypair::generate().public_key;
+  Notifications recorded;
+  int64_t span = record(account, recorded);
+  ASSERT(span > 100000000);
+
+  Notifications fastest;
+  replay(account, 0, fastest);
+  ASSERT(fastest.slots == recorded.slots);
+  ASSERT(fastest.lamports == recorded.lamports);
+
+  Notifications real_time;
+  auto elapsed = replay(account, 1, real_time);
+  ASSERT(real_time.slots == recorded.slots);
+  ASSERT(elapsed.count() >= span);
+
+  Notifications faster;
+  elapsed = replay(account, 4, faster);
+  ASSERT(faster.lamports == recorded.lamports);
+  ASSERT(elapsed.count() >= span / 4);
+  ASSERT(elapsed.count() < span / 2);
+
+  unlink(CAPTURE.c_str());
+}
+
+TEST_CASE("WebSocketClient capture files round trip and reject other files") {
+  int64_t now = websockets::capture::now();
+  {
+    websockets::capture::Writer writer(CAPTURE);
+    writer.write(websockets::capture::SUBSCRIBED, now + 1000, "{}", 2);
+    writer.write(websockets::capture::RECEIVED, now + 123456789, "\x81\x02{}", 4);
+    // An earlier timestamp is recorded as the previous one
+    writer.write(websockets::capture::RECEIVED, now + 5000, "", 0);
+    ASSERT(writer.records() == 3);
+  }
+  websockets::capture::Reader reader(CAPTURE);
+  websockets::capture::Record record;
+  ASSERT(reader.next(record));
+  ASSERT(record.type == websockets::capture::SUBSCRIBED && record.data == "{}" && record.timestamp >= now + 1000);
+  ASSERT(reader.next(record));
+  ASSERT(record.timestamp == now + 123456789 && record.data == std::string("\x81\x02{}", 4));
+  ASSERT(reader.next(record));
+  ASSERT(record.timestamp == now + 123456789 && record.data.empty());
+  ASSERT(!reader.next(record));
+
+  std::ofstream(CAPTURE) << "not a capture";
+  bool thrown = false;
+  try {
+    websockets::capture::Reader other(CAPTURE);
+  } catch (const std::runtime_error& e) {
+    thrown = true;
+  }
+  ASSERT(thrown);
+  unlink(CAPTURE.c_str());
+}